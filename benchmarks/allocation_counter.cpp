@@ -0,0 +1,100 @@
+#include "allocation_counter.h"
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// The benchmarks are single-threaded, so plain counters suffice.
+uint64_t allocationCount = 0;
+uint64_t allocatedBytes = 0;
+
+void* allocate(std::size_t size) {
+    allocationCount++;
+    allocatedBytes += size;
+    if (void* pointer = std::malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    allocationCount++;
+    allocatedBytes += size;
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    allocationCount++;
+    allocatedBytes += size;
+    return std::malloc(size ? size : 1);
+}
+
+// Memory resources allocate with an explicit alignment
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    allocationCount++;
+    allocatedBytes += size;
+    std::size_t align = static_cast<std::size_t>(alignment);
+    if (void* pointer = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+namespace msl_parser {
+namespace bench {
+
+AllocationTotals allocationTotals() {
+    AllocationTotals totals;
+    totals.count = allocationCount;
+    totals.bytes = allocatedBytes;
+    return totals;
+}
+
+} // namespace bench
+} // namespace msl_parser
@@ -0,0 +1,21 @@
+#ifndef MSL_PARSER_BENCH_ALLOCATION_COUNTER_H
+#define MSL_PARSER_BENCH_ALLOCATION_COUNTER_H
+
+#include <cstdint>
+
+namespace msl_parser {
+namespace bench {
+
+// Totals of every global operator new call made by the benchmark binary
+// (allocation_counter.cpp replaces the global allocation functions).
+struct AllocationTotals {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+AllocationTotals allocationTotals();
+
+} // namespace bench
+} // namespace msl_parser
+
+#endif // MSL_PARSER_BENCH_ALLOCATION_COUNTER_H
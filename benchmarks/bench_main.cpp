@@ -0,0 +1,342 @@
+// Lexer and parser throughput benchmarks over the generated corpus.
+//
+// For every corpus input this runs three benchmarks:
+//   lex        Lexer::scanTokens
+//   parse      Parser::parse on pre-scanned tokens (AST construction)
+//   lex+parse  both, as a client would run them
+// and reports MB/s, tokens/s, AST nodes/s and heap allocations per KB of
+// input. Time spent destroying the results is not measured.
+//
+// Each benchmark is repeated (--repetitions) and the median throughput is
+// reported with a 95% confidence interval. --json writes the results for
+// msl_parser_bench_compare, together with the time of a fixed calibration
+// workload that lets results from different machines be compared.
+//
+// Usage: msl_parser_bench [--filter=SUBSTRING] [--min-time=SECONDS]
+//                         [--repetitions=N] [--json=FILE] [--list]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "allocation_counter.h"
+#include "corpus.h"
+#include "msl_parser/ast/recursive_visitor.h"
+#include "msl_parser/lexer.h"
+#include "msl_parser/parser.h"
+
+using namespace msl_parser;
+
+namespace {
+
+#ifndef MSL_PARSER_BENCH_BUILD_TYPE
+#define MSL_PARSER_BENCH_BUILD_TYPE ""
+#endif
+
+struct Options {
+    std::string filter;
+    std::string jsonPath;
+    double minTime = 0.5;
+    int repetitions = 1;
+    bool list = false;
+};
+
+struct Measurement {
+    size_t iterations = 0;
+    double seconds = 0;
+    uint64_t allocations = 0;
+};
+
+struct Result {
+    std::string name;
+    size_t bytes = 0;
+    size_t tokens = 0;
+    size_t nodes = 0;
+    double allocationsPerKB = 0;
+    std::vector<double> throughput; // MB/s of each repetition
+    double median = 0;
+    double low = 0; // 95% confidence interval of the median
+    double high = 0;
+};
+
+class NodeCounter : public ast::RecursiveASTVisitor {
+public:
+    size_t count = 0;
+
+protected:
+    void visitNode(ast::ASTNode*) override { count++; }
+};
+
+// Runs `body` until at least `minTime` seconds have been measured (and at
+// least once). The value `body` returns is destroyed outside the timed
+// region.
+template <typename Body>
+Measurement measure(double minTime, Body body) {
+    Measurement measurement;
+    do {
+        bench::AllocationTotals before = bench::allocationTotals();
+        auto begin = std::chrono::steady_clock::now();
+        auto result = body();
+        auto end = std::chrono::steady_clock::now();
+        bench::AllocationTotals after = bench::allocationTotals();
+
+        measurement.iterations++;
+        measurement.seconds += std::chrono::duration<double>(end - begin).count();
+        measurement.allocations += after.count - before.count;
+    } while (measurement.seconds < minTime);
+    return measurement;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (std::strncmp(arg, "--filter=", 9) == 0) {
+            options.filter = arg + 9;
+        } else if (std::strncmp(arg, "--min-time=", 11) == 0) {
+            options.minTime = std::atof(arg + 11);
+        } else if (std::strncmp(arg, "--repetitions=", 14) == 0) {
+            options.repetitions = std::max(1, std::atoi(arg + 14));
+        } else if (std::strncmp(arg, "--json=", 7) == 0) {
+            options.jsonPath = arg + 7;
+        } else if (std::strcmp(arg, "--list") == 0) {
+            options.list = true;
+        } else {
+            std::fprintf(stderr,
+                         "usage: %s [--filter=SUBSTRING] [--min-time=SECONDS] "
+                         "[--repetitions=N] [--json=FILE] [--list]\n",
+                         argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// The corpus must be valid input, otherwise error recovery would be timed
+// instead of parsing.
+bool checkInput(const bench::CorpusInput& input) {
+    DiagnosticEngine diagnostics;
+    Lexer lexer(input.source, &diagnostics);
+    auto tokens = lexer.scanTokens();
+    Parser parser(tokens, &diagnostics);
+    parser.parse();
+    if (diagnostics.getDiagnostics().empty()) {
+        return true;
+    }
+    std::fprintf(stderr, "corpus '%s' does not parse cleanly:\n", input.name);
+    DiagnosticPrinter printer(input.source, input.name);
+    std::fprintf(stderr, "%s", printer.render(diagnostics.getDiagnostics()[0]).c_str());
+    return false;
+}
+
+// Median with a distribution-free 95% confidence interval taken from the
+// order statistics (normal approximation of the binomial ranks).
+void summarize(Result& result) {
+    std::vector<double> sorted = result.throughput;
+    std::sort(sorted.begin(), sorted.end());
+    size_t n = sorted.size();
+    result.median = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+
+    double spread = 1.96 * std::sqrt(static_cast<double>(n)) / 2;
+    double lowRank = std::floor(static_cast<double>(n) / 2 - spread);
+    double highRank = std::ceil(static_cast<double>(n) / 2 + spread);
+    result.low = sorted[static_cast<size_t>(std::max(0.0, lowRank))];
+    result.high = sorted[std::min(n - 1, static_cast<size_t>(std::max(0.0, highRank - 1)))];
+}
+
+// A fixed workload independent of the library, with the same mix of
+// data-dependent branches, hashing and small allocations as lexing. Its
+// timings are a measure of machine speed.
+void calibrate(std::vector<double>& samples) {
+    std::string data(1 << 20, ' ');
+    uint32_t state = 2463534242u;
+    for (char& c : data) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        c = static_cast<char>(' ' + state % 95);
+    }
+
+    for (int run = 0; run < 20; run++) {
+        auto begin = std::chrono::steady_clock::now();
+        std::unordered_set<std::string> words;
+        size_t classes[4] = {};
+        size_t wordStart = 0;
+        for (size_t i = 0; i < data.size(); i++) {
+            char c = data[i];
+            if (c >= 'a' && c <= 'z') {
+                classes[0]++;
+            } else if (c >= '0' && c <= '9') {
+                classes[1]++;
+            } else if (c == ' ') {
+                words.insert(data.substr(wordStart, i - wordStart));
+                wordStart = i + 1;
+                classes[2]++;
+            } else {
+                classes[3]++;
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        if (words.size() + classes[0] + classes[1] + classes[2] + classes[3] == 0) {
+            std::printf("unreachable\n"); // keeps the loop from being optimized away
+        }
+        samples.push_back(std::chrono::duration<double>(end - begin).count());
+    }
+}
+
+void printResult(const Result& result, const Measurement& m) {
+    const double perIteration = m.seconds / static_cast<double>(m.iterations);
+    char nodeRate[32] = "-";
+    if (result.nodes > 0) {
+        std::snprintf(nodeRate, sizeof(nodeRate), "%.2f",
+                      static_cast<double>(result.nodes) / perIteration / 1e6);
+    }
+    char interval[48] = "";
+    if (result.throughput.size() > 1) {
+        std::snprintf(interval, sizeof(interval), " [%.1f, %.1f]", result.low, result.high);
+    }
+    std::printf("%-30s %10.3f %10.1f %10.2f %10s %10.2f%s\n", result.name.c_str(),
+                perIteration * 1e3, result.median,
+                static_cast<double>(result.tokens) / perIteration / 1e6, nodeRate,
+                result.allocationsPerKB, interval);
+}
+
+bool writeJson(const std::string& path, const std::vector<Result>& results,
+               double calibrationSeconds, const Options& options) {
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        std::fprintf(stderr, "cannot write %s\n", path.c_str());
+        return false;
+    }
+    std::fprintf(file, "{\n");
+    std::fprintf(file, "  \"version\": 1,\n");
+    std::fprintf(file, "  \"build_type\": \"%s\",\n", MSL_PARSER_BENCH_BUILD_TYPE);
+    std::fprintf(file, "  \"repetitions\": %d,\n", options.repetitions);
+    std::fprintf(file, "  \"calibration_seconds\": %.9g,\n", calibrationSeconds);
+    std::fprintf(file, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& result = results[i];
+        std::fprintf(file, "    {\"name\": \"%s\", \"bytes\": %zu, \"tokens\": %zu, "
+                           "\"nodes\": %zu, \"allocations_per_kb\": %.4f,\n",
+                     result.name.c_str(), result.bytes, result.tokens, result.nodes,
+                     result.allocationsPerKB);
+        std::fprintf(file, "     \"mb_per_s\": {\"median\": %.4f, \"ci_low\": %.4f, "
+                           "\"ci_high\": %.4f, \"samples\": [",
+                     result.median, result.low, result.high);
+        for (size_t j = 0; j < result.throughput.size(); j++) {
+            std::fprintf(file, "%s%.4f", j ? ", " : "", result.throughput[j]);
+        }
+        std::fprintf(file, "]}}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(file, "  ]\n}\n");
+    return std::fclose(file) == 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 2;
+    }
+
+    std::vector<bench::CorpusInput> corpus = bench::makeStandardCorpus();
+    const char* benchmarks[] = {"lex", "parse", "lex+parse"};
+
+    if (options.list) {
+        for (const auto& input : corpus) {
+            for (const char* benchmark : benchmarks) {
+                std::printf("%s/%s\n", benchmark, input.name);
+            }
+        }
+        return 0;
+    }
+
+    std::printf("%-30s %10s %10s %10s %10s %10s\n", "benchmark", "ms/iter", "MB/s", "Mtok/s",
+                "Mnodes/s", "allocs/KB");
+    // Calibrated before and after the suite and summarized by the median, like
+    // the benchmarks, so load that changes during the run evens out.
+    std::vector<double> calibration;
+    if (!options.jsonPath.empty()) {
+        calibrate(calibration);
+    }
+
+    std::vector<Result> results;
+    for (const auto& input : corpus) {
+        if (!checkInput(input)) {
+            return 1;
+        }
+
+        // Token and node counts are properties of the input
+        Lexer lexer(input.source);
+        const std::pmr::vector<Token> tokens = lexer.scanTokens();
+        NodeCounter nodes;
+        {
+            Parser parser(tokens);
+            auto unit = parser.parse();
+            nodes.traverse(unit.get());
+        }
+
+        for (const char* benchmark : benchmarks) {
+            Result result;
+            result.name = std::string(benchmark) + "/" + input.name;
+            if (result.name.find(options.filter) == std::string::npos) {
+                continue;
+            }
+            result.bytes = input.source.size();
+            result.tokens = tokens.size();
+            result.nodes = std::strcmp(benchmark, "lex") != 0 ? nodes.count : 0;
+
+            Measurement total;
+            for (int repetition = 0; repetition < options.repetitions; repetition++) {
+                Measurement m;
+                if (std::strcmp(benchmark, "lex") == 0) {
+                    m = measure(options.minTime, [&] {
+                        Lexer scanner(input.source);
+                        return scanner.scanTokens();
+                    });
+                } else if (std::strcmp(benchmark, "parse") == 0) {
+                    m = measure(options.minTime, [&] {
+                        Parser parser(tokens);
+                        return parser.parse();
+                    });
+                } else {
+                    m = measure(options.minTime, [&] {
+                        Lexer scanner(input.source);
+                        auto scanned = scanner.scanTokens();
+                        Parser parser(scanned);
+                        return std::make_pair(std::move(scanned), parser.parse());
+                    });
+                }
+                double perIteration = m.seconds / static_cast<double>(m.iterations);
+                result.throughput.push_back(static_cast<double>(result.bytes) / perIteration / 1e6);
+                total.iterations += m.iterations;
+                total.seconds += m.seconds;
+                total.allocations += m.allocations;
+            }
+            result.allocationsPerKB = static_cast<double>(total.allocations) /
+                                      static_cast<double>(total.iterations) /
+                                      (static_cast<double>(result.bytes) / 1024.0);
+            summarize(result);
+            printResult(result, total);
+            results.push_back(std::move(result));
+        }
+    }
+
+    if (!options.jsonPath.empty()) {
+        calibrate(calibration);
+        std::sort(calibration.begin(), calibration.end());
+        double calibrationSeconds = calibration[calibration.size() / 2];
+        std::printf("calibration: %.3f ms\n", calibrationSeconds * 1e3);
+        if (!writeJson(options.jsonPath, results, calibrationSeconds, options)) {
+            return 1;
+        }
+    }
+    return 0;
+}
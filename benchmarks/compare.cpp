@@ -0,0 +1,149 @@
+// Compares msl_parser_bench JSON results against a baseline.
+//
+// Throughput is normalized by each run's calibration time, so a baseline
+// recorded on one machine can be checked on another. A benchmark regresses
+// when even the upper end of its current confidence interval is more than
+// the threshold below the baseline median; noise that overlaps the
+// threshold is reported but does not fail.
+//
+// Usage: msl_parser_bench_compare [--threshold=FRACTION] BASELINE CURRENT
+//
+// Exit status: 0 no regression, 1 regression, 2 usage or input error,
+// 77 results not comparable (different build types; ctest skips).
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "msl_parser/json.h"
+
+using namespace msl_parser;
+
+namespace {
+
+bool load(const char* path, JsonValue& value) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::fprintf(stderr, "cannot read %s\n", path);
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string text = buffer.str();
+    if (!JsonReader(text).read(value) || !value.isObject()) {
+        std::fprintf(stderr, "%s is not a benchmark result file\n", path);
+        return false;
+    }
+    return true;
+}
+
+struct Throughput {
+    double median = 0;
+    double high = 0;
+};
+
+std::map<std::string, Throughput> collect(const JsonValue& results) {
+    std::map<std::string, Throughput> throughputs;
+    const JsonValue* benchmarks = results.get("benchmarks");
+    if (!benchmarks) {
+        return throughputs;
+    }
+    for (const JsonValue& benchmark : benchmarks->items) {
+        const JsonValue* rate = benchmark.get("mb_per_s");
+        if (!rate) {
+            continue;
+        }
+        Throughput throughput;
+        throughput.median = rate->numberOr("median", 0);
+        throughput.high = rate->numberOr("ci_high", throughput.median);
+        throughputs[benchmark.stringOr("name", "")] = throughput;
+    }
+    return throughputs;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    double threshold = 0.10;
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], "--threshold=", 12) == 0) {
+            threshold = std::atof(argv[i] + 12);
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.size() != 2 || threshold <= 0 || threshold >= 1) {
+        std::fprintf(stderr, "usage: %s [--threshold=FRACTION] BASELINE CURRENT\n", argv[0]);
+        return 2;
+    }
+
+    JsonValue baseline;
+    JsonValue current;
+    if (!load(paths[0], baseline) || !load(paths[1], current)) {
+        return 2;
+    }
+
+    std::string baselineType = baseline.stringOr("build_type", "");
+    std::string currentType = current.stringOr("build_type", "");
+    if (baselineType != currentType) {
+        std::printf("baseline is a '%s' build, current is a '%s' build; not comparable\n",
+                    baselineType.c_str(), currentType.c_str());
+        return 77;
+    }
+
+    // Scale the baseline to this machine
+    double baselineCalibration = baseline.numberOr("calibration_seconds", 0);
+    double currentCalibration = current.numberOr("calibration_seconds", 0);
+    double scale = 1.0;
+    if (baselineCalibration > 0 && currentCalibration > 0) {
+        scale = baselineCalibration / currentCalibration;
+    }
+    std::printf("machine speed relative to baseline: %.2fx, threshold %.0f%%\n\n", scale,
+                threshold * 100);
+
+    std::map<std::string, Throughput> before = collect(baseline);
+    std::map<std::string, Throughput> after = collect(current);
+
+    std::printf("%-30s %12s %12s %9s  %s\n", "benchmark", "expected", "current", "change",
+                "status");
+    int regressions = 0;
+    for (const auto& entry : before) {
+        auto it = after.find(entry.first);
+        if (it == after.end()) {
+            std::printf("%-30s %12.1f %12s %9s  missing\n", entry.first.c_str(),
+                        entry.second.median * scale, "-", "-");
+            continue;
+        }
+        double expected = entry.second.median * scale;
+        double change = expected > 0 ? it->second.median / expected - 1.0 : 0.0;
+        const char* status = "ok";
+        if (it->second.high < expected * (1.0 - threshold)) {
+            status = "REGRESSION";
+            regressions++;
+        } else if (it->second.median < expected * (1.0 - threshold)) {
+            status = "noisy";
+        } else if (change > threshold) {
+            status = "faster";
+        }
+        std::printf("%-30s %12.1f %12.1f %+8.1f%%  %s\n", entry.first.c_str(), expected,
+                    it->second.median, change * 100, status);
+    }
+    for (const auto& entry : after) {
+        if (!before.count(entry.first)) {
+            std::printf("%-30s %12s %12.1f %9s  new\n", entry.first.c_str(), "-",
+                        entry.second.median, "-");
+        }
+    }
+
+    if (regressions > 0) {
+        std::printf("\n%d benchmark(s) regressed by more than %.0f%%\n", regressions,
+                    threshold * 100);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,456 @@
+#include "corpus.h"
+
+namespace msl_parser {
+namespace bench {
+
+namespace {
+
+// Shaders in the style of real Metal code, used as-is for the small input
+// and mixed into the generated ones.
+const char* const handWrittenShaders[] = {
+    "using namespace metal;\n"
+    "\n"
+    "struct VertexIn {\n"
+    "    float3 position [[attribute(0)]];\n"
+    "    float3 normal [[attribute(1)]];\n"
+    "    float2 texCoord [[attribute(2)]];\n"
+    "};\n"
+    "\n"
+    "struct VertexOut {\n"
+    "    float4 position [[position]];\n"
+    "    float3 worldNormal;\n"
+    "    float3 worldPosition;\n"
+    "    float2 texCoord;\n"
+    "};\n"
+    "\n"
+    "struct Uniforms {\n"
+    "    float4x4 modelMatrix;\n"
+    "    float4x4 viewProjectionMatrix;\n"
+    "    float3 lightPosition;\n"
+    "    float3 cameraPosition;\n"
+    "};\n"
+    "\n"
+    "vertex VertexOut vertex_main(VertexIn in [[stage_in]],\n"
+    "                             constant Uniforms& uniforms [[buffer(1)]]) {\n"
+    "    VertexOut out;\n"
+    "    float4 worldPosition = uniforms.modelMatrix * float4(in.position, 1.0);\n"
+    "    out.position = uniforms.viewProjectionMatrix * worldPosition;\n"
+    "    out.worldPosition = worldPosition.xyz;\n"
+    "    out.worldNormal = (uniforms.modelMatrix * float4(in.normal, 0.0)).xyz;\n"
+    "    out.texCoord = in.texCoord;\n"
+    "    return out;\n"
+    "}\n"
+    "\n"
+    "fragment float4 fragment_main(VertexOut in [[stage_in]],\n"
+    "                              constant Uniforms& uniforms [[buffer(1)]],\n"
+    "                              texture2d<float> albedo [[texture(0)]],\n"
+    "                              sampler linearSampler [[sampler(0)]]) {\n"
+    "    float3 N = normalize(in.worldNormal);\n"
+    "    float3 L = normalize(uniforms.lightPosition - in.worldPosition);\n"
+    "    float3 V = normalize(uniforms.cameraPosition - in.worldPosition);\n"
+    "    float3 H = normalize(L + V);\n"
+    "    float diffuse = max(dot(N, L), 0.0f);\n"
+    "    float specular = pow(max(dot(N, H), 0.0f), 32.0f);\n"
+    "    float4 base = albedo.sample(linearSampler, in.texCoord);\n"
+    "    float3 color = base.rgb * (0.1f + diffuse) + float3(specular);\n"
+    "    return float4(color, base.a);\n"
+    "}\n",
+
+    "// Separable Gaussian blur, horizontal pass.\n"
+    "constant float sigma = 2.0f;\n"
+    "\n"
+    "kernel void blur_horizontal(texture2d<float, access::read> inTexture [[texture(0)]],\n"
+    "                            texture2d<float, access::write> outTexture [[texture(1)]],\n"
+    "                            uint2 gid [[thread_position_in_grid]]) {\n"
+    "    if (gid.x >= outTexture.get_width() || gid.y >= outTexture.get_height()) {\n"
+    "        return;\n"
+    "    }\n"
+    "    float4 sum = inTexture.read(gid);\n"
+    "    float total = 1.0f;\n"
+    "    for (int i = 1; i < 5; ++i) {\n"
+    "        float weight = exp(-float(i * i) / (2.0f * sigma * sigma));\n"
+    "        uint left = uint(max(int(gid.x) - i, 0));\n"
+    "        uint right = min(gid.x + uint(i), outTexture.get_width() - 1);\n"
+    "        sum += inTexture.read(uint2(left, gid.y)) * weight;\n"
+    "        sum += inTexture.read(uint2(right, gid.y)) * weight;\n"
+    "        total += 2.0f * weight;\n"
+    "    }\n"
+    "    outTexture.write(sum / total, gid);\n"
+    "}\n",
+
+    "/*\n"
+    " * Reduction of a float buffer into per-SIMD-group partial sums. Each\n"
+    " * thread first adds four consecutive elements.\n"
+    " */\n"
+    "kernel void reduce_sum(device const float* input [[buffer(0)]],\n"
+    "                       device float* partialSums [[buffer(1)]],\n"
+    "                       constant uint& count [[buffer(2)]],\n"
+    "                       uint gid [[thread_position_in_grid]],\n"
+    "                       uint lane [[thread_index_in_simdgroup]],\n"
+    "                       uint simdGroup [[simdgroup_index_in_threadgroup]],\n"
+    "                       uint groupId [[threadgroup_position_in_grid]]) {\n"
+    "    float value = 0.0f;\n"
+    "    for (uint i = 0; i < 4; ++i) {\n"
+    "        uint index = gid * 4 + i;\n"
+    "        if (index < count) {\n"
+    "            value += input[index];\n"
+    "        }\n"
+    "    }\n"
+    "    value = simd_sum(value);\n"
+    "    if (lane == 0) {\n"
+    "        partialSums[groupId * 32 + simdGroup] = value;\n"
+    "    }\n"
+    "}\n",
+};
+
+// Small, portable PRNG (xorshift32); std distributions are not specified
+// exactly, so they would make the corpus differ between standard libraries.
+class Random {
+public:
+    explicit Random(uint32_t seed) : state(seed ? seed : 1) {}
+
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    uint32_t below(uint32_t bound) { return next() % bound; }
+    bool chance(uint32_t percent) { return below(100) < percent; }
+
+    template <size_t N>
+    const char* pick(const char* const (&items)[N]) {
+        return items[below(static_cast<uint32_t>(N))];
+    }
+
+private:
+    uint32_t state;
+};
+
+const char* const operands[] = {"x", "y", "v.x", "v.y", "gid.x", "scale", "in[gid.x].w", "k0",
+                                "params.bias", "acc", "t", "uv.x"};
+const char* const vectorOperands[] = {"v", "n", "color.rgb", "in[gid.x].xyz", "params.tint",
+                                      "float3(x, y, t)", "normalize(n)"};
+const char* const binaryOperators[] = {" + ", " - ", " * ", " / ", " + ", " * "};
+const char* const compareOperators[] = {" < ", " > ", " <= ", " >= ", " == ", " != "};
+const char* const assignOperators[] = {" = ", " += ", " -= ", " *= ", " /= "};
+const char* const denseOperators[] = {"+", "-", "*", "/", "%", "&", "|", "^", "<<", ">>",
+                                      "<", ">", "<=", ">=", "==", "!=", "&&", "||"};
+const char* const scalarCalls[] = {"dot", "distance", "max", "min", "step"};
+const char* const comments[] = {
+    "// Accumulate the weighted contribution of this sample.\n",
+    "// TODO: move this into a shared helper once the API settles.\n",
+    "// Clamp to avoid NaNs from the division below.\n",
+    "/* The reference implementation uses a two-pass approach here; this\n"
+    "   version folds both passes into one loop to save bandwidth. */\n",
+    "// Matches the CPU path in Renderer.swift; keep the two in sync.\n",
+};
+
+class Generator {
+public:
+    Generator(uint32_t seed) : random(seed) {}
+
+    std::string take() { return std::move(out); }
+    size_t size() const { return out.size(); }
+
+    void append(const char* text) { out += text; }
+
+    void header() { out += "using namespace metal;\n\n"; }
+
+    void structDeclaration() {
+        out += "struct Params" + std::to_string(counter++) + " {\n";
+        out += "    float scale;\n    float bias;\n    float3 tint;\n    uint count;\n};\n\n";
+    }
+
+    void constantDeclaration() {
+        out += "constant float k" + std::to_string(counter++) + " = " + floatLiteral() + ";\n";
+    }
+
+    void kernel(int statements, int nesting) {
+        out += "kernel void kernel" + std::to_string(counter++) +
+               "(device const float4* in [[buffer(0)]],\n"
+               "    device float4* out [[buffer(1)]],\n"
+               "    constant Params0& params [[buffer(2)]],\n"
+               "    uint2 gid [[thread_position_in_grid]]) {\n";
+        indent = 1;
+        line("float x = in[gid.x].x;");
+        line("float y = in[gid.y].y;");
+        line("float3 v = in[gid.x].xyz;");
+        line("float3 n = normalize(v);");
+        line("float acc = 0.0f;");
+        for (int i = 0; i < statements; i++) {
+            statement(nesting);
+        }
+        line("out[gid.x] = float4(v * acc, 1.0f);");
+        out += "}\n\n";
+    }
+
+    void helperFunction(int statements) {
+        out += "float helper" + std::to_string(counter++) + "(float x, float y, float3 v) {\n";
+        indent = 1;
+        line("float acc = x;");
+        for (int i = 0; i < statements; i++) {
+            statement(1);
+        }
+        line("return acc + " + scalarExpression(2) + ";");
+        out += "}\n\n";
+    }
+
+    void commentedKernel(int statements) {
+        out += "/**\n"
+               " * Generated kernel. Reads one element per thread, applies a chain of\n"
+               " * arithmetic and writes the result back. Parameters:\n"
+               " *   in     - source buffer\n"
+               " *   out    - destination buffer\n"
+               " *   params - per-dispatch constants\n"
+               " */\n";
+        out += "kernel void commented" + std::to_string(counter++) +
+               "(device const float4* in [[buffer(0)]], // input\n"
+               "    device float4* out [[buffer(1)]], // output\n"
+               "    constant Params0& params [[buffer(2)]], // constants\n"
+               "    uint2 gid [[thread_position_in_grid]]) {\n";
+        indent = 1;
+        line("float acc = 0.0f; // running total");
+        for (int i = 0; i < statements; i++) {
+            for (int c = 0; c < 2; c++) {
+                indented(random.pick(comments));
+            }
+            statement(0);
+        }
+        line("out[gid.x] = float4(acc); // store");
+        out += "}\n\n";
+    }
+
+    void nestedKernel(int blockDepth, int parenDepth) {
+        out += "kernel void nested" + std::to_string(counter++) +
+               "(device float* data [[buffer(0)]], uint gid [[thread_position_in_grid]]) {\n";
+        indent = 1;
+        line("float x = data[gid];");
+        for (int d = 0; d < blockDepth; d++) {
+            if (d % 3 == 0) {
+                line("for (int i" + std::to_string(d) + " = 0; i" + std::to_string(d) +
+                     " < 4; ++i" + std::to_string(d) + ") {");
+            } else {
+                line("if (x" + std::string(random.pick(compareOperators)) + floatLiteral() +
+                     ") {");
+            }
+            indent++;
+        }
+        std::string expression = "x";
+        for (int d = 0; d < parenDepth; d++) {
+            expression = "(" + expression + random.pick(binaryOperators) + random.pick(operands) +
+                         ")";
+        }
+        line("x = " + expression + ";");
+        for (int d = 0; d < blockDepth; d++) {
+            indent--;
+            line("}");
+        }
+        line("data[gid] = x;");
+        out += "}\n\n";
+    }
+
+    void operatorDenseKernel(int statements) {
+        out += "kernel void dense" + std::to_string(counter++) +
+               "(device int* d [[buffer(0)]], uint i [[thread_position_in_grid]]) {\n";
+        indent = 1;
+        line("int a = d[i], b = d[i + 1], c = d[i + 2];");
+        for (int s = 0; s < statements; s++) {
+            std::string expression = denseOperand();
+            int operators = 8 + static_cast<int>(random.below(24));
+            for (int o = 0; o < operators; o++) {
+                expression += random.pick(denseOperators);
+                expression += denseOperand();
+            }
+            const char* target = random.pick({"a", "b", "c", "d[i]"});
+            line(std::string(target) + random.pick({"=", "+=", "-=", "*="}) +
+                 expression + ";");
+        }
+        out += "}\n\n";
+    }
+
+private:
+    Random random;
+    std::string out;
+    int indent = 0;
+    int counter = 0;
+
+    void line(const std::string& text) {
+        out.append(static_cast<size_t>(indent) * 4, ' ');
+        out += text;
+        out += '\n';
+    }
+
+    void indented(const char* text) {
+        out.append(static_cast<size_t>(indent) * 4, ' ');
+        out += text;
+    }
+
+    std::string floatLiteral() {
+        std::string text = std::to_string(random.below(100)) + "." + std::to_string(random.below(1000));
+        return random.chance(50) ? text + "f" : text;
+    }
+
+    std::string denseOperand() {
+        switch (random.below(5)) {
+            case 0: return std::to_string(random.below(256));
+            case 1: return "a";
+            case 2: return "b";
+            case 3: return "(c+1)";
+            default: return "d[i]";
+        }
+    }
+
+    std::string scalarExpression(int depth) {
+        if (depth <= 0 || random.chance(30)) {
+            return random.chance(25) ? floatLiteral() : std::string(random.pick(operands));
+        }
+        switch (random.below(6)) {
+            case 0:
+                return std::string(random.pick(scalarCalls)) + "(" + vectorExpression(depth - 1) +
+                       ", " + vectorExpression(depth - 1) + ")";
+            case 1:
+                return "(" + scalarExpression(depth - 1) + random.pick(compareOperators) +
+                       scalarExpression(depth - 1) + " ? " + scalarExpression(depth - 1) + " : " +
+                       scalarExpression(depth - 1) + ")";
+            case 2:
+                return "-" + scalarExpression(depth - 1);
+            default:
+                return scalarExpression(depth - 1) + random.pick(binaryOperators) +
+                       scalarExpression(depth - 1);
+        }
+    }
+
+    std::string vectorExpression(int depth) {
+        if (depth <= 0 || random.chance(40)) {
+            return random.pick(vectorOperands);
+        }
+        switch (random.below(4)) {
+            case 0:
+                return "normalize(" + vectorExpression(depth - 1) + ")";
+            case 1:
+                return "clamp(" + vectorExpression(depth - 1) + ", 0.0f, 1.0f)";
+            default:
+                return vectorExpression(depth - 1) + (random.chance(50) ? " * " : " + ") +
+                       scalarExpression(depth - 1);
+        }
+    }
+
+    void statement(int nesting) {
+        uint32_t choice = random.below(nesting > 0 ? 8 : 5);
+        switch (choice) {
+            case 0:
+                line("float t" + std::to_string(counter++) + " = " + scalarExpression(3) + ";");
+                break;
+            case 1:
+                line("v" + std::string(random.pick({" = ", " += ", " *= "})) +
+                     vectorExpression(3) + ";");
+                break;
+            case 2:
+            case 3:
+            case 4:
+                line("acc" + std::string(random.pick(assignOperators)) + scalarExpression(3) +
+                     ";");
+                break;
+            case 5:
+                line("if (" + scalarExpression(2) + random.pick(compareOperators) +
+                     scalarExpression(1) + ") {");
+                block(nesting - 1);
+                if (random.chance(40)) {
+                    line("} else {");
+                    block(nesting - 1);
+                }
+                line("}");
+                break;
+            case 6:
+                line("for (int i = 0; i < " + std::to_string(1 + random.below(16)) + "; ++i) {");
+                block(nesting - 1);
+                line("}");
+                break;
+            default:
+                line("while (acc < " + floatLiteral() + ") {");
+                indent++;
+                line("acc += 1.0f;");
+                indent--;
+                line("}");
+                break;
+        }
+    }
+
+    void block(int nesting) {
+        indent++;
+        int statements = 1 + static_cast<int>(random.below(3));
+        for (int i = 0; i < statements; i++) {
+            statement(nesting);
+        }
+        indent--;
+    }
+};
+
+} // namespace
+
+const char* corpusKindName(CorpusKind kind) {
+    switch (kind) {
+        case CorpusKind::SMALL: return "small";
+        case CorpusKind::LARGE: return "large";
+        case CorpusKind::COMMENT_HEAVY: return "comment_heavy";
+        case CorpusKind::DEEPLY_NESTED: return "deeply_nested";
+        case CorpusKind::OPERATOR_DENSE: return "operator_dense";
+        default: return "unknown";
+    }
+}
+
+std::string generateCorpus(CorpusKind kind, uint32_t seed) {
+    Generator generator(seed);
+    switch (kind) {
+        case CorpusKind::SMALL:
+            for (const char* shader : handWrittenShaders) {
+                generator.append(shader);
+                generator.append("\n");
+            }
+            break;
+        case CorpusKind::LARGE:
+            generator.header();
+            generator.structDeclaration();
+            while (generator.size() < (2u << 20)) {
+                generator.constantDeclaration();
+                generator.helperFunction(6);
+                generator.kernel(24, 3);
+                if (generator.size() % 7 == 0) {
+                    generator.append(handWrittenShaders[1]);
+                }
+            }
+            break;
+        case CorpusKind::COMMENT_HEAVY:
+            generator.header();
+            generator.structDeclaration();
+            while (generator.size() < (1u << 20)) {
+                generator.commentedKernel(12);
+            }
+            break;
+        case CorpusKind::DEEPLY_NESTED:
+            while (generator.size() < (1u << 20)) {
+                generator.nestedKernel(40, 40);
+            }
+            break;
+        case CorpusKind::OPERATOR_DENSE:
+            while (generator.size() < (1u << 20)) {
+                generator.operatorDenseKernel(32);
+            }
+            break;
+    }
+    return generator.take();
+}
+
+std::vector<CorpusInput> makeStandardCorpus() {
+    std::vector<CorpusInput> corpus;
+    for (CorpusKind kind : {CorpusKind::SMALL, CorpusKind::LARGE, CorpusKind::COMMENT_HEAVY,
+                            CorpusKind::DEEPLY_NESTED, CorpusKind::OPERATOR_DENSE}) {
+        corpus.push_back({kind, corpusKindName(kind), generateCorpus(kind)});
+    }
+    return corpus;
+}
+
+} // namespace bench
+} // namespace msl_parser
@@ -0,0 +1,38 @@
+#ifndef MSL_PARSER_BENCH_CORPUS_H
+#define MSL_PARSER_BENCH_CORPUS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace msl_parser {
+namespace bench {
+
+enum class CorpusKind {
+    SMALL,          // a few hand-written shaders, a few KB
+    LARGE,          // generated kernels and shaders, several MB
+    COMMENT_HEAVY,  // mostly line and block comments
+    DEEPLY_NESTED,  // nested blocks and parenthesized expressions
+    OPERATOR_DENSE, // long expressions over short operands
+};
+
+struct CorpusInput {
+    CorpusKind kind;
+    const char* name;
+    std::string source;
+};
+
+const char* corpusKindName(CorpusKind kind);
+
+// Generates the input for `kind`. The output depends only on the kind and
+// the seed, so results are comparable across runs and machines. Every
+// input lexes and parses without diagnostics.
+std::string generateCorpus(CorpusKind kind, uint32_t seed = 1);
+
+// All corpus kinds with the default seed.
+std::vector<CorpusInput> makeStandardCorpus();
+
+} // namespace bench
+} // namespace msl_parser
+
+#endif // MSL_PARSER_BENCH_CORPUS_H
@@ -0,0 +1,107 @@
+#ifndef MSL_PARSER_BENCH_PERF_COUNTERS_H
+#define MSL_PARSER_BENCH_PERF_COUNTERS_H
+
+#include <cstdint>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace msl_parser {
+namespace bench {
+
+// Hardware branch counters for the calling thread, read through
+// perf_event_open on Linux. Where the counters cannot be opened (other
+// platforms, containers, perf_event_paranoid > 2) available() is false and
+// the readings stay zero, so callers can fall back to timings alone.
+class BranchCounters {
+public:
+    BranchCounters() {
+#if defined(__linux__)
+        branchesFd = open(PERF_COUNT_HW_BRANCH_INSTRUCTIONS, -1);
+        missesFd = open(PERF_COUNT_HW_BRANCH_MISSES, branchesFd);
+        if (branchesFd < 0 || missesFd < 0) {
+            closeAll();
+        }
+#endif
+    }
+
+    ~BranchCounters() { closeAll(); }
+
+    BranchCounters(const BranchCounters&) = delete;
+    BranchCounters& operator=(const BranchCounters&) = delete;
+
+    bool available() const { return branchesFd >= 0; }
+
+    void start() {
+#if defined(__linux__)
+        if (available()) {
+            ioctl(branchesFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(branchesFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+    void stop() {
+#if defined(__linux__)
+        if (available()) {
+            ioctl(branchesFd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+            branches = read(branchesFd);
+            misses = read(missesFd);
+        }
+#endif
+    }
+
+    uint64_t getBranches() const { return branches; }
+    uint64_t getMisses() const { return misses; }
+
+private:
+    int branchesFd = -1;
+    int missesFd = -1;
+    uint64_t branches = 0;
+    uint64_t misses = 0;
+
+#if defined(__linux__)
+    static int open(uint64_t config, int groupFd) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = config;
+        attr.disabled = groupFd < 0 ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+    }
+
+    static uint64_t read(int fd) {
+        uint64_t value = 0;
+        if (::read(fd, &value, sizeof(value)) != static_cast<ssize_t>(sizeof(value))) {
+            return 0;
+        }
+        return value;
+    }
+#endif
+
+    void closeAll() {
+#if defined(__linux__)
+        if (missesFd >= 0) {
+            close(missesFd);
+        }
+        if (branchesFd >= 0) {
+            close(branchesFd);
+        }
+#endif
+        missesFd = -1;
+        branchesFd = -1;
+    }
+};
+
+} // namespace bench
+} // namespace msl_parser
+
+#endif // MSL_PARSER_BENCH_PERF_COUNTERS_H
@@ -1,12 +1,26 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace msl_parser {
 namespace ast {
 
 class ASTVisitor;
+class Declaration;
+class VariableDeclaration;
+
+// The children of a node. Like the names inside nodes, lists are allocated
+// from the node's resource (see ASTNode::getResource()), so a tree parsed
+// into an arena makes no allocations on the global heap.
+template <typename T>
+using NodeList = std::pmr::vector<std::unique_ptr<T>>;
 
 struct SourceLocation {
     int line;
@@ -29,6 +43,18 @@ struct SourceRange {
 class ASTNode {
 public:
     virtual ~ASTNode() = default;
+
+    // Nodes can be allocated from a memory resource with
+    // `new (resource) Node(...)`; plain `new` uses the global heap. Each
+    // allocation is prefixed with the resource it came from, so that
+    // deleting a node, as std::unique_ptr does, returns it there. Nodes must
+    // need no more than pointer alignment.
+    static void* operator new(size_t size);
+    static void* operator new(size_t size, std::pmr::memory_resource* resource);
+    static void operator delete(void* pointer);
+    static void operator delete(void* pointer, std::pmr::memory_resource* resource);
+    // Bytes in front of `node` in its allocation.
+    static size_t allocationHeaderSize(const ASTNode* node);
     
     virtual void accept(ASTVisitor* visitor) = 0;
     
@@ -41,6 +67,12 @@ public:
 protected:
     ASTNode() = default;
     ASTNode(const SourceRange& range) : sourceRange(range) {}
+
+    // The resource the node was allocated from, or the default resource for
+    // a node on the global heap. Strings and lists in the node are built
+    // from it; the ones handed to a constructor are moved when they already
+    // use it and copied into it otherwise.
+    std::pmr::memory_resource* getResource() const;
     
 private:
     SourceRange sourceRange;
@@ -51,6 +83,14 @@ class Expression : public ASTNode {
 public:
     Expression() = default;
     Expression(const SourceRange& range) : ASTNode(range) {}
+    
+    // The expression's TypeId in the TypeTable of the TypeChecker that
+    // checked it; 0 (unknown) until then.
+    uint16_t getTypeId() const { return typeId; }
+    void setTypeId(uint16_t id) { typeId = id; }
+    
+private:
+    uint16_t typeId = 0;
 };
 
 class IntegerLiteral : public Expression {
@@ -83,16 +123,22 @@ private:
 
 class Identifier : public Expression {
 public:
-    explicit Identifier(const std::string& name) : name(name) {}
-    Identifier(const std::string& name, const SourceRange& range)
-        : Expression(range), name(name) {}
+    explicit Identifier(std::string_view name) : name(name, getResource()) {}
+    Identifier(std::string_view name, const SourceRange& range)
+        : Expression(range), name(name, getResource()) {}
+    
+    const std::pmr::string& getName() const { return name; }
     
-    const std::string& getName() const { return name; }
+    // The declaration the name refers to, set by NameResolver; null when
+    // unresolved, e.g. for built-in functions.
+    Declaration* getDeclaration() const { return declaration; }
+    void setDeclaration(Declaration* decl) { declaration = decl; }
     
     void accept(ASTVisitor* visitor) override;
     
 private:
-    std::string name;
+    std::pmr::string name;
+    Declaration* declaration = nullptr;
 };
 
 class UnaryExpression : public Expression {
@@ -100,11 +146,20 @@ public:
     enum class Operator {
         NEGATE,
         NOT,
-        BITWISE_NOT
+        BITWISE_NOT,
+        PLUS,
+        PRE_INCREMENT,
+        PRE_DECREMENT,
+        POST_INCREMENT,
+        POST_DECREMENT,
+        ADDRESS_OF,
+        DEREFERENCE
     };
     
     UnaryExpression(Operator op, std::unique_ptr<Expression> operand)
-        : op(op), operand(std::move(operand)) {}
+        : op(op), operand(std::move(operand)) {
+        this->operand->setParent(this);
+    }
     
     Operator getOperator() const { return op; }
     Expression* getOperand() const { return operand.get(); }
@@ -122,17 +177,41 @@ public:
         ADD,
         SUBTRACT,
         MULTIPLY,
-        DIVIDE
+        DIVIDE,
+        MODULO,
+        EQUAL,
+        NOT_EQUAL,
+        LESS_THAN,
+        GREATER_THAN,
+        LESS_EQUAL,
+        GREATER_EQUAL,
+        LOGICAL_AND,
+        LOGICAL_OR,
+        BITWISE_AND,
+        BITWISE_OR,
+        BITWISE_XOR,
+        LEFT_SHIFT,
+        RIGHT_SHIFT,
+        ASSIGN,
+        ADD_ASSIGN,
+        SUBTRACT_ASSIGN,
+        MULTIPLY_ASSIGN,
+        DIVIDE_ASSIGN,
+        MODULO_ASSIGN
     };
     
     BinaryExpression(std::unique_ptr<Expression> left,
                     Operator op,
                     std::unique_ptr<Expression> right)
-        : left(std::move(left)), op(op), right(std::move(right)) {}
+        : left(std::move(left)), op(op), right(std::move(right)) {
+        this->left->setParent(this);
+        this->right->setParent(this);
+    }
     
     Expression* getLeft() const { return left.get(); }
     Expression* getRight() const { return right.get(); }
     Operator getOperator() const { return op; }
+    bool isAssignment() const { return op >= Operator::ASSIGN; }
     
     void accept(ASTVisitor* visitor) override;
     
@@ -142,6 +221,574 @@ private:
     std::unique_ptr<Expression> right;
 };
 
+class BoolLiteral : public Expression {
+public:
+    explicit BoolLiteral(bool value) : value(value) {}
+    BoolLiteral(bool value, const SourceRange& range) : Expression(range), value(value) {}
+    
+    bool getValue() const { return value; }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    bool value;
+};
+
+class ConditionalExpression : public Expression {
+public:
+    ConditionalExpression(std::unique_ptr<Expression> condition,
+                          std::unique_ptr<Expression> trueExpr,
+                          std::unique_ptr<Expression> falseExpr)
+        : condition(std::move(condition)), trueExpr(std::move(trueExpr)),
+          falseExpr(std::move(falseExpr)) {
+        this->condition->setParent(this);
+        this->trueExpr->setParent(this);
+        this->falseExpr->setParent(this);
+    }
+    
+    Expression* getCondition() const { return condition.get(); }
+    Expression* getTrueExpression() const { return trueExpr.get(); }
+    Expression* getFalseExpression() const { return falseExpr.get(); }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    std::unique_ptr<Expression> condition;
+    std::unique_ptr<Expression> trueExpr;
+    std::unique_ptr<Expression> falseExpr;
+};
+
+// Address space qualifiers that may prefix a type in MSL.
+enum class AddressSpace {
+    NONE,
+    DEVICE,
+    CONSTANT,
+    THREAD,
+    THREADGROUP
+};
+
+// A written type such as `const device float4*` or `texture2d<float>`.
+// Types are not nodes; they are stored by value on declarations, copied
+// into the declaration's resource.
+struct TypeSpec {
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+    std::pmr::string name;
+    std::pmr::vector<std::pmr::string> templateArguments;
+    AddressSpace addressSpace = AddressSpace::NONE;
+    bool isConst = false;
+    int pointerDepth = 0;
+    bool isReference = false;
+
+    TypeSpec() = default;
+    explicit TypeSpec(const allocator_type& allocator)
+        : name(allocator), templateArguments(allocator) {}
+    TypeSpec(const TypeSpec& other, const allocator_type& allocator)
+        : name(other.name, allocator), templateArguments(other.templateArguments, allocator),
+          addressSpace(other.addressSpace), isConst(other.isConst),
+          pointerDepth(other.pointerDepth), isReference(other.isReference) {}
+    TypeSpec(const TypeSpec&) = default;
+    TypeSpec(TypeSpec&&) = default;
+    TypeSpec& operator=(const TypeSpec&) = default;
+    TypeSpec& operator=(TypeSpec&&) = default;
+};
+
+// An attribute such as `[[buffer(0)]]`; `argument` is empty when absent.
+// Allocator-aware, so attributes in a std::pmr::vector keep their strings
+// in the vector's resource.
+struct Attribute {
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+    std::pmr::string name;
+    std::pmr::string argument;
+
+    Attribute() = default;
+    explicit Attribute(const allocator_type& allocator) : name(allocator), argument(allocator) {}
+    Attribute(std::string_view name, std::string_view argument,
+              const allocator_type& allocator = {})
+        : name(name, allocator), argument(argument, allocator) {}
+    Attribute(const Attribute& other, const allocator_type& allocator)
+        : name(other.name, allocator), argument(other.argument, allocator) {}
+    Attribute(Attribute&& other, const allocator_type& allocator)
+        : name(std::move(other.name), allocator), argument(std::move(other.argument), allocator) {}
+    Attribute(const Attribute&) = default;
+    Attribute(Attribute&&) = default;
+    Attribute& operator=(const Attribute&) = default;
+    Attribute& operator=(Attribute&&) = default;
+};
+
+class CallExpression : public Expression {
+public:
+    CallExpression(std::unique_ptr<Expression> callee, NodeList<Expression> arguments)
+        : callee(std::move(callee)), arguments(std::move(arguments), getResource()) {
+        this->callee->setParent(this);
+        for (auto& arg : this->arguments) {
+            arg->setParent(this);
+        }
+    }
+    
+    Expression* getCallee() const { return callee.get(); }
+    const NodeList<Expression>& getArguments() const { return arguments; }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    std::unique_ptr<Expression> callee;
+    NodeList<Expression> arguments;
+};
+
+// A constructor-style expression on a built-in type, e.g. `float4(1.0)`.
+class ConstructExpression : public Expression {
+public:
+    ConstructExpression(const TypeSpec& type, NodeList<Expression> arguments)
+        : type(type, getResource()), arguments(std::move(arguments), getResource()) {
+        for (auto& arg : this->arguments) {
+            arg->setParent(this);
+        }
+    }
+    
+    const TypeSpec& getType() const { return type; }
+    const NodeList<Expression>& getArguments() const { return arguments; }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    TypeSpec type;
+    NodeList<Expression> arguments;
+};
+
+class CastExpression : public Expression {
+public:
+    CastExpression(const TypeSpec& type, std::unique_ptr<Expression> operand)
+        : type(type, getResource()), operand(std::move(operand)) {
+        this->operand->setParent(this);
+    }
+    
+    const TypeSpec& getType() const { return type; }
+    Expression* getOperand() const { return operand.get(); }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    TypeSpec type;
+    std::unique_ptr<Expression> operand;
+};
+
+// Member access `base.member` or `base->member`; also covers swizzles.
+class MemberExpression : public Expression {
+public:
+    MemberExpression(std::unique_ptr<Expression> base, std::string_view member, bool isArrow)
+        : base(std::move(base)), member(member, getResource()), arrow(isArrow) {
+        this->base->setParent(this);
+    }
+    
+    Expression* getBase() const { return base.get(); }
+    const std::pmr::string& getMember() const { return member; }
+    bool isArrow() const { return arrow; }
+    
+    // The struct field accessed, set by NameResolver; null for swizzles and
+    // members of types it cannot see.
+    VariableDeclaration* getField() const { return field; }
+    void setField(VariableDeclaration* decl) { field = decl; }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    std::unique_ptr<Expression> base;
+    std::pmr::string member;
+    bool arrow;
+    VariableDeclaration* field = nullptr;
+};
+
+class IndexExpression : public Expression {
+public:
+    IndexExpression(std::unique_ptr<Expression> base, std::unique_ptr<Expression> index)
+        : base(std::move(base)), index(std::move(index)) {
+        this->base->setParent(this);
+        this->index->setParent(this);
+    }
+    
+    Expression* getBase() const { return base.get(); }
+    Expression* getIndex() const { return index.get(); }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    std::unique_ptr<Expression> base;
+    std::unique_ptr<Expression> index;
+};
+
+// Statements
+
+class Statement : public ASTNode {
+public:
+    Statement() = default;
+    Statement(const SourceRange& range) : ASTNode(range) {}
+};
+
+class Declaration : public ASTNode {
+public:
+    const std::pmr::string& getName() const { return name; }
+    
+protected:
+    explicit Declaration(std::string_view name) : name(name, getResource()) {}
+    
+private:
+    std::pmr::string name;
+};
+
+class VariableDeclaration : public Declaration {
+public:
+    enum class Kind {
+        GLOBAL,
+        LOCAL,
+        PARAMETER,
+        FIELD
+    };
+    
+    VariableDeclaration(Kind kind, const TypeSpec& type, std::string_view name,
+                        std::unique_ptr<Expression> initializer = nullptr)
+        : Declaration(name), kind(kind), type(type, getResource()),
+          initializer(std::move(initializer)), attributes(getResource()) {
+        if (this->initializer) {
+            this->initializer->setParent(this);
+        }
+    }
+    
+    Kind getKind() const { return kind; }
+    const TypeSpec& getType() const { return type; }
+    Expression* getInitializer() const { return initializer.get(); }
+    
+    // Array extent for `float x[4]`; null for non-array variables.
+    Expression* getArraySize() const { return arraySize.get(); }
+    void setArraySize(std::unique_ptr<Expression> size) {
+        arraySize = std::move(size);
+        if (arraySize) {
+            arraySize->setParent(this);
+        }
+    }
+    
+    const std::pmr::vector<Attribute>& getAttributes() const { return attributes; }
+    void setAttributes(std::pmr::vector<Attribute> attrs) { attributes = std::move(attrs); }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    Kind kind;
+    TypeSpec type;
+    std::unique_ptr<Expression> initializer;
+    std::unique_ptr<Expression> arraySize;
+    std::pmr::vector<Attribute> attributes;
+};
+
+class CompoundStatement : public Statement {
+public:
+    explicit CompoundStatement(NodeList<Statement> statements)
+        : statements(std::move(statements), getResource()) {
+        for (auto& stmt : this->statements) {
+            stmt->setParent(this);
+        }
+    }
+    
+    const NodeList<Statement>& getStatements() const { return statements; }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    NodeList<Statement> statements;
+};
+
+// A local declaration such as `float a = 1.0, b;`.
+class DeclarationStatement : public Statement {
+public:
+    explicit DeclarationStatement(NodeList<VariableDeclaration> declarations)
+        : declarations(std::move(declarations), getResource()) {
+        for (auto& decl : this->declarations) {
+            decl->setParent(this);
+        }
+    }
+    
+    const NodeList<VariableDeclaration>& getDeclarations() const {
+        return declarations;
+    }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    NodeList<VariableDeclaration> declarations;
+};
+
+// An expression followed by `;`. The expression is null for an empty statement.
+class ExpressionStatement : public Statement {
+public:
+    explicit ExpressionStatement(std::unique_ptr<Expression> expression)
+        : expression(std::move(expression)) {
+        if (this->expression) {
+            this->expression->setParent(this);
+        }
+    }
+    
+    Expression* getExpression() const { return expression.get(); }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    std::unique_ptr<Expression> expression;
+};
+
+class ReturnStatement : public Statement {
+public:
+    explicit ReturnStatement(std::unique_ptr<Expression> value) : value(std::move(value)) {
+        if (this->value) {
+            this->value->setParent(this);
+        }
+    }
+    
+    Expression* getValue() const { return value.get(); }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    std::unique_ptr<Expression> value;
+};
+
+class IfStatement : public Statement {
+public:
+    IfStatement(std::unique_ptr<Expression> condition, std::unique_ptr<Statement> thenStmt,
+                std::unique_ptr<Statement> elseStmt)
+        : condition(std::move(condition)), thenStmt(std::move(thenStmt)),
+          elseStmt(std::move(elseStmt)) {
+        this->condition->setParent(this);
+        this->thenStmt->setParent(this);
+        if (this->elseStmt) {
+            this->elseStmt->setParent(this);
+        }
+    }
+    
+    Expression* getCondition() const { return condition.get(); }
+    Statement* getThen() const { return thenStmt.get(); }
+    Statement* getElse() const { return elseStmt.get(); }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    std::unique_ptr<Expression> condition;
+    std::unique_ptr<Statement> thenStmt;
+    std::unique_ptr<Statement> elseStmt;
+};
+
+// `for (init; condition; increment) body`; any of the first three may be null.
+class ForStatement : public Statement {
+public:
+    ForStatement(std::unique_ptr<Statement> init, std::unique_ptr<Expression> condition,
+                 std::unique_ptr<Expression> increment, std::unique_ptr<Statement> body)
+        : init(std::move(init)), condition(std::move(condition)),
+          increment(std::move(increment)), body(std::move(body)) {
+        if (this->init) {
+            this->init->setParent(this);
+        }
+        if (this->condition) {
+            this->condition->setParent(this);
+        }
+        if (this->increment) {
+            this->increment->setParent(this);
+        }
+        this->body->setParent(this);
+    }
+    
+    Statement* getInit() const { return init.get(); }
+    Expression* getCondition() const { return condition.get(); }
+    Expression* getIncrement() const { return increment.get(); }
+    Statement* getBody() const { return body.get(); }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    std::unique_ptr<Statement> init;
+    std::unique_ptr<Expression> condition;
+    std::unique_ptr<Expression> increment;
+    std::unique_ptr<Statement> body;
+};
+
+class WhileStatement : public Statement {
+public:
+    WhileStatement(std::unique_ptr<Expression> condition, std::unique_ptr<Statement> body)
+        : condition(std::move(condition)), body(std::move(body)) {
+        this->condition->setParent(this);
+        this->body->setParent(this);
+    }
+    
+    Expression* getCondition() const { return condition.get(); }
+    Statement* getBody() const { return body.get(); }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    std::unique_ptr<Expression> condition;
+    std::unique_ptr<Statement> body;
+};
+
+class DoStatement : public Statement {
+public:
+    DoStatement(std::unique_ptr<Statement> body, std::unique_ptr<Expression> condition)
+        : body(std::move(body)), condition(std::move(condition)) {
+        this->body->setParent(this);
+        this->condition->setParent(this);
+    }
+    
+    Statement* getBody() const { return body.get(); }
+    Expression* getCondition() const { return condition.get(); }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    std::unique_ptr<Statement> body;
+    std::unique_ptr<Expression> condition;
+};
+
+class SwitchStatement : public Statement {
+public:
+    SwitchStatement(std::unique_ptr<Expression> condition, std::unique_ptr<Statement> body)
+        : condition(std::move(condition)), body(std::move(body)) {
+        this->condition->setParent(this);
+        this->body->setParent(this);
+    }
+    
+    Expression* getCondition() const { return condition.get(); }
+    Statement* getBody() const { return body.get(); }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    std::unique_ptr<Expression> condition;
+    std::unique_ptr<Statement> body;
+};
+
+// A `case value:` label, or `default:` when the value is null.
+class CaseStatement : public Statement {
+public:
+    explicit CaseStatement(std::unique_ptr<Expression> value) : value(std::move(value)) {
+        if (this->value) {
+            this->value->setParent(this);
+        }
+    }
+    
+    Expression* getValue() const { return value.get(); }
+    bool isDefault() const { return value == nullptr; }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    std::unique_ptr<Expression> value;
+};
+
+class BreakStatement : public Statement {
+public:
+    void accept(ASTVisitor* visitor) override;
+};
+
+class ContinueStatement : public Statement {
+public:
+    void accept(ASTVisitor* visitor) override;
+};
+
+// Declarations
+
+class FunctionDeclaration : public Declaration {
+public:
+    enum class Qualifier {
+        NONE,
+        KERNEL,
+        VERTEX,
+        FRAGMENT
+    };
+    
+    FunctionDeclaration(Qualifier qualifier, const TypeSpec& returnType, std::string_view name,
+                        NodeList<VariableDeclaration> parameters,
+                        std::unique_ptr<CompoundStatement> body)
+        : Declaration(name), qualifier(qualifier), returnType(returnType, getResource()),
+          parameters(std::move(parameters), getResource()), body(std::move(body)),
+          attributes(getResource()) {
+        for (auto& param : this->parameters) {
+            param->setParent(this);
+        }
+        if (this->body) {
+            this->body->setParent(this);
+        }
+    }
+    
+    Qualifier getQualifier() const { return qualifier; }
+    const TypeSpec& getReturnType() const { return returnType; }
+    const NodeList<VariableDeclaration>& getParameters() const {
+        return parameters;
+    }
+    // Null for a prototype without a body.
+    CompoundStatement* getBody() const { return body.get(); }
+    
+    const std::pmr::vector<Attribute>& getAttributes() const { return attributes; }
+    void setAttributes(std::pmr::vector<Attribute> attrs) { attributes = std::move(attrs); }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    Qualifier qualifier;
+    TypeSpec returnType;
+    NodeList<VariableDeclaration> parameters;
+    std::unique_ptr<CompoundStatement> body;
+    std::pmr::vector<Attribute> attributes;
+};
+
+class StructDeclaration : public Declaration {
+public:
+    StructDeclaration(std::string_view name, NodeList<VariableDeclaration> fields)
+        : Declaration(name), fields(std::move(fields), getResource()) {
+        for (auto& field : this->fields) {
+            field->setParent(this);
+        }
+    }
+    
+    const NodeList<VariableDeclaration>& getFields() const { return fields; }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    NodeList<VariableDeclaration> fields;
+};
+
+// `using namespace metal;` - the name is the namespace being imported.
+class UsingDeclaration : public Declaration {
+public:
+    explicit UsingDeclaration(std::string_view name) : Declaration(name) {}
+    
+    void accept(ASTVisitor* visitor) override;
+};
+
+class TranslationUnit : public ASTNode {
+public:
+    TranslationUnit() : declarations(getResource()) {}
+    explicit TranslationUnit(NodeList<Declaration> declarations)
+        : declarations(std::move(declarations), getResource()) {
+        for (auto& decl : this->declarations) {
+            decl->setParent(this);
+        }
+    }
+    
+    const NodeList<Declaration>& getDeclarations() const {
+        return declarations;
+    }
+    
+    // Hands the top-level declarations to the caller, e.g. for reuse by an
+    // incremental reparse. The translation unit is left empty.
+    NodeList<Declaration> releaseDeclarations() {
+        return std::move(declarations);
+    }
+    
+    void accept(ASTVisitor* visitor) override;
+    
+private:
+    NodeList<Declaration> declarations;
+};
+
 } // namespace ast
 } // namespace msl_parser
 
@@ -170,5 +817,101 @@ inline void BinaryExpression::accept(ASTVisitor* visitor) {
     visitor->visitBinaryExpression(this);
 }
 
+inline void BoolLiteral::accept(ASTVisitor* visitor) {
+    visitor->visitBoolLiteral(this);
+}
+
+inline void ConditionalExpression::accept(ASTVisitor* visitor) {
+    visitor->visitConditionalExpression(this);
+}
+
+inline void CallExpression::accept(ASTVisitor* visitor) {
+    visitor->visitCallExpression(this);
+}
+
+inline void ConstructExpression::accept(ASTVisitor* visitor) {
+    visitor->visitConstructExpression(this);
+}
+
+inline void CastExpression::accept(ASTVisitor* visitor) {
+    visitor->visitCastExpression(this);
+}
+
+inline void MemberExpression::accept(ASTVisitor* visitor) {
+    visitor->visitMemberExpression(this);
+}
+
+inline void IndexExpression::accept(ASTVisitor* visitor) {
+    visitor->visitIndexExpression(this);
+}
+
+inline void VariableDeclaration::accept(ASTVisitor* visitor) {
+    visitor->visitVariableDeclaration(this);
+}
+
+inline void CompoundStatement::accept(ASTVisitor* visitor) {
+    visitor->visitCompoundStatement(this);
+}
+
+inline void DeclarationStatement::accept(ASTVisitor* visitor) {
+    visitor->visitDeclarationStatement(this);
+}
+
+inline void ExpressionStatement::accept(ASTVisitor* visitor) {
+    visitor->visitExpressionStatement(this);
+}
+
+inline void ReturnStatement::accept(ASTVisitor* visitor) {
+    visitor->visitReturnStatement(this);
+}
+
+inline void IfStatement::accept(ASTVisitor* visitor) {
+    visitor->visitIfStatement(this);
+}
+
+inline void ForStatement::accept(ASTVisitor* visitor) {
+    visitor->visitForStatement(this);
+}
+
+inline void WhileStatement::accept(ASTVisitor* visitor) {
+    visitor->visitWhileStatement(this);
+}
+
+inline void DoStatement::accept(ASTVisitor* visitor) {
+    visitor->visitDoStatement(this);
+}
+
+inline void SwitchStatement::accept(ASTVisitor* visitor) {
+    visitor->visitSwitchStatement(this);
+}
+
+inline void CaseStatement::accept(ASTVisitor* visitor) {
+    visitor->visitCaseStatement(this);
+}
+
+inline void BreakStatement::accept(ASTVisitor* visitor) {
+    visitor->visitBreakStatement(this);
+}
+
+inline void ContinueStatement::accept(ASTVisitor* visitor) {
+    visitor->visitContinueStatement(this);
+}
+
+inline void FunctionDeclaration::accept(ASTVisitor* visitor) {
+    visitor->visitFunctionDeclaration(this);
+}
+
+inline void StructDeclaration::accept(ASTVisitor* visitor) {
+    visitor->visitStructDeclaration(this);
+}
+
+inline void UsingDeclaration::accept(ASTVisitor* visitor) {
+    visitor->visitUsingDeclaration(this);
+}
+
+inline void TranslationUnit::accept(ASTVisitor* visitor) {
+    visitor->visitTranslationUnit(this);
+}
+
 } // namespace ast
 } // namespace msl_parser
\ No newline at end of file
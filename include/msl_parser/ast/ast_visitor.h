@@ -8,6 +8,30 @@ class FloatLiteral;
 class Identifier;
 class UnaryExpression;
 class BinaryExpression;
+class BoolLiteral;
+class ConditionalExpression;
+class CallExpression;
+class ConstructExpression;
+class CastExpression;
+class MemberExpression;
+class IndexExpression;
+class VariableDeclaration;
+class CompoundStatement;
+class DeclarationStatement;
+class ExpressionStatement;
+class ReturnStatement;
+class IfStatement;
+class ForStatement;
+class WhileStatement;
+class DoStatement;
+class SwitchStatement;
+class CaseStatement;
+class BreakStatement;
+class ContinueStatement;
+class FunctionDeclaration;
+class StructDeclaration;
+class UsingDeclaration;
+class TranslationUnit;
 
 class ASTVisitor {
 public:
@@ -18,6 +42,33 @@ public:
     virtual void visitIdentifier(Identifier* node) = 0;
     virtual void visitUnaryExpression(UnaryExpression* node) = 0;
     virtual void visitBinaryExpression(BinaryExpression* node) = 0;
+    
+    // Nodes added with the parser default to no-ops so that expression-only
+    // visitors keep compiling.
+    virtual void visitBoolLiteral(BoolLiteral*) {}
+    virtual void visitConditionalExpression(ConditionalExpression*) {}
+    virtual void visitCallExpression(CallExpression*) {}
+    virtual void visitConstructExpression(ConstructExpression*) {}
+    virtual void visitCastExpression(CastExpression*) {}
+    virtual void visitMemberExpression(MemberExpression*) {}
+    virtual void visitIndexExpression(IndexExpression*) {}
+    virtual void visitVariableDeclaration(VariableDeclaration*) {}
+    virtual void visitCompoundStatement(CompoundStatement*) {}
+    virtual void visitDeclarationStatement(DeclarationStatement*) {}
+    virtual void visitExpressionStatement(ExpressionStatement*) {}
+    virtual void visitReturnStatement(ReturnStatement*) {}
+    virtual void visitIfStatement(IfStatement*) {}
+    virtual void visitForStatement(ForStatement*) {}
+    virtual void visitWhileStatement(WhileStatement*) {}
+    virtual void visitDoStatement(DoStatement*) {}
+    virtual void visitSwitchStatement(SwitchStatement*) {}
+    virtual void visitCaseStatement(CaseStatement*) {}
+    virtual void visitBreakStatement(BreakStatement*) {}
+    virtual void visitContinueStatement(ContinueStatement*) {}
+    virtual void visitFunctionDeclaration(FunctionDeclaration*) {}
+    virtual void visitStructDeclaration(StructDeclaration*) {}
+    virtual void visitUsingDeclaration(UsingDeclaration*) {}
+    virtual void visitTranslationUnit(TranslationUnit*) {}
 };
 
 } // namespace ast
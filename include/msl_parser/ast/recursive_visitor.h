@@ -0,0 +1,68 @@
+#pragma once
+
+#include "ast_node.h"
+#include "../stats.h"
+
+namespace msl_parser {
+namespace ast {
+
+// Walks a tree in source order. visitNode() is called for every node before its
+// children; subclasses that override a specific visit method should call the
+// base implementation to keep descending.
+class RecursiveASTVisitor : public ASTVisitor {
+public:
+    void traverse(ASTNode* node) {
+        if (node) {
+#if MSL_PARSER_ENABLE_STATS
+            // Only the outermost call is recorded, as one phase per pass
+            ScopedPhase phase(passName(), traversalDepth == 0);
+            traversalDepth++;
+            node->accept(this);
+            traversalDepth--;
+#else
+            node->accept(this);
+#endif
+        }
+    }
+    
+    void visitIntegerLiteral(IntegerLiteral* node) override;
+    void visitFloatLiteral(FloatLiteral* node) override;
+    void visitIdentifier(Identifier* node) override;
+    void visitUnaryExpression(UnaryExpression* node) override;
+    void visitBinaryExpression(BinaryExpression* node) override;
+    void visitBoolLiteral(BoolLiteral* node) override;
+    void visitConditionalExpression(ConditionalExpression* node) override;
+    void visitCallExpression(CallExpression* node) override;
+    void visitConstructExpression(ConstructExpression* node) override;
+    void visitCastExpression(CastExpression* node) override;
+    void visitMemberExpression(MemberExpression* node) override;
+    void visitIndexExpression(IndexExpression* node) override;
+    void visitVariableDeclaration(VariableDeclaration* node) override;
+    void visitCompoundStatement(CompoundStatement* node) override;
+    void visitDeclarationStatement(DeclarationStatement* node) override;
+    void visitExpressionStatement(ExpressionStatement* node) override;
+    void visitReturnStatement(ReturnStatement* node) override;
+    void visitIfStatement(IfStatement* node) override;
+    void visitForStatement(ForStatement* node) override;
+    void visitWhileStatement(WhileStatement* node) override;
+    void visitDoStatement(DoStatement* node) override;
+    void visitSwitchStatement(SwitchStatement* node) override;
+    void visitCaseStatement(CaseStatement* node) override;
+    void visitBreakStatement(BreakStatement* node) override;
+    void visitContinueStatement(ContinueStatement* node) override;
+    void visitFunctionDeclaration(FunctionDeclaration* node) override;
+    void visitStructDeclaration(StructDeclaration* node) override;
+    void visitUsingDeclaration(UsingDeclaration* node) override;
+    void visitTranslationUnit(TranslationUnit* node) override;
+
+protected:
+    virtual void visitNode(ASTNode*) {}
+    // Phase name for this pass in threadStats()
+    virtual const char* passName() const { return "ast_pass"; }
+
+private:
+    int traversalDepth = 0;
+};
+
+} // namespace ast
+} // namespace msl_parser
@@ -0,0 +1,123 @@
+#ifndef MSL_PARSER_BATCH_H
+#define MSL_PARSER_BATCH_H
+
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "msl_parser/file_reader.h"
+
+namespace msl_parser {
+
+class PreludeDeclarations;
+class PreludeSnapshot;
+
+// What BatchProcessor writes for each file.
+enum class BatchMode : uint8_t {
+    TOKENS,     // the lexer's tokens, without preprocessing
+    AST,        // top-level declarations and node and token counts
+    REFLECTION  // entry points with their parameters, structs and globals
+};
+
+struct BatchOptions {
+    BatchMode mode = BatchMode::AST;
+    // Worker threads; 0 for one per hardware thread
+    unsigned jobs = 0;
+    // Run the preprocessor in front of the parser (AST and reflection modes)
+    bool preprocess = true;
+    // Run the TypeChecker and include its diagnostics
+    bool typeCheck = false;
+    // How run() reads the files
+    FileIo io = FileIo::AUTO;
+    // Bytes run() may keep of the contents and lines of files already
+    // processed, so that files with the same contents are processed once;
+    // 0 processes every file
+    size_t deduplicateMemory = 64 * 1024 * 1024;
+    std::vector<std::string> searchPaths;
+    // -D style definitions: name (possibly with parameters) and replacement
+    std::vector<std::pair<std::string, std::string>> defines;
+    // A prelude snapshot (see prelude.h) every file starts from: the
+    // preprocessor takes its macros and the type checker its declarations
+    std::shared_ptr<const PreludeSnapshot> prelude;
+};
+
+// Expands command-line inputs into a list of files: a directory stands for
+// the .metal files below it, in sorted order, and "@file" for the
+// whitespace-separated arguments in `file`, which may be quoted and may
+// name further response files. Other arguments are taken as files. Returns
+// false with a message in `error` when an input does not exist.
+bool expandInputs(const std::vector<std::string>& arguments, std::vector<std::string>& files,
+                  std::string& error);
+
+// What BatchProcessor::run() did.
+struct BatchStats {
+    size_t processed = 0;       // files lexed, and parsed unless in tokens mode
+    size_t duplicates = 0;      // files given the line of an identical file
+    size_t duplicateBytes = 0;  // the size of those files
+    size_t unreadable = 0;
+};
+
+// Parses many files and writes one line of JSON per file (NDJSON). Every
+// line has "file", "ok" (no errors) and "diagnostics", each with "line",
+// "column", "severity" and "message" (and "file" when it is in an included
+// header), plus the data for the mode:
+//
+//   tokens:     "tokens": [{"type", "text", "line", "column"}, ...]
+//   ast:        "tokenCount", "nodeCount" and
+//               "declarations": [{"kind", "name", "line"}, ...]
+//   reflection: "entryPoints": [{"name", "stage", "line", "returnType",
+//                                "attributes", "parameters"}, ...],
+//               "structs": [{"name", "line", "fields"}, ...],
+//               "globals": [{"name", "type", "line", "attributes"}, ...]
+//
+// Parameters, fields and globals have "name", "type" (as written) and
+// "attributes": [{"name", "argument"}, ...]. Declarations that come from
+// an included header also have "file".
+class BatchProcessor {
+public:
+    explicit BatchProcessor(BatchOptions options = {});
+
+    // Appends the line for `source`, the contents of `path`, to `out`.
+    // Working storage comes from `resource` when one is given; it can be
+    // released once this returns. The files the preprocessor read besides
+    // `path` are stored in `dependencies` when one is given. Returns false
+    // when the file had errors.
+    bool processSource(const std::string& path, const std::string& source, std::string& out,
+                       std::pmr::memory_resource* resource = nullptr,
+                       std::vector<std::string>* dependencies = nullptr) const;
+    // Reads `path` first; a file that cannot be read gets a line with an
+    // error diagnostic.
+    bool processFile(const std::string& path, std::string& out,
+                     std::pmr::memory_resource* resource = nullptr,
+                     std::vector<std::string>* dependencies = nullptr) const;
+
+    // Processes `files` on options.jobs threads and writes their lines to
+    // `out` in the order of `files`. A FileReader reads the files ahead of
+    // the workers, which take each one as soon as its contents arrive.
+    // Each worker formats into its own buffer; whichever worker finishes
+    // the next file due writes out every finished line in order, without
+    // locks. Returns the number of files with errors.
+    //
+    // Files are hashed as they arrive, and a file with the same contents as
+    // one already taken (and, when it may include files relative to its
+    // own directory, in the same directory) is not processed again: it gets
+    // that file's line with its own "file". A duplicate arriving while the
+    // first is still being processed is written by the worker processing
+    // it. See BatchOptions::deduplicateMemory.
+    size_t run(const std::vector<std::string>& files, std::ostream& out,
+               BatchStats* stats = nullptr) const;
+
+    const BatchOptions& getOptions() const { return options; }
+
+private:
+    BatchOptions options;
+    // Shared by the workers, so each prelude declaration is parsed once
+    std::shared_ptr<const PreludeDeclarations> preludeDeclarations;
+};
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_BATCH_H
@@ -0,0 +1,92 @@
+#ifndef MSL_PARSER_BINARY_FILE_H
+#define MSL_PARSER_BINARY_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "msl_parser/hash.h"
+
+namespace msl_parser {
+
+// Building blocks for the library's binary files (prelude snapshots,
+// symbol indexes): a header of section offsets, 8-byte aligned sections of
+// fixed-size records, one shared string table, and open-addressing hash
+// tables that store record indexes + 1.
+
+// Buckets for open addressing with linear probing, at most half full: a
+// power of two, at least 1.
+uint32_t bucketCount(size_t entries);
+
+// A table of bucketCount(names.size()) buckets holding index + 1 of each
+// name, 0 for empty buckets.
+std::vector<uint32_t> hashTable(const std::vector<std::string_view>& names);
+
+// A file mapped read-only, or read into memory where mmap is unavailable.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Returns false when the file cannot be read.
+    bool open(const std::string& path);
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+    bool mapped = false;       // bytes is an mmap'd region, not `buffer`
+    std::vector<char> buffer;
+};
+
+// Lays out a binary file in memory.
+class BinaryWriter {
+public:
+    std::string out;
+
+    // Strings are stored once, however often they occur. `Ref` is the
+    // file's {offset, length} record.
+    template <typename Ref>
+    Ref string(std::string_view text) {
+        auto it = stringOffsets.find(text);
+        uint32_t offset;
+        if (it != stringOffsets.end()) {
+            offset = it->second;
+        } else {
+            offset = static_cast<uint32_t>(strings.size());
+            strings.append(text.data(), text.size());
+            stringOffsets.emplace(keys.emplace_back(text), offset);
+        }
+        return {offset, static_cast<uint32_t>(text.size())};
+    }
+
+    // Appends a section, 8-byte aligned, and returns its offset.
+    template <typename Record>
+    uint64_t section(const std::vector<Record>& records) {
+        return append(records.data(), records.size() * sizeof(Record));
+    }
+
+    uint64_t append(const void* bytes, size_t length);
+
+    const std::string& getStrings() const { return strings; }
+
+    // Writes `out` next to `path` and renames it into place, so a reader
+    // never maps a partly written file.
+    bool save(const std::string& path) const;
+
+private:
+    std::string strings;
+    std::unordered_map<std::string_view, uint32_t> stringOffsets;
+    std::deque<std::string> keys;  // owns the keys of stringOffsets
+};
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_BINARY_FILE_H
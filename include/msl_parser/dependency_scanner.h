@@ -0,0 +1,63 @@
+#ifndef MSL_PARSER_DEPENDENCY_SCANNER_H
+#define MSL_PARSER_DEPENDENCY_SCANNER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace msl_parser {
+
+// Reduces `source` to what decides which files it includes: its #include,
+// #define, #undef and "#pragma once" directives and the conditionals around
+// them, copied as they are. Everything else, including conditional blocks
+// with none of those directives inside, is replaced by its newlines, so
+// lines keep their numbers. Lines without a quote or a slash are skipped
+// with one memchr each; only the others are looked at byte by byte, to
+// keep comments and strings from hiding or faking a directive.
+std::string minimizeDirectives(std::string_view source);
+
+struct DependencyScanOptions {
+    // Worker threads; 0 for one per hardware thread
+    unsigned jobs = 0;
+    std::vector<std::string> searchPaths;
+    // -D style definitions: name (possibly with parameters) and replacement
+    std::vector<std::pair<std::string, std::string>> defines;
+    // Minimized files are kept here between runs; none when empty
+    std::string cachePath;
+};
+
+struct FileDependencies {
+    std::string file;
+    bool readable = false;
+    // Canonical paths of the files included, directly or not, in the order
+    // they were first read
+    std::vector<std::string> dependencies;
+    // Rendered preprocessor errors, e.g. includes that were not found
+    std::string errors;
+};
+
+struct DependencyScanStats {
+    size_t minimized = 0;   // files read and minimized
+    size_t cached = 0;      // files whose minimized form came from the cache
+    size_t unreadable = 0;  // inputs that could not be read
+};
+
+// Finds the files each of `files` includes, like clang-scan-deps: every
+// file is minimized once (see minimizeDirectives()) and the minimized
+// sources are run through the Preprocessor, so only the #if conditions
+// that can change an include or a macro are evaluated, with the real
+// expression rules, include guards and "#pragma once". Inputs are scanned
+// on options.jobs threads sharing one HeaderCache.
+//
+// With a cache path, a file whose size and modification time match the
+// cache is not read at all; the cache is rewritten when new files were
+// minimized. Returns false with a message in `error` when it cannot be.
+bool scanDependencies(const std::vector<std::string>& files, const DependencyScanOptions& options,
+                      std::vector<FileDependencies>& results, std::string& error,
+                      DependencyScanStats* stats = nullptr);
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_DEPENDENCY_SCANNER_H
@@ -0,0 +1,116 @@
+#ifndef MSL_PARSER_ERROR_H
+#define MSL_PARSER_ERROR_H
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace msl_parser {
+
+enum class Severity : uint8_t {
+    ERROR,
+    WARNING,
+    NOTE
+};
+
+enum class DiagID : uint16_t {
+#define DIAG(ID, SEVERITY, MESSAGE) ID,
+#include "msl_parser/diagnostic_kinds.def"
+#undef DIAG
+    NUM_DIAGNOSTICS
+};
+
+// How a diagnostic argument is rendered.
+enum class DiagArgKind : uint8_t {
+    INTEGER,
+    CHARACTER,
+    TOKEN_TYPE
+};
+
+// A compact diagnostic record. Only the ID, the byte offset and raw
+// arguments are stored; message text, line/column and source snippets are
+// produced by DiagnosticPrinter when the diagnostic is printed.
+struct Diagnostic {
+    static constexpr size_t MAX_ARGS = 2;
+
+    DiagID id;
+    uint8_t argCount;
+    DiagArgKind argKinds[MAX_ARGS];
+    uint32_t offset;
+    uint32_t args[MAX_ARGS];
+};
+
+// Collects diagnostics from the lexer and parser without formatting them.
+// Once `errorLimit` errors have been recorded, further diagnostics are
+// dropped and a single note is recorded; the lexer and parser check
+// errorLimitReached() and stop early. A limit of 0 means no limit.
+// Suppressed IDs are neither recorded nor counted.
+class DiagnosticEngine {
+public:
+    static constexpr size_t DEFAULT_ERROR_LIMIT = 20;
+
+    explicit DiagnosticEngine(size_t errorLimit = DEFAULT_ERROR_LIMIT);
+
+    void report(DiagID id, uint32_t offset);
+    void report(DiagID id, uint32_t offset, DiagArgKind kind, uint32_t arg);
+    // Records a prepared diagnostic, e.g. one replayed from another engine.
+    void report(const Diagnostic& diagnostic) { record(diagnostic); }
+
+    void suppress(DiagID id) { suppressed.set(static_cast<size_t>(id)); }
+    void unsuppress(DiagID id) { suppressed.reset(static_cast<size_t>(id)); }
+    bool isSuppressed(DiagID id) const { return suppressed.test(static_cast<size_t>(id)); }
+
+    void setErrorLimit(size_t limit) { errorLimit = limit; }
+    size_t getErrorLimit() const { return errorLimit; }
+
+    const std::vector<Diagnostic>& getDiagnostics() const { return diagnostics; }
+    size_t getErrorCount() const { return errorCount; }
+    bool hasErrors() const { return errorCount > 0; }
+    bool errorLimitReached() const { return errorLimit != 0 && errorCount >= errorLimit; }
+
+    static Severity getSeverity(DiagID id);
+
+private:
+    size_t errorLimit;
+    size_t errorCount = 0;
+    std::bitset<static_cast<size_t>(DiagID::NUM_DIAGNOSTICS)> suppressed;
+    std::vector<Diagnostic> diagnostics;
+
+    void record(const Diagnostic& diagnostic);
+};
+
+// Turns diagnostics for one source buffer into text. Line starts are
+// indexed on first use, so resolving many offsets costs one scan of the
+// source plus a binary search each.
+class DiagnosticPrinter {
+public:
+    explicit DiagnosticPrinter(const std::string& source, const std::string& fileName = "");
+
+    // 1-based line and byte column of `offset`.
+    void resolve(uint32_t offset, uint32_t& line, uint32_t& column) const;
+
+    // The message text alone, e.g. "unexpected character '@'".
+    std::string formatMessage(const Diagnostic& diagnostic) const;
+
+    // "file:line:column: error: message", followed by the source line and a
+    // caret under the offending column.
+    std::string render(const Diagnostic& diagnostic) const;
+
+    void print(std::ostream& out, const DiagnosticEngine& engine) const;
+
+private:
+    const std::string& source;
+    std::string fileName;
+    mutable std::vector<uint32_t> lineStarts;
+
+    void indexLines() const;
+};
+
+const char* severityToString(Severity severity);
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_ERROR_H
@@ -0,0 +1,98 @@
+#ifndef MSL_PARSER_FILE_READER_H
+#define MSL_PARSER_FILE_READER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace msl_parser {
+
+// How FileReader does its I/O.
+enum class FileIo : uint8_t {
+    AUTO,      // io_uring where available, THREADS otherwise
+    IO_URING,  // batched opens, stats and reads through io_uring (Linux)
+    THREADS    // a pool of threads calling open() and pread()
+};
+
+struct FileReaderOptions {
+    FileIo io = FileIo::AUTO;
+    // Files being read at once: the files in flight on the ring, or the
+    // threads of the pool
+    unsigned depth = 32;
+    // Files read but not yet taken by next(); reading pauses beyond this
+    size_t maxQueued = 256;
+};
+
+// Reads a list of files in the background so their I/O overlaps with the
+// work done on them. With io_uring, one thread keeps `depth` files in
+// flight: the open and the statx of a file are submitted together, then
+// one read of its whole size, then the close, and every submission and
+// wait is a single io_uring_enter for all the files at once. Where
+// io_uring is unavailable or refused (seccomp), or lacks those operations
+// (kernels before 5.6), `depth` threads read with pread instead.
+//
+// Files are handed out in the order they finish, each to one caller of
+// next(), so worker threads can lex or parse a file as soon as its bytes
+// are in memory.
+class FileReader {
+public:
+    struct File {
+        size_t index = 0;  // in the list given to the constructor
+        bool readable = false;
+        std::string contents;
+    };
+
+    // Starts reading `files`, which must outlive the reader.
+    explicit FileReader(const std::vector<std::string>& files, FileReaderOptions options = {});
+    // Stops reading and waits for the I/O in flight; files not yet taken
+    // are dropped.
+    ~FileReader();
+
+    FileReader(const FileReader&) = delete;
+    FileReader& operator=(const FileReader&) = delete;
+
+    // Waits for the next file that has been read, or found unreadable.
+    // Returns false once every file has been handed out. Safe to call from
+    // several threads.
+    bool next(File& file);
+
+    // The backend in use: IO_URING or THREADS.
+    FileIo getIo() const { return io; }
+
+    // Whether this process can set up an io_uring that opens, stats and
+    // reads files.
+    static bool isIoUringAvailable();
+
+private:
+    class Ring;
+
+    const std::vector<std::string>& files;
+    FileReaderOptions options;
+    FileIo io = FileIo::THREADS;
+    std::unique_ptr<Ring> ring;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable readyCondition;  // a file was queued
+    std::condition_variable spaceCondition;  // a file was taken, or stop
+    std::deque<File> queue;
+    size_t remaining;        // files not yet handed out by next()
+    size_t nextFile = 0;     // THREADS: the next file to read
+    bool stopping = false;
+
+    void readWithRing();
+    void readWithThreads();
+    // Waits until the queue has room; false when stopping
+    bool waitForSpace();
+    void deliver(File file);
+};
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_FILE_READER_H
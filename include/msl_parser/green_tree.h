@@ -0,0 +1,97 @@
+#ifndef MSL_PARSER_GREEN_TREE_H
+#define MSL_PARSER_GREEN_TREE_H
+
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "msl_parser/ast/ast_node.h"
+#include "msl_parser/stats.h"
+#include "msl_parser/token.h"
+
+namespace msl_parser {
+
+// A node of an immutable, lossless syntax tree. Leaves are tokens, each
+// holding its text together with the trivia before it; inner nodes have the
+// kind of the AST node they stand for and hold no positions, only the
+// widths of their children. Concatenating the leaves reproduces the
+// source. Green nodes are interned by a GreenNodeCache, so equal subtrees,
+// within one tree or across the trees of successive edits, are one node.
+class GreenNode {
+public:
+    GreenNode(const GreenNode&) = delete;
+    GreenNode& operator=(const GreenNode&) = delete;
+
+    bool isToken() const { return token; }
+    // Only meaningful for inner nodes and tokens respectively.
+    NodeKind getNodeKind() const { return static_cast<NodeKind>(kind); }
+    TokenType getTokenType() const { return static_cast<TokenType>(kind); }
+
+    // Bytes of source text covered, trivia included.
+    uint32_t getWidth() const { return width; }
+
+    // Of a token: its leading trivia followed by its lexeme.
+    std::string_view getText() const { return text; }
+    std::string_view getTrivia() const { return std::string_view(text).substr(0, triviaLength); }
+
+    const std::vector<const GreenNode*>& getChildren() const { return children; }
+
+    // Appends the source text of the subtree.
+    void writeText(std::string& out) const;
+
+private:
+    friend class GreenNodeCache;
+
+    GreenNode() = default;
+
+    uint8_t kind = 0;
+    bool token = false;
+    uint32_t width = 0;
+    uint32_t triviaLength = 0;
+    size_t hash = 0;
+    std::string text;
+    std::vector<const GreenNode*> children;
+
+    bool sameAs(const GreenNode& other) const;
+};
+
+// Builds green trees and owns their nodes. Nodes stay valid until they are
+// released by retain() or clear(); reuse one cache across the versions of a
+// document so that unchanged subtrees are shared.
+class GreenNodeCache {
+public:
+    GreenNodeCache() = default;
+    GreenNodeCache(const GreenNodeCache&) = delete;
+    GreenNodeCache& operator=(const GreenNodeCache&) = delete;
+
+    // The green tree of one parse. `tokens` must come from lexing `source`
+    // without preprocessing, and `unit` from parsing them. Nodes nest by
+    // their source ranges; tokens that no node's range covers belong to the
+    // nearest enclosing node, ultimately the translation unit.
+    const GreenNode* build(std::string_view source, const std::pmr::vector<Token>& tokens,
+                           ast::TranslationUnit* unit);
+
+    // Distinct nodes and tokens stored.
+    size_t size() const { return nodes.size(); }
+
+    // Frees every node not reachable from `roots`.
+    void retain(const std::vector<const GreenNode*>& roots);
+    void clear() { nodes.clear(); }
+
+private:
+    // Keyed by hash; equal hashes are told apart by GreenNode::sameAs
+    std::unordered_multimap<size_t, std::unique_ptr<GreenNode>> nodes;
+
+    friend class GreenTreeBuilder;
+
+    const GreenNode* makeToken(TokenType type, std::string_view text, uint32_t triviaLength);
+    const GreenNode* makeNode(NodeKind kind, std::vector<const GreenNode*> children);
+    const GreenNode* intern(std::unique_ptr<GreenNode> candidate);
+};
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_GREEN_TREE_H
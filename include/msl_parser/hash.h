@@ -0,0 +1,29 @@
+#ifndef MSL_PARSER_HASH_H
+#define MSL_PARSER_HASH_H
+
+#include <cstdint>
+#include <string_view>
+
+namespace msl_parser {
+
+// 32-bit FNV-1a, for name lookups and the hash tables stored in files.
+inline uint32_t hashName(std::string_view name) {
+    uint32_t hash = 2166136261u;
+    for (char c : name) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+// 64-bit FNV-1a, for recognizing unchanged file contents.
+inline uint64_t hashContent(std::string_view data) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : data) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_HASH_H
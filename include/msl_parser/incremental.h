@@ -0,0 +1,74 @@
+#ifndef MSL_PARSER_INCREMENTAL_H
+#define MSL_PARSER_INCREMENTAL_H
+
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include "msl_parser/ast/ast_node.h"
+#include "msl_parser/node_index.h"
+#include "msl_parser/token.h"
+
+namespace msl_parser {
+
+// Replaces `removedLength` bytes at `offset` with `insertedText`.
+struct TextEdit {
+    size_t offset;
+    size_t removedLength;
+    std::string insertedText;
+};
+
+// Keeps the tokens and AST of a document up to date across edits. Each edit
+// relexes from the nearest safe restart point before it until the token
+// stream lines up with the previous one again, then reparses only the
+// top-level declarations that overlap the relexed region. Declarations
+// outside it are moved into the new tree unchanged (with their locations
+// shifted), so pointers to them stay valid.
+class IncrementalParser {
+public:
+    struct EditStats {
+        size_t relexedTokens = 0;
+        size_t reusedTokens = 0;
+        size_t reparsedDeclarations = 0;
+        size_t reusedDeclarations = 0;
+    };
+
+    explicit IncrementalParser(const std::string& source);
+
+    void applyEdit(const TextEdit& edit);
+
+    const std::string& getSource() const { return source; }
+    const std::pmr::vector<Token>& getTokens() const { return tokens; }
+    ast::TranslationUnit* getTranslationUnit() const { return unit.get(); }
+    const EditStats& getLastEditStats() const { return stats; }
+
+    // The offset index of the current tree, built on first use after each
+    // edit.
+    const NodeIndex& getNodeIndex();
+
+private:
+    std::string source;
+    std::pmr::vector<Token> tokens;
+    std::unique_ptr<ast::TranslationUnit> unit;
+    EditStats stats;
+    NodeIndex nodeIndex;
+    bool nodeIndexValid = false;
+
+    // Where the relexed tokens rejoined the previous token stream, and how
+    // locations from that point on move.
+    struct Resync {
+        bool found = false;
+        size_t oldOffset = 0;
+        long long offsetDelta = 0;
+        uint32_t oldLine = 0;
+        long long lineDelta = 0;
+        long long columnDelta = 0;
+    };
+
+    Resync relex(const TextEdit& edit, size_t& restartOffset);
+    void reparse(size_t restartOffset, const Resync& resync);
+};
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_INCREMENTAL_H
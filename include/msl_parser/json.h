@@ -0,0 +1,93 @@
+#ifndef MSL_PARSER_JSON_H
+#define MSL_PARSER_JSON_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace msl_parser {
+
+// A parsed JSON document.
+struct JsonValue {
+    enum class Kind { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+    Kind kind = Kind::NUL;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    std::vector<JsonValue> items;
+    std::map<std::string, JsonValue, std::less<>> members;
+
+    // The member `key` of an object; null when absent or not an object.
+    const JsonValue* get(std::string_view key) const;
+
+    bool isNull() const { return kind == Kind::NUL; }
+    bool isObject() const { return kind == Kind::OBJECT; }
+
+    // The member `key` when it has the expected kind, `fallback` otherwise.
+    double numberOr(std::string_view key, double fallback) const;
+    std::string stringOr(std::string_view key, const std::string& fallback) const;
+};
+
+// Parses `text` into `value`. Escapes, including \u surrogate pairs, are
+// decoded to UTF-8. Nesting is limited to MAX_DEPTH levels.
+class JsonReader {
+public:
+    static constexpr int MAX_DEPTH = 64;
+
+    explicit JsonReader(std::string_view text) : text(text) {}
+
+    // False unless the whole text is one valid JSON value.
+    bool read(JsonValue& value);
+
+private:
+    std::string_view text;
+    size_t position = 0;
+
+    void skipSpace();
+    bool consume(char c);
+    bool consumeWord(std::string_view word);
+    bool parseString(std::string& out);
+    bool parseHex(uint32_t& code);
+    bool parseValue(JsonValue& value, int depth);
+};
+
+// Appends compact JSON to a string. Commas between members and elements
+// are inserted automatically; the caller is responsible for balancing
+// begin and end calls and for giving every object member a key.
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : out(out) {}
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    // The key of the next object member.
+    void key(std::string_view name);
+
+    void string(std::string_view text);
+    void number(int64_t value);
+    void boolean(bool value);
+    void null();
+    // A parsed value, e.g. a request ID echoed back to the sender.
+    void value(const JsonValue& value);
+    // Already-formatted JSON, copied as it is.
+    void raw(std::string_view json);
+
+    // `text` as a quoted JSON string, with control characters, quotes and
+    // backslashes escaped. Other bytes are copied as they are.
+    static void escape(std::string& out, std::string_view text);
+
+private:
+    std::string& out;
+    bool needsComma = false;
+
+    void separate();
+};
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_JSON_H
@@ -0,0 +1,90 @@
+#ifndef MSL_PARSER_LANGUAGE_SERVER_H
+#define MSL_PARSER_LANGUAGE_SERVER_H
+
+#include <chrono>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "msl_parser/json.h"
+
+namespace msl_parser {
+
+struct LanguageServerOptions {
+    // How long a document must go without edits before it is analyzed
+    std::chrono::milliseconds debounce{150};
+    // Include the TypeChecker's diagnostics
+    bool typeCheck = true;
+};
+
+// A Language Server Protocol server for Metal. Each open document keeps an
+// IncrementalParser, so an edit relexes and reparses only the declarations
+// it touches, and the semantic tokens and document symbols computed from it
+// are cached until the next edit. Diagnostics come from a full lex, parse
+// and type check on a background thread, started once a document has been
+// left alone for the debounce interval; an analysis overtaken by a newer
+// edit is abandoned between phases, and its results are never published.
+//
+// Supported: initialize, shutdown, exit, textDocument/didOpen, didChange
+// (incremental and full), didClose, semanticTokens/full, documentSymbol,
+// and publishDiagnostics. Positions are in UTF-16 code units, as the
+// protocol requires.
+class LanguageServer {
+public:
+    // Receives each outgoing JSON-RPC message, one call at a time, from the
+    // thread handling requests or from the analysis thread.
+    using Output = std::function<void(const std::string& message)>;
+
+    explicit LanguageServer(Output output, LanguageServerOptions options = {});
+    ~LanguageServer();
+
+    LanguageServer(const LanguageServer&) = delete;
+    LanguageServer& operator=(const LanguageServer&) = delete;
+
+    // Handles one JSON-RPC message.
+    void handle(std::string_view message);
+
+    bool isShutdown() const { return shutdown; }
+    bool hasExited() const { return exited; }
+
+    // Waits until every scheduled analysis has finished or been abandoned.
+    void waitForAnalysis();
+
+    // Serves the "Content-Length" framed protocol on `in` and `out` until
+    // an exit notification or the end of the input. Returns the process
+    // exit code: 0 when shutdown came before exit, 1 otherwise.
+    static int run(std::istream& in, std::ostream& out, LanguageServerOptions options = {});
+
+private:
+    struct Document;
+    class Analyzer;
+
+    Output output;
+    LanguageServerOptions options;
+    std::mutex outputMutex;
+    std::unordered_map<std::string, std::unique_ptr<Document>> documents;
+    std::unique_ptr<Analyzer> analyzer;
+    bool shutdown = false;
+    bool exited = false;
+
+    void send(const std::string& message);
+    void respond(const JsonValue& id, const std::string& result);
+    void respondError(const JsonValue& id, int code, const std::string& message);
+
+    std::string initialize();
+    void didOpen(const JsonValue& params);
+    void didChange(const JsonValue& params);
+    void didClose(const JsonValue& params);
+    std::string semanticTokens(const JsonValue& params);
+    std::string documentSymbols(const JsonValue& params);
+    Document* findDocument(const JsonValue& params);
+    void scheduleAnalysis(const std::string& uri, Document& document);
+};
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_LANGUAGE_SERVER_H
@@ -1,39 +1,66 @@
 #ifndef MSL_PARSER_LEXER_H
 #define MSL_PARSER_LEXER_H
 
+#include <memory_resource>
 #include <string>
 #include <vector>
+#include "msl_parser/error.h"
+#include "msl_parser/memory.h"
 #include "msl_parser/token.h"
 
 namespace msl_parser {
 
 class Lexer {
 public:
-    explicit Lexer(const std::string& source);
-    std::vector<Token> scanTokens();
+    // Lexical errors (unknown characters, unterminated strings and comments)
+    // are reported to `diagnostics` when one is given. Scanning stops early
+    // once its error limit is reached, or once `budget` is exceeded. The
+    // lexer's copy of the source, the token vector and the lexemes are
+    // allocated from `resource`, or the default resource when none is given.
+    explicit Lexer(const std::string& source, DiagnosticEngine* diagnostics = nullptr,
+                   MemoryBudget* budget = nullptr, std::pmr::memory_resource* resource = nullptr);
+
+    // Scans the whole source. The token vector is moved out, so call this
+    // once per lexer.
+    std::pmr::vector<Token> scanTokens();
+    
+    // Resumes scanning at a token boundary inside the source. The line and
+    // column are those of the token that starts at `offset`.
+    void seek(size_t offset, uint32_t line, uint32_t column);
+    
+    // Scans the next token into `token`. Returns false once the input is
+    // exhausted, in which case `token` is the END_OF_FILE token.
+    bool scanNextToken(Token& token);
 
 private:
-    std::string source;
-    std::vector<Token> tokens;
+    std::pmr::string source;
+    DiagnosticEngine* diagnostics;
+    MemoryBudget* budget;
+    std::pmr::vector<Token> tokens;
     size_t start = 0;
     size_t current = 0;
     uint32_t line = 1;
     uint32_t column = 1;
+    bool atLineStart = true;  // no token yet on the current line
     
     void scanToken();
+    void operatorToken(char c);
+    void blockComment();
     void number();
     void identifier();
     void string();
     
-    bool isDigit(char c);
-    bool isHexDigit(char c);
-    bool isAlpha(char c);
-    bool isAlphaNumeric(char c);
     bool isAtEnd();
     char advance();
     char peek();
     char peekNext();
-    void addToken(TokenType type);
+    void addToken(TokenType type, uint8_t numericFlags = 0);
+    void chargeToken(size_t previousCapacity);
+    void chargeDiagnostics(size_t previousCapacity);
+    void chargeMemory(MemoryCategory category, size_t bytes);
+    void error(DiagID id);
+    void error(DiagID id, DiagArgKind kind, uint32_t arg);
+    void stopIfErrorLimitReached();
 };
 
 } // namespace msl_parser
@@ -0,0 +1,70 @@
+#ifndef MSL_PARSER_MEMORY_H
+#define MSL_PARSER_MEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+
+namespace msl_parser {
+
+namespace ast {
+class ASTNode;
+} // namespace ast
+
+enum class MemoryCategory : uint8_t {
+    SOURCE,  // the lexer's copy of the source text
+    TOKENS,  // token vector storage
+    LEXEMES, // heap storage of token lexemes
+    AST,     // AST nodes and the strings and vectors they own
+    TABLES,  // diagnostic records
+    NUM_CATEGORIES
+};
+
+const char* memoryCategoryToString(MemoryCategory category);
+
+// The bytes held by one parse, by category, with an optional hard limit.
+// Pass the same budget to the Lexer and the Parser of a parse. Once the
+// total exceeds the limit, each reports MEMORY_LIMIT_EXCEEDED and stops as
+// if the input had ended there. A limit of 0 means no limit.
+//
+// Usage is what the lexer and parser asked the allocator for: vector and
+// string capacities and node sizes, not allocator overhead. Storage that
+// is freed again, such as a token vector's buffer before it grows, is not
+// counted.
+class MemoryBudget {
+public:
+    explicit MemoryBudget(size_t limit = 0) : limit(limit) {}
+
+    // Returns false once the total is over the limit.
+    bool charge(MemoryCategory category, size_t bytes);
+    void release(MemoryCategory category, size_t bytes);
+
+    size_t getUsage(MemoryCategory category) const {
+        return usage[static_cast<size_t>(category)];
+    }
+    size_t getTotal() const { return total; }
+    size_t getPeak() const { return peak; }
+
+    void setLimit(size_t limit) { this->limit = limit; }
+    size_t getLimit() const { return limit; }
+    bool limitExceeded() const { return limit != 0 && total > limit; }
+
+private:
+    size_t limit;
+    size_t usage[static_cast<size_t>(MemoryCategory::NUM_CATEGORIES)] = {};
+    size_t total = 0;
+    size_t peak = 0;
+};
+
+// Heap bytes owned by `text`: 0 while it fits in the string object itself.
+size_t heapBytes(const std::string& text);
+size_t heapBytes(const std::pmr::string& text);
+
+// Bytes of `node`, its allocation header and the strings and vectors it
+// owns. Child nodes are not included.
+size_t nodeBytes(const ast::ASTNode& node);
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_MEMORY_H
@@ -0,0 +1,62 @@
+#ifndef MSL_PARSER_NODE_INDEX_H
+#define MSL_PARSER_NODE_INDEX_H
+
+#include <cstdint>
+#include <vector>
+#include "msl_parser/ast/ast_node.h"
+
+namespace msl_parser {
+
+// Maps source offsets to the AST nodes whose ranges contain them, e.g. for
+// hover or for attaching a diagnostic to a node. Built once per parse from
+// the nodes' SourceRange offsets (end exclusive): the starts and ends of
+// all ranges cut the source into segments, each recording the innermost
+// range covering it, so findInnermost() is one binary search, O(log n)
+// however deep the tree. Each range also keeps the nearest range enclosing
+// it, which findEnclosing() follows outwards. Nodes with empty ranges are
+// not indexed.
+//
+// The index holds raw pointers into the tree; rebuild or clear it whenever
+// the tree changes.
+class NodeIndex {
+public:
+    NodeIndex() = default;
+    explicit NodeIndex(ast::ASTNode* root) { build(root); }
+
+    // Replaces the index with the nodes under `root`, reusing its storage.
+    void build(ast::ASTNode* root);
+    void clear();
+
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+
+    // The smallest indexed node whose range contains `offset`, or nullptr.
+    ast::ASTNode* findInnermost(size_t offset) const;
+
+    // Every indexed node whose range contains `offset`, innermost first.
+    std::vector<ast::ASTNode*> findEnclosing(size_t offset) const;
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Entry {
+        ast::ASTNode* node;
+        uint32_t end;
+        // The nearest earlier entry whose range contains this one
+        uint32_t parent;
+    };
+
+    // Sorted by the start of the range, enclosing ranges first
+    std::vector<Entry> entries;
+    // Segment starts, kept apart for the binary search, and the innermost
+    // entry covering each segment (NONE for gaps); a segment ends where
+    // the next begins
+    std::vector<uint32_t> segmentBegins;
+    std::vector<uint32_t> segmentEntries;
+
+    uint32_t find(size_t offset) const;
+};
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_NODE_INDEX_H
@@ -0,0 +1,40 @@
+#ifndef MSL_PARSER_NUMERIC_LITERAL_H
+#define MSL_PARSER_NUMERIC_LITERAL_H
+
+#include <cstdint>
+#include "msl_parser/token.h"
+
+namespace msl_parser {
+
+enum class LiteralStatus : uint8_t {
+    OK,
+    OUT_OF_RANGE, // too large for the destination type
+    INVALID,      // not a well-formed literal, e.g. "0x" or "09"
+};
+
+// Converts literal spellings to values on demand. Conversion is exact
+// (floating-point results are correctly rounded, ties to even), does not
+// depend on the locale and does not allocate. Suffixes (u, f, h) are
+// accepted and ignored; the lexer records them as NumericFlags.
+
+// Decimal, hexadecimal (0x), binary (0b) and octal (leading 0) integers.
+LiteralStatus decodeIntegerLiteral(const char* begin, const char* end, uint64_t& value);
+
+// Decimal floating-point literals with an optional fraction and exponent.
+// Values too large for the type become infinity and report OUT_OF_RANGE.
+LiteralStatus decodeFloatLiteral(const char* begin, const char* end, float& value);
+LiteralStatus decodeFloatLiteral(const char* begin, const char* end, double& value);
+
+inline LiteralStatus decodeIntegerLiteral(const Token& token, uint64_t& value) {
+    return decodeIntegerLiteral(token.lexeme.data(), token.lexeme.data() + token.lexeme.size(),
+                                value);
+}
+
+inline LiteralStatus decodeFloatLiteral(const Token& token, float& value) {
+    return decodeFloatLiteral(token.lexeme.data(), token.lexeme.data() + token.lexeme.size(),
+                              value);
+}
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_NUMERIC_LITERAL_H
@@ -0,0 +1,178 @@
+#ifndef MSL_PARSER_PARSER_H
+#define MSL_PARSER_PARSER_H
+
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <utility>
+#include <vector>
+#include "msl_parser/ast/ast_node.h"
+#include "msl_parser/error.h"
+#include "msl_parser/memory.h"
+#include "msl_parser/stats.h"
+#include "msl_parser/token.h"
+
+namespace msl_parser {
+
+// Recursive-descent parser with panic-mode error recovery. After an error
+// it skips to the next `;`, `}` or top-level keyword and carries on, and it
+// reports nothing further until it has resynchronized. Every token is
+// skipped at most once, speculation is bounded, and nesting is capped at
+// MAX_NESTING_DEPTH, so parsing stays linear and stack-safe on arbitrary
+// input. Parsing stops once the diagnostic engine's error limit is reached.
+class Parser {
+public:
+    static constexpr int MAX_NESTING_DEPTH = 256;
+    static constexpr size_t MAX_TEMPLATE_TOKENS = 64;
+
+    // The token vector must end with END_OF_FILE and outlive the parser.
+    // Errors go to `diagnostics`, or to an engine owned by the parser. AST
+    // storage is charged to `budget`, usually the one the lexer charged;
+    // parsing stops once it is exceeded. Nodes are allocated from
+    // `resource`, which must outlive the tree, or from the global heap when
+    // none is given.
+    explicit Parser(const std::pmr::vector<Token>& tokens,
+                    DiagnosticEngine* diagnostics = nullptr, MemoryBudget* budget = nullptr,
+                    std::pmr::memory_resource* resource = nullptr);
+
+    std::unique_ptr<ast::TranslationUnit> parse();
+
+    // Parses one top-level declaration at the current position and appends
+    // it to `declarations` (a global like `constant float a, b;` yields more
+    // than one). Returns false if nothing could be parsed, after skipping to
+    // the next point where parsing can resume. Incremental reparsing uses
+    // this to parse only the declarations touched by an edit.
+    bool parseTopLevelDeclaration(ast::NodeList<ast::Declaration>& declarations);
+
+    size_t getPosition() const { return current; }
+    void setPosition(size_t position);
+    bool isAtEnd() const;
+
+    bool hadError() const { return errorCount > 0; }
+    const DiagnosticEngine& getDiagnostics() const { return *diagnostics; }
+
+private:
+    class NestingGuard;
+
+    const std::pmr::vector<Token>& tokens;
+    DiagnosticEngine ownDiagnostics;
+    DiagnosticEngine* diagnostics;
+    MemoryBudget* budget;
+    std::pmr::memory_resource* resource; // null for the global heap
+    size_t current = 0;
+    size_t errorCount = 0;
+    int depth = 0;
+    // Set after an error until the parser has resynchronized; suppresses
+    // the cascade of follow-on errors.
+    bool panicMode = false;
+    // Set when the first half of a `]]` token has been consumed as `]`, as
+    // in `a[b[0]]`, where the lexer produces ATTRIBUTE_RIGHT.
+    bool splitAttributeRight = false;
+    bool speculating = false;
+    bool memoryLimitReached = false;
+
+    // Error recovery
+    void synchronizeTopLevel();
+    void synchronizeStatement();
+    bool isTopLevelKeyword() const;
+
+    // Declarations
+    bool parseTopLevel(ast::NodeList<ast::Declaration>& declarations);
+    bool parseType(ast::TypeSpec& type);
+    bool parseTemplateArguments(ast::TypeSpec& type);
+    bool parseAttributes(std::pmr::vector<ast::Attribute>& attributes);
+    bool isDeclarationStart();
+    std::unique_ptr<ast::Declaration> parseUsingDeclaration(size_t begin);
+    std::unique_ptr<ast::Declaration> parseStructDeclaration(size_t begin);
+    std::unique_ptr<ast::Declaration> parseFunctionDeclaration(
+        size_t begin, ast::FunctionDeclaration::Qualifier qualifier, const ast::TypeSpec& returnType,
+        std::string_view name, std::pmr::vector<ast::Attribute> attributes);
+    std::unique_ptr<ast::VariableDeclaration> parseParameter();
+    bool parseVariableList(size_t begin, ast::VariableDeclaration::Kind kind,
+                           const ast::TypeSpec& type,
+                           ast::NodeList<ast::VariableDeclaration>& variables);
+
+    // Statements
+    std::unique_ptr<ast::Statement> parseStatement();
+    std::unique_ptr<ast::CompoundStatement> parseCompoundStatement();
+    std::unique_ptr<ast::Statement> parseDeclarationStatement();
+    std::unique_ptr<ast::Statement> parseExpressionStatement();
+    std::unique_ptr<ast::Statement> parseIfStatement();
+    std::unique_ptr<ast::Statement> parseForStatement();
+    std::unique_ptr<ast::Statement> parseWhileStatement();
+    std::unique_ptr<ast::Statement> parseDoStatement();
+    std::unique_ptr<ast::Statement> parseSwitchStatement();
+    std::unique_ptr<ast::Statement> parseCaseStatement();
+    std::unique_ptr<ast::Statement> parseReturnStatement();
+
+    // Expressions
+    std::unique_ptr<ast::Expression> parseExpression();
+    std::unique_ptr<ast::Expression> parseAssignment();
+    std::unique_ptr<ast::Expression> parseConditional();
+    std::unique_ptr<ast::Expression> parseBinary(int minPrecedence);
+    std::unique_ptr<ast::Expression> parseUnary();
+    std::unique_ptr<ast::Expression> parsePostfix();
+    std::unique_ptr<ast::Expression> parsePrimary();
+    bool parseArguments(ast::NodeList<ast::Expression>& arguments);
+    std::unique_ptr<ast::Expression> parseIntegerLiteral(const Token& token);
+    std::unique_ptr<ast::Expression> parseFloatLiteral(const Token& token);
+
+    // Token helpers
+    const Token& peek() const;
+    const Token& peekAt(size_t distance) const;
+    const Token& previous() const;
+    bool check(TokenType type) const;
+    bool checkIdentifier(const char* name) const;
+    bool match(TokenType type);
+    const Token& advance();
+    bool expect(TokenType type, DiagID id);
+    bool expect(TokenType type, DiagID id, TokenType context);
+    bool consumeRightBracket();
+    void error(DiagID id);
+    void reportLiteral(DiagID id, const Token& token);
+    void chargeDiagnostics(size_t previousCapacity);
+    void chargeMemory(MemoryCategory category, size_t bytes);
+    void stopForMemoryLimit();
+
+    // Where nodes, and the names and lists inside them, are allocated.
+    std::pmr::memory_resource* memory() const {
+        return resource ? resource : std::pmr::get_default_resource();
+    }
+
+    // Every AST node is allocated here.
+    template <typename T, typename... Args>
+    std::unique_ptr<T> makeNode(Args&&... args) {
+        static_assert(alignof(T) <= alignof(void*), "AST nodes are allocated pointer-aligned");
+        MSL_PARSER_STATS({
+            Stats& stats = threadStats();
+            stats.nodesByKind[static_cast<size_t>(NodeKindOf<T>::value)]++;
+            stats.arenaBytes += sizeof(T);
+        })
+        std::unique_ptr<T> node(resource ? new (resource) T(std::forward<Args>(args)...)
+                                         : new T(std::forward<Args>(args)...));
+        if (budget) {
+            chargeMemory(MemoryCategory::AST, nodeBytes(*node));
+        }
+        return node;
+    }
+
+    template <typename T>
+    void setAttributes(T& node, std::pmr::vector<ast::Attribute> attributes) {
+        size_t before = budget ? nodeBytes(node) : 0;
+        node.setAttributes(std::move(attributes));
+        if (budget) {
+            chargeMemory(MemoryCategory::AST, nodeBytes(node) - before);
+        }
+    }
+
+    ast::SourceRange rangeFrom(size_t startToken) const;
+    template <typename T>
+    std::unique_ptr<T> finish(std::unique_ptr<T> node, size_t startToken) {
+        node->setSourceRange(rangeFrom(startToken));
+        return node;
+    }
+};
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_PARSER_H
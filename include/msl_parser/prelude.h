@@ -0,0 +1,163 @@
+#ifndef MSL_PARSER_PRELUDE_H
+#define MSL_PARSER_PRELUDE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "msl_parser/binary_file.h"
+#include "msl_parser/preprocessor.h"
+#include "msl_parser/stats.h"
+#include "msl_parser/token.h"
+
+namespace msl_parser {
+
+namespace ast {
+class Declaration;
+}
+
+// A prelude (the common header every shader of a project includes)
+// preprocessed once and saved as a binary file: its tokens, its macro
+// table, its top-level declarations and the files it included. Opening a
+// snapshot maps the file read-only and checks only its header; records are
+// read, and bounds-checked, when they are looked up, so opening and using a
+// snapshot costs the same whatever the size of the prelude. Macros and
+// declarations are found by name through hash tables stored in the file.
+//
+// Snapshots are specific to the library version and byte order that wrote
+// them; open() rejects any other.
+class PreludeSnapshot {
+public:
+    struct Declaration {
+        NodeKind kind;  // FunctionDeclaration, StructDeclaration, ...
+        std::string_view name;
+        uint32_t firstToken;
+        uint32_t tokenCount;
+    };
+
+    // Writes a snapshot of `tokens`, the output of `preprocessor` for the
+    // prelude, with the macros it has defined and the files it read. Top-level
+    // declarations are found by parsing the tokens. The file is replaced
+    // atomically. Returns false when it cannot be written.
+    static bool write(const std::string& path, const Preprocessor& preprocessor,
+                      const std::pmr::vector<Token>& tokens);
+
+    // Maps the snapshot at `path`. Returns nullptr when the file cannot be
+    // read or is not a snapshot this version can use.
+    static std::shared_ptr<const PreludeSnapshot> open(const std::string& path);
+
+    ~PreludeSnapshot();
+    PreludeSnapshot(const PreludeSnapshot&) = delete;
+    PreludeSnapshot& operator=(const PreludeSnapshot&) = delete;
+
+    size_t getTokenCount() const;
+    // Tokens [first, first + count) followed by END_OF_FILE, ready for a
+    // Parser. Out-of-range tokens are left out.
+    std::pmr::vector<Token> getTokens(size_t first, size_t count,
+                                      std::pmr::memory_resource* resource = nullptr) const;
+
+    size_t getDeclarationCount() const;
+    bool getDeclaration(size_t index, Declaration& declaration) const;
+    bool findDeclaration(std::string_view name, Declaration& declaration) const;
+    // Appends every declaration named `name` (overloads, redeclarations) to
+    // `declarations`, in prelude order.
+    void findDeclarations(std::string_view name, std::vector<Declaration>& declarations) const;
+
+    size_t getMacroCount() const;
+    bool findMacro(std::string_view name, MacroDefinition& macro) const;
+    bool hasMacro(std::string_view name) const;
+
+    // Whether the prelude read `path` (a canonical path), and its include
+    // guard and "#pragma once" status if so. The prelude file itself counts
+    // as "#pragma once".
+    bool findFile(std::string_view path, std::string_view& includeGuard, bool& once) const;
+
+    size_t getSize() const { return size; }
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t tokenCount;
+        uint32_t bodyTokenCount;
+        uint32_t parameterCount;
+        uint32_t macroCount;
+        uint32_t macroBucketCount;  // a power of two
+        uint32_t declarationCount;
+        uint32_t declarationBucketCount;
+        uint32_t fileCount;
+        // Byte offsets of the sections
+        uint64_t strings;
+        uint64_t stringsSize;
+        uint64_t tokens;
+        uint64_t bodyTokens;
+        uint64_t parameters;
+        uint64_t macros;
+        uint64_t macroBuckets;
+        uint64_t declarations;
+        uint64_t declarationBuckets;
+        uint64_t files;
+    };
+    struct StringRef;
+    struct TokenRecord;
+    struct MacroRecord;
+    struct DeclarationRecord;
+    struct FileRecord;
+
+    MappedFile file;
+    const char* data = nullptr;
+    size_t size = 0;
+    Header header = {};
+
+    PreludeSnapshot() = default;
+
+    bool validate();
+    template <typename Record>
+    bool read(uint64_t sectionOffset, uint32_t count, size_t index, Record& record) const;
+    bool string(const StringRef& ref, std::string_view& text) const;
+    bool token(size_t index, uint64_t section, uint32_t count, Token& token) const;
+    uint32_t findMacroIndex(std::string_view name) const;
+};
+
+// The declarations of a prelude snapshot as AST nodes, for NameResolver and
+// TypeChecker to bind names the translation unit does not declare. A
+// declaration is parsed from the snapshot's tokens the first time its name
+// is looked up, so the cost follows the names the units use rather than
+// the size of the prelude. One object can be shared by any number of
+// threads; its nodes are not changed once parsed.
+class PreludeDeclarations {
+public:
+    explicit PreludeDeclarations(std::shared_ptr<const PreludeSnapshot> snapshot);
+    ~PreludeDeclarations();
+    PreludeDeclarations(const PreludeDeclarations&) = delete;
+    PreludeDeclarations& operator=(const PreludeDeclarations&) = delete;
+
+    // The top-level declarations named `name`, in prelude order; empty
+    // when the prelude has none.
+    const std::vector<ast::Declaration*>& find(std::string_view name) const;
+
+    // Token ranges parsed so far.
+    size_t getParsedCount() const;
+    const std::shared_ptr<const PreludeSnapshot>& getSnapshot() const { return snapshot; }
+
+private:
+    struct Parsed;
+
+    std::shared_ptr<const PreludeSnapshot> snapshot;
+    mutable std::mutex mutex;
+    // By first token; a range can hold several declarations, as in
+    // `constant float a, b;`
+    mutable std::unordered_map<uint32_t, std::unique_ptr<Parsed>> parsed;
+    // Keyed by names in the snapshot's string table
+    mutable std::unordered_map<std::string_view, std::vector<ast::Declaration*>> names;
+};
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_PRELUDE_H
@@ -0,0 +1,210 @@
+#ifndef MSL_PARSER_PREPROCESSOR_H
+#define MSL_PARSER_PREPROCESSOR_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "msl_parser/error.h"
+#include "msl_parser/token.h"
+
+namespace msl_parser {
+
+class PreludeSnapshot;
+
+// A source file and its tokens, lexed once. Token and diagnostic offsets
+// are relative to the start of the file.
+struct LexedFile {
+    std::string path;
+    std::string source;
+    std::pmr::vector<Token> tokens;
+    std::vector<Diagnostic> diagnostics;  // from the lexer
+    // X when the whole file is wrapped in "#ifndef X" (or "#if !defined X")
+    // ... "#endif"; empty otherwise.
+    std::string includeGuard;
+    uint64_t size = 0;
+    int64_t modificationTime = 0;
+
+    static std::shared_ptr<LexedFile> lex(std::string path, std::string source);
+};
+
+// Lexed headers shared by every Preprocessor that uses the cache, so a
+// header included by many translation units is read and lexed once per
+// process. A header is read again when its size or modification time
+// changes. Safe to use from several threads.
+class HeaderCache {
+public:
+    // Reads the file at `path`, whose size and modification time are given,
+    // into `source`. Returns false when it cannot be read. Called without
+    // the cache's lock held, possibly from several threads at once.
+    using Loader = std::function<bool(const std::string& path, uint64_t size,
+                                      int64_t modificationTime, std::string& source)>;
+
+    // The default reads each file whole.
+    HeaderCache() = default;
+    // Files are read through `loader`, e.g. to lex only part of them.
+    explicit HeaderCache(Loader loader) : loader(std::move(loader)) {}
+
+    // The cache preprocessors use unless given another one.
+    static HeaderCache& processCache();
+
+    // The lexed file at `path`, or nullptr when it cannot be read.
+    std::shared_ptr<const LexedFile> get(const std::string& path);
+
+    void clear();
+    size_t size() const;
+    // How many times a file was read and lexed, for tests and statistics.
+    uint64_t getLexCount() const;
+
+private:
+    Loader loader;
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<const LexedFile>> files;
+    uint64_t lexCount = 0;
+};
+
+// A #define: the parameters ("__VA_ARGS__" last when variadic) and the
+// replacement tokens.
+struct MacroDefinition {
+    std::string name;
+    std::vector<std::string> parameters;
+    std::vector<Token> body;
+    bool functionLike = false;
+    bool variadic = false;
+};
+
+// Runs in front of the parser: handles #include, #define/#undef and
+// conditional directives, and expands object- and function-like macros
+// (including '#', '##' and __VA_ARGS__). Quoted includes are looked up next
+// to the including file first, then, like <...> includes, in the search
+// paths in order. The Metal standard library headers (<metal_stdlib> and
+// friends) are built into the parser's type knowledge, so they are treated
+// as empty unless a search path provides them.
+//
+// Like clang, an #include of a file marked with "#pragma once", or of a
+// file with an include guard whose macro is defined, is skipped without
+// looking at the file again.
+//
+// The output tokens carry offsets into one combined offset space: the main
+// source starts at 0 and each included file gets its own range after it
+// (see getFiles()). Tokens produced by a macro expansion carry the location
+// of the macro name they replaced; macro arguments keep their own.
+class Preprocessor {
+public:
+    static constexpr size_t MAX_INCLUDE_DEPTH = 200;
+    // Parentheses, unary operators and ?: nested in an #if expression
+    static constexpr int MAX_CONDITION_DEPTH = 256;
+    // Limits on macro expansion. Past them processing stops with an error,
+    // as at the error limit, so no input takes unbounded time or memory.
+    // Macro calls nested in the arguments of other macro calls:
+    static constexpr int MAX_MACRO_ARGUMENT_DEPTH = 256;
+    // Tokens produced by macro expansion in one preprocess() call,
+    // counting those of arguments expanded inside other arguments:
+    static constexpr size_t MAX_EXPANDED_TOKENS = size_t(1) << 20;
+
+    struct SourceFile {
+        std::shared_ptr<const LexedFile> file;
+        uint32_t base;  // offset of the file's first byte
+    };
+
+    // Errors are reported to `diagnostics` when one is given; processing
+    // stops once its error limit is reached. Headers are cached in `cache`,
+    // or in HeaderCache::processCache() when none is given.
+    explicit Preprocessor(DiagnosticEngine* diagnostics = nullptr, HeaderCache* cache = nullptr);
+    ~Preprocessor();
+
+    void addSearchPath(const std::string& directory);
+
+    // Starts every translation unit from a prelude snapshot (see
+    // prelude.h): its macros are defined, and the prelude file and the
+    // headers it included count as already included, as far as their
+    // #pragma once and include guards go. The prelude's tokens are not part
+    // of the output. Macros are read from the snapshot when first used, so
+    // the cost does not grow with the prelude.
+    void setPrelude(std::shared_ptr<const PreludeSnapshot> snapshot);
+
+    // Like -D and -U on a compiler command line. `definition` is the
+    // replacement text, e.g. define("SQUARE(x)", "((x) * (x))").
+    void define(const std::string& name, const std::string& definition = "1");
+    void undefine(const std::string& name);
+    bool isDefined(std::string_view name) const;
+
+    // Preprocesses `source`, the contents of `fileName`. The output ends
+    // with an END_OF_FILE token and is allocated from `resource`, or the
+    // default resource when none is given. Macros defined by the source
+    // stay defined for later calls.
+    std::pmr::vector<Token> preprocess(const std::string& source,
+                                       const std::string& fileName = "",
+                                       std::pmr::memory_resource* resource = nullptr);
+
+    // Files read by the last preprocess() call, the main source first, in
+    // increasing order of base offset.
+    const std::vector<SourceFile>& getFiles() const { return files; }
+    const SourceFile* findFile(uint32_t offset) const;
+    // #includes the last preprocess() call skipped because of an include
+    // guard or "#pragma once".
+    size_t getSkippedIncludes() const { return skippedIncludes; }
+
+    // Prints diagnostics from the preprocessor and from the parser of its
+    // output, each against the file its offset falls in.
+    void printDiagnostics(std::ostream& out, const DiagnosticEngine& engine) const;
+
+private:
+    friend class PreludeSnapshot;
+    struct Macro;
+    struct Conditional;
+    class Expander;
+
+    DiagnosticEngine* diagnostics;
+    HeaderCache* cache;
+    std::vector<std::string> searchPaths;
+    std::shared_ptr<const PreludeSnapshot> prelude;
+    // Keyed by Macro::name. Macros from the prelude are copied in when first
+    // used; one #undef'd here stays in the map, marked undefined.
+    mutable std::unordered_map<std::string_view, std::unique_ptr<Macro>> macros;
+    std::vector<SourceFile> files;
+    std::unordered_map<std::string, size_t> fileIndices;
+    // Per preprocess() call: the path each include spelling resolved to,
+    // the include guards of the files read, and the files marked
+    // "#pragma once"
+    std::unordered_map<std::string, std::string> resolvedIncludes;
+    std::unordered_map<std::string, std::string> includeGuards;
+    std::unordered_set<std::string> onceFiles;
+    size_t skippedIncludes = 0;
+    uint64_t nextBase = 0;
+    size_t includeDepth = 0;
+    bool stopped = false;
+    // Tokens produced by macro expansion in this preprocess() call
+    size_t expandedTokens = 0;
+
+    void processFile(size_t fileIndex, std::pmr::vector<Token>& output);
+    void directive(size_t fileIndex, const std::vector<Token>& line,
+                   std::vector<Conditional>& conditionals, std::pmr::vector<Token>& output);
+    void include(size_t fileIndex, const std::vector<Token>& line, std::pmr::vector<Token>& output);
+    void defineMacro(const std::vector<Token>& line);
+    bool evaluateCondition(const std::vector<Token>& line);
+    std::string findInclude(const std::string& name, bool quoted, const std::string& includer);
+    bool isIncluded(const std::string& path) const;
+    size_t addFile(std::shared_ptr<const LexedFile> file);
+    const Macro* findMacro(const Token& token) const;
+    const Macro* findMacro(std::string_view name) const;
+    void removeMacro(std::string_view name);
+    // Macros defined here, not those only in the prelude
+    std::vector<const MacroDefinition*> getDefinedMacros() const;
+    void extraTokens(const std::vector<Token>& line, size_t expected);
+    void report(DiagID id, uint32_t offset);
+    void report(const Diagnostic& diagnostic);
+    // Reports a limit hit and stops processing, like the error limit.
+    void stop(DiagID id, uint32_t offset);
+};
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_PREPROCESSOR_H
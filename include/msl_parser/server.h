@@ -0,0 +1,164 @@
+#ifndef MSL_PARSER_SERVER_H
+#define MSL_PARSER_SERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "msl_parser/batch.h"
+
+namespace msl_parser {
+
+// The parse daemon's wire protocol. Every message is a frame: a 32-bit
+// size (the bytes after it), then the fields below. Integers are
+// little-endian.
+//
+//   request:  u32 size, u32 id, u8 mode (BatchMode), u8 flags, u16 reserved,
+//             u32 path length, path bytes, source bytes (the rest)
+//   response: u32 size, u32 id, u8 status (ResponseStatus), u8[3] reserved,
+//             payload (the rest)
+//
+// The payload is the file's NDJSON line, as BatchProcessor writes it, or
+// an error message for BAD_REQUEST. A client may send any number of
+// requests before reading responses; responses carry the ID of their
+// request and may arrive in a different order.
+namespace protocol {
+
+constexpr size_t REQUEST_HEADER_SIZE = 16;
+constexpr size_t RESPONSE_HEADER_SIZE = 12;
+
+// Request flags
+constexpr uint8_t READ_FILE = 1 << 0;   // the server reads the file at `path`; no source is sent
+constexpr uint8_t TYPE_CHECK = 1 << 1;  // run the TypeChecker
+
+} // namespace protocol
+
+enum class ResponseStatus : uint8_t {
+    OK,          // parsed without errors
+    ERRORS,      // the payload lists the file's errors
+    BAD_REQUEST  // malformed or too large; the payload says why
+};
+
+struct ParseRequest {
+    uint32_t id = 0;
+    BatchMode mode = BatchMode::AST;
+    uint8_t flags = 0;
+    std::string path;
+    std::string source;
+};
+
+struct ParseResponse {
+    uint32_t id = 0;
+    ResponseStatus status = ResponseStatus::OK;
+    std::string payload;
+};
+
+struct ServerOptions {
+    // Search paths and defines for every request; the mode and type
+    // checking come from each request
+    BatchOptions batch;
+    // Worker threads; 0 for one per hardware thread
+    unsigned threads = 0;
+    // Larger requests get BAD_REQUEST and the connection is closed
+    size_t maxRequestSize = 64 * 1024 * 1024;
+    // Requests of one connection queued or in progress; its socket is not
+    // read further until one is answered, so a client pipelining requests
+    // cannot grow the queue without bound
+    size_t maxPendingRequests = 64;
+    // A client that does not take a response for this long is
+    // disconnected, so that it cannot hold up the workers
+    std::chrono::milliseconds sendTimeout{10000};
+};
+
+// Serves parse requests on a Unix domain socket, keeping everything that
+// is expensive to set up resident between them: the worker threads and
+// their arenas, the processors for each mode and the process-wide
+// HeaderCache, so headers shared by many shaders are lexed once. Each
+// connection has a reader thread that hands requests to the workers as
+// they arrive, so pipelined requests from one client are processed in
+// parallel. Only available where Unix domain sockets are; elsewhere
+// listen() fails.
+class ParseServer {
+public:
+    explicit ParseServer(ServerOptions options = {});
+    ~ParseServer();
+
+    ParseServer(const ParseServer&) = delete;
+    ParseServer& operator=(const ParseServer&) = delete;
+
+    // Binds `socketPath`, replacing a stale socket file left by an earlier
+    // server.
+    bool listen(const std::string& socketPath, std::string& error);
+
+    // Accepts connections until stop() is called, then closes them and
+    // waits for requests in progress.
+    void serve();
+
+    // Makes serve() return. Safe to call from any thread and from a signal
+    // handler.
+    void stop();
+
+    uint64_t getRequestCount() const { return requestCount.load(); }
+
+private:
+    struct Connection;
+    class WorkQueue;
+
+    ServerOptions options;
+    // Indexed by mode, then by whether to type check
+    std::vector<BatchProcessor> processors;
+    std::unique_ptr<WorkQueue> queue;
+    std::string socketPath;
+    int listenSocket = -1;
+    int wakePipe[2] = {-1, -1};
+    std::atomic<uint64_t> requestCount{0};
+    std::mutex connectionsMutex;
+    std::vector<std::shared_ptr<Connection>> connections;
+
+    void readRequests(std::shared_ptr<Connection> connection);
+    void handle(const std::shared_ptr<Connection>& connection, ParseRequest request,
+                std::pmr::memory_resource* arena);
+    void closeAll();
+};
+
+// A connection to a ParseServer. Requests can be pipelined: send() several,
+// then receive() their responses.
+class ParseClient {
+public:
+    ParseClient() = default;
+    ~ParseClient();
+
+    ParseClient(const ParseClient&) = delete;
+    ParseClient& operator=(const ParseClient&) = delete;
+
+    bool connect(const std::string& socketPath, std::string& error);
+    void close();
+    bool isConnected() const { return socket >= 0; }
+
+    // Sends `request` without waiting for the response. An ID of 0 is
+    // replaced by the next unused one; returns the ID sent, or 0 when the
+    // connection failed.
+    uint32_t send(ParseRequest request);
+    // Waits for the next response. Returns false when the connection is
+    // closed.
+    bool receive(ParseResponse& response);
+    // Sends `request` and waits for its response; responses to other
+    // requests still in flight are kept for later receive() calls.
+    bool request(ParseRequest request, ParseResponse& response);
+
+private:
+    int socket = -1;
+    uint32_t nextId = 1;
+    // Responses read while waiting for another one
+    std::vector<ParseResponse> pending;
+
+    bool readFrame(ParseResponse& response);
+};
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_SERVER_H
@@ -0,0 +1,122 @@
+#ifndef MSL_PARSER_STATS_H
+#define MSL_PARSER_STATS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "msl_parser/token.h"
+
+// Phase timings and counters, compiled in only when the library is built
+// with -DMSL_PARSER_ENABLE_STATS=ON. Otherwise MSL_PARSER_STATS() expands to
+// nothing, so the lexer and parser carry no instrumentation at all, and the
+// Stats of every thread stay empty.
+#ifndef MSL_PARSER_ENABLE_STATS
+#define MSL_PARSER_ENABLE_STATS 0
+#endif
+
+#if MSL_PARSER_ENABLE_STATS
+#define MSL_PARSER_STATS(statement) statement
+#else
+#define MSL_PARSER_STATS(statement)
+#endif
+
+namespace msl_parser {
+
+namespace ast {
+class ASTNode;
+#define AST_NODE(CLASS) class CLASS;
+#include "msl_parser/ast/ast_nodes.def"
+#undef AST_NODE
+} // namespace ast
+
+enum class NodeKind : uint8_t {
+#define AST_NODE(CLASS) CLASS,
+#include "msl_parser/ast/ast_nodes.def"
+#undef AST_NODE
+    NUM_NODE_KINDS
+};
+
+template <typename T>
+struct NodeKindOf;
+
+#define AST_NODE(CLASS)                                                    \
+    template <>                                                            \
+    struct NodeKindOf<ast::CLASS> {                                        \
+        static constexpr NodeKind value = NodeKind::CLASS;                 \
+    };
+#include "msl_parser/ast/ast_nodes.def"
+#undef AST_NODE
+
+const char* nodeKindToString(NodeKind kind);
+// The concrete class of `node`, found through its accept() method.
+NodeKind getNodeKind(ast::ASTNode* node);
+
+constexpr bool statsEnabled() {
+    return MSL_PARSER_ENABLE_STATS != 0;
+}
+
+struct PhaseRecord {
+    const char* name; // static string
+    uint64_t startNanoseconds; // since the Stats were reset
+    uint64_t durationNanoseconds;
+    uint32_t depth; // number of enclosing phases
+};
+
+struct Stats {
+    static constexpr size_t NUM_TOKEN_TYPES = static_cast<size_t>(TokenType::END_OF_FILE) + 1;
+    static constexpr size_t NUM_NODE_KINDS = static_cast<size_t>(NodeKind::NUM_NODE_KINDS);
+
+    // Completed phases in the order they finished: "lex", "parse", "relex",
+    // "reparse", one entry per AST pass (RecursiveASTVisitor::passName()),
+    // and any the caller adds with ScopedPhase, such as "read".
+    std::vector<PhaseRecord> phases;
+
+    uint64_t tokensByType[NUM_TOKEN_TYPES] = {};
+    uint64_t nodesByKind[NUM_NODE_KINDS] = {};
+    uint64_t bytesProcessed = 0; // source bytes scanned by scanTokens()
+    uint64_t arenaBytes = 0;     // storage for AST nodes, as an arena would hold
+    uint64_t peakTokenCount = 0; // largest token vector produced
+    uint64_t peakTokenBytes = 0; // and its capacity in bytes
+
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    uint32_t openPhases = 0; // ScopedPhase instances currently running
+
+    void reset();
+
+    // Total time of all phases with this name, in nanoseconds.
+    uint64_t phaseNanoseconds(const char* name) const;
+    uint64_t tokenCount(TokenType type) const {
+        return tokensByType[static_cast<size_t>(type)];
+    }
+    uint64_t nodeCount(NodeKind kind) const { return nodesByKind[static_cast<size_t>(kind)]; }
+    uint64_t totalTokens() const;
+    uint64_t totalNodes() const;
+
+    // Writes the phases as Chrome trace events (chrome://tracing, Perfetto)
+    // with the counters attached as a final counter event.
+    void writeChromeTrace(std::ostream& out) const;
+};
+
+// Statistics collected on the calling thread.
+Stats& threadStats();
+
+// Records the time until the end of the scope as a phase of threadStats().
+class ScopedPhase {
+public:
+    explicit ScopedPhase(const char* name, bool active = true);
+    ~ScopedPhase();
+
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+private:
+    const char* name;
+    bool active;
+    std::chrono::steady_clock::time_point start;
+};
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_STATS_H
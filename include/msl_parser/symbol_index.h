@@ -0,0 +1,154 @@
+#ifndef MSL_PARSER_SYMBOL_INDEX_H
+#define MSL_PARSER_SYMBOL_INDEX_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "msl_parser/binary_file.h"
+
+namespace msl_parser {
+
+enum class SymbolKind : uint8_t {
+    FUNCTION,
+    STRUCT,
+    VARIABLE,  // a global
+    MACRO,
+    BUFFER,    // a [[buffer(n)]] parameter
+    TEXTURE,   // a [[texture(n)]] parameter
+    SAMPLER,   // a [[sampler(n)]] parameter
+    NAME,      // any identifier, for references
+};
+
+enum class SymbolRole : uint8_t {
+    DEFINITION,
+    DECLARATION,  // a function prototype
+    REFERENCE,
+    BINDING,
+};
+
+const char* symbolKindToString(SymbolKind kind);
+
+// One entry of a SymbolIndex. The strings point into the index.
+struct SymbolEntry {
+    SymbolKind kind;
+    SymbolRole role;
+    // The symbol; for a binding, the parameter
+    std::string_view name;
+    // For a binding, the function the parameter belongs to
+    std::string_view context;
+    std::string_view file;
+    uint32_t line;
+    uint32_t column;
+    // For a binding, the slot; for a reference, the uses in the file
+    uint32_t value;
+};
+
+struct SymbolIndexOptions {
+    // Worker threads; 0 for one per hardware thread
+    unsigned jobs = 0;
+    std::vector<std::string> searchPaths;
+    // -D style definitions: name (possibly with parameters) and replacement
+    std::vector<std::pair<std::string, std::string>> defines;
+};
+
+// Definitions, references and resource bindings across a corpus of shader
+// files, written once and then mapped read-only for queries. Each file is
+// preprocessed and parsed on its own; its top-level functions, structs,
+// globals and #defines are definitions, the [[buffer(n)]], [[texture(n)]]
+// and [[sampler(n)]] parameters of its functions are bindings, and every
+// identifier it uses outside a definition is a reference, recorded once per
+// file with the position of its first use and the number of uses.
+//
+// Lookups go through hash tables and sorted arrays stored in the file and
+// only read the records they return, so they take microseconds whatever the
+// size of the corpus. Like prelude snapshots, indexes are specific to the
+// library version and byte order that wrote them.
+class SymbolIndex {
+public:
+    struct BuildStats {
+        size_t indexed = 0;     // files parsed
+        size_t reused = 0;      // unchanged files copied from the previous index
+        size_t unreadable = 0;  // files that could not be read, left out
+    };
+
+    // Indexes `files` on options.jobs threads and writes the index to
+    // `path`, replacing it atomically. Files whose path and content hash
+    // match an entry of `previous` are not parsed again; their entries are
+    // copied. Returns false with a message in `error` when the index
+    // cannot be written.
+    static bool build(const std::vector<std::string>& files, const std::string& path,
+                      const SymbolIndexOptions& options, std::string& error,
+                      const SymbolIndex* previous = nullptr, BuildStats* stats = nullptr);
+
+    // Maps the index at `path`. Returns nullptr when the file cannot be read
+    // or is not an index this version can use.
+    static std::shared_ptr<const SymbolIndex> open(const std::string& path);
+
+    SymbolIndex(const SymbolIndex&) = delete;
+    SymbolIndex& operator=(const SymbolIndex&) = delete;
+
+    size_t getFileCount() const;
+    bool getFile(size_t index, std::string_view& path, uint64_t& contentHash) const;
+
+    // Definitions and declarations of `name`.
+    std::vector<SymbolEntry> findDefinitions(std::string_view name) const;
+    // Files using `name`, one entry each.
+    std::vector<SymbolEntry> findReferences(std::string_view name) const;
+    // Parameters bound to `slot` of a BUFFER, TEXTURE or SAMPLER `kind`.
+    std::vector<SymbolEntry> findBindings(SymbolKind kind, uint32_t slot) const;
+
+    // Every entry of file `file`.
+    std::vector<SymbolEntry> getFileEntries(size_t file) const;
+
+    size_t getEntryCount() const;
+    size_t getSize() const { return size; }
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t fileCount;
+        uint32_t entryCount;
+        uint32_t nameCount;
+        uint32_t nameBucketCount;  // a power of two
+        uint32_t bindingCount;
+        uint32_t padding;
+        // Byte offsets of the sections
+        uint64_t strings;
+        uint64_t stringsSize;
+        uint64_t files;
+        uint64_t entries;
+        uint64_t names;
+        uint64_t nameBuckets;
+        uint64_t bindings;
+        uint64_t fileEntries;
+    };
+    struct StringRef;
+    struct FileRecord;
+    struct EntryRecord;
+    struct NameRecord;
+
+    MappedFile file;
+    const char* data = nullptr;
+    size_t size = 0;
+    Header header = {};
+
+    SymbolIndex() = default;
+
+    template <typename Record>
+    bool read(uint64_t section, uint32_t count, size_t index, Record& record) const;
+
+    bool validate();
+    bool string(const StringRef& ref, std::string_view& text) const;
+    bool entry(size_t index, SymbolEntry& entry) const;
+    // The range of entries named `name`
+    bool findName(std::string_view name, uint32_t& first, uint32_t& count) const;
+};
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_SYMBOL_INDEX_H
@@ -0,0 +1,137 @@
+#ifndef MSL_PARSER_SYMBOL_TABLE_H
+#define MSL_PARSER_SYMBOL_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+#include "msl_parser/ast/ast_node.h"
+
+namespace msl_parser {
+
+class PreludeDeclarations;
+
+// Interned names. Each distinct name gets a dense ID, so tables keyed by
+// name can be plain vectors. Names are found through an open-addressing
+// hash table and their characters are copied into the table's own storage.
+class NameTable {
+public:
+    static constexpr uint32_t NO_NAME = UINT32_MAX;
+
+    NameTable() = default;
+    NameTable(const NameTable&) = delete;
+    NameTable& operator=(const NameTable&) = delete;
+
+    uint32_t intern(std::string_view name);
+    // The ID of `name`, or NO_NAME if it was never interned.
+    uint32_t find(std::string_view name) const;
+    std::string_view getName(uint32_t id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+    void clear();
+
+private:
+    std::vector<uint32_t> buckets;  // ID + 1; 0 is empty
+    std::vector<std::string_view> names;
+    std::vector<uint32_t> hashes;
+    std::pmr::monotonic_buffer_resource storage;
+
+    size_t findBucket(std::string_view name, uint32_t hash) const;
+    void grow();
+};
+
+// Scoped bindings from names to declarations. The innermost binding of
+// each name is kept in a vector indexed by name ID, so lookups are one
+// index. Declaring a name logs the binding it hides; popScope() undoes the
+// log back to where pushScope() left it, so entering and leaving a scope
+// costs nothing beyond the names declared in it.
+//
+// Struct fields live in a separate table keyed by struct and name.
+class SymbolTable {
+public:
+    NameTable& getNames() { return names; }
+    const NameTable& getNames() const { return names; }
+
+    void pushScope();
+    void popScope();
+    // Scopes pushed and not yet popped; 0 is the global scope.
+    size_t getDepth() const { return scopeMarks.size(); }
+    void clear();
+
+    // Binds `name` to `declaration` until the current scope is popped.
+    void declare(uint32_t name, ast::Declaration* declaration);
+    void declare(std::string_view name, ast::Declaration* declaration) {
+        declare(names.intern(name), declaration);
+    }
+    // Binds the unbound `name` at global scope, whatever the current scope;
+    // no popScope() undoes it.
+    void declareGlobal(uint32_t name, ast::Declaration* declaration);
+    // The innermost declaration of `name`, or null.
+    ast::Declaration* lookup(uint32_t name) const {
+        return name < bindings.size() ? bindings[name] : nullptr;
+    }
+    ast::Declaration* lookup(std::string_view name) const { return lookup(names.find(name)); }
+
+    void declareField(const ast::StructDeclaration* owner, uint32_t name,
+                      ast::VariableDeclaration* field);
+    ast::VariableDeclaration* lookupField(const ast::StructDeclaration* owner,
+                                          uint32_t name) const;
+
+private:
+    struct Shadowed {
+        uint32_t name;
+        ast::Declaration* previous;
+    };
+    struct Field {
+        const ast::StructDeclaration* owner = nullptr;
+        uint32_t name = 0;
+        ast::VariableDeclaration* field = nullptr;
+    };
+
+    NameTable names;
+    std::vector<ast::Declaration*> bindings;  // by name ID
+    std::vector<Shadowed> undoLog;
+    std::vector<size_t> scopeMarks;           // undo log size at each pushScope()
+    std::vector<Field> fields;                // open addressing; owner null when empty
+    size_t fieldCount = 0;
+
+    size_t findField(const ast::StructDeclaration* owner, uint32_t name) const;
+};
+
+// Resolves names in one pass over a translation unit, in source order as
+// C++ does: each ast::Identifier gets the local, parameter, global or
+// function declaration visible at that point, and each member access on a
+// variable of a struct type gets the struct's field. With a prelude, names
+// the unit does not declare are looked up among the prelude's declarations
+// and bound as globals, as if the prelude were included first. Names
+// declared nowhere, such as Metal built-ins, stay unresolved.
+//
+// The resolved pointers are not updated by IncrementalParser; resolve again
+// after an edit.
+class NameResolver {
+public:
+    void resolve(ast::TranslationUnit* unit);
+
+    void setPrelude(std::shared_ptr<const PreludeDeclarations> declarations) {
+        prelude = std::move(declarations);
+    }
+    const std::shared_ptr<const PreludeDeclarations>& getPrelude() const { return prelude; }
+
+    // Global declarations stay bound after resolve().
+    const SymbolTable& getSymbols() const { return symbols; }
+    size_t getResolvedCount() const { return resolved; }
+    size_t getUnresolvedCount() const { return unresolved; }
+
+private:
+    class Pass;
+
+    SymbolTable symbols;
+    std::shared_ptr<const PreludeDeclarations> prelude;
+    size_t resolved = 0;
+    size_t unresolved = 0;
+};
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_SYMBOL_TABLE_H
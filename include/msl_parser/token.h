@@ -1,12 +1,14 @@
 #ifndef MSL_PARSER_TOKEN_H
 #define MSL_PARSER_TOKEN_H
 
-#include <string>
 #include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
 
 namespace msl_parser {
 
-enum class TokenType {
+enum class TokenType : uint8_t {
     // Literals
     INTEGER_LITERAL,
     FLOAT_LITERAL,
@@ -127,22 +129,71 @@ enum class TokenType {
     ATTRIBUTE_LEFT,
     ATTRIBUTE_RIGHT,
     
+    // Preprocessor
+    HASH,
+    HASH_HASH,
+    
     // Special
     END_OF_FILE
 };
 
+// Properties of INTEGER_LITERAL and FLOAT_LITERAL tokens, recorded while
+// scanning so later stages need not look at the spelling again.
+enum NumericFlags : uint8_t {
+    NUMERIC_HEX = 1 << 0,
+    NUMERIC_BINARY = 1 << 1,
+    NUMERIC_FRACTION = 1 << 2, // has a '.'
+    NUMERIC_EXPONENT = 1 << 3,
+    NUMERIC_SUFFIX_F = 1 << 4,
+    NUMERIC_SUFFIX_H = 1 << 5,
+    NUMERIC_SUFFIX_U = 1 << 6,
+};
+
+// Token properties beyond the type.
+enum TokenFlags : uint8_t {
+    TOKEN_AT_LINE_START = 1 << 0, // first token on its line; starts directives
+    TOKEN_NO_EXPAND = 1 << 1,     // names a macro that must not be expanded here
+};
+
+// Tokens are allocator-aware: in a std::pmr::vector<Token> the lexeme is
+// allocated from the vector's memory resource.
 struct Token {
-    TokenType type;
-    std::string lexeme;
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+    // Ordered to pack into 56 bytes on 64-bit targets
+    std::pmr::string lexeme;
     uint32_t line;
     uint32_t column;
-    
-    Token(TokenType type, const std::string& lexeme, uint32_t line, uint32_t column)
-        : type(type), lexeme(lexeme), line(line), column(column) {}
+    uint32_t offset;  // Byte offset of the first character in the source
+    TokenType type;
+    uint8_t numericFlags = 0;  // NumericFlags, for numeric literals
+    uint8_t flags = 0;         // TokenFlags
+    
+    Token(TokenType type, std::string_view lexeme, uint32_t line, uint32_t column,
+          uint32_t offset = 0, const allocator_type& allocator = {})
+        : lexeme(lexeme, allocator), line(line), column(column), offset(offset), type(type) {}
+    Token(const Token& other, const allocator_type& allocator)
+        : lexeme(other.lexeme, allocator), line(other.line), column(other.column),
+          offset(other.offset), type(other.type), numericFlags(other.numericFlags),
+          flags(other.flags) {}
+    Token(Token&& other, const allocator_type& allocator)
+        : lexeme(std::move(other.lexeme), allocator), line(other.line), column(other.column),
+          offset(other.offset), type(other.type), numericFlags(other.numericFlags),
+          flags(other.flags) {}
+    Token(const Token&) = default;
+    Token(Token&&) = default;
+    Token& operator=(const Token&) = default;
+    Token& operator=(Token&&) = default;
+    
+    uint32_t endOffset() const { return offset + static_cast<uint32_t>(lexeme.size()); }
 };
 
 const char* tokenTypeToString(TokenType type);
 
+// Source spelling of keywords and punctuation ("if", "->"); other types
+// fall back to tokenTypeToString().
+const char* tokenTypeSpelling(TokenType type);
+
 } // namespace msl_parser
 
 #endif // MSL_PARSER_TOKEN_H
\ No newline at end of file
@@ -0,0 +1,70 @@
+#ifndef MSL_PARSER_TRIVIA_H
+#define MSL_PARSER_TRIVIA_H
+
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+#include "msl_parser/token.h"
+
+namespace msl_parser {
+
+enum class TriviaKind : uint8_t {
+    WHITESPACE,        // a run of spaces, tabs and carriage returns
+    NEWLINE,
+    LINE_COMMENT,      // "//" up to, not including, the newline
+    BLOCK_COMMENT,     // "/* */", or to the end of the file when unterminated
+    LINE_CONTINUATION, // a backslash and the newline it joins
+    SKIPPED,           // a character the lexer reported and dropped
+};
+
+struct Trivia {
+    uint32_t offset;
+    uint32_t length;
+    TriviaKind kind;
+};
+
+// The source text between tokens, split into pieces and attached to the
+// token that follows it. The table is derived from the token offsets after
+// lexing, so the Lexer keeps discarding trivia and costs nothing extra when
+// no table is built. Together with the lexemes it reproduces the source
+// exactly.
+class TriviaTable {
+public:
+    // Pieces of trivia ending where a token starts
+    struct Range {
+        const Trivia* first;
+        const Trivia* last;
+
+        const Trivia* begin() const { return first; }
+        const Trivia* end() const { return last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+        bool empty() const { return first == last; }
+    };
+
+    TriviaTable() = default;
+    // `tokens` must come from lexing `source` without preprocessing.
+    TriviaTable(std::string_view source, const std::pmr::vector<Token>& tokens);
+
+    // The trivia before token `index`. The END_OF_FILE token's trivia ends
+    // the file.
+    Range leading(size_t index) const {
+        return {pieces.data() + firstPiece[index], pieces.data() + firstPiece[index + 1]};
+    }
+
+    // Bytes of trivia before token `index`.
+    uint32_t leadingLength(size_t index) const;
+
+    const std::vector<Trivia>& getPieces() const { return pieces; }
+
+private:
+    std::vector<Trivia> pieces;
+    // Index of the first piece before each token, plus one past the last
+    std::vector<uint32_t> firstPiece;
+
+    void split(std::string_view source, uint32_t begin, uint32_t end);
+};
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_TRIVIA_H
@@ -0,0 +1,49 @@
+#ifndef MSL_PARSER_TYPE_CHECKER_H
+#define MSL_PARSER_TYPE_CHECKER_H
+
+#include "msl_parser/ast/ast_node.h"
+#include "msl_parser/error.h"
+#include "msl_parser/symbol_table.h"
+#include "msl_parser/types.h"
+
+namespace msl_parser {
+
+// Assigns a type to every expression of a translation unit (see
+// Expression::getTypeId()) and reports operations the types do not allow.
+// Names are resolved first with a NameResolver.
+//
+// The rules follow the Metal Shading Language: scalars convert implicitly
+// to one another and to vectors (by splatting), but vectors of different
+// element types or sizes do not; arithmetic is component-wise, with the
+// usual arithmetic conversions for the element type; `*` on matrices is the
+// linear-algebra product; comparisons of vectors give bool vectors.
+// Swizzles, constructors of built-in types and the common built-in
+// functions (dot, normalize, clamp, ...) are typed. Expressions the checker
+// cannot type, such as texture methods, get TypeTable::UNKNOWN, which
+// converts to anything and never causes an error.
+class TypeChecker {
+public:
+    explicit TypeChecker(DiagnosticEngine* diagnostics = nullptr);
+
+    void check(ast::TranslationUnit* unit);
+
+    // Names the unit does not declare are looked up in the prelude (see
+    // NameResolver), and its functions, variables and structs typed.
+    void setPrelude(std::shared_ptr<const PreludeDeclarations> declarations) {
+        resolver.setPrelude(std::move(declarations));
+    }
+
+    const TypeTable& getTypes() const { return types; }
+    const NameResolver& getResolver() const { return resolver; }
+
+private:
+    class Pass;
+
+    DiagnosticEngine* diagnostics;
+    TypeTable types;
+    NameResolver resolver;
+};
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_TYPE_CHECKER_H
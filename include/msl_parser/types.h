@@ -0,0 +1,121 @@
+#ifndef MSL_PARSER_TYPES_H
+#define MSL_PARSER_TYPES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "msl_parser/ast/ast_node.h"
+#include "msl_parser/symbol_table.h"
+
+namespace msl_parser {
+
+// An index into a TypeTable. Two types are the same exactly when their IDs
+// are equal.
+using TypeId = uint16_t;
+
+enum class TypeKind : uint8_t {
+    UNKNOWN,  // not known to the checker, e.g. the result of a texture method
+    VOID,
+    SCALAR,
+    VECTOR,
+    MATRIX,
+    POINTER,
+    ARRAY,
+    STRUCT,
+    OPAQUE    // textures, samplers and other library types
+};
+
+// In order of conversion rank.
+enum class ScalarType : uint8_t {
+    BOOL,
+    CHAR,
+    UCHAR,
+    SHORT,
+    USHORT,
+    INT,
+    UINT,
+    HALF,
+    FLOAT,
+    NUM_SCALAR_TYPES
+};
+
+struct Type {
+    TypeKind kind = TypeKind::UNKNOWN;
+    ScalarType scalar = ScalarType::BOOL;  // element type of scalars, vectors and matrices
+    uint8_t rows = 1;      // vector size, or matrix rows
+    uint8_t columns = 1;   // matrix columns
+    ast::AddressSpace addressSpace = ast::AddressSpace::NONE;  // pointers
+    TypeId element = 0;    // pointee or array element
+    const ast::StructDeclaration* structDeclaration = nullptr;
+    std::string_view name; // opaque types
+};
+
+// Interned types. Scalars, vectors and matrices have fixed IDs that need
+// no lookup; pointer, array, struct and opaque types get an ID the first
+// time they are asked for. Expressions carry only the 16-bit ID.
+class TypeTable {
+public:
+    static constexpr TypeId UNKNOWN = 0;
+    static constexpr TypeId VOID = 1;
+    // Fixed IDs: the scalars, their 2- to 4-component vectors, then float
+    // and half matrices with 2 to 4 columns and rows
+    static constexpr TypeId FIRST_SCALAR = 2;
+    static constexpr size_t NUM_SCALARS = static_cast<size_t>(ScalarType::NUM_SCALAR_TYPES);
+    static constexpr TypeId FIRST_VECTOR = static_cast<TypeId>(FIRST_SCALAR + NUM_SCALARS);
+    static constexpr TypeId FIRST_MATRIX = static_cast<TypeId>(FIRST_VECTOR + NUM_SCALARS * 3);
+    static constexpr TypeId NUM_BUILTIN_TYPES = static_cast<TypeId>(FIRST_MATRIX + 2 * 9);
+
+    TypeTable();
+
+    static constexpr TypeId scalar(ScalarType type) {
+        return static_cast<TypeId>(FIRST_SCALAR + static_cast<int>(type));
+    }
+    // A scalar when `size` is 1; UNKNOWN for sizes over 4.
+    static constexpr TypeId vector(ScalarType type, int size) {
+        if (size == 1) {
+            return scalar(type);
+        }
+        if (size < 2 || size > 4) {
+            return UNKNOWN;
+        }
+        return static_cast<TypeId>(FIRST_VECTOR + static_cast<int>(type) * 3 + (size - 2));
+    }
+    // `columns` x `rows` matrices exist for float and half only.
+    static constexpr TypeId matrix(ScalarType type, int columns, int rows) {
+        if ((type != ScalarType::FLOAT && type != ScalarType::HALF) || columns < 2 ||
+            columns > 4 || rows < 2 || rows > 4) {
+            return UNKNOWN;
+        }
+        return static_cast<TypeId>(FIRST_MATRIX + (type == ScalarType::HALF ? 9 : 0) +
+                                   (columns - 2) * 3 + (rows - 2));
+    }
+
+    TypeId pointer(TypeId pointee, ast::AddressSpace addressSpace);
+    TypeId array(TypeId element);
+    TypeId structType(const ast::StructDeclaration* declaration);
+    TypeId opaque(std::string_view name);
+
+    // The scalar, vector or matrix type named `name` ("float4", "half3x3",
+    // "packed_float3", "metal::uint2", ...), or UNKNOWN.
+    static TypeId findBuiltin(std::string_view name);
+
+    const Type& get(TypeId id) const { return types[id]; }
+    std::string getName(TypeId id) const;
+    size_t size() const { return types.size(); }
+
+private:
+    std::vector<Type> types;
+    // Keyed by kind, address space and element, or by opaque name ID
+    std::unordered_map<uint64_t, TypeId> derived;
+    std::unordered_map<const ast::StructDeclaration*, TypeId> structs;
+    NameTable names;
+
+    TypeId add(const Type& type);
+};
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_TYPES_H
@@ -0,0 +1,102 @@
+#ifndef MSL_PARSER_WATCHER_H
+#define MSL_PARSER_WATCHER_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "msl_parser/batch.h"
+
+namespace msl_parser {
+
+struct WatchOptions {
+    // Mode, worker threads, search paths and defines for every file
+    BatchOptions batch;
+    // Events less than this far apart are handled together, so an editor
+    // saving through a temporary file and a rename causes one update
+    std::chrono::milliseconds settle{5};
+};
+
+// Keeps the NDJSON line (see BatchProcessor) of every shader in a tree up
+// to date as files change. start() processes every shader once; after
+// that, a change reprocesses only the shaders that changed and those that
+// include a changed file, directly or not, on the batch's worker threads.
+// Headers stay lexed in HeaderCache::processCache(), which lexes a header
+// again only when its size or modification time changed, so an update
+// costs about as much as parsing the affected shaders.
+//
+// Changes come from inotify where it is available (Linux): the input
+// directories are watched recursively, along with the search paths and
+// the directories of every file a shader includes. update() takes changes
+// from elsewhere, e.g. from tests.
+class ShaderWatcher {
+public:
+    explicit ShaderWatcher(WatchOptions options = {});
+    ~ShaderWatcher();
+
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    // Processes every file `inputs` expand to (see expandInputs()) and
+    // appends their lines to `out`, in order. New .metal files below input
+    // directories are picked up later. Returns false with a message in
+    // `error` when an input does not exist.
+    bool start(const std::vector<std::string>& inputs, std::string& out, std::string& error);
+
+    // Whether file system events are being received; false where inotify
+    // is unavailable.
+    bool isWatching() const { return watchDescriptor >= 0; }
+
+    // Waits up to `timeout` for file system events and handles them like
+    // update(). Returns false once stop() was called or the watch failed.
+    bool wait(std::chrono::milliseconds timeout, std::string& out);
+
+    // Reprocesses the shaders affected by changes to `paths` and appends
+    // their lines to `out`, sorted by file: shaders that changed or
+    // appeared, shaders that include a changed file, and, when a file that
+    // is neither appears, shaders that had errors, in case it is an include
+    // they could not find. A shader that is gone gets a line with
+    // "removed": true. Returns the number of lines appended.
+    size_t update(const std::vector<std::string>& paths, std::string& out);
+
+    // Makes wait() return false. Safe to call from any thread and from a
+    // signal handler.
+    void stop();
+
+    size_t getFileCount() const { return shaders.size(); }
+
+private:
+    struct Shader {
+        bool ok = false;
+        std::vector<std::string> dependencies;  // canonical paths
+    };
+
+    WatchOptions options;
+    BatchProcessor processor;
+    // By path as found, e.g. "shaders/blur.metal"
+    std::unordered_map<std::string, Shader> shaders;
+    // Canonical path to the key in `shaders`
+    std::unordered_map<std::string, std::string> shaderPaths;
+    // Canonical path of a file to the shaders that read it
+    std::unordered_map<std::string, std::unordered_set<std::string>> dependents;
+    // Directories given as inputs, canonical
+    std::vector<std::string> roots;
+    int watchDescriptor = -1;  // the inotify instance
+    int wakePipe[2] = {-1, -1};
+    std::unordered_map<int, std::string> watches;  // watch to directory
+    std::unordered_set<std::string> watchedDirectories;
+
+    // Appends the lines of `files` (keys of `shaders`) to `out`, processing
+    // them in parallel, and updates their dependencies.
+    void process(const std::vector<std::string>& files, std::string& out);
+    void addShader(const std::string& path);
+    void watchDirectory(const std::string& directory, bool recursive);
+    bool isBelowRoot(const std::string& canonical) const;
+    void readEvents(std::vector<std::string>& paths);
+};
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_WATCHER_H
@@ -1 +1,238 @@
-// Placeholder for AST implementation
\ No newline at end of file
+#include "msl_parser/ast/recursive_visitor.h"
+#include <new>
+
+namespace msl_parser {
+namespace ast {
+
+// ASTNode allocation
+//
+// A node allocated from the global heap is preceded by a null resource
+// pointer. One allocated from a resource is preceded by the resource and,
+// before that, the size of the whole block:
+//
+//   heap:      [nullptr][node]
+//   resource:  [size][resource][node]
+
+namespace {
+
+constexpr size_t RESOURCE_HEADER = 2 * sizeof(void*);
+
+std::pmr::memory_resource*& resourceOf(const void* node) {
+    auto* bytes = static_cast<unsigned char*>(const_cast<void*>(node));
+    return *reinterpret_cast<std::pmr::memory_resource**>(bytes - sizeof(void*));
+}
+
+} // namespace
+
+void* ASTNode::operator new(size_t size) {
+    auto* block = static_cast<unsigned char*>(::operator new(sizeof(void*) + size));
+    void* node = block + sizeof(void*);
+    resourceOf(node) = nullptr;
+    return node;
+}
+
+void* ASTNode::operator new(size_t size, std::pmr::memory_resource* resource) {
+    size += RESOURCE_HEADER;
+    auto* block = static_cast<unsigned char*>(resource->allocate(size, alignof(std::max_align_t)));
+    *reinterpret_cast<size_t*>(block) = size;
+    void* node = block + RESOURCE_HEADER;
+    resourceOf(node) = resource;
+    return node;
+}
+
+void ASTNode::operator delete(void* pointer) {
+    if (!pointer) {
+        return;
+    }
+    std::pmr::memory_resource* resource = resourceOf(pointer);
+    if (!resource) {
+        ::operator delete(static_cast<unsigned char*>(pointer) - sizeof(void*));
+        return;
+    }
+    auto* block = static_cast<unsigned char*>(pointer) - RESOURCE_HEADER;
+    resource->deallocate(block, *reinterpret_cast<size_t*>(block), alignof(std::max_align_t));
+}
+
+// Matches the placement form; called only if a node's constructor throws.
+void ASTNode::operator delete(void* pointer, std::pmr::memory_resource*) {
+    operator delete(pointer);
+}
+
+size_t ASTNode::allocationHeaderSize(const ASTNode* node) {
+    return resourceOf(node) ? RESOURCE_HEADER : sizeof(void*);
+}
+
+std::pmr::memory_resource* ASTNode::getResource() const {
+    std::pmr::memory_resource* resource = resourceOf(this);
+    return resource ? resource : std::pmr::get_default_resource();
+}
+
+void RecursiveASTVisitor::visitIntegerLiteral(IntegerLiteral* node) {
+    visitNode(node);
+}
+
+void RecursiveASTVisitor::visitFloatLiteral(FloatLiteral* node) {
+    visitNode(node);
+}
+
+void RecursiveASTVisitor::visitBoolLiteral(BoolLiteral* node) {
+    visitNode(node);
+}
+
+void RecursiveASTVisitor::visitIdentifier(Identifier* node) {
+    visitNode(node);
+}
+
+void RecursiveASTVisitor::visitUnaryExpression(UnaryExpression* node) {
+    visitNode(node);
+    traverse(node->getOperand());
+}
+
+void RecursiveASTVisitor::visitBinaryExpression(BinaryExpression* node) {
+    visitNode(node);
+    traverse(node->getLeft());
+    traverse(node->getRight());
+}
+
+void RecursiveASTVisitor::visitConditionalExpression(ConditionalExpression* node) {
+    visitNode(node);
+    traverse(node->getCondition());
+    traverse(node->getTrueExpression());
+    traverse(node->getFalseExpression());
+}
+
+void RecursiveASTVisitor::visitCallExpression(CallExpression* node) {
+    visitNode(node);
+    traverse(node->getCallee());
+    for (const auto& arg : node->getArguments()) {
+        traverse(arg.get());
+    }
+}
+
+void RecursiveASTVisitor::visitConstructExpression(ConstructExpression* node) {
+    visitNode(node);
+    for (const auto& arg : node->getArguments()) {
+        traverse(arg.get());
+    }
+}
+
+void RecursiveASTVisitor::visitCastExpression(CastExpression* node) {
+    visitNode(node);
+    traverse(node->getOperand());
+}
+
+void RecursiveASTVisitor::visitMemberExpression(MemberExpression* node) {
+    visitNode(node);
+    traverse(node->getBase());
+}
+
+void RecursiveASTVisitor::visitIndexExpression(IndexExpression* node) {
+    visitNode(node);
+    traverse(node->getBase());
+    traverse(node->getIndex());
+}
+
+void RecursiveASTVisitor::visitVariableDeclaration(VariableDeclaration* node) {
+    visitNode(node);
+    traverse(node->getArraySize());
+    traverse(node->getInitializer());
+}
+
+void RecursiveASTVisitor::visitCompoundStatement(CompoundStatement* node) {
+    visitNode(node);
+    for (const auto& stmt : node->getStatements()) {
+        traverse(stmt.get());
+    }
+}
+
+void RecursiveASTVisitor::visitDeclarationStatement(DeclarationStatement* node) {
+    visitNode(node);
+    for (const auto& decl : node->getDeclarations()) {
+        traverse(decl.get());
+    }
+}
+
+void RecursiveASTVisitor::visitExpressionStatement(ExpressionStatement* node) {
+    visitNode(node);
+    traverse(node->getExpression());
+}
+
+void RecursiveASTVisitor::visitReturnStatement(ReturnStatement* node) {
+    visitNode(node);
+    traverse(node->getValue());
+}
+
+void RecursiveASTVisitor::visitIfStatement(IfStatement* node) {
+    visitNode(node);
+    traverse(node->getCondition());
+    traverse(node->getThen());
+    traverse(node->getElse());
+}
+
+void RecursiveASTVisitor::visitForStatement(ForStatement* node) {
+    visitNode(node);
+    traverse(node->getInit());
+    traverse(node->getCondition());
+    traverse(node->getIncrement());
+    traverse(node->getBody());
+}
+
+void RecursiveASTVisitor::visitWhileStatement(WhileStatement* node) {
+    visitNode(node);
+    traverse(node->getCondition());
+    traverse(node->getBody());
+}
+
+void RecursiveASTVisitor::visitDoStatement(DoStatement* node) {
+    visitNode(node);
+    traverse(node->getBody());
+    traverse(node->getCondition());
+}
+
+void RecursiveASTVisitor::visitSwitchStatement(SwitchStatement* node) {
+    visitNode(node);
+    traverse(node->getCondition());
+    traverse(node->getBody());
+}
+
+void RecursiveASTVisitor::visitCaseStatement(CaseStatement* node) {
+    visitNode(node);
+    traverse(node->getValue());
+}
+
+void RecursiveASTVisitor::visitBreakStatement(BreakStatement* node) {
+    visitNode(node);
+}
+
+void RecursiveASTVisitor::visitContinueStatement(ContinueStatement* node) {
+    visitNode(node);
+}
+
+void RecursiveASTVisitor::visitFunctionDeclaration(FunctionDeclaration* node) {
+    visitNode(node);
+    for (const auto& param : node->getParameters()) {
+        traverse(param.get());
+    }
+    traverse(node->getBody());
+}
+
+void RecursiveASTVisitor::visitStructDeclaration(StructDeclaration* node) {
+    visitNode(node);
+    for (const auto& field : node->getFields()) {
+        traverse(field.get());
+    }
+}
+
+void RecursiveASTVisitor::visitUsingDeclaration(UsingDeclaration* node) {
+    visitNode(node);
+}
+
+void RecursiveASTVisitor::visitTranslationUnit(TranslationUnit* node) {
+    visitNode(node);
+    for (const auto& decl : node->getDeclarations()) {
+        traverse(decl.get());
+    }
+}
+
+} // namespace ast
+} // namespace msl_parser
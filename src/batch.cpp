@@ -0,0 +1,730 @@
+#include "msl_parser/batch.h"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include "msl_parser/ast/recursive_visitor.h"
+#include "msl_parser/hash.h"
+#include "msl_parser/json.h"
+#include "msl_parser/lexer.h"
+#include "msl_parser/parser.h"
+#include "msl_parser/prelude.h"
+#include "msl_parser/preprocessor.h"
+#include "msl_parser/type_checker.h"
+
+namespace msl_parser {
+
+using namespace ast;
+
+namespace {
+
+// Response files naming each other in a cycle stop here
+constexpr int MAX_RESPONSE_DEPTH = 16;
+
+// Per-worker arena; most files fit in the first block
+constexpr size_t ARENA_BLOCK_SIZE = 256 * 1024;
+
+bool readFile(const std::string& path, std::string& contents) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+// Splits a response file into arguments. Quotes group whitespace into an
+// argument, and a backslash outside single quotes escapes the next
+// character.
+std::vector<std::string> splitArguments(const std::string& text) {
+    std::vector<std::string> arguments;
+    std::string current;
+    bool inArgument = false;
+    char quote = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+        char c = text[i];
+        if (quote) {
+            if (c == quote) {
+                quote = 0;
+            } else if (c == '\\' && quote == '"' && i + 1 < text.size()) {
+                current += text[++i];
+            } else {
+                current += c;
+            }
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+            inArgument = true;
+        } else if (c == '\\' && i + 1 < text.size()) {
+            current += text[++i];
+            inArgument = true;
+        } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            if (inArgument) {
+                arguments.push_back(std::move(current));
+                current.clear();
+                inArgument = false;
+            }
+        } else {
+            current += c;
+            inArgument = true;
+        }
+    }
+    if (inArgument) {
+        arguments.push_back(std::move(current));
+    }
+    return arguments;
+}
+
+bool expandInput(const std::string& argument, std::vector<std::string>& files, std::string& error,
+                 int depth) {
+    if (argument.size() > 1 && argument[0] == '@') {
+        std::string path = argument.substr(1);
+        std::string contents;
+        if (depth >= MAX_RESPONSE_DEPTH) {
+            error = "response files nested too deeply: " + path;
+            return false;
+        }
+        if (!readFile(path, contents)) {
+            error = "cannot read response file: " + path;
+            return false;
+        }
+        for (const std::string& nested : splitArguments(contents)) {
+            if (!expandInput(nested, files, error, depth + 1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::file_status status = fs::status(argument, ec);
+    if (ec || !fs::exists(status)) {
+        error = "no such file or directory: " + argument;
+        return false;
+    }
+    if (!fs::is_directory(status)) {
+        files.push_back(argument);
+        return true;
+    }
+    std::vector<std::string> found;
+    for (fs::recursive_directory_iterator it(argument, ec), end; !ec && it != end;
+         it.increment(ec)) {
+        if (it->path().extension() == ".metal" && it->is_regular_file(ec)) {
+            found.push_back(it->path().string());
+        }
+    }
+    if (ec) {
+        error = "cannot read directory: " + argument;
+        return false;
+    }
+    std::sort(found.begin(), found.end());
+    files.insert(files.end(), found.begin(), found.end());
+    return true;
+}
+
+class NodeCounter : public RecursiveASTVisitor {
+public:
+    size_t count = 0;
+
+protected:
+    void visitNode(ASTNode*) override { count++; }
+    const char* passName() const override { return "batch_count"; }
+};
+
+// The type as written, e.g. "device const float4*" or "texture2d<float>".
+std::string spellType(const TypeSpec& type) {
+    static const char* const SPACES[] = {"", "device ", "constant ", "thread ", "threadgroup "};
+    std::string text = SPACES[static_cast<size_t>(type.addressSpace)];
+    if (type.isConst) {
+        text += "const ";
+    }
+    text += type.name;
+    if (!type.templateArguments.empty()) {
+        text += '<';
+        for (size_t i = 0; i < type.templateArguments.size(); i++) {
+            text += i ? ", " : "";
+            text += type.templateArguments[i];
+        }
+        text += '>';
+    }
+    text.append(static_cast<size_t>(type.pointerDepth), '*');
+    if (type.isReference) {
+        text += '&';
+    }
+    return text;
+}
+
+const char* stageName(FunctionDeclaration::Qualifier qualifier) {
+    switch (qualifier) {
+        case FunctionDeclaration::Qualifier::KERNEL: return "kernel";
+        case FunctionDeclaration::Qualifier::VERTEX: return "vertex";
+        case FunctionDeclaration::Qualifier::FRAGMENT: return "fragment";
+        default: return nullptr;
+    }
+}
+
+// Writes the JSON for one file. Offsets are in the preprocessor's combined
+// offset space when it ran, and relative to `source` otherwise.
+class RecordWriter {
+public:
+    RecordWriter(std::string& out, const std::string& path, const std::string& source,
+                 const Preprocessor* preprocessor)
+        : json(out), path(path), source(source), preprocessor(preprocessor) {}
+
+    JsonWriter json;
+
+    void diagnostics(const DiagnosticEngine& engine) {
+        json.key("diagnostics");
+        json.beginArray();
+        for (const Diagnostic& diagnostic : engine.getDiagnostics()) {
+            Diagnostic local = diagnostic;
+            const DiagnosticPrinter& printer = printerFor(local.offset, local.offset);
+            uint32_t line, column;
+            printer.resolve(local.offset, line, column);
+            json.beginObject();
+            if (printerPath != &path) {
+                json.key("file");
+                json.string(*printerPath);
+            }
+            json.key("line");
+            json.number(line);
+            json.key("column");
+            json.number(column);
+            json.key("severity");
+            json.string(severityToString(DiagnosticEngine::getSeverity(diagnostic.id)));
+            json.key("message");
+            json.string(printer.formatMessage(local));
+            json.endObject();
+        }
+        json.endArray();
+    }
+
+    // "line", and "file" when `node` comes from an included header.
+    void location(const ASTNode* node) {
+        uint32_t offset = static_cast<uint32_t>(node->getSourceRange().start.offset);
+        printerFor(offset, offset);
+        if (printerPath != &path) {
+            json.key("file");
+            json.string(*printerPath);
+        }
+        json.key("line");
+        json.number(node->getSourceRange().start.line);
+    }
+
+    void attributes(const std::pmr::vector<Attribute>& attributes) {
+        json.key("attributes");
+        json.beginArray();
+        for (const Attribute& attribute : attributes) {
+            json.beginObject();
+            json.key("name");
+            json.string(attribute.name);
+            if (!attribute.argument.empty()) {
+                json.key("argument");
+                json.string(attribute.argument);
+            }
+            json.endObject();
+        }
+        json.endArray();
+    }
+
+    void variable(const VariableDeclaration* variable) {
+        json.beginObject();
+        json.key("name");
+        json.string(variable->getName());
+        json.key("type");
+        json.string(spellType(variable->getType()));
+        attributes(variable->getAttributes());
+        json.endObject();
+    }
+
+private:
+    const std::string& path;
+    const std::string& source;
+    const Preprocessor* preprocessor;
+    // One printer per file, created on first use
+    std::vector<std::unique_ptr<DiagnosticPrinter>> printers;
+    const std::string* printerPath = nullptr;
+
+    // The printer for the file `offset` falls in; `local` becomes the offset
+    // within that file.
+    const DiagnosticPrinter& printerFor(uint32_t offset, uint32_t& local) {
+        size_t index = 0;
+        local = offset;
+        printerPath = &path;
+        const std::string* text = &source;
+        if (preprocessor) {
+            const Preprocessor::SourceFile* file = preprocessor->findFile(offset);
+            if (file) {
+                index = static_cast<size_t>(file - preprocessor->getFiles().data());
+                local = offset - file->base;
+                if (index != 0) {
+                    printerPath = &file->file->path;
+                    text = &file->file->source;
+                }
+            }
+        }
+        if (index >= printers.size()) {
+            printers.resize(index + 1);
+        }
+        if (!printers[index]) {
+            printers[index] = std::make_unique<DiagnosticPrinter>(*text, *printerPath);
+        }
+        return *printers[index];
+    }
+};
+
+void writeTokens(RecordWriter& record, const std::pmr::vector<Token>& tokens) {
+    JsonWriter& json = record.json;
+    json.key("tokens");
+    json.beginArray();
+    for (const Token& token : tokens) {
+        if (token.type == TokenType::END_OF_FILE) {
+            break;
+        }
+        json.beginObject();
+        json.key("type");
+        json.string(tokenTypeToString(token.type));
+        json.key("text");
+        json.string(token.lexeme);
+        json.key("line");
+        json.number(token.line);
+        json.key("column");
+        json.number(token.column);
+        json.endObject();
+    }
+    json.endArray();
+}
+
+void writeSummary(RecordWriter& record, TranslationUnit* unit, size_t tokenCount) {
+    JsonWriter& json = record.json;
+    NodeCounter counter;
+    counter.traverse(unit);
+    json.key("tokenCount");
+    json.number(static_cast<int64_t>(tokenCount));
+    json.key("nodeCount");
+    json.number(static_cast<int64_t>(counter.count));
+    json.key("declarations");
+    json.beginArray();
+    for (const auto& declaration : unit->getDeclarations()) {
+        json.beginObject();
+        json.key("kind");
+        json.string(nodeKindToString(getNodeKind(declaration.get())));
+        json.key("name");
+        json.string(declaration->getName());
+        record.location(declaration.get());
+        json.endObject();
+    }
+    json.endArray();
+}
+
+void writeReflection(RecordWriter& record, TranslationUnit* unit) {
+    JsonWriter& json = record.json;
+    std::vector<FunctionDeclaration*> entryPoints;
+    std::vector<StructDeclaration*> structs;
+    std::vector<VariableDeclaration*> globals;
+    for (const auto& declaration : unit->getDeclarations()) {
+        switch (getNodeKind(declaration.get())) {
+            case NodeKind::FunctionDeclaration: {
+                auto* function = static_cast<FunctionDeclaration*>(declaration.get());
+                if (stageName(function->getQualifier())) {
+                    entryPoints.push_back(function);
+                }
+                break;
+            }
+            case NodeKind::StructDeclaration:
+                structs.push_back(static_cast<StructDeclaration*>(declaration.get()));
+                break;
+            case NodeKind::VariableDeclaration:
+                globals.push_back(static_cast<VariableDeclaration*>(declaration.get()));
+                break;
+            default:
+                break;
+        }
+    }
+
+    json.key("entryPoints");
+    json.beginArray();
+    for (FunctionDeclaration* function : entryPoints) {
+        json.beginObject();
+        json.key("name");
+        json.string(function->getName());
+        json.key("stage");
+        json.string(stageName(function->getQualifier()));
+        record.location(function);
+        json.key("returnType");
+        json.string(spellType(function->getReturnType()));
+        record.attributes(function->getAttributes());
+        json.key("parameters");
+        json.beginArray();
+        for (const auto& parameter : function->getParameters()) {
+            record.variable(parameter.get());
+        }
+        json.endArray();
+        json.endObject();
+    }
+    json.endArray();
+
+    json.key("structs");
+    json.beginArray();
+    for (StructDeclaration* structure : structs) {
+        json.beginObject();
+        json.key("name");
+        json.string(structure->getName());
+        record.location(structure);
+        json.key("fields");
+        json.beginArray();
+        for (const auto& field : structure->getFields()) {
+            record.variable(field.get());
+        }
+        json.endArray();
+        json.endObject();
+    }
+    json.endArray();
+
+    json.key("globals");
+    json.beginArray();
+    for (VariableDeclaration* global : globals) {
+        json.beginObject();
+        json.key("name");
+        json.string(global->getName());
+        json.key("type");
+        json.string(spellType(global->getType()));
+        record.location(global);
+        record.attributes(global->getAttributes());
+        json.endObject();
+    }
+    json.endArray();
+}
+
+// The start of a line: "{", and "file" with its value. What follows
+// depends only on the contents of the file (see sharingDirectory()).
+void writeFileKey(const std::string& path, std::string& out) {
+    JsonWriter json(out);
+    json.beginObject();
+    json.key("file");
+    json.string(path);
+}
+
+// The directory a file's line depends on besides its contents: its own
+// when it is preprocessed and may include a file by a quoted name, which
+// is looked up next to it first; otherwise none, and identical files
+// anywhere share their line.
+std::string sharingDirectory(const std::string& path, const std::string& source,
+                             bool preprocess) {
+    if (!preprocess || source.find("include") == std::string::npos) {
+        return std::string();
+    }
+    return std::filesystem::path(path).parent_path().string();
+}
+
+// The line for a file that cannot be read
+void writeUnreadable(const std::string& path, std::string& out) {
+    JsonWriter json(out);
+    json.beginObject();
+    json.key("file");
+    json.string(path);
+    json.key("ok");
+    json.boolean(false);
+    json.key("diagnostics");
+    json.beginArray();
+    json.beginObject();
+    json.key("severity");
+    json.string("error");
+    json.key("message");
+    json.string("cannot read file");
+    json.endObject();
+    json.endArray();
+    json.endObject();
+    out += '\n';
+}
+
+} // namespace
+
+bool expandInputs(const std::vector<std::string>& arguments, std::vector<std::string>& files,
+                  std::string& error) {
+    for (const std::string& argument : arguments) {
+        if (!expandInput(argument, files, error, 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+BatchProcessor::BatchProcessor(BatchOptions options) : options(std::move(options)) {
+    if (this->options.prelude) {
+        preludeDeclarations = std::make_shared<const PreludeDeclarations>(this->options.prelude);
+    }
+}
+
+bool BatchProcessor::processSource(const std::string& path, const std::string& source,
+                                   std::string& out, std::pmr::memory_resource* resource,
+                                   std::vector<std::string>* dependencies) const {
+    DiagnosticEngine diagnostics;
+    Preprocessor preprocessor(&diagnostics);
+    const bool preprocess = options.preprocess && options.mode != BatchMode::TOKENS;
+    std::pmr::vector<Token> tokens(resource ? resource : std::pmr::get_default_resource());
+    if (preprocess) {
+        for (const std::string& searchPath : options.searchPaths) {
+            preprocessor.addSearchPath(searchPath);
+        }
+        for (const auto& define : options.defines) {
+            preprocessor.define(define.first, define.second);
+        }
+        if (options.prelude) {
+            preprocessor.setPrelude(options.prelude);
+        }
+        tokens = preprocessor.preprocess(source, path, resource);
+        if (dependencies) {
+            const std::vector<Preprocessor::SourceFile>& files = preprocessor.getFiles();
+            for (size_t i = 1; i < files.size(); i++) {
+                dependencies->push_back(files[i].file->path);
+            }
+        }
+    } else {
+        Lexer lexer(source, &diagnostics, nullptr, resource);
+        tokens = lexer.scanTokens();
+    }
+
+    std::unique_ptr<TranslationUnit> unit;
+    if (options.mode != BatchMode::TOKENS) {
+        Parser parser(tokens, &diagnostics, nullptr, resource);
+        unit = parser.parse();
+        if (options.typeCheck) {
+            TypeChecker checker(&diagnostics);
+            checker.setPrelude(preludeDeclarations);
+            checker.check(unit.get());
+        }
+    }
+
+    const bool ok = !diagnostics.hasErrors();
+    RecordWriter record(out, path, source, preprocess ? &preprocessor : nullptr);
+    JsonWriter& json = record.json;
+    json.beginObject();
+    json.key("file");
+    json.string(path);
+    json.key("ok");
+    json.boolean(ok);
+    switch (options.mode) {
+        case BatchMode::TOKENS:
+            writeTokens(record, tokens);
+            break;
+        case BatchMode::AST:
+            // Not counting END_OF_FILE
+            writeSummary(record, unit.get(), tokens.size() - 1);
+            break;
+        case BatchMode::REFLECTION:
+            writeReflection(record, unit.get());
+            break;
+    }
+    record.diagnostics(diagnostics);
+    json.endObject();
+    out += '\n';
+    return ok;
+}
+
+bool BatchProcessor::processFile(const std::string& path, std::string& out,
+                                 std::pmr::memory_resource* resource,
+                                 std::vector<std::string>* dependencies) const {
+    std::string source;
+    if (readFile(path, source)) {
+        return processSource(path, source, out, resource, dependencies);
+    }
+    writeUnreadable(path, out);
+    return false;
+}
+
+size_t BatchProcessor::run(const std::vector<std::string>& files, std::ostream& out,
+                           BatchStats* stats) const {
+    struct Slot {
+        std::string output;
+        std::atomic<bool> done{false};
+    };
+    std::vector<Slot> slots(files.size());
+    std::atomic<size_t> failures{0};
+    // Lines before `flushed` have been written. Only the thread holding
+    // `flushing` writes.
+    std::atomic<size_t> flushed{0};
+    std::atomic<bool> flushing{false};
+
+    // Called after marking a slot done. Marking slots done, taking and
+    // releasing the flag and the check of the next slot after releasing it
+    // are sequentially consistent, so either a worker that just marked its
+    // slot done sees the flag free or the flusher sees the slot done.
+    auto flush = [&]() {
+        while (!flushing.exchange(true)) {
+            size_t index = flushed.load(std::memory_order_relaxed);
+            while (index < slots.size() && slots[index].done.load(std::memory_order_acquire)) {
+                out.write(slots[index].output.data(),
+                          static_cast<std::streamsize>(slots[index].output.size()));
+                std::string().swap(slots[index].output);
+                index++;
+            }
+            flushed.store(index, std::memory_order_relaxed);
+            flushing.store(false);
+            // A worker that finished the next line while this one held the
+            // flag left it for us
+            if (index == slots.size() || !slots[index].done.load()) {
+                break;
+            }
+        }
+    };
+
+    // The first file taken with some contents; later ones with the same
+    // contents and directory get its line
+    struct Shared {
+        std::string directory;  // see sharingDirectory()
+        std::string source;
+        std::string record;     // the line after writeFileKey()
+        bool ok = false;
+        bool done = false;
+        std::vector<size_t> waiting;  // duplicates taken before it was done
+    };
+    std::mutex sharedMutex;
+    std::unordered_multimap<uint64_t, Shared> shared;  // by hashContent()
+    size_t sharedBytes = 0;
+    std::atomic<size_t> processed{0};
+    std::atomic<size_t> duplicates{0};
+    std::atomic<size_t> duplicateBytes{0};
+    std::atomic<size_t> unreadable{0};
+    const bool preprocess = options.preprocess && options.mode != BatchMode::TOKENS;
+
+    // Gives file `index` the line of an identical file and flushes
+    auto finishDuplicate = [&](size_t index, const std::string& record, bool ok) {
+        writeFileKey(files[index], slots[index].output);
+        slots[index].output += record;
+        if (!ok) {
+            failures.fetch_add(1, std::memory_order_relaxed);
+        }
+        slots[index].done.store(true);
+        flush();
+    };
+
+    FileReaderOptions readerOptions;
+    readerOptions.io = options.io;
+    FileReader reader(files, readerOptions);
+    auto work = [&]() {
+        std::pmr::monotonic_buffer_resource arena(ARENA_BLOCK_SIZE);
+        FileReader::File file;
+        while (reader.next(file)) {
+            const size_t index = file.index;
+            std::string& output = slots[index].output;
+            if (!file.readable) {
+                writeUnreadable(files[index], output);
+                unreadable.fetch_add(1, std::memory_order_relaxed);
+                failures.fetch_add(1, std::memory_order_relaxed);
+                slots[index].done.store(true);
+                flush();
+                continue;
+            }
+
+            // Look for an identical file, or become the one others share
+            Shared* entry = nullptr;
+            if (options.deduplicateMemory > 0) {
+                const uint64_t hash = hashContent(file.contents);
+                std::string directory = sharingDirectory(files[index], file.contents, preprocess);
+                std::unique_lock<std::mutex> lock(sharedMutex);
+                bool duplicate = false;
+                auto range = shared.equal_range(hash);
+                for (auto it = range.first; it != range.second; ++it) {
+                    Shared& candidate = it->second;
+                    if (candidate.directory != directory || candidate.source != file.contents) {
+                        continue;
+                    }
+                    duplicate = true;
+                    duplicates.fetch_add(1, std::memory_order_relaxed);
+                    duplicateBytes.fetch_add(file.contents.size(), std::memory_order_relaxed);
+                    if (!candidate.done) {
+                        candidate.waiting.push_back(index);
+                    } else {
+                        // Entries are only erased before they are done, and
+                        // never change after
+                        lock.unlock();
+                        finishDuplicate(index, candidate.record, candidate.ok);
+                    }
+                    break;
+                }
+                if (duplicate) {
+                    continue;
+                }
+                if (sharedBytes + file.contents.size() <= options.deduplicateMemory) {
+                    sharedBytes += file.contents.size();
+                    entry = &shared.emplace(hash, Shared())->second;
+                    entry->directory = std::move(directory);
+                    entry->source = std::move(file.contents);
+                }
+            }
+
+            const std::string& source = entry ? entry->source : file.contents;
+            const bool ok = processSource(files[index], source, output, &arena);
+            processed.fetch_add(1, std::memory_order_relaxed);
+            arena.release();
+            if (!ok) {
+                failures.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (!entry) {
+                slots[index].done.store(true);
+                flush();
+                continue;
+            }
+
+            // Keep the line for later duplicates if it fits, and write the
+            // ones that arrived meanwhile
+            std::string prefix;
+            writeFileKey(files[index], prefix);
+            std::string record = output.substr(prefix.size());
+            std::vector<size_t> waiting;
+            {
+                std::lock_guard<std::mutex> lock(sharedMutex);
+                entry->done = true;
+                entry->ok = ok;
+                waiting.swap(entry->waiting);
+                if (sharedBytes + record.size() <= options.deduplicateMemory) {
+                    sharedBytes += record.size();
+                    entry->record = record;
+                } else {
+                    sharedBytes -= entry->source.size();
+                    auto range = shared.equal_range(hashContent(entry->source));
+                    for (auto it = range.first; it != range.second; ++it) {
+                        if (&it->second == entry) {
+                            shared.erase(it);
+                            break;
+                        }
+                    }
+                }
+            }
+            slots[index].done.store(true);
+            flush();
+            for (size_t duplicate : waiting) {
+                finishDuplicate(duplicate, record, ok);
+            }
+        }
+    };
+
+    size_t jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::min(jobs, std::max<size_t>(files.size(), 1));
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < jobs; i++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    // Only this thread is left; writes any line still pending
+    flush();
+    if (stats) {
+        stats->processed = processed.load();
+        stats->duplicates = duplicates.load();
+        stats->duplicateBytes = duplicateBytes.load();
+        stats->unreadable = unreadable.load();
+    }
+    return failures.load();
+}
+
+} // namespace msl_parser
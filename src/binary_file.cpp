@@ -0,0 +1,105 @@
+#include "msl_parser/binary_file.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MSL_PARSER_HAVE_MMAP 1
+#endif
+
+namespace msl_parser {
+
+uint32_t bucketCount(size_t entries) {
+    uint32_t count = 1;
+    while (count < entries * 2) {
+        count *= 2;
+    }
+    return count;
+}
+
+std::vector<uint32_t> hashTable(const std::vector<std::string_view>& names) {
+    std::vector<uint32_t> buckets(bucketCount(names.size()), 0);
+    const uint32_t mask = static_cast<uint32_t>(buckets.size()) - 1;
+    for (size_t i = 0; i < names.size(); i++) {
+        uint32_t bucket = hashName(names[i]) & mask;
+        while (buckets[bucket] != 0) {
+            bucket = (bucket + 1) & mask;
+        }
+        buckets[bucket] = static_cast<uint32_t>(i + 1);
+    }
+    return buckets;
+}
+
+// MappedFile
+
+MappedFile::~MappedFile() {
+#if MSL_PARSER_HAVE_MMAP
+    if (mapped) {
+        munmap(const_cast<char*>(bytes), length);
+    }
+#endif
+}
+
+bool MappedFile::open(const std::string& path) {
+#if MSL_PARSER_HAVE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* region = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE,
+                        fd, 0);
+    ::close(fd);
+    if (region == MAP_FAILED) {
+        return false;
+    }
+    bytes = static_cast<const char*>(region);
+    length = static_cast<size_t>(status.st_size);
+    mapped = true;
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    bytes = buffer.data();
+    length = buffer.size();
+#endif
+    return true;
+}
+
+// BinaryWriter
+
+uint64_t BinaryWriter::append(const void* bytes, size_t length) {
+    out.resize((out.size() + 7) & ~size_t(7), '\0');
+    uint64_t offset = out.size();
+    out.append(static_cast<const char*>(bytes), length);
+    return offset;
+}
+
+bool BinaryWriter::save(const std::string& path) const {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(out.data(), static_cast<std::streamsize>(out.size()));
+        if (!file) {
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace msl_parser
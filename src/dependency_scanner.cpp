@@ -0,0 +1,467 @@
+#include "msl_parser/dependency_scanner.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include "msl_parser/binary_file.h"
+#include "msl_parser/preprocessor.h"
+
+namespace msl_parser {
+
+namespace {
+
+constexpr char MAGIC[8] = {'M', 'S', 'L', 'D', 'E', 'P', 'S', 'C'};
+// Bump whenever the layout or what minimizeDirectives() keeps changes
+constexpr uint32_t VERSION = 1;
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+bool readFile(const std::string& path, std::string& contents) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+enum class DirectiveKind {
+    INCLUDE,
+    MACRO,        // #define, #undef and "#pragma once"
+    CONDITIONAL,  // #if, #ifdef and #ifndef
+    ALTERNATIVE,  // #elif and #else
+    END,          // #endif
+    OTHER,        // dropped
+};
+
+struct Directive {
+    const char* begin;  // the '#'
+    const char* end;    // the newline ending it, or the end of the source
+    DirectiveKind kind;
+};
+
+// Finds the directives of a source the way the Lexer would: a '#' is one
+// when only whitespace and comments come before it on its line, and a
+// directive runs to the first newline outside a string or a block comment
+// that no backslash escapes.
+class DirectiveScanner {
+public:
+    explicit DirectiveScanner(std::string_view source)
+        : begin(source.data()), end(source.data() + source.size()) {}
+
+    void run(std::vector<Directive>& directives) {
+        const char* p = begin;
+        // Each iteration starts at or inside the leading whitespace of a line
+        while (p < end) {
+            char c = *p;
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                p++;
+            } else if (c == '/' && p + 1 < end && p[1] == '*') {
+                p = skipBlockComment(p + 2);
+            } else if (c == '\\' && joinsLines(p)) {
+                p = find(p, '\n') + 1;
+            } else if (c == '#') {
+                const char* hash = p;
+                p = lineEnd(p + 1);
+                DirectiveKind kind = classify(hash + 1, p);
+                if (kind != DirectiveKind::OTHER) {
+                    directives.push_back({hash, p, kind});
+                }
+            } else {
+                p = lineEnd(p);
+            }
+        }
+    }
+
+private:
+    const char* begin;
+    const char* end;
+
+    const char* find(const char* p, char c) const {
+        const void* found = std::memchr(p, c, static_cast<size_t>(end - p));
+        return found ? static_cast<const char*>(found) : end;
+    }
+
+    // A backslash before "\n" or "\r\n"
+    bool joinsLines(const char* p) const {
+        return p + 1 < end && (p[1] == '\n' || (p[1] == '\r' && p + 2 < end && p[2] == '\n'));
+    }
+
+    // The newline ending the line `p` is in, or `end`.
+    const char* lineEnd(const char* p) const {
+        while (p < end) {
+            const char* newline = find(p, '\n');
+            const size_t length = static_cast<size_t>(newline - p);
+            const char* quote = static_cast<const char*>(std::memchr(p, '"', length));
+            const char* slash = static_cast<const char*>(std::memchr(p, '/', length));
+            if (!quote && !slash) {
+                const char* last = newline;
+                if (last > p && last[-1] == '\r') {
+                    last--;
+                }
+                if (newline == end || last == p || last[-1] != '\\') {
+                    return newline;
+                }
+                p = newline + 1;
+                continue;
+            }
+            const char* special = !quote ? slash : !slash ? quote : std::min(quote, slash);
+            if (*special == '"') {
+                p = skipString(special + 1);
+            } else if (special + 1 < end && special[1] == '/') {
+                return find(special, '\n'); // a line comment does not continue
+            } else if (special + 1 < end && special[1] == '*') {
+                p = skipBlockComment(special + 2);
+            } else {
+                p = special + 1;
+            }
+        }
+        return end;
+    }
+
+    // Strings may span lines, as in the Lexer
+    const char* skipString(const char* p) const {
+        while (p < end) {
+            if (*p == '"') {
+                return p + 1;
+            }
+            p += *p == '\\' ? 2 : 1;
+        }
+        return end;
+    }
+
+    const char* skipBlockComment(const char* p) const {
+        while (p < end) {
+            p = find(p, '*');
+            if (p + 1 < end && p[1] == '/') {
+                return p + 2;
+            }
+            p++;
+        }
+        return end;
+    }
+
+    static bool isIdentifierChar(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+               c == '_';
+    }
+
+    // The identifier at `p` after spaces, moving `p` past it
+    static std::string_view word(const char*& p, const char* end) {
+        while (p < end && (*p == ' ' || *p == '\t')) {
+            p++;
+        }
+        const char* begin = p;
+        while (p < end && isIdentifierChar(*p)) {
+            p++;
+        }
+        return std::string_view(begin, static_cast<size_t>(p - begin));
+    }
+
+    static DirectiveKind classify(const char* p, const char* end) {
+        std::string_view name = word(p, end);
+        if (name == "include") {
+            return DirectiveKind::INCLUDE;
+        }
+        if (name == "define" || name == "undef") {
+            return DirectiveKind::MACRO;
+        }
+        if (name == "if" || name == "ifdef" || name == "ifndef") {
+            return DirectiveKind::CONDITIONAL;
+        }
+        if (name == "elif" || name == "else") {
+            return DirectiveKind::ALTERNATIVE;
+        }
+        if (name == "endif") {
+            return DirectiveKind::END;
+        }
+        if (name == "pragma" && word(p, end) == "once") {
+            return DirectiveKind::MACRO;
+        }
+        return DirectiveKind::OTHER;
+    }
+};
+
+struct StringRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t fileCount;
+    uint32_t padding;
+    // Byte offsets of the sections
+    uint64_t strings;
+    uint64_t stringsSize;
+    uint64_t files;
+};
+
+struct CacheRecord {
+    StringRef path;
+    StringRef source;  // minimized
+    uint64_t size;
+    int64_t modificationTime;
+};
+
+// Minimized sources by path: those in the cache file and those minimized
+// since. Safe to use from several threads.
+class MinimizedFiles {
+public:
+    std::atomic<size_t> minimized{0};
+    std::atomic<size_t> cached{0};
+
+    // A missing or unusable cache file is ignored.
+    void load(const std::string& path) {
+        if (!file.open(path)) {
+            return;
+        }
+        const char* data = file.data();
+        const size_t size = file.size();
+        CacheHeader header;
+        if (size < sizeof(header)) {
+            return;
+        }
+        std::memcpy(&header, data, sizeof(header));
+        auto fits = [&](uint64_t offset, uint64_t count, size_t recordSize) {
+            return offset <= size && count <= (size - offset) / recordSize;
+        };
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+            header.byteOrder != BYTE_ORDER_MARK || !fits(header.strings, header.stringsSize, 1) ||
+            !fits(header.files, header.fileCount, sizeof(CacheRecord))) {
+            return;
+        }
+        auto string = [&](const StringRef& ref, std::string_view& text) {
+            if (ref.offset > header.stringsSize || ref.length > header.stringsSize - ref.offset) {
+                return false;
+            }
+            text = std::string_view(data + header.strings + ref.offset, ref.length);
+            return true;
+        };
+        for (uint32_t i = 0; i < header.fileCount; i++) {
+            CacheRecord record;
+            std::memcpy(&record, data + header.files + i * sizeof(CacheRecord), sizeof(record));
+            std::string_view recordPath;
+            Entry entry{record.size, record.modificationTime, {}};
+            if (string(record.path, recordPath) && string(record.source, entry.source)) {
+                stored.emplace(recordPath, entry);
+            }
+        }
+    }
+
+    // A HeaderCache::Loader
+    bool get(const std::string& path, uint64_t size, int64_t modificationTime,
+             std::string& source) {
+        auto it = stored.find(path);
+        if (it != stored.end() && it->second.size == size &&
+            it->second.modificationTime == modificationTime) {
+            source.assign(it->second.source);
+            cached.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        std::string contents;
+        if (!readFile(path, contents)) {
+            return false;
+        }
+        source = minimizeDirectives(contents);
+        minimized.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex);
+        added[path] = {size, modificationTime, source};
+        return true;
+    }
+
+    // Writes the stored files, updated with the ones minimized since, to
+    // `path`. Nothing is written when nothing changed.
+    bool save(const std::string& path) const {
+        if (added.empty()) {
+            return true;
+        }
+        BinaryWriter writer;
+        std::vector<CacheRecord> records;
+        auto add = [&](std::string_view filePath, uint64_t size, int64_t modificationTime,
+                       std::string_view source) {
+            CacheRecord record = {};
+            record.path = writer.string<StringRef>(filePath);
+            record.source = writer.string<StringRef>(source);
+            record.size = size;
+            record.modificationTime = modificationTime;
+            records.push_back(record);
+        };
+        for (const auto& [filePath, entry] : stored) {
+            if (!added.count(std::string(filePath))) {
+                add(filePath, entry.size, entry.modificationTime, entry.source);
+            }
+        }
+        for (const auto& [filePath, entry] : added) {
+            add(filePath, entry.size, entry.modificationTime, entry.source);
+        }
+
+        CacheHeader header = {};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.byteOrder = BYTE_ORDER_MARK;
+        header.fileCount = static_cast<uint32_t>(records.size());
+        writer.append(&header, sizeof(header)); // placeholder, rewritten below
+        header.strings = writer.append(writer.getStrings().data(), writer.getStrings().size());
+        header.stringsSize = writer.getStrings().size();
+        header.files = writer.section(records);
+        std::memcpy(&writer.out[0], &header, sizeof(header));
+        return writer.save(path);
+    }
+
+private:
+    struct Entry {
+        uint64_t size;
+        int64_t modificationTime;
+        std::string_view source;
+    };
+    struct AddedEntry {
+        uint64_t size;
+        int64_t modificationTime;
+        std::string source;
+    };
+
+    MappedFile file;
+    // Points into `file`; not changed after load()
+    std::unordered_map<std::string_view, Entry> stored;
+    std::mutex mutex;
+    std::unordered_map<std::string, AddedEntry> added;
+};
+
+} // namespace
+
+std::string minimizeDirectives(std::string_view source) {
+    std::vector<Directive> directives;
+    DirectiveScanner(source).run(directives);
+
+    // Conditional blocks with nothing but other such blocks inside make no
+    // difference, so their conditions are never evaluated
+    std::vector<bool> keep(directives.size(), true);
+    struct Block {
+        size_t first;
+        bool used;
+    };
+    std::vector<Block> blocks;
+    for (size_t i = 0; i < directives.size(); i++) {
+        switch (directives[i].kind) {
+            case DirectiveKind::CONDITIONAL:
+                blocks.push_back({i, false});
+                break;
+            case DirectiveKind::ALTERNATIVE:
+                break;
+            case DirectiveKind::END:
+                if (!blocks.empty()) {
+                    Block block = blocks.back();
+                    blocks.pop_back();
+                    if (!block.used) {
+                        std::fill(keep.begin() + static_cast<ptrdiff_t>(block.first),
+                                  keep.begin() + static_cast<ptrdiff_t>(i) + 1, false);
+                    } else if (!blocks.empty()) {
+                        blocks.back().used = true;
+                    }
+                }
+                break;
+            default:
+                if (!blocks.empty()) {
+                    blocks.back().used = true;
+                }
+                break;
+        }
+    }
+
+    std::string out;
+    auto newlines = [&](const char* begin, const char* end) {
+        out.append(static_cast<size_t>(std::count(begin, end, '\n')), '\n');
+    };
+    const char* position = source.data();
+    for (size_t i = 0; i < directives.size(); i++) {
+        const Directive& directive = directives[i];
+        newlines(position, directive.begin);
+        if (keep[i]) {
+            out.append(directive.begin, directive.end);
+        } else {
+            newlines(directive.begin, directive.end);
+        }
+        position = directive.end;
+    }
+    newlines(position, source.data() + source.size());
+    return out;
+}
+
+bool scanDependencies(const std::vector<std::string>& files, const DependencyScanOptions& options,
+                      std::vector<FileDependencies>& results, std::string& error,
+                      DependencyScanStats* stats) {
+    MinimizedFiles minimized;
+    if (!options.cachePath.empty()) {
+        minimized.load(options.cachePath);
+    }
+    HeaderCache cache([&](const std::string& path, uint64_t size, int64_t modificationTime,
+                          std::string& source) {
+        return minimized.get(path, size, modificationTime, source);
+    });
+
+    results.assign(files.size(), FileDependencies());
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        for (size_t index = next.fetch_add(1); index < files.size(); index = next.fetch_add(1)) {
+            FileDependencies& result = results[index];
+            result.file = files[index];
+            std::shared_ptr<const LexedFile> file = cache.get(files[index]);
+            if (!file) {
+                continue;
+            }
+            result.readable = true;
+
+            DiagnosticEngine diagnostics(0);
+            Preprocessor preprocessor(&diagnostics, &cache);
+            for (const std::string& searchPath : options.searchPaths) {
+                preprocessor.addSearchPath(searchPath);
+            }
+            for (const auto& [name, value] : options.defines) {
+                preprocessor.define(name, value);
+            }
+            preprocessor.preprocess(file->source, files[index]);
+            const std::vector<Preprocessor::SourceFile>& read = preprocessor.getFiles();
+            for (size_t i = 1; i < read.size(); i++) {
+                result.dependencies.push_back(read[i].file->path);
+            }
+            if (diagnostics.hasErrors()) {
+                std::ostringstream out;
+                preprocessor.printDiagnostics(out, diagnostics);
+                result.errors = out.str();
+            }
+        }
+    };
+    size_t jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::min(jobs, std::max<size_t>(files.size(), 1));
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < jobs; i++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    if (stats) {
+        stats->minimized = minimized.minimized.load();
+        stats->cached = minimized.cached.load();
+        stats->unreadable = static_cast<size_t>(
+            std::count_if(results.begin(), results.end(),
+                          [](const FileDependencies& result) { return !result.readable; }));
+    }
+    if (!options.cachePath.empty() && !minimized.save(options.cachePath)) {
+        error = "cannot write '" + options.cachePath + "'";
+        return false;
+    }
+    return true;
+}
+
+} // namespace msl_parser
@@ -1 +1,178 @@
-// Placeholder for Error handling implementation
\ No newline at end of file
+#include "msl_parser/error.h"
+#include <algorithm>
+#include "msl_parser/token.h"
+
+namespace msl_parser {
+
+namespace {
+
+struct DiagInfo {
+    Severity severity;
+    const char* message;
+};
+
+const DiagInfo diagInfos[] = {
+#define DIAG(ID, SEVERITY, MESSAGE) {Severity::SEVERITY, MESSAGE},
+#include "msl_parser/diagnostic_kinds.def"
+#undef DIAG
+};
+
+static_assert(sizeof(diagInfos) / sizeof(diagInfos[0]) ==
+                  static_cast<size_t>(DiagID::NUM_DIAGNOSTICS),
+              "diagnostic table out of sync with DiagID");
+
+const DiagInfo& infoFor(DiagID id) {
+    return diagInfos[static_cast<size_t>(id)];
+}
+
+std::string formatArgument(DiagArgKind kind, uint32_t value) {
+    switch (kind) {
+        case DiagArgKind::CHARACTER: {
+            if (value >= 0x20 && value < 0x7f) {
+                return std::string(1, static_cast<char>(value));
+            }
+            static const char hex[] = "0123456789abcdef";
+            return std::string("\\x") + hex[(value >> 4) & 0xf] + hex[value & 0xf];
+        }
+        case DiagArgKind::TOKEN_TYPE:
+            return tokenTypeSpelling(static_cast<TokenType>(value));
+        case DiagArgKind::INTEGER:
+        default:
+            return std::to_string(value);
+    }
+}
+
+} // namespace
+
+// DiagnosticEngine
+
+DiagnosticEngine::DiagnosticEngine(size_t errorLimit) : errorLimit(errorLimit) {}
+
+void DiagnosticEngine::report(DiagID id, uint32_t offset) {
+    Diagnostic diagnostic;
+    diagnostic.id = id;
+    diagnostic.argCount = 0;
+    diagnostic.offset = offset;
+    record(diagnostic);
+}
+
+void DiagnosticEngine::report(DiagID id, uint32_t offset, DiagArgKind kind, uint32_t arg) {
+    Diagnostic diagnostic;
+    diagnostic.id = id;
+    diagnostic.argCount = 1;
+    diagnostic.argKinds[0] = kind;
+    diagnostic.args[0] = arg;
+    diagnostic.offset = offset;
+    record(diagnostic);
+}
+
+void DiagnosticEngine::record(const Diagnostic& diagnostic) {
+    if (errorLimitReached() || isSuppressed(diagnostic.id)) {
+        return;
+    }
+
+    diagnostics.push_back(diagnostic);
+    if (getSeverity(diagnostic.id) != Severity::ERROR) {
+        return;
+    }
+
+    errorCount++;
+    if (errorLimitReached()) {
+        Diagnostic note;
+        note.id = DiagID::TOO_MANY_ERRORS;
+        note.argCount = 1;
+        note.argKinds[0] = DiagArgKind::INTEGER;
+        note.args[0] = static_cast<uint32_t>(errorLimit);
+        note.offset = diagnostic.offset;
+        diagnostics.push_back(note);
+    }
+}
+
+Severity DiagnosticEngine::getSeverity(DiagID id) {
+    return infoFor(id).severity;
+}
+
+// DiagnosticPrinter
+
+DiagnosticPrinter::DiagnosticPrinter(const std::string& source, const std::string& fileName)
+    : source(source), fileName(fileName) {}
+
+void DiagnosticPrinter::indexLines() const {
+    if (!lineStarts.empty()) {
+        return;
+    }
+    lineStarts.push_back(0);
+    for (size_t i = 0; i < source.size(); i++) {
+        if (source[i] == '\n') {
+            lineStarts.push_back(static_cast<uint32_t>(i + 1));
+        }
+    }
+}
+
+void DiagnosticPrinter::resolve(uint32_t offset, uint32_t& line, uint32_t& column) const {
+    indexLines();
+    auto it = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset);
+    size_t index = static_cast<size_t>(it - lineStarts.begin()) - 1;
+    line = static_cast<uint32_t>(index + 1);
+    column = offset - lineStarts[index] + 1;
+}
+
+std::string DiagnosticPrinter::formatMessage(const Diagnostic& diagnostic) const {
+    std::string message;
+    for (const char* p = infoFor(diagnostic.id).message; *p; p++) {
+        if (p[0] == '%' && p[1] >= '0' && p[1] < '0' + static_cast<int>(Diagnostic::MAX_ARGS)) {
+            size_t index = static_cast<size_t>(p[1] - '0');
+            if (index < diagnostic.argCount) {
+                message += formatArgument(diagnostic.argKinds[index], diagnostic.args[index]);
+            }
+            p++;
+        } else {
+            message += *p;
+        }
+    }
+    return message;
+}
+
+std::string DiagnosticPrinter::render(const Diagnostic& diagnostic) const {
+    uint32_t line;
+    uint32_t column;
+    resolve(diagnostic.offset, line, column);
+
+    std::string text;
+    if (!fileName.empty()) {
+        text += fileName + ":";
+    }
+    text += std::to_string(line) + ":" + std::to_string(column) + ": " +
+            severityToString(DiagnosticEngine::getSeverity(diagnostic.id)) + ": " +
+            formatMessage(diagnostic) + "\n";
+
+    // Source snippet with a caret under the column
+    size_t lineStart = lineStarts[line - 1];
+    size_t lineEnd = source.find('\n', lineStart);
+    if (lineEnd == std::string::npos) {
+        lineEnd = source.size();
+    }
+    text += source.substr(lineStart, lineEnd - lineStart) + "\n";
+    for (size_t i = lineStart; i < lineStart + column - 1 && i < source.size(); i++) {
+        text += source[i] == '\t' ? '\t' : ' ';
+    }
+    text += "^\n";
+    return text;
+}
+
+void DiagnosticPrinter::print(std::ostream& out, const DiagnosticEngine& engine) const {
+    for (const auto& diagnostic : engine.getDiagnostics()) {
+        out << render(diagnostic);
+    }
+}
+
+const char* severityToString(Severity severity) {
+    switch (severity) {
+        case Severity::ERROR: return "error";
+        case Severity::WARNING: return "warning";
+        case Severity::NOTE: return "note";
+        default: return "unknown";
+    }
+}
+
+} // namespace msl_parser
@@ -0,0 +1,502 @@
+#include "msl_parser/file_reader.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MSL_PARSER_HAVE_PREAD 1
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define MSL_PARSER_HAVE_IO_URING 1
+#endif
+
+namespace msl_parser {
+
+namespace {
+
+// Reads `path` whole with one open, fstat and as few preads as it takes.
+bool readWhole(const std::string& path, std::string& contents) {
+#if MSL_PARSER_HAVE_PREAD
+    int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0) {
+        return false;
+    }
+    struct stat status;
+    if (::fstat(descriptor, &status) < 0 || S_ISDIR(status.st_mode)) {
+        ::close(descriptor);
+        return false;
+    }
+    contents.resize(static_cast<size_t>(status.st_size));
+    size_t offset = 0;
+    while (offset < contents.size()) {
+        ssize_t length = ::pread(descriptor, &contents[offset], contents.size() - offset,
+                                 static_cast<off_t>(offset));
+        if (length < 0 && errno == EINTR) {
+            continue;
+        }
+        if (length < 0) {
+            ::close(descriptor);
+            return false;
+        }
+        if (length == 0) {
+            contents.resize(offset); // the file shrank
+            break;
+        }
+        offset += static_cast<size_t>(length);
+    }
+    ::close(descriptor);
+    return true;
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    contents = buffer.str();
+    return true;
+#endif
+}
+
+} // namespace
+
+#if MSL_PARSER_HAVE_IO_URING
+
+// A submission and a completion queue shared with the kernel, set up
+// through the raw system calls, so no liburing is needed.
+class FileReader::Ring {
+public:
+    Ring() = default;
+    ~Ring() {
+        if (sqes != MAP_FAILED) {
+            ::munmap(sqes, sqesSize);
+        }
+        if (cqRing != MAP_FAILED && cqRing != sqRing) {
+            ::munmap(cqRing, cqSize);
+        }
+        if (sqRing != MAP_FAILED) {
+            ::munmap(sqRing, sqSize);
+        }
+        if (descriptor >= 0) {
+            ::close(descriptor);
+        }
+    }
+
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    bool init(unsigned requested) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        long result = ::syscall(__NR_io_uring_setup, requested, &params);
+        if (result < 0) {
+            return false;
+        }
+        descriptor = static_cast<int>(result);
+        entries = params.sq_entries;
+        sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) {
+            sqSize = cqSize = std::max(sqSize, cqSize);
+        }
+        sqRing = ::mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        descriptor, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) {
+            return false;
+        }
+        cqRing = single ? sqRing
+                        : ::mmap(nullptr, cqSize, PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            return false;
+        }
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* mapped = ::mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_SQES);
+        if (mapped == MAP_FAILED) {
+            return false;
+        }
+        sqes = static_cast<io_uring_sqe*>(mapped);
+
+        char* sq = static_cast<char*>(sqRing);
+        sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        char* cq = static_cast<char*>(cqRing);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        tail = submitted = *sqTail;
+        return supportsOperations();
+    }
+
+    unsigned getEntries() const { return entries; }
+
+    // A cleared submission entry, or nullptr when the queue is full.
+    io_uring_sqe* get() {
+        if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= entries) {
+            return nullptr;
+        }
+        unsigned index = tail & sqMask;
+        io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqArray[index] = index;
+        tail++;
+        return sqe;
+    }
+
+    // Submits the entries from get() and waits for `wait` completions.
+    // Returns false on errors other than interruptions and a busy kernel.
+    bool submit(unsigned wait) {
+        __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+        while (true) {
+            long result = ::syscall(__NR_io_uring_enter, descriptor, tail - submitted, wait,
+                                    wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (result >= 0) {
+                submitted += static_cast<unsigned>(result);
+                return true;
+            }
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                return false;
+            }
+        }
+    }
+
+    // Takes the next completion; false when there is none.
+    bool complete(uint64_t& data, int32_t& result) {
+        unsigned head = *cqHead;
+        if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        const io_uring_cqe& cqe = cqes[head & cqMask];
+        data = cqe.user_data;
+        result = cqe.res;
+        __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+private:
+    // io_uring_setup works from Linux 5.1, but openat, statx and read only
+    // came in 5.6, with the probe; before that they complete with -EINVAL.
+    bool supportsOperations() {
+        constexpr unsigned OPS = 64;
+        alignas(io_uring_probe) unsigned char
+            buffer[sizeof(io_uring_probe) + OPS * sizeof(io_uring_probe_op)] = {};
+        auto* probe = reinterpret_cast<io_uring_probe*>(buffer);
+        if (::syscall(__NR_io_uring_register, descriptor, IORING_REGISTER_PROBE, probe, OPS) < 0) {
+            return false;
+        }
+        for (unsigned op : {IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_CLOSE}) {
+            if (op > probe->last_op || op >= probe->ops_len ||
+                !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int descriptor = -1;
+    unsigned entries = 0;
+    void* sqRing = MAP_FAILED;
+    void* cqRing = MAP_FAILED;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqSize = 0;
+    size_t cqSize = 0;
+    size_t sqesSize = 0;
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned sqMask = 0;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+    unsigned tail = 0;       // of the entries handed out by get()
+    unsigned submitted = 0;  // tail of the entries the kernel has taken
+};
+
+#else
+
+class FileReader::Ring {};
+
+#endif
+
+FileReader::FileReader(const std::vector<std::string>& files, FileReaderOptions options)
+    : files(files), options(options), remaining(files.size()) {
+    this->options.depth = std::max(1u, this->options.depth);
+    this->options.maxQueued = std::max<size_t>(1, this->options.maxQueued);
+#if MSL_PARSER_HAVE_IO_URING
+    if (options.io != FileIo::THREADS) {
+        // Two entries per file in flight: its open and its statx
+        auto candidate = std::make_unique<Ring>();
+        if (candidate->init(2 * this->options.depth)) {
+            ring = std::move(candidate);
+            io = FileIo::IO_URING;
+        }
+    }
+#endif
+    if (files.empty()) {
+        return;
+    }
+    if (ring) {
+        threads.emplace_back(&FileReader::readWithRing, this);
+        return;
+    }
+    size_t count = std::min<size_t>(this->options.depth, files.size());
+    for (size_t i = 0; i < count; i++) {
+        threads.emplace_back(&FileReader::readWithThreads, this);
+    }
+}
+
+FileReader::~FileReader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    spaceCondition.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+bool FileReader::isIoUringAvailable() {
+#if MSL_PARSER_HAVE_IO_URING
+    return Ring().init(2);
+#else
+    return false;
+#endif
+}
+
+bool FileReader::next(File& file) {
+    std::unique_lock<std::mutex> lock(mutex);
+    readyCondition.wait(lock, [&]() { return !queue.empty() || remaining == 0; });
+    if (queue.empty()) {
+        return false;
+    }
+    file = std::move(queue.front());
+    queue.pop_front();
+    if (--remaining == 0) {
+        readyCondition.notify_all();
+    }
+    spaceCondition.notify_one();
+    return true;
+}
+
+bool FileReader::waitForSpace() {
+    std::unique_lock<std::mutex> lock(mutex);
+    spaceCondition.wait(lock, [&]() { return stopping || queue.size() < options.maxQueued; });
+    return !stopping;
+}
+
+void FileReader::deliver(File file) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(file));
+    }
+    readyCondition.notify_one();
+}
+
+void FileReader::readWithThreads() {
+    while (waitForSpace()) {
+        File file;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (nextFile == files.size()) {
+                return;
+            }
+            file.index = nextFile++;
+        }
+        file.readable = readWhole(files[file.index], file.contents);
+        deliver(std::move(file));
+    }
+}
+
+void FileReader::readWithRing() {
+#if MSL_PARSER_HAVE_IO_URING
+    // A file in flight
+    struct Slot {
+        size_t file = 0;
+        int descriptor = -1;
+        int pending = 0;  // of the open and the statx
+        bool failed = false;
+        uint64_t size = 0;
+        size_t offset = 0;
+        std::string contents;
+        struct statx status;
+    };
+    // The low bits of an entry's user data; the slot is in the others
+    enum Operation : uint64_t { OPEN, STAT, READ, CLOSE };
+    // Reads larger than this are split
+    constexpr size_t MAX_READ = 1u << 30;
+
+    std::vector<Slot> slots(options.depth);
+    std::vector<size_t> freeSlots;
+    for (size_t i = slots.size(); i > 0; i--) {
+        freeSlots.push_back(i - 1);
+    }
+    const unsigned entries = ring->getEntries();
+    unsigned inFlight = 0;
+    size_t started = 0;
+
+    // Never null: no more than `entries` operations are ever in flight
+    auto push = [&](Operation operation, size_t slot) {
+        io_uring_sqe* sqe = ring->get();
+        sqe->user_data = (static_cast<uint64_t>(slot) << 2) | operation;
+        inFlight++;
+        return sqe;
+    };
+    auto read = [&](size_t index) {
+        Slot& slot = slots[index];
+        io_uring_sqe* sqe = push(READ, index);
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = slot.descriptor;
+        sqe->addr = reinterpret_cast<uintptr_t>(&slot.contents[slot.offset]);
+        sqe->len = static_cast<uint32_t>(std::min(slot.contents.size() - slot.offset, MAX_READ));
+        sqe->off = slot.offset;
+    };
+    // Hands the file out, closes it without waiting and frees the slot
+    auto finish = [&](size_t index, bool readable) {
+        Slot& slot = slots[index];
+        File file;
+        file.index = slot.file;
+        file.readable = readable;
+        if (readable) {
+            file.contents = std::move(slot.contents);
+        }
+        slot.contents = std::string();
+        deliver(std::move(file));
+        if (slot.descriptor >= 0) {
+            io_uring_sqe* sqe = push(CLOSE, index);
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = slot.descriptor;
+            slot.descriptor = -1;
+        }
+        freeSlots.push_back(index);
+    };
+    auto opened = [&](size_t index) {
+        Slot& slot = slots[index];
+        if (slot.failed || S_ISDIR(slot.status.stx_mode)) {
+            finish(index, false);
+        } else if (slot.size == 0) {
+            finish(index, true);
+        } else {
+            slot.contents.resize(slot.size);
+            read(index);
+        }
+    };
+    auto hasRoom = [&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return !stopping && queue.size() < options.maxQueued;
+    };
+
+    while (true) {
+        // Keep the ring full: each file starts with its open and statx
+        while (started < files.size() && !freeSlots.empty() && inFlight + 2 <= entries &&
+               hasRoom()) {
+            size_t index = freeSlots.back();
+            freeSlots.pop_back();
+            Slot& slot = slots[index];
+            slot.file = started++;
+            slot.pending = 2;
+            slot.failed = false;
+            slot.size = 0;
+            slot.offset = 0;
+            const char* path = files[slot.file].c_str();
+            io_uring_sqe* sqe = push(OPEN, index);
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<uintptr_t>(path);
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            sqe = push(STAT, index);
+            sqe->opcode = IORING_OP_STATX;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<uintptr_t>(path);
+            sqe->len = STATX_SIZE | STATX_TYPE;
+            sqe->off = reinterpret_cast<uintptr_t>(&slot.status);
+        }
+        if (inFlight == 0) {
+            if (started == files.size() || !waitForSpace()) {
+                break;
+            }
+            continue;
+        }
+        if (!ring->submit(1)) {
+            // Not expected with a valid ring. The kernel may still write
+            // into the buffers in flight, so they are leaked, not freed;
+            // every file not handed out yet is reported unreadable.
+            for (Slot& slot : slots) {
+                if (slot.pending > 0 || !slot.contents.empty()) {
+                    deliver({slot.file, false, std::string()});
+                }
+            }
+            for (; started < files.size(); started++) {
+                deliver({started, false, std::string()});
+            }
+            new std::vector<Slot>(std::move(slots));
+            return;
+        }
+        uint64_t data;
+        int32_t result;
+        while (ring->complete(data, result)) {
+            inFlight--;
+            const size_t index = static_cast<size_t>(data >> 2);
+            Slot& slot = slots[index];
+            switch (static_cast<Operation>(data & 3)) {
+                case OPEN:
+                    if (result < 0) {
+                        slot.failed = true;
+                    } else {
+                        slot.descriptor = result;
+                    }
+                    if (--slot.pending == 0) {
+                        opened(index);
+                    }
+                    break;
+                case STAT:
+                    if (result < 0) {
+                        slot.failed = true;
+                    } else {
+                        slot.size = slot.status.stx_size;
+                    }
+                    if (--slot.pending == 0) {
+                        opened(index);
+                    }
+                    break;
+                case READ:
+                    if (result == -EAGAIN || result == -EINTR) {
+                        read(index);
+                    } else if (result < 0) {
+                        finish(index, false);
+                    } else if (result == 0) {
+                        slot.contents.resize(slot.offset); // the file shrank
+                        finish(index, true);
+                    } else {
+                        slot.offset += static_cast<size_t>(result);
+                        if (slot.offset < slot.contents.size()) {
+                            read(index);
+                        } else {
+                            finish(index, true);
+                        }
+                    }
+                    break;
+                case CLOSE:
+                    break;
+            }
+        }
+    }
+#endif
+}
+
+} // namespace msl_parser
@@ -0,0 +1,180 @@
+#include "msl_parser/green_tree.h"
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
+#include "msl_parser/ast/recursive_visitor.h"
+
+namespace msl_parser {
+
+using namespace ast;
+
+namespace {
+
+size_t combine(size_t seed, size_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+} // namespace
+
+// GreenNode
+
+bool GreenNode::sameAs(const GreenNode& other) const {
+    return kind == other.kind && token == other.token && triviaLength == other.triviaLength &&
+           text == other.text && children == other.children;
+}
+
+void GreenNode::writeText(std::string& out) const {
+    if (token) {
+        out += text;
+        return;
+    }
+    for (const GreenNode* child : children) {
+        child->writeText(out);
+    }
+}
+
+// GreenTreeBuilder
+
+// Walks the tokens once, opening a node whenever the next node range starts
+// at or before the next token and closing it at the first token past its
+// end.
+class GreenTreeBuilder {
+public:
+    GreenTreeBuilder(GreenNodeCache& cache, std::string_view source,
+                     const std::pmr::vector<Token>& tokens)
+        : cache(cache), source(source), tokens(tokens) {}
+
+    const GreenNode* build(TranslationUnit* unit) {
+        RangeCollector(unit, ranges).traverse(unit);
+        // Enclosing ranges first among those starting together
+        std::stable_sort(ranges.begin(), ranges.end(), [](const NodeRange& a, const NodeRange& b) {
+            return a.begin != b.begin ? a.begin < b.begin : a.end > b.end;
+        });
+        std::vector<const GreenNode*> children;
+        while (nextToken < tokens.size()) {
+            children.push_back(nextRangeStarts() ? node(nextRange++) : token());
+        }
+        return cache.makeNode(NodeKind::TranslationUnit, std::move(children));
+    }
+
+private:
+    struct NodeRange {
+        ASTNode* node;
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    // Every located node below the root
+    class RangeCollector : public RecursiveASTVisitor {
+    public:
+        RangeCollector(ASTNode* root, std::vector<NodeRange>& ranges)
+            : root(root), ranges(ranges) {}
+
+    protected:
+        void visitNode(ASTNode* node) override {
+            const SourceRange& range = node->getSourceRange();
+            if (node != root && range.start.line > 0 && range.end.offset >= range.start.offset) {
+                ranges.push_back({node, static_cast<uint32_t>(range.start.offset),
+                                  static_cast<uint32_t>(range.end.offset)});
+            }
+        }
+        const char* passName() const override { return "green_tree"; }
+
+    private:
+        ASTNode* root;
+        std::vector<NodeRange>& ranges;
+    };
+
+    GreenNodeCache& cache;
+    std::string_view source;
+    const std::pmr::vector<Token>& tokens;
+    std::vector<NodeRange> ranges;
+    size_t nextToken = 0;
+    size_t nextRange = 0;
+    uint32_t textEnd = 0;
+
+    bool nextRangeStarts() const {
+        return nextRange < ranges.size() && ranges[nextRange].begin <= tokens[nextToken].offset;
+    }
+
+    const GreenNode* node(size_t index) {
+        const NodeRange& range = ranges[index];
+        std::vector<const GreenNode*> children;
+        while (nextToken < tokens.size() && tokens[nextToken].offset < range.end) {
+            if (nextRangeStarts() && ranges[nextRange].end <= range.end) {
+                children.push_back(node(nextRange++));
+            } else {
+                children.push_back(token());
+            }
+        }
+        return cache.makeNode(getNodeKind(range.node), std::move(children));
+    }
+
+    const GreenNode* token() {
+        const Token& token = tokens[nextToken++];
+        uint32_t begin = textEnd;
+        textEnd = token.endOffset();
+        return cache.makeToken(token.type, source.substr(begin, textEnd - begin),
+                               token.offset - begin);
+    }
+};
+
+// GreenNodeCache
+
+const GreenNode* GreenNodeCache::build(std::string_view source,
+                                       const std::pmr::vector<Token>& tokens,
+                                       TranslationUnit* unit) {
+    return GreenTreeBuilder(*this, source, tokens).build(unit);
+}
+
+const GreenNode* GreenNodeCache::makeToken(TokenType type, std::string_view text,
+                                           uint32_t triviaLength) {
+    std::unique_ptr<GreenNode> token(new GreenNode());
+    token->kind = static_cast<uint8_t>(type);
+    token->token = true;
+    token->width = static_cast<uint32_t>(text.size());
+    token->triviaLength = triviaLength;
+    token->text = text;
+    token->hash = combine(std::hash<std::string_view>()(text), token->kind);
+    return intern(std::move(token));
+}
+
+const GreenNode* GreenNodeCache::makeNode(NodeKind kind, std::vector<const GreenNode*> children) {
+    std::unique_ptr<GreenNode> node(new GreenNode());
+    node->kind = static_cast<uint8_t>(kind);
+    node->hash = static_cast<size_t>(kind) + 1;
+    for (const GreenNode* child : children) {
+        node->width += child->width;
+        node->hash = combine(node->hash, std::hash<const GreenNode*>()(child));
+    }
+    node->children = std::move(children);
+    return intern(std::move(node));
+}
+
+const GreenNode* GreenNodeCache::intern(std::unique_ptr<GreenNode> candidate) {
+    auto range = nodes.equal_range(candidate->hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second->sameAs(*candidate)) {
+            return it->second.get();
+        }
+    }
+    size_t hash = candidate->hash;
+    return nodes.emplace(hash, std::move(candidate))->second.get();
+}
+
+void GreenNodeCache::retain(const std::vector<const GreenNode*>& roots) {
+    std::unordered_set<const GreenNode*> reachable;
+    std::vector<const GreenNode*> pending(roots.begin(), roots.end());
+    while (!pending.empty()) {
+        const GreenNode* node = pending.back();
+        pending.pop_back();
+        if (node && reachable.insert(node).second) {
+            pending.insert(pending.end(), node->children.begin(), node->children.end());
+        }
+    }
+    for (auto it = nodes.begin(); it != nodes.end();) {
+        it = reachable.count(it->second.get()) ? std::next(it) : nodes.erase(it);
+    }
+}
+
+} // namespace msl_parser
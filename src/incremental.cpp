@@ -0,0 +1,262 @@
+#include "msl_parser/incremental.h"
+#include <algorithm>
+#include "msl_parser/ast/recursive_visitor.h"
+#include "msl_parser/lexer.h"
+#include "msl_parser/parser.h"
+#include "msl_parser/stats.h"
+
+namespace msl_parser {
+
+namespace {
+
+bool spansLines(const Token& token) {
+    return token.lexeme.find('\n') != std::string::npos;
+}
+
+// Moves source locations that lie after the resync point of an edit.
+struct LocationShift {
+    long long offsetDelta;
+    uint32_t oldLine;
+    long long lineDelta;
+    long long columnDelta;
+
+    void apply(uint32_t& line, uint32_t& column, uint32_t& offset) const {
+        offset = static_cast<uint32_t>(offset + offsetDelta);
+        if (line == oldLine) {
+            column = static_cast<uint32_t>(column + columnDelta);
+        }
+        line = static_cast<uint32_t>(line + lineDelta);
+    }
+
+    void apply(ast::SourceLocation& location) const {
+        location.offset = static_cast<int>(location.offset + offsetDelta);
+        if (location.line == static_cast<int>(oldLine)) {
+            location.column = static_cast<int>(location.column + columnDelta);
+        }
+        location.line = static_cast<int>(location.line + lineDelta);
+    }
+};
+
+class LocationShifter : public ast::RecursiveASTVisitor {
+public:
+    explicit LocationShifter(const LocationShift& shift) : shift(shift) {}
+
+protected:
+    void visitNode(ast::ASTNode* node) override {
+        ast::SourceRange range = node->getSourceRange();
+        shift.apply(range.start);
+        shift.apply(range.end);
+        node->setSourceRange(range);
+    }
+    const char* passName() const override { return "shift_locations"; }
+
+private:
+    const LocationShift& shift;
+};
+
+} // namespace
+
+IncrementalParser::IncrementalParser(const std::string& source) : source(source) {
+    Lexer lexer(source);
+    tokens = lexer.scanTokens();
+    // No error limit: a parse that stopped early could not be extended
+    // consistently by later partial reparses.
+    DiagnosticEngine diagnostics(0);
+    Parser parser(tokens, &diagnostics);
+    unit = parser.parse();
+}
+
+void IncrementalParser::applyEdit(const TextEdit& edit) {
+    stats = EditStats();
+    // Reparsed nodes are new and reused ones have moved
+    nodeIndexValid = false;
+    size_t restartOffset = 0;
+    Resync resync = relex(edit, restartOffset);
+    reparse(restartOffset, resync);
+}
+
+const NodeIndex& IncrementalParser::getNodeIndex() {
+    if (!nodeIndexValid) {
+        nodeIndex.build(unit.get());
+        nodeIndexValid = true;
+    }
+    return nodeIndex;
+}
+
+IncrementalParser::Resync IncrementalParser::relex(const TextEdit& edit, size_t& restartOffset) {
+    MSL_PARSER_STATS(ScopedPhase phase("relex"));
+    const size_t oldEditEnd = edit.offset + edit.removedLength;
+    const size_t newEditEnd = edit.offset + edit.insertedText.size();
+    const long long delta =
+        static_cast<long long>(edit.insertedText.size()) - static_cast<long long>(edit.removedLength);
+
+    // Restart at the last token that begins strictly before the edit: it may
+    // grow into the edited text (`a` + `b` -> `ab`). Tokens spanning lines
+    // record their end line, so they cannot seed the lexer state; step over them.
+    auto firstAtEdit = std::lower_bound(
+        tokens.begin(), tokens.end(), edit.offset,
+        [](const Token& token, size_t offset) { return token.offset < offset; });
+    size_t keep = static_cast<size_t>(firstAtEdit - tokens.begin());
+    size_t restartIndex = keep > 0 ? keep - 1 : 0;
+    while (restartIndex > 0 && spansLines(tokens[restartIndex])) {
+        restartIndex--;
+    }
+
+    uint32_t line = 1;
+    uint32_t column = 1;
+    restartOffset = 0;
+    keep = 0;
+    if (restartIndex < tokens.size() && tokens[restartIndex].offset < edit.offset &&
+        !spansLines(tokens[restartIndex])) {
+        const Token& restart = tokens[restartIndex];
+        restartOffset = restart.offset;
+        line = restart.line;
+        column = restart.column;
+        keep = restartIndex;
+    }
+
+    std::pmr::vector<Token> oldTokens = std::move(tokens);
+    source.replace(edit.offset, edit.removedLength, edit.insertedText);
+
+    tokens.clear();
+    tokens.reserve(oldTokens.size());
+    tokens.insert(tokens.end(), std::make_move_iterator(oldTokens.begin()),
+                  std::make_move_iterator(oldTokens.begin() + keep));
+
+    Lexer lexer(source);
+    lexer.seek(restartOffset, line, column);
+
+    // Old tokens after the edit that a relexed token may line up with.
+    size_t candidate = keep;
+    while (candidate < oldTokens.size() && oldTokens[candidate].offset < oldEditEnd) {
+        candidate++;
+    }
+    const size_t oldEof = oldTokens.size() - 1;
+
+    Resync resync;
+    Token token(TokenType::END_OF_FILE, "", 0, 0);
+    for (;;) {
+        if (!lexer.scanNextToken(token)) {
+            tokens.push_back(token);
+            stats.relexedTokens++;
+            break;
+        }
+
+        if (token.offset >= newEditEnd) {
+            while (candidate < oldEof &&
+                   static_cast<long long>(oldTokens[candidate].offset) + delta < token.offset) {
+                candidate++;
+            }
+            // The lexer carries no state between tokens, so two token starts
+            // followed by identical text yield identical streams from here on.
+            // Only the flags of the first depend on the text before it: an
+            // edit may join its line to the previous one or split it.
+            const Token& old = oldTokens[candidate];
+            if (candidate < oldEof && static_cast<long long>(old.offset) + delta == token.offset &&
+                old.flags == token.flags && !spansLines(old)) {
+                resync.found = true;
+                resync.oldOffset = old.offset;
+                resync.offsetDelta = delta;
+                resync.oldLine = old.line;
+                resync.lineDelta = static_cast<long long>(token.line) - old.line;
+                resync.columnDelta = static_cast<long long>(token.column) - old.column;
+                break;
+            }
+        }
+        tokens.push_back(std::move(token));
+        stats.relexedTokens++;
+    }
+
+    if (resync.found) {
+        LocationShift shift{resync.offsetDelta, resync.oldLine, resync.lineDelta,
+                            resync.columnDelta};
+        for (size_t i = candidate; i < oldTokens.size(); i++) {
+            Token& old = oldTokens[i];
+            shift.apply(old.line, old.column, old.offset);
+            tokens.push_back(std::move(old));
+        }
+        stats.reusedTokens = keep + (oldTokens.size() - candidate);
+    } else {
+        stats.reusedTokens = keep;
+    }
+    return resync;
+}
+
+void IncrementalParser::reparse(size_t restartOffset, const Resync& resync) {
+    MSL_PARSER_STATS(ScopedPhase phase("reparse"));
+    ast::NodeList<ast::Declaration> oldDecls = unit->releaseDeclarations();
+
+    // Declarations that end before the relexed region are untouched, provided
+    // they were closed by ';' or '}' and so never looked at a later token.
+    size_t prefix = 0;
+    while (prefix < oldDecls.size()) {
+        const ast::SourceRange& range = oldDecls[prefix]->getSourceRange();
+        size_t end = static_cast<size_t>(range.end.offset);
+        if (end > restartOffset || end == 0 || (source[end - 1] != ';' && source[end - 1] != '}')) {
+            break;
+        }
+        prefix++;
+    }
+
+    // Declarations that start after the resync point can be reused once the
+    // parser arrives exactly at their (shifted) start.
+    size_t suffix = oldDecls.size();
+    if (resync.found) {
+        suffix = prefix;
+        while (suffix < oldDecls.size() &&
+               static_cast<size_t>(oldDecls[suffix]->getSourceRange().start.offset) <
+                   resync.oldOffset) {
+            suffix++;
+        }
+    }
+
+    size_t parseFrom = prefix > 0 ? oldDecls[prefix - 1]->getSourceRange().end.offset : 0;
+    auto startToken = std::lower_bound(
+        tokens.begin(), tokens.end(), parseFrom,
+        [](const Token& token, size_t offset) { return token.offset < offset; });
+
+    DiagnosticEngine diagnostics(0);
+    Parser parser(tokens, &diagnostics);
+    parser.setPosition(static_cast<size_t>(startToken - tokens.begin()));
+    ast::NodeList<ast::Declaration> reparsed;
+    while (!parser.isAtEnd()) {
+        long long position = tokens[parser.getPosition()].offset;
+        while (suffix < oldDecls.size() &&
+               oldDecls[suffix]->getSourceRange().start.offset + resync.offsetDelta < position) {
+            suffix++;
+        }
+        if (suffix < oldDecls.size() &&
+            oldDecls[suffix]->getSourceRange().start.offset + resync.offsetDelta == position) {
+            break;
+        }
+        parser.parseTopLevelDeclaration(reparsed);
+    }
+    if (parser.isAtEnd()) {
+        suffix = oldDecls.size();
+    }
+
+    ast::NodeList<ast::Declaration> decls;
+    decls.reserve(prefix + reparsed.size() + (oldDecls.size() - suffix));
+    for (size_t i = 0; i < prefix; i++) {
+        decls.push_back(std::move(oldDecls[i]));
+    }
+    for (auto& decl : reparsed) {
+        decls.push_back(std::move(decl));
+    }
+    LocationShift shift{resync.offsetDelta, resync.oldLine, resync.lineDelta, resync.columnDelta};
+    LocationShifter shifter(shift);
+    for (size_t i = suffix; i < oldDecls.size(); i++) {
+        shifter.traverse(oldDecls[i].get());
+        decls.push_back(std::move(oldDecls[i]));
+    }
+
+    stats.reparsedDeclarations = reparsed.size();
+    stats.reusedDeclarations = prefix + (oldDecls.size() - suffix);
+
+    unit = std::make_unique<ast::TranslationUnit>(std::move(decls));
+    const Token& eof = tokens.back();
+    unit->setSourceRange(ast::SourceRange(ast::SourceLocation(1, 1, 0),
+                                          ast::SourceLocation(eof.line, eof.column, eof.offset)));
+}
+
+} // namespace msl_parser
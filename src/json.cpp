@@ -0,0 +1,347 @@
+#include "msl_parser/json.h"
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace msl_parser {
+
+namespace {
+
+void appendUtf8(std::string& out, uint32_t code) {
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xc0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    } else if (code < 0x10000) {
+        out += static_cast<char>(0xe0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    } else {
+        out += static_cast<char>(0xf0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    }
+}
+
+} // namespace
+
+// JsonValue
+
+const JsonValue* JsonValue::get(std::string_view key) const {
+    auto it = members.find(key);
+    return it != members.end() ? &it->second : nullptr;
+}
+
+double JsonValue::numberOr(std::string_view key, double fallback) const {
+    const JsonValue* value = get(key);
+    return value && value->kind == Kind::NUMBER ? value->number : fallback;
+}
+
+std::string JsonValue::stringOr(std::string_view key, const std::string& fallback) const {
+    const JsonValue* value = get(key);
+    return value && value->kind == Kind::STRING ? value->string : fallback;
+}
+
+// JsonReader
+
+bool JsonReader::read(JsonValue& value) {
+    if (!parseValue(value, 0)) {
+        return false;
+    }
+    skipSpace();
+    return position == text.size();
+}
+
+void JsonReader::skipSpace() {
+    while (position < text.size() && (text[position] == ' ' || text[position] == '\t' ||
+                                      text[position] == '\n' || text[position] == '\r')) {
+        position++;
+    }
+}
+
+bool JsonReader::consume(char c) {
+    skipSpace();
+    if (position < text.size() && text[position] == c) {
+        position++;
+        return true;
+    }
+    return false;
+}
+
+bool JsonReader::consumeWord(std::string_view word) {
+    if (text.substr(position, word.size()) == word) {
+        position += word.size();
+        return true;
+    }
+    return false;
+}
+
+bool JsonReader::parseHex(uint32_t& code) {
+    if (position + 4 > text.size()) {
+        return false;
+    }
+    code = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = text[position++];
+        code <<= 4;
+        if (c >= '0' && c <= '9') {
+            code |= static_cast<uint32_t>(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            code |= static_cast<uint32_t>(c - 'a' + 10);
+        } else if (c >= 'A' && c <= 'F') {
+            code |= static_cast<uint32_t>(c - 'A' + 10);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool JsonReader::parseString(std::string& out) {
+    if (!consume('"')) {
+        return false;
+    }
+    while (position < text.size() && text[position] != '"') {
+        char c = text[position++];
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+        if (position >= text.size()) {
+            return false;
+        }
+        char escaped = text[position++];
+        switch (escaped) {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u': {
+                uint32_t code;
+                if (!parseHex(code)) {
+                    return false;
+                }
+                // A high surrogate followed by a low one encodes one code point
+                if (code >= 0xd800 && code < 0xdc00 && consumeWord("\\u")) {
+                    uint32_t low;
+                    if (!parseHex(low) || low < 0xdc00 || low >= 0xe000) {
+                        return false;
+                    }
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                }
+                appendUtf8(out, code);
+                break;
+            }
+            default: out += escaped; break;
+        }
+    }
+    if (position >= text.size()) {
+        return false;
+    }
+    position++;
+    return true;
+}
+
+bool JsonReader::parseValue(JsonValue& value, int depth) {
+    if (depth > MAX_DEPTH) {
+        return false;
+    }
+    skipSpace();
+    if (position >= text.size()) {
+        return false;
+    }
+    char c = text[position];
+    if (c == '{') {
+        position++;
+        value.kind = JsonValue::Kind::OBJECT;
+        if (consume('}')) {
+            return true;
+        }
+        do {
+            std::string key;
+            skipSpace();
+            if (!parseString(key) || !consume(':') ||
+                !parseValue(value.members[key], depth + 1)) {
+                return false;
+            }
+        } while (consume(','));
+        return consume('}');
+    }
+    if (c == '[') {
+        position++;
+        value.kind = JsonValue::Kind::ARRAY;
+        if (consume(']')) {
+            return true;
+        }
+        do {
+            value.items.emplace_back();
+            if (!parseValue(value.items.back(), depth + 1)) {
+                return false;
+            }
+        } while (consume(','));
+        return consume(']');
+    }
+    if (c == '"') {
+        value.kind = JsonValue::Kind::STRING;
+        return parseString(value.string);
+    }
+    if (consumeWord("true") || consumeWord("false")) {
+        value.kind = JsonValue::Kind::BOOLEAN;
+        value.boolean = text[position - 1] == 'e' && text[position - 2] == 'u';
+        return true;
+    }
+    if (consumeWord("null")) {
+        value.kind = JsonValue::Kind::NUL;
+        return true;
+    }
+    // strtod needs a terminated string; JSON numbers are short
+    size_t end = position;
+    while (end < text.size() && end - position < 64 &&
+           (std::isdigit(static_cast<unsigned char>(text[end])) || text[end] == '-' ||
+            text[end] == '+' || text[end] == '.' || text[end] == 'e' || text[end] == 'E')) {
+        end++;
+    }
+    std::string number(text.substr(position, end - position));
+    char* parsedEnd = nullptr;
+    value.number = std::strtod(number.c_str(), &parsedEnd);
+    if (number.empty() || parsedEnd != number.c_str() + number.size()) {
+        return false;
+    }
+    value.kind = JsonValue::Kind::NUMBER;
+    position = end;
+    return true;
+}
+
+// JsonWriter
+
+void JsonWriter::separate() {
+    if (needsComma) {
+        out += ',';
+    }
+}
+
+void JsonWriter::beginObject() {
+    separate();
+    out += '{';
+    needsComma = false;
+}
+
+void JsonWriter::endObject() {
+    out += '}';
+    needsComma = true;
+}
+
+void JsonWriter::beginArray() {
+    separate();
+    out += '[';
+    needsComma = false;
+}
+
+void JsonWriter::endArray() {
+    out += ']';
+    needsComma = true;
+}
+
+void JsonWriter::key(std::string_view name) {
+    separate();
+    escape(out, name);
+    out += ':';
+    needsComma = false;
+}
+
+void JsonWriter::string(std::string_view text) {
+    separate();
+    escape(out, text);
+    needsComma = true;
+}
+
+void JsonWriter::number(int64_t value) {
+    separate();
+    out += std::to_string(value);
+    needsComma = true;
+}
+
+void JsonWriter::boolean(bool value) {
+    separate();
+    out += value ? "true" : "false";
+    needsComma = true;
+}
+
+void JsonWriter::null() {
+    separate();
+    out += "null";
+    needsComma = true;
+}
+
+void JsonWriter::value(const JsonValue& value) {
+    switch (value.kind) {
+        case JsonValue::Kind::NUL:
+            null();
+            break;
+        case JsonValue::Kind::BOOLEAN:
+            boolean(value.boolean);
+            break;
+        case JsonValue::Kind::NUMBER:
+            if (value.number == std::floor(value.number) && std::fabs(value.number) < 9.0e15) {
+                number(static_cast<int64_t>(value.number));
+            } else {
+                char buffer[32];
+                std::snprintf(buffer, sizeof(buffer), "%.17g", value.number);
+                raw(buffer);
+            }
+            break;
+        case JsonValue::Kind::STRING:
+            string(value.string);
+            break;
+        case JsonValue::Kind::ARRAY:
+            beginArray();
+            for (const JsonValue& item : value.items) {
+                this->value(item);
+            }
+            endArray();
+            break;
+        case JsonValue::Kind::OBJECT:
+            beginObject();
+            for (const auto& member : value.members) {
+                key(member.first);
+                this->value(member.second);
+            }
+            endObject();
+            break;
+    }
+}
+
+void JsonWriter::raw(std::string_view json) {
+    separate();
+    out += json;
+    needsComma = true;
+}
+
+void JsonWriter::escape(std::string& out, std::string_view text) {
+    static const char HEX[] = "0123456789abcdef";
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out += "\\u00";
+                    out += HEX[(c >> 4) & 0xf];
+                    out += HEX[c & 0xf];
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+} // namespace msl_parser
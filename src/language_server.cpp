@@ -0,0 +1,761 @@
+#include "msl_parser/language_server.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "msl_parser/incremental.h"
+#include "msl_parser/lexer.h"
+#include "msl_parser/parser.h"
+#include "msl_parser/stats.h"
+#include "msl_parser/type_checker.h"
+#include "msl_parser/types.h"
+
+namespace msl_parser {
+
+using namespace ast;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// JSON-RPC error codes
+constexpr int PARSE_ERROR = -32700;
+constexpr int INVALID_REQUEST = -32600;
+constexpr int METHOD_NOT_FOUND = -32601;
+
+// LSP enumerations
+constexpr int TEXT_DOCUMENT_SYNC_INCREMENTAL = 2;
+constexpr int SYMBOL_FIELD = 8;
+constexpr int SYMBOL_FUNCTION = 12;
+constexpr int SYMBOL_VARIABLE = 13;
+constexpr int SYMBOL_STRUCT = 23;
+
+// Semantic token types, in the order of the legend sent on initialize
+enum SemanticTokenType {
+    SEMANTIC_KEYWORD,
+    SEMANTIC_TYPE,
+    SEMANTIC_FUNCTION,
+    SEMANTIC_VARIABLE,
+    SEMANTIC_PROPERTY,
+    SEMANTIC_NUMBER,
+    SEMANTIC_STRING,
+    SEMANTIC_MACRO,
+    NUM_SEMANTIC_TOKEN_TYPES
+};
+
+const char* const SEMANTIC_TOKEN_NAMES[NUM_SEMANTIC_TOKEN_TYPES] = {
+    "keyword", "type", "function", "variable", "property", "number", "string", "macro"};
+
+// Keywords the lexer scans as identifiers
+const std::unordered_set<std::string_view> KEYWORD_IDENTIFIERS = {
+    "struct", "const",  "constexpr", "using",  "namespace", "static", "inline", "typedef",
+    "template", "typename", "sizeof", "true", "false",   "unsigned", "signed", "enum",
+    "class",  "volatile"};
+
+// Metal library types that TypeTable::findBuiltin does not know
+bool isLibraryType(std::string_view name) {
+    return name.substr(0, 7) == "texture" || name.substr(0, 5) == "depth" ||
+           name.substr(0, 6) == "atomic" || name == "sampler" || name == "array" ||
+           name == "vec" || name == "matrix";
+}
+
+// UTF-16 code units in UTF-8 `text`: one per code point, two above U+FFFF.
+size_t utf16Length(std::string_view text) {
+    size_t length = 0;
+    for (char c : text) {
+        auto byte = static_cast<unsigned char>(c);
+        if ((byte & 0xc0) != 0x80) {
+            length += byte >= 0xf0 ? 2 : 1;
+        }
+    }
+    return length;
+}
+
+int classify(const std::pmr::vector<Token>& tokens, size_t index,
+             const std::unordered_set<std::string_view>& structNames) {
+    const Token& token = tokens[index];
+    switch (token.type) {
+        case TokenType::INTEGER_LITERAL:
+        case TokenType::FLOAT_LITERAL:
+            return SEMANTIC_NUMBER;
+        case TokenType::STRING_LITERAL:
+            return SEMANTIC_STRING;
+        case TokenType::IDENTIFIER:
+            break;
+        default:
+            if (token.type >= TokenType::VOID && token.type <= TokenType::FLOAT4X4) {
+                return SEMANTIC_TYPE;
+            }
+            if (token.type >= TokenType::IF && token.type <= TokenType::THREADGROUP) {
+                return SEMANTIC_KEYWORD;
+            }
+            return -1;
+    }
+
+    std::string_view name = token.lexeme;
+    const Token* previous = index > 0 ? &tokens[index - 1] : nullptr;
+    // The token vector ends with END_OF_FILE, so an identifier has a successor
+    const Token& next = tokens[index + 1];
+    if (previous && previous->type == TokenType::HASH) {
+        return SEMANTIC_KEYWORD; // the directive name
+    }
+    if (index > 1 && tokens[index - 2].type == TokenType::HASH && previous->lexeme == "define") {
+        return SEMANTIC_MACRO;
+    }
+    if (KEYWORD_IDENTIFIERS.count(name)) {
+        return SEMANTIC_KEYWORD;
+    }
+    if (previous && (previous->type == TokenType::DOT || previous->type == TokenType::ARROW)) {
+        return SEMANTIC_PROPERTY;
+    }
+    if (structNames.count(name) || TypeTable::findBuiltin(name) != TypeTable::UNKNOWN ||
+        isLibraryType(name)) {
+        return SEMANTIC_TYPE;
+    }
+    if (next.type == TokenType::LEFT_PAREN) {
+        return SEMANTIC_FUNCTION;
+    }
+    return SEMANTIC_VARIABLE;
+}
+
+void writePosition(JsonWriter& json, const char* key, uint32_t line, uint32_t character) {
+    json.key(key);
+    json.beginObject();
+    json.key("line");
+    json.number(line);
+    json.key("character");
+    json.number(character);
+    json.endObject();
+}
+
+} // namespace
+
+// Document
+
+struct LanguageServer::Document {
+    explicit Document(const std::string& text) : parser(std::make_unique<IncrementalParser>(text)) {
+        update();
+    }
+
+    std::unique_ptr<IncrementalParser> parser;
+    int64_t version = 0;
+    // Bumped on every change; analyses of older generations are stale
+    uint64_t generation = 0;
+    std::vector<uint32_t> lineStarts;
+    // No multi-byte characters, so byte columns are UTF-16 columns
+    bool ascii = true;
+    // Cached responses; empty when they need recomputing
+    std::string semanticTokens;
+    std::string symbols;
+
+    const std::string& source() const { return parser->getSource(); }
+
+    // Called after every change.
+    void update() {
+        const std::string& text = source();
+        lineStarts.assign(1, 0);
+        ascii = true;
+        for (size_t i = 0; i < text.size(); i++) {
+            if (text[i] == '\n') {
+                lineStarts.push_back(static_cast<uint32_t>(i + 1));
+            } else if (static_cast<unsigned char>(text[i]) >= 0x80) {
+                ascii = false;
+            }
+        }
+        semanticTokens.clear();
+        symbols.clear();
+    }
+
+    // The byte offset of an LSP position, clamped to the document.
+    size_t toOffset(const JsonValue& position) const {
+        const std::string& text = source();
+        auto line = static_cast<size_t>(std::max(0.0, position.numberOr("line", 0)));
+        auto character = static_cast<size_t>(std::max(0.0, position.numberOr("character", 0)));
+        if (line >= lineStarts.size()) {
+            return text.size();
+        }
+        size_t offset = lineStarts[line];
+        for (size_t units = 0; offset < text.size() && text[offset] != '\n' && units < character;) {
+            auto byte = static_cast<unsigned char>(text[offset]);
+            size_t length = byte < 0x80 ? 1 : byte < 0xe0 ? 2 : byte < 0xf0 ? 3 : 4;
+            units += length == 4 ? 2 : 1;
+            offset += length;
+        }
+        return std::min(offset, text.size());
+    }
+
+    // The 0-based line and UTF-16 character of a byte offset. Taken from
+    // the offset rather than the token's line and column, which only the
+    // lexer keeps track of.
+    void toPosition(size_t offset, uint32_t& line, uint32_t& character) const {
+        std::string_view text = source();
+        offset = std::min(offset, text.size());
+        auto next = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset);
+        line = static_cast<uint32_t>(next - lineStarts.begin() - 1);
+        size_t lineStart = lineStarts[line];
+        character = ascii ? static_cast<uint32_t>(offset - lineStart)
+                          : static_cast<uint32_t>(
+                                utf16Length(text.substr(lineStart, offset - lineStart)));
+    }
+
+    void writeRange(JsonWriter& json, const char* key, const SourceRange& range) const {
+        json.key(key);
+        json.beginObject();
+        auto position = [&](const char* name, const SourceLocation& location) {
+            uint32_t line, character;
+            toPosition(static_cast<size_t>(location.offset), line, character);
+            writePosition(json, name, line, character);
+        };
+        position("start", range.start);
+        position("end", range.end);
+        json.endObject();
+    }
+};
+
+// Analyzer
+
+// Produces diagnostics on a background thread. At most one analysis is
+// pending per document; scheduling a newer generation replaces it and
+// restarts the debounce interval.
+class LanguageServer::Analyzer {
+public:
+    explicit Analyzer(LanguageServer& server) : server(server), thread([this]() { work(); }) {}
+
+    ~Analyzer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        thread.join();
+    }
+
+    void schedule(const std::string& uri, uint64_t generation, int64_t version,
+                  std::string source) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            latest[uri] = generation;
+            Job& job = pending[uri];
+            job.generation = generation;
+            job.version = version;
+            job.source = std::move(source);
+            job.due = Clock::now() + server.options.debounce;
+        }
+        changed.notify_all();
+    }
+
+    // Forgets `uri` and clears its diagnostics; an analysis in progress is
+    // not published.
+    void close(const std::string& uri) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.erase(uri);
+        latest.erase(uri);
+        server.send(publishMessage(uri, nullptr, "[]"));
+    }
+
+    void waitIdle() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]() { return pending.empty() && !running; });
+    }
+
+private:
+    struct Job {
+        uint64_t generation = 0;
+        int64_t version = 0;
+        std::string source;
+        Clock::time_point due;
+    };
+
+    LanguageServer& server;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::condition_variable idle;
+    std::unordered_map<std::string, Job> pending;
+    // The newest generation of each open document
+    std::unordered_map<std::string, uint64_t> latest;
+    bool running = false;
+    bool stopping = false;
+    std::thread thread;
+
+    static std::string publishMessage(const std::string& uri, const int64_t* version,
+                                      const std::string& diagnostics) {
+        std::string message;
+        JsonWriter json(message);
+        json.beginObject();
+        json.key("jsonrpc");
+        json.string("2.0");
+        json.key("method");
+        json.string("textDocument/publishDiagnostics");
+        json.key("params");
+        json.beginObject();
+        json.key("uri");
+        json.string(uri);
+        if (version) {
+            json.key("version");
+            json.number(*version);
+        }
+        json.key("diagnostics");
+        json.raw(diagnostics);
+        json.endObject();
+        json.endObject();
+        return message;
+    }
+
+    bool isCurrent(const std::string& uri, uint64_t generation) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = latest.find(uri);
+        return it != latest.end() && it->second == generation;
+    }
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            if (pending.empty()) {
+                idle.notify_all();
+                changed.wait(lock);
+                continue;
+            }
+            auto next = std::min_element(pending.begin(), pending.end(),
+                                         [](const auto& a, const auto& b) {
+                                             return a.second.due < b.second.due;
+                                         });
+            if (Clock::now() < next->second.due) {
+                changed.wait_until(lock, next->second.due);
+                continue;
+            }
+            std::string uri = next->first;
+            Job job = std::move(next->second);
+            pending.erase(next);
+            running = true;
+            lock.unlock();
+            std::string message = analyze(uri, job);
+            lock.lock();
+            running = false;
+            auto current = latest.find(uri);
+            if (!message.empty() && current != latest.end() && current->second == job.generation) {
+                server.send(message);
+            }
+        }
+    }
+
+    // The publishDiagnostics message, or an empty string once the document
+    // has moved on.
+    std::string analyze(const std::string& uri, const Job& job) {
+        DiagnosticEngine diagnostics;
+        Lexer lexer(job.source, &diagnostics);
+        std::pmr::vector<Token> tokens = lexer.scanTokens();
+        if (!isCurrent(uri, job.generation)) {
+            return {};
+        }
+        Parser parser(tokens, &diagnostics);
+        std::unique_ptr<TranslationUnit> unit = parser.parse();
+        if (!isCurrent(uri, job.generation)) {
+            return {};
+        }
+        if (server.options.typeCheck) {
+            TypeChecker checker(&diagnostics);
+            checker.check(unit.get());
+            if (!isCurrent(uri, job.generation)) {
+                return {};
+            }
+        }
+
+        DiagnosticPrinter printer(job.source, uri);
+        std::string_view source = job.source;
+        std::string list;
+        JsonWriter json(list);
+        json.beginArray();
+        for (const Diagnostic& diagnostic : diagnostics.getDiagnostics()) {
+            uint32_t line, column;
+            printer.resolve(diagnostic.offset, line, column);
+            size_t lineStart = diagnostic.offset - (column - 1);
+            auto character =
+                static_cast<uint32_t>(utf16Length(source.substr(lineStart, column - 1)));
+            // Underline the token at the offset, if one starts there
+            auto token = std::lower_bound(
+                tokens.begin(), tokens.end(), diagnostic.offset,
+                [](const Token& token, uint32_t offset) { return token.offset < offset; });
+            uint32_t length = 0;
+            if (token != tokens.end() && token->offset == diagnostic.offset &&
+                token->type != TokenType::END_OF_FILE &&
+                token->lexeme.find('\n') == std::string::npos) {
+                length = static_cast<uint32_t>(utf16Length(token->lexeme));
+            }
+
+            json.beginObject();
+            json.key("range");
+            json.beginObject();
+            writePosition(json, "start", line - 1, character);
+            writePosition(json, "end", line - 1, character + length);
+            json.endObject();
+            json.key("severity");
+            json.number(static_cast<int>(DiagnosticEngine::getSeverity(diagnostic.id)) + 1);
+            json.key("source");
+            json.string("msl_parser");
+            json.key("message");
+            json.string(printer.formatMessage(diagnostic));
+            json.endObject();
+        }
+        json.endArray();
+        return publishMessage(uri, &job.version, list);
+    }
+};
+
+// LanguageServer
+
+LanguageServer::LanguageServer(Output output, LanguageServerOptions options)
+    : output(std::move(output)), options(options) {
+    analyzer = std::make_unique<Analyzer>(*this);
+}
+
+LanguageServer::~LanguageServer() {
+    // Stop the analysis thread before the documents and output go away
+    analyzer.reset();
+}
+
+void LanguageServer::send(const std::string& message) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    output(message);
+}
+
+void LanguageServer::respond(const JsonValue& id, const std::string& result) {
+    std::string message;
+    JsonWriter json(message);
+    json.beginObject();
+    json.key("jsonrpc");
+    json.string("2.0");
+    json.key("id");
+    json.value(id);
+    json.key("result");
+    json.raw(result);
+    json.endObject();
+    send(message);
+}
+
+void LanguageServer::respondError(const JsonValue& id, int code, const std::string& text) {
+    std::string message;
+    JsonWriter json(message);
+    json.beginObject();
+    json.key("jsonrpc");
+    json.string("2.0");
+    json.key("id");
+    json.value(id);
+    json.key("error");
+    json.beginObject();
+    json.key("code");
+    json.number(code);
+    json.key("message");
+    json.string(text);
+    json.endObject();
+    json.endObject();
+    send(message);
+}
+
+void LanguageServer::waitForAnalysis() {
+    analyzer->waitIdle();
+}
+
+void LanguageServer::handle(std::string_view text) {
+    JsonValue message;
+    if (!JsonReader(text).read(message) || !message.isObject()) {
+        respondError(JsonValue(), PARSE_ERROR, "invalid JSON");
+        return;
+    }
+    static const JsonValue NO_PARAMS;
+    const JsonValue* id = message.get("id");
+    const JsonValue* paramsValue = message.get("params");
+    const JsonValue& params = paramsValue ? *paramsValue : NO_PARAMS;
+    std::string method = message.stringOr("method", "");
+
+    if (method == "exit") {
+        exited = true;
+        return;
+    }
+    if (shutdown) {
+        if (id) {
+            respondError(*id, INVALID_REQUEST, "the server is shutting down");
+        }
+        return;
+    }
+
+    // Notifications; any not listed ("initialized", "$/cancelRequest", ...)
+    // are ignored
+    if (method == "textDocument/didOpen") {
+        didOpen(params);
+        return;
+    }
+    if (method == "textDocument/didChange") {
+        didChange(params);
+        return;
+    }
+    if (method == "textDocument/didClose") {
+        didClose(params);
+        return;
+    }
+    if (!id) {
+        return;
+    }
+
+    if (method == "initialize") {
+        respond(*id, initialize());
+    } else if (method == "shutdown") {
+        shutdown = true;
+        respond(*id, "null");
+    } else if (method == "textDocument/semanticTokens/full") {
+        respond(*id, semanticTokens(params));
+    } else if (method == "textDocument/documentSymbol") {
+        respond(*id, documentSymbols(params));
+    } else {
+        respondError(*id, METHOD_NOT_FOUND, "unsupported method: " + method);
+    }
+}
+
+std::string LanguageServer::initialize() {
+    std::string result;
+    JsonWriter json(result);
+    json.beginObject();
+    json.key("capabilities");
+    json.beginObject();
+    json.key("textDocumentSync");
+    json.beginObject();
+    json.key("openClose");
+    json.boolean(true);
+    json.key("change");
+    json.number(TEXT_DOCUMENT_SYNC_INCREMENTAL);
+    json.endObject();
+    json.key("semanticTokensProvider");
+    json.beginObject();
+    json.key("legend");
+    json.beginObject();
+    json.key("tokenTypes");
+    json.beginArray();
+    for (const char* name : SEMANTIC_TOKEN_NAMES) {
+        json.string(name);
+    }
+    json.endArray();
+    json.key("tokenModifiers");
+    json.beginArray();
+    json.endArray();
+    json.endObject();
+    json.key("full");
+    json.boolean(true);
+    json.endObject();
+    json.key("documentSymbolProvider");
+    json.boolean(true);
+    json.endObject();
+    json.key("serverInfo");
+    json.beginObject();
+    json.key("name");
+    json.string("msl-lsp");
+    json.endObject();
+    json.endObject();
+    return result;
+}
+
+LanguageServer::Document* LanguageServer::findDocument(const JsonValue& params) {
+    const JsonValue* textDocument = params.get("textDocument");
+    if (!textDocument) {
+        return nullptr;
+    }
+    auto it = documents.find(textDocument->stringOr("uri", ""));
+    return it != documents.end() ? it->second.get() : nullptr;
+}
+
+void LanguageServer::scheduleAnalysis(const std::string& uri, Document& document) {
+    document.generation++;
+    analyzer->schedule(uri, document.generation, document.version, document.source());
+}
+
+void LanguageServer::didOpen(const JsonValue& params) {
+    const JsonValue* textDocument = params.get("textDocument");
+    if (!textDocument) {
+        return;
+    }
+    std::string uri = textDocument->stringOr("uri", "");
+    auto document = std::make_unique<Document>(textDocument->stringOr("text", ""));
+    document->version = static_cast<int64_t>(textDocument->numberOr("version", 0));
+    Document& opened = *document;
+    documents[uri] = std::move(document);
+    scheduleAnalysis(uri, opened);
+}
+
+void LanguageServer::didChange(const JsonValue& params) {
+    Document* document = findDocument(params);
+    const JsonValue* changes = params.get("contentChanges");
+    if (!document || !changes) {
+        return;
+    }
+    const JsonValue& textDocument = *params.get("textDocument");
+    document->version = static_cast<int64_t>(textDocument.numberOr("version", 0));
+    for (const JsonValue& change : changes->items) {
+        const JsonValue* range = change.get("range");
+        const JsonValue* start = range ? range->get("start") : nullptr;
+        const JsonValue* end = range ? range->get("end") : nullptr;
+        if (start && end) {
+            size_t startOffset = document->toOffset(*start);
+            size_t endOffset = std::max(startOffset, document->toOffset(*end));
+            document->parser->applyEdit(
+                {startOffset, endOffset - startOffset, change.stringOr("text", "")});
+        } else {
+            document->parser = std::make_unique<IncrementalParser>(change.stringOr("text", ""));
+        }
+        // Later changes are relative to the text after this one
+        document->update();
+    }
+    scheduleAnalysis(textDocument.stringOr("uri", ""), *document);
+}
+
+void LanguageServer::didClose(const JsonValue& params) {
+    const JsonValue* textDocument = params.get("textDocument");
+    if (!textDocument) {
+        return;
+    }
+    std::string uri = textDocument->stringOr("uri", "");
+    documents.erase(uri);
+    analyzer->close(uri);
+}
+
+std::string LanguageServer::semanticTokens(const JsonValue& params) {
+    Document* document = findDocument(params);
+    if (!document) {
+        return "null";
+    }
+    if (document->semanticTokens.empty()) {
+        std::unordered_set<std::string_view> structNames;
+        for (const auto& declaration : document->parser->getTranslationUnit()->getDeclarations()) {
+            if (getNodeKind(declaration.get()) == NodeKind::StructDeclaration) {
+                structNames.insert(declaration->getName());
+            }
+        }
+
+        // Each token is five integers: line and start relative to the
+        // previous token, length, type and modifiers
+        std::string& result = document->semanticTokens;
+        JsonWriter json(result);
+        json.beginObject();
+        json.key("data");
+        json.beginArray();
+        const std::pmr::vector<Token>& tokens = document->parser->getTokens();
+        uint32_t previousLine = 0;
+        uint32_t previousCharacter = 0;
+        for (size_t i = 0; i + 1 < tokens.size(); i++) {
+            const Token& token = tokens[i];
+            int type = classify(tokens, i, structNames);
+            if (type < 0 || token.lexeme.find('\n') != std::string::npos) {
+                continue;
+            }
+            uint32_t line, character;
+            document->toPosition(token.offset, line, character);
+            uint32_t length = document->ascii ? static_cast<uint32_t>(token.lexeme.size())
+                                              : static_cast<uint32_t>(utf16Length(token.lexeme));
+            json.number(line - previousLine);
+            json.number(line == previousLine ? character - previousCharacter : character);
+            json.number(length);
+            json.number(type);
+            json.number(0);
+            previousLine = line;
+            previousCharacter = character;
+        }
+        json.endArray();
+        json.endObject();
+    }
+    return document->semanticTokens;
+}
+
+std::string LanguageServer::documentSymbols(const JsonValue& params) {
+    Document* document = findDocument(params);
+    if (!document) {
+        return "null";
+    }
+    if (!document->symbols.empty()) {
+        return document->symbols;
+    }
+
+    JsonWriter json(document->symbols);
+    auto symbol = [&](const Declaration* declaration, int kind) {
+        json.beginObject();
+        json.key("name");
+        json.string(declaration->getName());
+        json.key("kind");
+        json.number(kind);
+        document->writeRange(json, "range", declaration->getSourceRange());
+        document->writeRange(json, "selectionRange", declaration->getSourceRange());
+    };
+    json.beginArray();
+    for (const auto& declaration : document->parser->getTranslationUnit()->getDeclarations()) {
+        if (declaration->getSourceRange().start.line == 0) {
+            continue; // no location, e.g. after an error
+        }
+        switch (getNodeKind(declaration.get())) {
+            case NodeKind::FunctionDeclaration:
+                symbol(declaration.get(), SYMBOL_FUNCTION);
+                json.endObject();
+                break;
+            case NodeKind::VariableDeclaration:
+                symbol(declaration.get(), SYMBOL_VARIABLE);
+                json.endObject();
+                break;
+            case NodeKind::StructDeclaration: {
+                symbol(declaration.get(), SYMBOL_STRUCT);
+                json.key("children");
+                json.beginArray();
+                const auto* structure = static_cast<const StructDeclaration*>(declaration.get());
+                for (const auto& field : structure->getFields()) {
+                    symbol(field.get(), SYMBOL_FIELD);
+                    json.endObject();
+                }
+                json.endArray();
+                json.endObject();
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    json.endArray();
+    return document->symbols;
+}
+
+int LanguageServer::run(std::istream& in, std::ostream& out, LanguageServerOptions options) {
+    LanguageServer server(
+        [&out](const std::string& message) {
+            out << "Content-Length: " << message.size() << "\r\n\r\n" << message;
+            out.flush();
+        },
+        options);
+    std::string body;
+    while (!server.hasExited()) {
+        // Headers end at an empty line; only Content-Length matters
+        size_t length = 0;
+        bool haveLength = false;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.empty()) {
+                break;
+            }
+            if (line.compare(0, 15, "Content-Length:") == 0) {
+                length = std::strtoul(line.c_str() + 15, nullptr, 10);
+                haveLength = true;
+            }
+        }
+        if (!in) {
+            break;
+        }
+        if (!haveLength) {
+            continue;
+        }
+        body.resize(length);
+        if (length > 0 && !in.read(&body[0], static_cast<std::streamsize>(length))) {
+            break;
+        }
+        server.handle(body);
+    }
+    return server.isShutdown() ? 0 : 1;
+}
+
+} // namespace msl_parser
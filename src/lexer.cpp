@@ -1,10 +1,13 @@
 #include "msl_parser/lexer.h"
-#include <cctype>
+#include "msl_parser/stats.h"
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
 #include <unordered_map>
 
 namespace msl_parser {
 
-static const std::unordered_map<std::string, TokenType> keywords = {
+static const std::unordered_map<std::string_view, TokenType> keywords = {
     // Types
     {"void", TokenType::VOID},
     {"bool", TokenType::BOOL},
@@ -57,299 +60,403 @@ static const std::unordered_map<std::string, TokenType> keywords = {
     {"threadgroup", TokenType::THREADGROUP},
 };
 
-Lexer::Lexer(const std::string& source) : source(source) {}
+namespace {
 
-std::vector<Token> Lexer::scanTokens() {
+// Every byte maps to one class, and scanToken dispatches on the class with a
+// single dense switch instead of testing character ranges one after another.
+enum class CharClass : uint8_t {
+    INVALID,
+    SPACE,
+    NEWLINE,
+    DIGIT,
+    IDENTIFIER,
+    OPERATOR,
+    SLASH,
+    QUOTE,
+};
+
+enum CharFlag : uint8_t {
+    DIGIT_FLAG = 1 << 0,
+    HEX_DIGIT_FLAG = 1 << 1,
+    IDENTIFIER_FLAG = 1 << 2, // letters, digits and '_'
+};
+
+struct CharTable {
+    CharClass classes[256] = {};
+    uint8_t flags[256] = {};
+};
+
+constexpr CharTable makeCharTable() {
+    CharTable table;
+    for (int c = '0'; c <= '9'; c++) {
+        table.classes[c] = CharClass::DIGIT;
+        table.flags[c] = DIGIT_FLAG | HEX_DIGIT_FLAG | IDENTIFIER_FLAG;
+    }
+    for (int c = 'a'; c <= 'z'; c++) {
+        table.classes[c] = CharClass::IDENTIFIER;
+        table.classes[c - 'a' + 'A'] = CharClass::IDENTIFIER;
+        table.flags[c] = IDENTIFIER_FLAG | (c <= 'f' ? HEX_DIGIT_FLAG : 0);
+        table.flags[c - 'a' + 'A'] = table.flags[c];
+    }
+    table.classes['_'] = CharClass::IDENTIFIER;
+    table.flags['_'] = IDENTIFIER_FLAG;
+    table.classes[' '] = CharClass::SPACE;
+    table.classes['\t'] = CharClass::SPACE;
+    table.classes['\r'] = CharClass::SPACE;
+    table.classes['\n'] = CharClass::NEWLINE;
+    table.classes['"'] = CharClass::QUOTE;
+    for (const char* p = "+-*%=!<>&|^~?:(){}[];,.#"; *p; p++) {
+        table.classes[static_cast<unsigned char>(*p)] = CharClass::OPERATOR;
+    }
+    table.classes['/'] = CharClass::SLASH;
+    return table;
+}
+
+constexpr CharTable charTable = makeCharTable();
+
+inline CharClass classOf(char c) {
+    return charTable.classes[static_cast<unsigned char>(c)];
+}
+
+inline bool isDigit(char c) {
+    return charTable.flags[static_cast<unsigned char>(c)] & DIGIT_FLAG;
+}
+
+inline bool isHexDigit(char c) {
+    return charTable.flags[static_cast<unsigned char>(c)] & HEX_DIGIT_FLAG;
+}
+
+inline bool isAlphaNumeric(char c) {
+    return charTable.flags[static_cast<unsigned char>(c)] & IDENTIFIER_FLAG;
+}
+
+// Operators are looked up in two steps: the first byte selects a row, the
+// byte after it selects a column, and the cell holds the two-character token
+// or END_OF_FILE when the pair does not form one.
+constexpr const char* OPERATOR_CHARS = "+-*/%=!<>&|^~?:(){}[];,.#";
+constexpr const char* SECOND_CHARS = "+-=<>&|:[]#";
+constexpr size_t OPERATOR_ROWS = 26;   // operator characters + "none"
+constexpr size_t OPERATOR_COLUMNS = 12; // second characters + "none"
+
+struct OperatorTable {
+    uint8_t row[256] = {};
+    uint8_t column[256] = {};
+    TokenType single[OPERATOR_ROWS] = {};
+    TokenType pair[OPERATOR_ROWS][OPERATOR_COLUMNS] = {};
+};
+
+struct OperatorSpelling {
+    const char* text;
+    TokenType type;
+};
+
+constexpr OperatorSpelling operatorSpellings[] = {
+    {"+", TokenType::PLUS},
+    {"-", TokenType::MINUS},
+    {"*", TokenType::MULTIPLY},
+    {"/", TokenType::DIVIDE},
+    {"%", TokenType::MODULO},
+    {"=", TokenType::ASSIGN},
+    {"!", TokenType::NOT},
+    {"<", TokenType::LESS_THAN},
+    {">", TokenType::GREATER_THAN},
+    {"&", TokenType::BITWISE_AND},
+    {"|", TokenType::BITWISE_OR},
+    {"^", TokenType::BITWISE_XOR},
+    {"~", TokenType::BITWISE_NOT},
+    {"?", TokenType::QUESTION},
+    {":", TokenType::COLON},
+    {"(", TokenType::LEFT_PAREN},
+    {")", TokenType::RIGHT_PAREN},
+    {"{", TokenType::LEFT_BRACE},
+    {"}", TokenType::RIGHT_BRACE},
+    {"[", TokenType::LEFT_BRACKET},
+    {"]", TokenType::RIGHT_BRACKET},
+    {";", TokenType::SEMICOLON},
+    {",", TokenType::COMMA},
+    {".", TokenType::DOT},
+    {"++", TokenType::PLUS_PLUS},
+    {"+=", TokenType::PLUS_ASSIGN},
+    {"--", TokenType::MINUS_MINUS},
+    {"-=", TokenType::MINUS_ASSIGN},
+    {"->", TokenType::ARROW},
+    {"*=", TokenType::MULTIPLY_ASSIGN},
+    {"/=", TokenType::DIVIDE_ASSIGN},
+    {"%=", TokenType::MODULO_ASSIGN},
+    {"==", TokenType::EQUAL},
+    {"!=", TokenType::NOT_EQUAL},
+    {"<=", TokenType::LESS_EQUAL},
+    {"<<", TokenType::LEFT_SHIFT},
+    {">=", TokenType::GREATER_EQUAL},
+    {">>", TokenType::RIGHT_SHIFT},
+    {"&&", TokenType::AND},
+    {"||", TokenType::OR},
+    {"::", TokenType::SCOPE_RESOLUTION},
+    {"[[", TokenType::ATTRIBUTE_LEFT},
+    {"]]", TokenType::ATTRIBUTE_RIGHT},
+    {"#", TokenType::HASH},
+    {"##", TokenType::HASH_HASH},
+};
+
+constexpr OperatorTable makeOperatorTable() {
+    OperatorTable table;
+    for (size_t r = 0; r < OPERATOR_ROWS; r++) {
+        for (size_t c = 0; c < OPERATOR_COLUMNS; c++) {
+            table.pair[r][c] = TokenType::END_OF_FILE;
+        }
+    }
+    for (uint8_t i = 0; OPERATOR_CHARS[i]; i++) {
+        table.row[static_cast<unsigned char>(OPERATOR_CHARS[i])] = i + 1;
+    }
+    for (uint8_t i = 0; SECOND_CHARS[i]; i++) {
+        table.column[static_cast<unsigned char>(SECOND_CHARS[i])] = i + 1;
+    }
+    for (const auto& spelling : operatorSpellings) {
+        uint8_t row = table.row[static_cast<unsigned char>(spelling.text[0])];
+        if (spelling.text[1] == '\0') {
+            table.single[row] = spelling.type;
+        } else {
+            table.pair[row][table.column[static_cast<unsigned char>(spelling.text[1])]] =
+                spelling.type;
+        }
+    }
+    return table;
+}
+
+constexpr OperatorTable operators = makeOperatorTable();
+
+static_assert(operators.pair[operators.row['-']][operators.column['>']] == TokenType::ARROW,
+              "operator table out of sync");
+static_assert(operators.pair[operators.row['-']][0] == TokenType::END_OF_FILE,
+              "operator table out of sync");
+
+} // namespace
+
+Lexer::Lexer(const std::string& source, DiagnosticEngine* diagnostics, MemoryBudget* budget,
+             std::pmr::memory_resource* resource)
+    : source(source, resource ? resource : std::pmr::get_default_resource()),
+      diagnostics(diagnostics),
+      budget(budget),
+      tokens(resource ? resource : std::pmr::get_default_resource()) {
+    if (budget) {
+        chargeMemory(MemoryCategory::SOURCE, heapBytes(this->source));
+    }
+}
+
+std::pmr::vector<Token> Lexer::scanTokens() {
+    MSL_PARSER_STATS(ScopedPhase phase("lex"));
+    MSL_PARSER_STATS(size_t scanStart = current);
+    while (!isAtEnd()) {
+        start = current;
+        scanToken();
+    }
+    
+    size_t capacity = tokens.capacity();
+    tokens.emplace_back(TokenType::END_OF_FILE, "", line, column, static_cast<uint32_t>(current));
+    if (budget) {
+        chargeToken(capacity);
+    }
+    MSL_PARSER_STATS({
+        Stats& stats = threadStats();
+        stats.tokensByType[static_cast<size_t>(TokenType::END_OF_FILE)]++;
+        stats.bytesProcessed += current - scanStart;
+        stats.peakTokenCount = std::max<uint64_t>(stats.peakTokenCount, tokens.size());
+        stats.peakTokenBytes =
+            std::max<uint64_t>(stats.peakTokenBytes, tokens.capacity() * sizeof(Token));
+    })
+    return std::move(tokens);
+}
+
+void Lexer::seek(size_t offset, uint32_t line, uint32_t column) {
+    tokens.clear();
+    start = offset;
+    current = offset;
+    this->line = line;
+    this->column = column;
+    // The next token starts a line when only blanks precede it on its line
+    size_t lineStart = offset;
+    while (lineStart > 0 && classOf(source[lineStart - 1]) == CharClass::SPACE) {
+        lineStart--;
+    }
+    atLineStart = lineStart == 0 || source[lineStart - 1] == '\n';
+}
+
+bool Lexer::scanNextToken(Token& token) {
     while (!isAtEnd()) {
         start = current;
         scanToken();
+        if (!tokens.empty()) {
+            token = std::move(tokens.back());
+            tokens.pop_back();
+            return true;
+        }
     }
     
-    tokens.push_back(Token(TokenType::END_OF_FILE, "", line, column));
-    return tokens;
+    token = Token(TokenType::END_OF_FILE, "", line, column, static_cast<uint32_t>(current));
+    return false;
 }
 
 void Lexer::scanToken() {
     char c = advance();
     
-    if (isDigit(c)) {
-        number();
-    } else if (isAlpha(c)) {
-        identifier();
-    } else if (c == ' ' || c == '\r' || c == '\t') {
-        // Ignore whitespace
-    } else if (c == '\n') {
-        line++;
-        column = 1;
-    } else {
-        // Handle operators
-        switch (c) {
-            // Single-character operators
-            case '+':
-                if (peek() == '+') {
-                    advance();
-                    addToken(TokenType::PLUS_PLUS);
-                } else if (peek() == '=') {
-                    advance();
-                    addToken(TokenType::PLUS_ASSIGN);
-                } else {
-                    addToken(TokenType::PLUS);
-                }
-                break;
-            case '-':
-                if (peek() == '-') {
-                    advance();
-                    addToken(TokenType::MINUS_MINUS);
-                } else if (peek() == '=') {
-                    advance();
-                    addToken(TokenType::MINUS_ASSIGN);
-                } else if (peek() == '>') {
-                    advance();
-                    addToken(TokenType::ARROW);
-                } else {
-                    addToken(TokenType::MINUS);
-                }
-                break;
-            case '*':
-                if (peek() == '=') {
-                    advance();
-                    addToken(TokenType::MULTIPLY_ASSIGN);
-                } else {
-                    addToken(TokenType::MULTIPLY);
-                }
-                break;
-            case '/':
-                if (peek() == '=') {
-                    advance();
-                    addToken(TokenType::DIVIDE_ASSIGN);
-                } else if (peek() == '/') {
-                    // Single-line comment
-                    while (peek() != '\n' && !isAtEnd()) {
-                        advance();
-                    }
-                } else if (peek() == '*') {
-                    // Multi-line comment
-                    advance(); // consume *
-                    while (!isAtEnd()) {
-                        if (peek() == '*' && peekNext() == '/') {
-                            advance(); // consume *
-                            advance(); // consume /
-                            break;
-                        }
-                        if (peek() == '\n') {
-                            line++;
-                            column = 1;
-                        }
-                        advance();
-                    }
-                } else {
-                    addToken(TokenType::DIVIDE);
-                }
-                break;
-            case '%':
-                if (peek() == '=') {
-                    advance();
-                    addToken(TokenType::MODULO_ASSIGN);
-                } else {
-                    addToken(TokenType::MODULO);
-                }
-                break;
-            case '=':
-                if (peek() == '=') {
-                    advance();
-                    addToken(TokenType::EQUAL);
-                } else {
-                    addToken(TokenType::ASSIGN);
-                }
-                break;
-            case '!':
-                if (peek() == '=') {
-                    advance();
-                    addToken(TokenType::NOT_EQUAL);
-                } else {
-                    addToken(TokenType::NOT);
-                }
-                break;
-            case '<':
-                if (peek() == '=') {
-                    advance();
-                    addToken(TokenType::LESS_EQUAL);
-                } else if (peek() == '<') {
-                    advance();
-                    addToken(TokenType::LEFT_SHIFT);
-                } else {
-                    addToken(TokenType::LESS_THAN);
-                }
-                break;
-            case '>':
-                if (peek() == '=') {
-                    advance();
-                    addToken(TokenType::GREATER_EQUAL);
-                } else if (peek() == '>') {
-                    advance();
-                    addToken(TokenType::RIGHT_SHIFT);
-                } else {
-                    addToken(TokenType::GREATER_THAN);
-                }
-                break;
-            case '&':
-                if (peek() == '&') {
-                    advance();
-                    addToken(TokenType::AND);
-                } else {
-                    addToken(TokenType::BITWISE_AND);
-                }
-                break;
-            case '|':
-                if (peek() == '|') {
-                    advance();
-                    addToken(TokenType::OR);
-                } else {
-                    addToken(TokenType::BITWISE_OR);
-                }
-                break;
-            case '^':
-                addToken(TokenType::BITWISE_XOR);
-                break;
-            case '~':
-                addToken(TokenType::BITWISE_NOT);
-                break;
-            case '?':
-                addToken(TokenType::QUESTION);
-                break;
-            case ':':
-                if (peek() == ':') {
-                    advance();
-                    addToken(TokenType::SCOPE_RESOLUTION);
-                } else {
-                    addToken(TokenType::COLON);
-                }
-                break;
-            case '(':
-                addToken(TokenType::LEFT_PAREN);
-                break;
-            case ')':
-                addToken(TokenType::RIGHT_PAREN);
-                break;
-            case '{':
-                addToken(TokenType::LEFT_BRACE);
-                break;
-            case '}':
-                addToken(TokenType::RIGHT_BRACE);
-                break;
-            case '[':
-                if (peek() == '[') {
+    switch (classOf(c)) {
+        case CharClass::DIGIT:
+            number();
+            break;
+        case CharClass::IDENTIFIER:
+            identifier();
+            break;
+        case CharClass::SPACE:
+            // Skip the whole run of whitespace in one go
+            while (classOf(peek()) == CharClass::SPACE) {
+                advance();
+            }
+            break;
+        case CharClass::NEWLINE:
+            line++;
+            column = 1;
+            atLineStart = true;
+            break;
+        case CharClass::SLASH:
+            if (peek() == '/') {
+                // Single-line comment
+                while (peek() != '\n' && !isAtEnd()) {
                     advance();
-                    addToken(TokenType::ATTRIBUTE_LEFT);
-                } else {
-                    addToken(TokenType::LEFT_BRACKET);
                 }
-                break;
-            case ']':
-                if (peek() == ']') {
+            } else if (peek() == '*') {
+                blockComment();
+            } else {
+                operatorToken(c);
+            }
+            break;
+        case CharClass::OPERATOR:
+            operatorToken(c);
+            break;
+        case CharClass::QUOTE:
+            string();
+            break;
+        case CharClass::INVALID:
+        default:
+            // A backslash before a newline joins the two lines
+            if (c == '\\' && (peek() == '\n' || (peek() == '\r' && peekNext() == '\n'))) {
+                if (peek() == '\r') {
                     advance();
-                    addToken(TokenType::ATTRIBUTE_RIGHT);
-                } else {
-                    addToken(TokenType::RIGHT_BRACKET);
                 }
+                advance();
+                line++;
+                column = 1;
                 break;
-            case ';':
-                addToken(TokenType::SEMICOLON);
-                break;
-            case ',':
-                addToken(TokenType::COMMA);
-                break;
-            case '.':
-                addToken(TokenType::DOT);
-                break;
-            case '"':
-                string();
-                break;
-            default:
-                // Skip unknown characters for now
-                break;
+            }
+            // Skip unknown characters
+            error(DiagID::UNEXPECTED_CHARACTER, DiagArgKind::CHARACTER,
+                  static_cast<unsigned char>(c));
+            break;
+    }
+}
+
+// One lookup on the following byte decides between the one- and the
+// two-character form, so maximal munch costs no extra branches.
+void Lexer::operatorToken(char c) {
+    const uint8_t row = operators.row[static_cast<unsigned char>(c)];
+    const TokenType pair = operators.pair[row][operators.column[static_cast<unsigned char>(peek())]];
+    if (pair != TokenType::END_OF_FILE) {
+        advance();
+        addToken(pair);
+    } else {
+        addToken(operators.single[row]);
+    }
+}
+
+void Lexer::blockComment() {
+    advance(); // consume *
+    bool closed = false;
+    while (!isAtEnd()) {
+        if (peek() == '*' && peekNext() == '/') {
+            advance(); // consume *
+            advance(); // consume /
+            closed = true;
+            break;
         }
+        if (advance() == '\n') {
+            line++;
+            column = 1;
+        }
+    }
+    if (!closed) {
+        error(DiagID::UNTERMINATED_COMMENT);
     }
 }
 
+// Classifies the literal while scanning it; the value is only converted
+// when asked for (see numeric_literal.h).
 void Lexer::number() {
-    // Check for hex or binary prefix
-    if (peek() == 'x' || peek() == 'X') {
-        // Hexadecimal
+    uint8_t flags = 0;
+    
+    // Hexadecimal and binary prefixes
+    if (source[start] == '0' && (peek() == 'x' || peek() == 'X')) {
         advance(); // consume 'x' or 'X'
         while (isHexDigit(peek())) {
             advance();
         }
-        addToken(TokenType::INTEGER_LITERAL);
-        return;
-    } else if (peek() == 'b' || peek() == 'B') {
-        // Binary
+        flags |= NUMERIC_HEX;
+    } else if (source[start] == '0' && (peek() == 'b' || peek() == 'B')) {
         advance(); // consume 'b' or 'B'
         while (peek() == '0' || peek() == '1') {
             advance();
         }
-        addToken(TokenType::INTEGER_LITERAL);
-        return;
-    }
-    
-    // Decimal integer part
-    while (isDigit(peek())) {
-        advance();
-    }
-    
-    // Look for a fractional part
-    if (peek() == '.') {
-        // Check if there's a digit after the dot or if it's just a trailing dot
-        if (isDigit(peekNext())) {
-            // Consume the "."
+        flags |= NUMERIC_BINARY;
+    } else {
+        // Decimal integer part
+        while (isDigit(peek())) {
+            advance();
+        }
+        
+        // Fractional part, or just a trailing dot like "10."
+        if (peek() == '.') {
             advance();
-            
             while (isDigit(peek())) {
                 advance();
             }
-        } else {
-            // Just a trailing dot like "10."
-            advance();
+            flags |= NUMERIC_FRACTION;
         }
-    }
-    
-    // Look for exponent
-    if (peek() == 'e' || peek() == 'E') {
-        advance();
-        if (peek() == '+' || peek() == '-') {
-            advance();
+        
+        // Exponent, only when digits follow
+        if ((peek() == 'e' || peek() == 'E') &&
+            (isDigit(peekNext()) ||
+             ((peekNext() == '+' || peekNext() == '-') && current + 2 < source.length() &&
+              isDigit(source[current + 2])))) {
+            advance(); // consume 'e' or 'E'
+            if (peek() == '+' || peek() == '-') {
+                advance();
+            }
+            while (isDigit(peek())) {
+                advance();
+            }
+            flags |= NUMERIC_EXPONENT;
         }
-        while (isDigit(peek())) {
+        
+        // Floating-point suffixes
+        if (peek() == 'f' || peek() == 'F') {
+            advance();
+            flags |= NUMERIC_SUFFIX_F;
+        } else if (peek() == 'h' || peek() == 'H') {
             advance();
+            flags |= NUMERIC_SUFFIX_H;
         }
     }
     
-    // Check for float suffix
-    if (peek() == 'f' || peek() == 'F' || peek() == 'h' || peek() == 'H') {
-        advance();
-        addToken(TokenType::FLOAT_LITERAL);
+    const uint8_t floatFlags = NUMERIC_FRACTION | NUMERIC_EXPONENT | NUMERIC_SUFFIX_F |
+                               NUMERIC_SUFFIX_H;
+    if (flags & floatFlags) {
+        addToken(TokenType::FLOAT_LITERAL, flags);
         return;
     }
     
-    // Determine if it's float or integer
-    std::string text = source.substr(start, current - start);
-    if (text.find('.') != std::string::npos || 
-        text.find('e') != std::string::npos || 
-        text.find('E') != std::string::npos) {
-        addToken(TokenType::FLOAT_LITERAL);
-    } else {
-        addToken(TokenType::INTEGER_LITERAL);
+    if (peek() == 'u' || peek() == 'U') {
+        advance();
+        flags |= NUMERIC_SUFFIX_U;
     }
-}
-
-bool Lexer::isDigit(char c) {
-    return c >= '0' && c <= '9';
-}
-
-bool Lexer::isHexDigit(char c) {
-    return (c >= '0' && c <= '9') || 
-           (c >= 'a' && c <= 'f') || 
-           (c >= 'A' && c <= 'F');
+    addToken(TokenType::INTEGER_LITERAL, flags);
 }
 
 bool Lexer::isAtEnd() {
@@ -371,9 +478,77 @@ char Lexer::peekNext() {
     return source[current + 1];
 }
 
-void Lexer::addToken(TokenType type) {
-    std::string text = source.substr(start, current - start);
-    tokens.push_back(Token(type, text, line, column - text.length()));
+void Lexer::addToken(TokenType type, uint8_t numericFlags) {
+    // The lexeme is constructed in place, from the tokens' memory resource
+    std::string_view text = std::string_view(source).substr(start, current - start);
+    size_t capacity = tokens.capacity();
+    tokens.emplace_back(type, text, line, static_cast<uint32_t>(column - text.length()),
+                        static_cast<uint32_t>(start));
+    tokens.back().numericFlags = numericFlags;
+    if (atLineStart) {
+        tokens.back().flags = TOKEN_AT_LINE_START;
+        atLineStart = false;
+    }
+    if (budget) {
+        chargeToken(capacity);
+    }
+    MSL_PARSER_STATS(threadStats().tokensByType[static_cast<size_t>(type)]++);
+}
+
+// Charges the token just added: its lexeme, and the vector's storage if
+// adding it made the vector grow.
+void Lexer::chargeToken(size_t previousCapacity) {
+    chargeMemory(MemoryCategory::TOKENS, (tokens.capacity() - previousCapacity) * sizeof(Token));
+    chargeMemory(MemoryCategory::LEXEMES, heapBytes(tokens.back().lexeme));
+}
+
+void Lexer::chargeDiagnostics(size_t previousCapacity) {
+    if (budget) {
+        chargeMemory(MemoryCategory::TABLES,
+                     (diagnostics->getDiagnostics().capacity() - previousCapacity) *
+                         sizeof(Diagnostic));
+    }
+}
+
+// Once the budget is exceeded, scanning stops as if the source ended here.
+void Lexer::chargeMemory(MemoryCategory category, size_t bytes) {
+    if (budget->charge(category, bytes) || isAtEnd()) {
+        return;
+    }
+    current = source.length();
+    if (diagnostics) {
+        size_t capacity = diagnostics->getDiagnostics().capacity();
+        diagnostics->report(DiagID::MEMORY_LIMIT_EXCEEDED, static_cast<uint32_t>(start),
+                            DiagArgKind::INTEGER,
+                            static_cast<uint32_t>((budget->getLimit() + 1023) / 1024));
+        budget->charge(MemoryCategory::TABLES,
+                       (diagnostics->getDiagnostics().capacity() - capacity) * sizeof(Diagnostic));
+    }
+}
+
+void Lexer::error(DiagID id) {
+    if (diagnostics) {
+        size_t capacity = diagnostics->getDiagnostics().capacity();
+        diagnostics->report(id, static_cast<uint32_t>(start));
+        chargeDiagnostics(capacity);
+        stopIfErrorLimitReached();
+    }
+}
+
+void Lexer::error(DiagID id, DiagArgKind kind, uint32_t arg) {
+    if (diagnostics) {
+        size_t capacity = diagnostics->getDiagnostics().capacity();
+        diagnostics->report(id, static_cast<uint32_t>(start), kind, arg);
+        chargeDiagnostics(capacity);
+        stopIfErrorLimitReached();
+    }
+}
+
+// Checked only when an error is reported, so the scanning loop pays nothing.
+void Lexer::stopIfErrorLimitReached() {
+    if (diagnostics->errorLimitReached()) {
+        current = source.length();
+    }
 }
 
 void Lexer::identifier() {
@@ -381,46 +556,29 @@ void Lexer::identifier() {
         advance();
     }
     
-    std::string text = source.substr(start, current - start);
-    
     // Check if it's a keyword
-    auto it = keywords.find(text);
+    auto it = keywords.find(std::string_view(source).substr(start, current - start));
     TokenType type = (it != keywords.end()) ? it->second : TokenType::IDENTIFIER;
     
     addToken(type);
 }
 
-bool Lexer::isAlpha(char c) {
-    return (c >= 'a' && c <= 'z') ||
-           (c >= 'A' && c <= 'Z') ||
-           c == '_';
-}
-
-bool Lexer::isAlphaNumeric(char c) {
-    return isAlpha(c) || isDigit(c);
-}
-
 void Lexer::string() {
     // Keep scanning until we find the closing quote
     while (peek() != '"' && !isAtEnd()) {
-        if (peek() == '\n') {
-            line++;
-            column = 1;
-        }
-        
-        // Handle escape sequences
+        // Handle escape sequences; an escaped newline continues the string
+        // on the next line
         if (peek() == '\\') {
             advance(); // consume the backslash
-            if (!isAtEnd()) {
-                advance(); // consume the escaped character
-            }
-        } else {
-            advance();
+        }
+        if (!isAtEnd() && advance() == '\n') {
+            line++;
+            column = 1;
         }
     }
     
     if (isAtEnd()) {
-        // TODO: Error - Unterminated string
+        error(DiagID::UNTERMINATED_STRING);
         return;
     }
     
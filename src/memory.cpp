@@ -0,0 +1,156 @@
+#include "msl_parser/memory.h"
+#include "msl_parser/ast/ast_node.h"
+
+namespace msl_parser {
+
+using namespace ast;
+
+namespace {
+
+// A string whose characters live inside the object uses its small-string
+// buffer; otherwise it owns capacity() + 1 bytes, the terminator included.
+template <typename String>
+size_t stringHeapBytes(const String& text) {
+    auto data = reinterpret_cast<std::uintptr_t>(text.data());
+    auto object = reinterpret_cast<std::uintptr_t>(&text);
+    if (data >= object && data < object + sizeof(String)) {
+        return 0;
+    }
+    return text.capacity() + 1;
+}
+
+size_t heapBytes(const TypeSpec& type) {
+    size_t bytes = msl_parser::heapBytes(type.name) +
+                   type.templateArguments.capacity() * sizeof(std::pmr::string);
+    for (const auto& argument : type.templateArguments) {
+        bytes += msl_parser::heapBytes(argument);
+    }
+    return bytes;
+}
+
+size_t heapBytes(const std::pmr::vector<Attribute>& attributes) {
+    size_t bytes = attributes.capacity() * sizeof(Attribute);
+    for (const auto& attribute : attributes) {
+        bytes += msl_parser::heapBytes(attribute.name) + msl_parser::heapBytes(attribute.argument);
+    }
+    return bytes;
+}
+
+template <typename T>
+size_t heapBytes(const NodeList<T>& children) {
+    return children.capacity() * sizeof(std::unique_ptr<T>);
+}
+
+// Storage owned by a node besides the node itself; nodes that hold only
+// scalars and child pointers own none.
+template <typename T>
+size_t ownedBytes(const T&) {
+    return 0;
+}
+
+size_t ownedBytes(const Identifier& node) {
+    return msl_parser::heapBytes(node.getName());
+}
+
+size_t ownedBytes(const MemberExpression& node) {
+    return msl_parser::heapBytes(node.getMember());
+}
+
+size_t ownedBytes(const CallExpression& node) {
+    return heapBytes(node.getArguments());
+}
+
+size_t ownedBytes(const ConstructExpression& node) {
+    return heapBytes(node.getType()) + heapBytes(node.getArguments());
+}
+
+size_t ownedBytes(const CastExpression& node) {
+    return heapBytes(node.getType());
+}
+
+size_t ownedBytes(const VariableDeclaration& node) {
+    return msl_parser::heapBytes(node.getName()) + heapBytes(node.getType()) +
+           heapBytes(node.getAttributes());
+}
+
+size_t ownedBytes(const CompoundStatement& node) {
+    return heapBytes(node.getStatements());
+}
+
+size_t ownedBytes(const DeclarationStatement& node) {
+    return heapBytes(node.getDeclarations());
+}
+
+size_t ownedBytes(const FunctionDeclaration& node) {
+    return msl_parser::heapBytes(node.getName()) + heapBytes(node.getReturnType()) +
+           heapBytes(node.getParameters()) + heapBytes(node.getAttributes());
+}
+
+size_t ownedBytes(const StructDeclaration& node) {
+    return msl_parser::heapBytes(node.getName()) + heapBytes(node.getFields());
+}
+
+size_t ownedBytes(const UsingDeclaration& node) {
+    return msl_parser::heapBytes(node.getName());
+}
+
+size_t ownedBytes(const TranslationUnit& node) {
+    return heapBytes(node.getDeclarations());
+}
+
+class NodeSizer : public ASTVisitor {
+public:
+    size_t bytes = 0;
+
+#define AST_NODE(CLASS)                                                    \
+    void visit##CLASS(CLASS* node) override {                              \
+        bytes = ASTNode::allocationHeaderSize(node) + sizeof(CLASS) + ownedBytes(*node); \
+    }
+#include "msl_parser/ast/ast_nodes.def"
+#undef AST_NODE
+};
+
+} // namespace
+
+const char* memoryCategoryToString(MemoryCategory category) {
+    switch (category) {
+        case MemoryCategory::SOURCE: return "source";
+        case MemoryCategory::TOKENS: return "tokens";
+        case MemoryCategory::LEXEMES: return "lexemes";
+        case MemoryCategory::AST: return "ast";
+        case MemoryCategory::TABLES: return "tables";
+        default: return "unknown";
+    }
+}
+
+// MemoryBudget
+
+bool MemoryBudget::charge(MemoryCategory category, size_t bytes) {
+    usage[static_cast<size_t>(category)] += bytes;
+    total += bytes;
+    if (total > peak) {
+        peak = total;
+    }
+    return !limitExceeded();
+}
+
+void MemoryBudget::release(MemoryCategory category, size_t bytes) {
+    usage[static_cast<size_t>(category)] -= bytes;
+    total -= bytes;
+}
+
+size_t heapBytes(const std::string& text) {
+    return stringHeapBytes(text);
+}
+
+size_t heapBytes(const std::pmr::string& text) {
+    return stringHeapBytes(text);
+}
+
+size_t nodeBytes(const ASTNode& node) {
+    NodeSizer sizer;
+    const_cast<ASTNode&>(node).accept(&sizer);
+    return sizer.bytes;
+}
+
+} // namespace msl_parser
@@ -0,0 +1,112 @@
+#include "msl_parser/node_index.h"
+#include <algorithm>
+#include "msl_parser/ast/recursive_visitor.h"
+
+namespace msl_parser {
+
+using namespace ast;
+
+namespace {
+
+struct Range {
+    ASTNode* node;
+    uint32_t begin;
+    uint32_t end;
+};
+
+class RangeCollector : public RecursiveASTVisitor {
+public:
+    explicit RangeCollector(std::vector<Range>& ranges) : ranges(ranges) {}
+
+protected:
+    void visitNode(ASTNode* node) override {
+        const SourceRange& range = node->getSourceRange();
+        if (range.start.offset >= 0 && range.end.offset > range.start.offset) {
+            ranges.push_back({node, static_cast<uint32_t>(range.start.offset),
+                              static_cast<uint32_t>(range.end.offset)});
+        }
+    }
+    const char* passName() const override { return "node_index"; }
+
+private:
+    std::vector<Range>& ranges;
+};
+
+} // namespace
+
+void NodeIndex::build(ASTNode* root) {
+    clear();
+    std::vector<Range> ranges;
+    RangeCollector(ranges).traverse(root);
+    // The traversal is in source order, so this rarely moves anything. Among
+    // ranges with the same start the enclosing one must come first: the
+    // longer, or for equal ranges the one visited first (the parent).
+    std::stable_sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) {
+        return a.begin != b.begin ? a.begin < b.begin : a.end > b.end;
+    });
+
+    entries.reserve(ranges.size());
+    segmentBegins.reserve(ranges.size() * 2);
+    segmentEntries.reserve(ranges.size() * 2);
+    // A segment starting at `position`, replacing an empty one there
+    auto segment = [&](uint32_t position, uint32_t index) {
+        if (!segmentBegins.empty() && segmentBegins.back() == position) {
+            segmentEntries.back() = index;
+        } else {
+            segmentBegins.push_back(position);
+            segmentEntries.push_back(index);
+        }
+    };
+    // The ranges containing the current position, innermost on top. Ranges
+    // ending up to `position` are closed, each starting a segment covered
+    // by the range that remains on top.
+    std::vector<uint32_t> open;
+    auto close = [&](uint32_t position) {
+        while (!open.empty() && entries[open.back()].end <= position) {
+            uint32_t end = entries[open.back()].end;
+            while (!open.empty() && entries[open.back()].end <= end) {
+                open.pop_back();
+            }
+            segment(end, open.empty() ? NONE : open.back());
+        }
+    };
+    for (const Range& range : ranges) {
+        close(range.begin);
+        while (!open.empty() && entries[open.back()].end < range.end) {
+            open.pop_back();  // overlaps without enclosing it
+        }
+        entries.push_back({range.node, range.end, open.empty() ? NONE : open.back()});
+        open.push_back(static_cast<uint32_t>(entries.size() - 1));
+        segment(range.begin, open.back());
+    }
+    close(UINT32_MAX);
+}
+
+void NodeIndex::clear() {
+    entries.clear();
+    segmentBegins.clear();
+    segmentEntries.clear();
+}
+
+uint32_t NodeIndex::find(size_t offset) const {
+    auto after = std::upper_bound(segmentBegins.begin(), segmentBegins.end(), offset);
+    if (after == segmentBegins.begin()) {
+        return NONE;
+    }
+    return segmentEntries[static_cast<size_t>(after - segmentBegins.begin() - 1)];
+}
+
+ASTNode* NodeIndex::findInnermost(size_t offset) const {
+    uint32_t index = find(offset);
+    return index != NONE ? entries[index].node : nullptr;
+}
+
+std::vector<ASTNode*> NodeIndex::findEnclosing(size_t offset) const {
+    std::vector<ASTNode*> nodes;
+    for (uint32_t index = find(offset); index != NONE; index = entries[index].parent) {
+        nodes.push_back(entries[index].node);
+    }
+    return nodes;
+}
+
+} // namespace msl_parser
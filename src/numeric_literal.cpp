@@ -0,0 +1,414 @@
+#include "msl_parser/numeric_literal.h"
+#include <cfloat>
+#include <cmath>
+#include <limits>
+
+namespace msl_parser {
+
+namespace {
+
+int digitValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return 99;
+}
+
+bool isSuffix(char c) {
+    return c == 'u' || c == 'U' || c == 'f' || c == 'F' || c == 'h' || c == 'H';
+}
+
+// Binary layout of the destination type.
+template <typename T>
+struct FloatFormat;
+
+template <>
+struct FloatFormat<float> {
+    static constexpr int MANTISSA_BITS = 24;
+    static constexpr int MIN_EXPONENT = -126;
+    static constexpr int MAX_EXPONENT = 127;
+    // Largest power of ten and integer that are exact in a float.
+    static constexpr int MAX_EXACT_POWER = 10;
+    static constexpr uint64_t MAX_EXACT_INTEGER = uint64_t(1) << 24;
+};
+
+template <>
+struct FloatFormat<double> {
+    static constexpr int MANTISSA_BITS = 53;
+    static constexpr int MIN_EXPONENT = -1022;
+    static constexpr int MAX_EXPONENT = 1023;
+    static constexpr int MAX_EXACT_POWER = 22;
+    static constexpr uint64_t MAX_EXACT_INTEGER = uint64_t(1) << 53;
+};
+
+const double exactPowersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                   1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                   1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// Significant digits beyond this cannot change the rounding of a double;
+// the rest are folded into one sticky digit.
+constexpr size_t MAX_DIGITS = 768;
+
+// Decimal literal split into significant digits and a power of ten:
+// value = digits * 10^exponent.
+struct DecimalNumber {
+    uint8_t digits[MAX_DIGITS + 1];
+    size_t count = 0;
+    int exponent = 0;
+    uint64_t leading = 0; // first 19 digits, for the fast path
+};
+
+bool parseDecimal(const char* p, const char* end, DecimalNumber& number) {
+    bool sawDigit = false;
+    bool truncatedNonZero = false;
+    long long exponent = 0;
+
+    auto addDigit = [&](int digit) {
+        sawDigit = true;
+        if (number.count == 0 && digit == 0) {
+            return false; // leading zero
+        }
+        if (number.count < MAX_DIGITS) {
+            if (number.count < 19) {
+                number.leading = number.leading * 10 + static_cast<uint64_t>(digit);
+            }
+            number.digits[number.count++] = static_cast<uint8_t>(digit);
+            return false;
+        }
+        truncatedNonZero |= digit != 0;
+        return true; // dropped, still scales the value
+    };
+
+    for (; p != end && *p >= '0' && *p <= '9'; p++) {
+        if (addDigit(*p - '0')) {
+            exponent++;
+        }
+    }
+    if (p != end && *p == '.') {
+        for (p++; p != end && *p >= '0' && *p <= '9'; p++) {
+            bool dropped = addDigit(*p - '0');
+            if (!dropped) {
+                exponent--;
+            }
+        }
+    }
+    if (!sawDigit) {
+        return false;
+    }
+    if (p != end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negative = false;
+        if (p != end && (*p == '+' || *p == '-')) {
+            negative = *p == '-';
+            p++;
+        }
+        if (p == end || *p < '0' || *p > '9') {
+            return false;
+        }
+        long long value = 0;
+        for (; p != end && *p >= '0' && *p <= '9'; p++) {
+            if (value < 100000) {
+                value = value * 10 + (*p - '0');
+            }
+        }
+        exponent += negative ? -value : value;
+    }
+    while (p != end && isSuffix(*p)) {
+        p++;
+    }
+    if (p != end) {
+        return false;
+    }
+
+    if (truncatedNonZero) {
+        // Any value strictly between the truncated digits and the next
+        // representable digit string rounds the same way.
+        number.digits[number.count++] = 1;
+        exponent--;
+    }
+    // Leading zeros in the fraction were not counted as digits but did
+    // lower the exponent, which keeps value = digits * 10^exponent.
+    if (exponent > 100000) exponent = 100000;
+    if (exponent < -100000) exponent = -100000;
+    number.exponent = static_cast<int>(exponent);
+    return true;
+}
+
+// Fixed-capacity unsigned integer for the exact slow path. 4096 bits cover
+// 769 significant digits scaled by any power of ten that does not already
+// overflow or underflow a double.
+class BigInt {
+public:
+    static constexpr size_t WORDS = 128;
+
+    explicit BigInt(uint32_t value = 0) {
+        words[0] = value;
+        size = value ? 1 : 0;
+    }
+
+    void multiplyAdd(uint32_t factor, uint32_t addend) {
+        uint64_t carry = addend;
+        for (size_t i = 0; i < size; i++) {
+            uint64_t product = static_cast<uint64_t>(words[i]) * factor + carry;
+            words[i] = static_cast<uint32_t>(product);
+            carry = product >> 32;
+        }
+        if (carry && size < WORDS) {
+            words[size++] = static_cast<uint32_t>(carry);
+        }
+    }
+
+    void multiplyPow10(int exponent) {
+        for (; exponent >= 9; exponent -= 9) {
+            multiplyAdd(1000000000u, 0);
+        }
+        static const uint32_t small[] = {1,      10,      100,      1000,     10000,
+                                         100000, 1000000, 10000000, 100000000};
+        multiplyAdd(small[exponent], 0);
+    }
+
+    void shiftLeft(size_t bits) {
+        if (size == 0) {
+            return;
+        }
+        size_t wordShift = bits / 32;
+        unsigned bitShift = static_cast<unsigned>(bits % 32);
+        size_t newSize = size + wordShift + 1;
+        if (newSize > WORDS) {
+            newSize = WORDS;
+        }
+        for (size_t i = newSize; i-- > 0;) {
+            uint64_t high = i >= wordShift && i - wordShift < size ? words[i - wordShift] : 0;
+            uint64_t low = i >= wordShift + 1 && i - wordShift - 1 < size
+                               ? words[i - wordShift - 1]
+                               : 0;
+            words[i] = static_cast<uint32_t>(
+                bitShift ? (high << bitShift) | (low >> (32 - bitShift)) : high);
+        }
+        size = newSize;
+        trim();
+    }
+
+    size_t bitLength() const {
+        if (size == 0) {
+            return 0;
+        }
+        uint32_t top = words[size - 1];
+        size_t bits = 0;
+        while (top) {
+            bits++;
+            top >>= 1;
+        }
+        return (size - 1) * 32 + bits;
+    }
+
+    int compare(const BigInt& other) const {
+        if (size != other.size) {
+            return size < other.size ? -1 : 1;
+        }
+        for (size_t i = size; i-- > 0;) {
+            if (words[i] != other.words[i]) {
+                return words[i] < other.words[i] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+
+    // Requires *this >= other.
+    void subtract(const BigInt& other) {
+        int64_t borrow = 0;
+        for (size_t i = 0; i < size; i++) {
+            int64_t difference = static_cast<int64_t>(words[i]) - borrow -
+                                 (i < other.size ? static_cast<int64_t>(other.words[i]) : 0);
+            borrow = difference < 0;
+            words[i] = static_cast<uint32_t>(difference + (borrow << 32));
+        }
+        trim();
+    }
+
+    bool isZero() const { return size == 0; }
+
+private:
+    uint32_t words[WORDS];
+    size_t size;
+
+    void trim() {
+        while (size > 0 && words[size - 1] == 0) {
+            size--;
+        }
+    }
+};
+
+// Rounds q * 2^-shift (plus a sticky remainder) to the destination format.
+template <typename T>
+T roundToFormat(uint64_t q, long long shift, bool sticky, LiteralStatus& status) {
+    using Format = FloatFormat<T>;
+    int bits = 64;
+    while (!(q >> (bits - 1))) {
+        bits--;
+    }
+    long long exponent = bits - 1 - shift; // value is in [2^exponent, 2^(exponent+1))
+    if (exponent > Format::MAX_EXPONENT) {
+        status = LiteralStatus::OUT_OF_RANGE;
+        return std::numeric_limits<T>::infinity();
+    }
+
+    long long keep = Format::MANTISSA_BITS;
+    if (exponent < Format::MIN_EXPONENT) {
+        keep -= Format::MIN_EXPONENT - exponent; // subnormal
+    }
+    if (keep < 0) {
+        return T(0);
+    }
+
+    int drop = static_cast<int>(bits - keep);
+    uint64_t mantissa;
+    bool roundUp;
+    if (drop >= 64) {
+        uint64_t half = uint64_t(1) << 63;
+        mantissa = 0;
+        roundUp = q > half || (q == half && sticky);
+    } else {
+        uint64_t half = uint64_t(1) << (drop - 1);
+        uint64_t remainder = q & ((half << 1) - 1);
+        mantissa = q >> drop;
+        roundUp = remainder > half || (remainder == half && (sticky || (mantissa & 1)));
+    }
+    if (roundUp) {
+        mantissa++;
+    }
+
+    T result = std::ldexp(static_cast<T>(mantissa), static_cast<int>(exponent - keep + 1));
+    if (std::isinf(result)) {
+        status = LiteralStatus::OUT_OF_RANGE;
+    }
+    return result;
+}
+
+// Exact conversion by long division: value = N / M with the quotient scaled
+// to 64 bits, the remainder giving the sticky bit.
+template <typename T>
+T convertSlow(const DecimalNumber& number, LiteralStatus& status) {
+    BigInt numerator;
+    for (size_t i = 0; i < number.count; i++) {
+        numerator.multiplyAdd(10, number.digits[i]);
+    }
+    BigInt denominator(1);
+    if (number.exponent > 0) {
+        numerator.multiplyPow10(number.exponent);
+    } else {
+        denominator.multiplyPow10(-number.exponent);
+    }
+
+    long long shift = 63 - static_cast<long long>(numerator.bitLength()) +
+                      static_cast<long long>(denominator.bitLength());
+    if (shift > 0) {
+        numerator.shiftLeft(static_cast<size_t>(shift));
+    } else {
+        denominator.shiftLeft(static_cast<size_t>(-shift));
+    }
+
+    uint64_t q = 0;
+    for (int bit = 63; bit >= 0; bit--) {
+        BigInt scaled = denominator;
+        scaled.shiftLeft(static_cast<size_t>(bit));
+        if (numerator.compare(scaled) >= 0) {
+            numerator.subtract(scaled);
+            q |= uint64_t(1) << bit;
+        }
+    }
+    return roundToFormat<T>(q, shift, !numerator.isZero(), status);
+}
+
+template <typename T>
+LiteralStatus decodeFloat(const char* begin, const char* end, T& value) {
+    using Format = FloatFormat<T>;
+    DecimalNumber number;
+    if (!parseDecimal(begin, end, number)) {
+        return LiteralStatus::INVALID;
+    }
+    if (number.count == 0) {
+        value = T(0);
+        return LiteralStatus::OK;
+    }
+
+    // Far outside the range of a double: no need for exact arithmetic.
+    long long magnitude = static_cast<long long>(number.count) + number.exponent;
+    if (magnitude > 310) {
+        value = std::numeric_limits<T>::infinity();
+        return LiteralStatus::OUT_OF_RANGE;
+    }
+    if (magnitude < -345) {
+        value = T(0);
+        return LiteralStatus::OK;
+    }
+
+#if FLT_EVAL_METHOD == 0
+    // Clinger's fast path: both operands are exact, so the single rounding
+    // of the multiplication or division is the correct one.
+    if (number.count <= 19 && number.leading <= Format::MAX_EXACT_INTEGER &&
+        number.exponent >= -Format::MAX_EXACT_POWER && number.exponent <= Format::MAX_EXACT_POWER) {
+        T significand = static_cast<T>(number.leading);
+        T power = static_cast<T>(exactPowersOfTen[number.exponent < 0 ? -number.exponent
+                                                                      : number.exponent]);
+        value = number.exponent < 0 ? significand / power : significand * power;
+        return LiteralStatus::OK;
+    }
+#endif
+
+    LiteralStatus status = LiteralStatus::OK;
+    value = convertSlow<T>(number, status);
+    return status;
+}
+
+} // namespace
+
+LiteralStatus decodeIntegerLiteral(const char* begin, const char* end, uint64_t& value) {
+    const char* p = begin;
+    uint64_t base = 10;
+    if (end - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+        base = 16;
+        p += 2;
+    } else if (end - p >= 2 && p[0] == '0' && (p[1] == 'b' || p[1] == 'B')) {
+        base = 2;
+        p += 2;
+    } else if (end - p >= 2 && p[0] == '0' && p[1] >= '0' && p[1] <= '9') {
+        base = 8;
+        p += 1;
+    }
+
+    const char* digitsBegin = p;
+    uint64_t result = 0;
+    bool overflow = false;
+    for (; p != end && *p != 'u' && *p != 'U'; p++) {
+        uint64_t digit = static_cast<uint64_t>(digitValue(*p));
+        if (digit >= base) {
+            return LiteralStatus::INVALID;
+        }
+        if (result > (std::numeric_limits<uint64_t>::max() - digit) / base) {
+            overflow = true;
+        }
+        result = result * base + digit;
+    }
+    if (p == digitsBegin) {
+        return LiteralStatus::INVALID;
+    }
+    for (; p != end; p++) {
+        if (*p != 'u' && *p != 'U') {
+            return LiteralStatus::INVALID;
+        }
+    }
+
+    value = result;
+    return overflow ? LiteralStatus::OUT_OF_RANGE : LiteralStatus::OK;
+}
+
+LiteralStatus decodeFloatLiteral(const char* begin, const char* end, float& value) {
+    return decodeFloat(begin, end, value);
+}
+
+LiteralStatus decodeFloatLiteral(const char* begin, const char* end, double& value) {
+    return decodeFloat(begin, end, value);
+}
+
+} // namespace msl_parser
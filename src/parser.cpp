@@ -1 +1,1272 @@
-// Placeholder for Parser implementation
\ No newline at end of file
+#include "msl_parser/parser.h"
+#include <cctype>
+#include "msl_parser/numeric_literal.h"
+
+namespace msl_parser {
+
+using namespace ast;
+
+namespace {
+
+bool isTypeKeyword(TokenType type) {
+    return type >= TokenType::VOID && type <= TokenType::FLOAT4X4;
+}
+
+bool isAddressSpace(TokenType type) {
+    return type == TokenType::DEVICE || type == TokenType::CONSTANT ||
+           type == TokenType::THREAD || type == TokenType::THREADGROUP;
+}
+
+AddressSpace toAddressSpace(TokenType type) {
+    switch (type) {
+        case TokenType::DEVICE: return AddressSpace::DEVICE;
+        case TokenType::CONSTANT: return AddressSpace::CONSTANT;
+        case TokenType::THREAD: return AddressSpace::THREAD;
+        case TokenType::THREADGROUP: return AddressSpace::THREADGROUP;
+        default: return AddressSpace::NONE;
+    }
+}
+
+// Binary operator precedence; higher binds tighter. Returns 0 for tokens that
+// are not binary operators.
+int binaryPrecedence(TokenType type, BinaryExpression::Operator& op) {
+    switch (type) {
+        case TokenType::OR: op = BinaryExpression::Operator::LOGICAL_OR; return 1;
+        case TokenType::AND: op = BinaryExpression::Operator::LOGICAL_AND; return 2;
+        case TokenType::BITWISE_OR: op = BinaryExpression::Operator::BITWISE_OR; return 3;
+        case TokenType::BITWISE_XOR: op = BinaryExpression::Operator::BITWISE_XOR; return 4;
+        case TokenType::BITWISE_AND: op = BinaryExpression::Operator::BITWISE_AND; return 5;
+        case TokenType::EQUAL: op = BinaryExpression::Operator::EQUAL; return 6;
+        case TokenType::NOT_EQUAL: op = BinaryExpression::Operator::NOT_EQUAL; return 6;
+        case TokenType::LESS_THAN: op = BinaryExpression::Operator::LESS_THAN; return 7;
+        case TokenType::GREATER_THAN: op = BinaryExpression::Operator::GREATER_THAN; return 7;
+        case TokenType::LESS_EQUAL: op = BinaryExpression::Operator::LESS_EQUAL; return 7;
+        case TokenType::GREATER_EQUAL: op = BinaryExpression::Operator::GREATER_EQUAL; return 7;
+        case TokenType::LEFT_SHIFT: op = BinaryExpression::Operator::LEFT_SHIFT; return 8;
+        case TokenType::RIGHT_SHIFT: op = BinaryExpression::Operator::RIGHT_SHIFT; return 8;
+        case TokenType::PLUS: op = BinaryExpression::Operator::ADD; return 9;
+        case TokenType::MINUS: op = BinaryExpression::Operator::SUBTRACT; return 9;
+        case TokenType::MULTIPLY: op = BinaryExpression::Operator::MULTIPLY; return 10;
+        case TokenType::DIVIDE: op = BinaryExpression::Operator::DIVIDE; return 10;
+        case TokenType::MODULO: op = BinaryExpression::Operator::MODULO; return 10;
+        default: return 0;
+    }
+}
+
+bool assignmentOperator(TokenType type, BinaryExpression::Operator& op) {
+    switch (type) {
+        case TokenType::ASSIGN: op = BinaryExpression::Operator::ASSIGN; return true;
+        case TokenType::PLUS_ASSIGN: op = BinaryExpression::Operator::ADD_ASSIGN; return true;
+        case TokenType::MINUS_ASSIGN: op = BinaryExpression::Operator::SUBTRACT_ASSIGN; return true;
+        case TokenType::MULTIPLY_ASSIGN: op = BinaryExpression::Operator::MULTIPLY_ASSIGN; return true;
+        case TokenType::DIVIDE_ASSIGN: op = BinaryExpression::Operator::DIVIDE_ASSIGN; return true;
+        case TokenType::MODULO_ASSIGN: op = BinaryExpression::Operator::MODULO_ASSIGN; return true;
+        default: return false;
+    }
+}
+
+// Not hexadecimal, binary or octal (a leading 0)
+bool isDecimal(const Token& token) {
+    return !(token.numericFlags & (NUMERIC_HEX | NUMERIC_BINARY)) &&
+           (token.lexeme.size() < 2 || token.lexeme[0] != '0' ||
+            !std::isdigit(static_cast<unsigned char>(token.lexeme[1])));
+}
+
+} // namespace
+
+// Bounds recursion so that deeply nested input reports an error instead of
+// exhausting the stack.
+class Parser::NestingGuard {
+public:
+    explicit NestingGuard(Parser& parser) : parser(parser) {
+        parser.depth++;
+    }
+    ~NestingGuard() {
+        parser.depth--;
+    }
+
+    bool tooDeep() {
+        if (parser.depth <= MAX_NESTING_DEPTH) {
+            return false;
+        }
+        parser.error(DiagID::NESTING_TOO_DEEP);
+        return true;
+    }
+
+private:
+    Parser& parser;
+};
+
+Parser::Parser(const std::pmr::vector<Token>& tokens, DiagnosticEngine* diagnostics,
+               MemoryBudget* budget, std::pmr::memory_resource* resource)
+    : tokens(tokens),
+      diagnostics(diagnostics ? diagnostics : &ownDiagnostics),
+      budget(budget),
+      resource(resource) {}
+
+std::unique_ptr<TranslationUnit> Parser::parse() {
+    MSL_PARSER_STATS(ScopedPhase phase("parse"));
+    if (budget && budget->limitExceeded()) {
+        stopForMemoryLimit();
+    }
+    NodeList<Declaration> declarations(memory());
+    while (!isAtEnd() && !diagnostics->errorLimitReached()) {
+        parseTopLevelDeclaration(declarations);
+    }
+
+    auto unit = makeNode<TranslationUnit>(std::move(declarations));
+    const Token& eof = tokens.back();
+    unit->setSourceRange(SourceRange(SourceLocation(1, 1, 0),
+                                     SourceLocation(eof.line, eof.column, eof.offset)));
+    return unit;
+}
+
+void Parser::setPosition(size_t position) {
+    current = position < tokens.size() ? position : tokens.size() - 1;
+    splitAttributeRight = false;
+}
+
+bool Parser::isAtEnd() const {
+    return peek().type == TokenType::END_OF_FILE;
+}
+
+bool Parser::parseTopLevelDeclaration(NodeList<Declaration>& declarations) {
+    // Top-level declarations never depend on parser state left behind by the
+    // previous one; incremental reparsing relies on this.
+    panicMode = memoryLimitReached;
+    depth = 0;
+    splitAttributeRight = false;
+
+    size_t begin = current;
+    if (parseTopLevel(declarations)) {
+        return true;
+    }
+    if (current == begin) {
+        advance();
+    }
+    synchronizeTopLevel();
+    return false;
+}
+
+// Error recovery
+
+bool Parser::isTopLevelKeyword() const {
+    TokenType t = peek().type;
+    return t == TokenType::KERNEL || t == TokenType::VERTEX || t == TokenType::FRAGMENT ||
+           checkIdentifier("struct") || checkIdentifier("using");
+}
+
+void Parser::synchronizeTopLevel() {
+    panicMode = memoryLimitReached;
+    int braces = 0;
+    while (!isAtEnd() && !isTopLevelKeyword()) {
+        TokenType t = advance().type;
+        if (t == TokenType::LEFT_BRACE) {
+            braces++;
+        } else if (t == TokenType::RIGHT_BRACE) {
+            if (braces > 0) {
+                braces--;
+            }
+            if (braces == 0) {
+                match(TokenType::SEMICOLON);
+                return;
+            }
+        } else if (t == TokenType::SEMICOLON && braces == 0) {
+            return;
+        }
+    }
+}
+
+void Parser::synchronizeStatement() {
+    panicMode = memoryLimitReached;
+    splitAttributeRight = false;
+    int braces = 0;
+    while (!isAtEnd() && !isTopLevelKeyword()) {
+        if (braces == 0 && check(TokenType::RIGHT_BRACE)) {
+            return;  // leave it to close the enclosing block
+        }
+        TokenType t = advance().type;
+        if (t == TokenType::LEFT_BRACE) {
+            braces++;
+        } else if (t == TokenType::RIGHT_BRACE) {
+            if (--braces == 0) {
+                return;
+            }
+        } else if (t == TokenType::SEMICOLON && braces == 0) {
+            return;
+        }
+    }
+}
+
+bool Parser::parseTopLevel(NodeList<Declaration>& declarations) {
+    size_t begin = current;
+
+    std::pmr::vector<Attribute> attributes(memory());
+    if (!parseAttributes(attributes)) {
+        return false;
+    }
+
+    if (checkIdentifier("using")) {
+        auto decl = parseUsingDeclaration(begin);
+        if (!decl) {
+            return false;
+        }
+        declarations.push_back(std::move(decl));
+        return true;
+    }
+    if (checkIdentifier("struct")) {
+        auto decl = parseStructDeclaration(begin);
+        if (!decl) {
+            return false;
+        }
+        declarations.push_back(std::move(decl));
+        return true;
+    }
+
+    auto qualifier = FunctionDeclaration::Qualifier::NONE;
+    if (match(TokenType::KERNEL)) {
+        qualifier = FunctionDeclaration::Qualifier::KERNEL;
+    } else if (match(TokenType::VERTEX)) {
+        qualifier = FunctionDeclaration::Qualifier::VERTEX;
+    } else if (match(TokenType::FRAGMENT)) {
+        qualifier = FunctionDeclaration::Qualifier::FRAGMENT;
+    }
+
+    TypeSpec type(memory());
+    if (!parseType(type)) {
+        error(DiagID::EXPECTED_DECLARATION);
+        return false;
+    }
+
+    if (check(TokenType::IDENTIFIER) && peekAt(1).type == TokenType::LEFT_PAREN) {
+        std::string_view name = advance().lexeme;
+        auto decl = parseFunctionDeclaration(begin, qualifier, type, name, std::move(attributes));
+        if (!decl) {
+            return false;
+        }
+        declarations.push_back(std::move(decl));
+        return true;
+    }
+
+    if (qualifier != FunctionDeclaration::Qualifier::NONE) {
+        error(DiagID::EXPECTED_FUNCTION_NAME);
+        return false;
+    }
+
+    NodeList<VariableDeclaration> variables(memory());
+    if (!parseVariableList(begin, VariableDeclaration::Kind::GLOBAL, type, variables)) {
+        return false;
+    }
+    for (auto& var : variables) {
+        declarations.push_back(std::move(var));
+    }
+    return true;
+}
+
+// Declarations
+
+bool Parser::parseType(TypeSpec& type) {
+    for (;;) {
+        if (isAddressSpace(peek().type)) {
+            type.addressSpace = toAddressSpace(advance().type);
+        } else if (checkIdentifier("const") || checkIdentifier("constexpr")) {
+            advance();
+            type.isConst = true;
+        } else if (checkIdentifier("static") || checkIdentifier("inline")) {
+            advance();
+        } else {
+            break;
+        }
+    }
+
+    bool isBuiltin = isTypeKeyword(peek().type);
+    if (!isBuiltin && !check(TokenType::IDENTIFIER)) {
+        return false;
+    }
+    type.name = advance().lexeme;
+
+    // Qualified names such as `metal::float4`
+    while (check(TokenType::SCOPE_RESOLUTION) &&
+           (peekAt(1).type == TokenType::IDENTIFIER || isTypeKeyword(peekAt(1).type))) {
+        advance();
+        isBuiltin = isTypeKeyword(peek().type);
+        type.name += "::";
+        type.name += advance().lexeme;
+    }
+
+    if (!isBuiltin && check(TokenType::LESS_THAN) && !parseTemplateArguments(type)) {
+        return false;
+    }
+
+    for (;;) {
+        if (checkIdentifier("const")) {
+            advance();
+            type.isConst = true;
+        } else if (isAddressSpace(peek().type)) {
+            type.addressSpace = toAddressSpace(advance().type);
+        } else if (match(TokenType::MULTIPLY)) {
+            type.pointerDepth++;
+        } else if (match(TokenType::BITWISE_AND)) {
+            type.isReference = true;
+        } else {
+            break;
+        }
+    }
+    return true;
+}
+
+bool Parser::parseTemplateArguments(TypeSpec& type) {
+    advance();  // consume '<'
+
+    // Bounded so that speculative type parsing stays cheap on inputs like
+    // `a < b, c, d, ...`.
+    std::pmr::string argument(memory());
+    int nesting = 0;
+    for (size_t count = 0; !isAtEnd() && count < MAX_TEMPLATE_TOKENS; count++) {
+        TokenType t = peek().type;
+        if (t == TokenType::SEMICOLON || t == TokenType::LEFT_BRACE ||
+            t == TokenType::RIGHT_BRACE) {
+            break;
+        }
+        if (nesting == 0 && (t == TokenType::COMMA || t == TokenType::GREATER_THAN)) {
+            advance();
+            type.templateArguments.push_back(std::move(argument));
+            argument.clear();
+            if (t == TokenType::GREATER_THAN) {
+                return true;
+            }
+            continue;
+        }
+        if (t == TokenType::LESS_THAN) {
+            nesting++;
+        } else if (t == TokenType::GREATER_THAN) {
+            nesting--;
+        }
+        argument += advance().lexeme;
+    }
+
+    error(DiagID::EXPECTED_TEMPLATE_CLOSE);
+    return false;
+}
+
+bool Parser::parseAttributes(std::pmr::vector<Attribute>& attributes) {
+    while (match(TokenType::ATTRIBUTE_LEFT)) {
+        do {
+            const Token& name = peek();
+            if (name.lexeme.empty() || !(std::isalpha(static_cast<unsigned char>(name.lexeme[0])) ||
+                                         name.lexeme[0] == '_')) {
+                error(DiagID::EXPECTED_ATTRIBUTE_NAME);
+                return false;
+            }
+            advance();
+
+            Attribute attribute(memory());
+            attribute.name = name.lexeme;
+            if (match(TokenType::LEFT_PAREN)) {
+                while (!check(TokenType::RIGHT_PAREN) && !isAtEnd() &&
+                       !check(TokenType::ATTRIBUTE_RIGHT)) {
+                    attribute.argument += advance().lexeme;
+                }
+                if (!expect(TokenType::RIGHT_PAREN, DiagID::EXPECTED_ATTRIBUTE_ARGUMENT_CLOSE)) {
+                    return false;
+                }
+            }
+            attributes.push_back(std::move(attribute));
+        } while (match(TokenType::COMMA));
+
+        if (!expect(TokenType::ATTRIBUTE_RIGHT, DiagID::EXPECTED_ATTRIBUTE_CLOSE)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Parser::isDeclarationStart() {
+    TokenType t = peek().type;
+    if (isAddressSpace(t) || checkIdentifier("const") || checkIdentifier("constexpr") ||
+        checkIdentifier("static")) {
+        return true;
+    }
+    if (isTypeKeyword(t)) {
+        TokenType next = peekAt(1).type;
+        return next == TokenType::IDENTIFIER || next == TokenType::MULTIPLY ||
+               next == TokenType::BITWISE_AND;
+    }
+    if (t != TokenType::IDENTIFIER) {
+        return false;
+    }
+
+    // A user-defined type: try to read a type followed by a name.
+    size_t saved = current;
+    bool savedSpeculating = speculating;
+    speculating = true;
+    TypeSpec type(memory());
+    bool result = parseType(type) && check(TokenType::IDENTIFIER);
+    speculating = savedSpeculating;
+    current = saved;
+    return result;
+}
+
+std::unique_ptr<Declaration> Parser::parseUsingDeclaration(size_t begin) {
+    advance();  // consume 'using'
+    if (!checkIdentifier("namespace")) {
+        error(DiagID::EXPECTED_NAMESPACE);
+        return nullptr;
+    }
+    advance();
+
+    if (!check(TokenType::IDENTIFIER)) {
+        error(DiagID::EXPECTED_NAMESPACE_NAME);
+        return nullptr;
+    }
+    std::string_view name = advance().lexeme;
+    if (!expect(TokenType::SEMICOLON, DiagID::EXPECTED_SEMI_AFTER_USING)) {
+        return nullptr;
+    }
+    return finish(makeNode<UsingDeclaration>(name), begin);
+}
+
+std::unique_ptr<Declaration> Parser::parseStructDeclaration(size_t begin) {
+    advance();  // consume 'struct'
+    if (!check(TokenType::IDENTIFIER)) {
+        error(DiagID::EXPECTED_STRUCT_NAME);
+        return nullptr;
+    }
+    std::string_view name = advance().lexeme;
+
+    NodeList<VariableDeclaration> fields(memory());
+    if (match(TokenType::LEFT_BRACE)) {
+        while (!check(TokenType::RIGHT_BRACE) && !isAtEnd()) {
+            size_t fieldBegin = current;
+            TypeSpec type(memory());
+            if (!parseType(type)) {
+                error(DiagID::EXPECTED_FIELD);
+                return nullptr;
+            }
+            if (!parseVariableList(fieldBegin, VariableDeclaration::Kind::FIELD, type, fields)) {
+                return nullptr;
+            }
+        }
+        if (!expect(TokenType::RIGHT_BRACE, DiagID::EXPECTED_STRUCT_CLOSE)) {
+            return nullptr;
+        }
+    }
+    if (!expect(TokenType::SEMICOLON, DiagID::EXPECTED_SEMI_AFTER_STRUCT)) {
+        return nullptr;
+    }
+    return finish(makeNode<StructDeclaration>(name, std::move(fields)), begin);
+}
+
+std::unique_ptr<Declaration> Parser::parseFunctionDeclaration(
+    size_t begin, FunctionDeclaration::Qualifier qualifier, const TypeSpec& returnType,
+    std::string_view name, std::pmr::vector<Attribute> attributes) {
+    advance();  // consume '('
+
+    NodeList<VariableDeclaration> parameters(memory());
+    if (check(TokenType::VOID) && peekAt(1).type == TokenType::RIGHT_PAREN) {
+        advance();
+    }
+    if (!check(TokenType::RIGHT_PAREN)) {
+        do {
+            auto param = parseParameter();
+            if (!param) {
+                return nullptr;
+            }
+            parameters.push_back(std::move(param));
+        } while (match(TokenType::COMMA));
+    }
+    if (!expect(TokenType::RIGHT_PAREN, DiagID::EXPECTED_PARAMETERS_CLOSE)) {
+        return nullptr;
+    }
+    if (!parseAttributes(attributes)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<CompoundStatement> body;
+    if (check(TokenType::LEFT_BRACE)) {
+        body = parseCompoundStatement();
+        if (!body) {
+            return nullptr;
+        }
+    } else if (!expect(TokenType::SEMICOLON, DiagID::EXPECTED_FUNCTION_BODY)) {
+        return nullptr;
+    }
+
+    auto decl = makeNode<FunctionDeclaration>(qualifier, returnType, name, std::move(parameters),
+                                              std::move(body));
+    setAttributes(*decl, std::move(attributes));
+    return finish(std::move(decl), begin);
+}
+
+std::unique_ptr<VariableDeclaration> Parser::parseParameter() {
+    size_t begin = current;
+    TypeSpec type(memory());
+    if (!parseType(type)) {
+        error(DiagID::EXPECTED_PARAMETER_TYPE);
+        return nullptr;
+    }
+
+    std::string_view name;
+    if (check(TokenType::IDENTIFIER)) {
+        name = advance().lexeme;
+    }
+
+    std::unique_ptr<Expression> arraySize;
+    if (match(TokenType::LEFT_BRACKET)) {
+        arraySize = parseExpression();
+        if (!arraySize || !consumeRightBracket()) {
+            error(DiagID::EXPECTED_ARRAY_SIZE_CLOSE);
+            return nullptr;
+        }
+    }
+
+    std::pmr::vector<Attribute> attributes(memory());
+    if (!parseAttributes(attributes)) {
+        return nullptr;
+    }
+
+    auto param = makeNode<VariableDeclaration>(VariableDeclaration::Kind::PARAMETER, type, name);
+    param->setArraySize(std::move(arraySize));
+    setAttributes(*param, std::move(attributes));
+    return finish(std::move(param), begin);
+}
+
+bool Parser::parseVariableList(size_t begin, VariableDeclaration::Kind kind,
+                               const TypeSpec& type,
+                               NodeList<VariableDeclaration>& variables) {
+    size_t first = variables.size();
+    do {
+        if (!check(TokenType::IDENTIFIER)) {
+            error(DiagID::EXPECTED_VARIABLE_NAME);
+            return false;
+        }
+        std::string_view name = advance().lexeme;
+
+        std::unique_ptr<Expression> arraySize;
+        if (match(TokenType::LEFT_BRACKET)) {
+            arraySize = parseExpression();
+            if (!arraySize || !consumeRightBracket()) {
+                error(DiagID::EXPECTED_ARRAY_SIZE_CLOSE);
+                return false;
+            }
+        }
+
+        std::pmr::vector<Attribute> attributes(memory());
+        if (!parseAttributes(attributes)) {
+            return false;
+        }
+
+        std::unique_ptr<Expression> initializer;
+        if (match(TokenType::ASSIGN)) {
+            initializer = parseAssignment();
+            if (!initializer) {
+                return false;
+            }
+        }
+
+        auto var = makeNode<VariableDeclaration>(kind, type, name, std::move(initializer));
+        var->setArraySize(std::move(arraySize));
+        setAttributes(*var, std::move(attributes));
+        variables.push_back(std::move(var));
+    } while (match(TokenType::COMMA));
+
+    if (!expect(TokenType::SEMICOLON, DiagID::EXPECTED_SEMI_AFTER_DECLARATION)) {
+        return false;
+    }
+
+    // Every variable of a declaration shares the range of the whole
+    // declaration, from the type to the ';'.
+    SourceRange range = rangeFrom(begin);
+    for (size_t i = first; i < variables.size(); i++) {
+        variables[i]->setSourceRange(range);
+    }
+    return true;
+}
+
+// Statements
+
+std::unique_ptr<Statement> Parser::parseStatement() {
+    NestingGuard guard(*this);
+    if (guard.tooDeep()) {
+        return nullptr;
+    }
+
+    switch (peek().type) {
+        case TokenType::LEFT_BRACE: return parseCompoundStatement();
+        case TokenType::IF: return parseIfStatement();
+        case TokenType::FOR: return parseForStatement();
+        case TokenType::WHILE: return parseWhileStatement();
+        case TokenType::DO: return parseDoStatement();
+        case TokenType::SWITCH: return parseSwitchStatement();
+        case TokenType::CASE:
+        case TokenType::DEFAULT:
+            return parseCaseStatement();
+        case TokenType::RETURN: return parseReturnStatement();
+        case TokenType::BREAK: {
+            size_t begin = current;
+            advance();
+            if (!expect(TokenType::SEMICOLON, DiagID::EXPECTED_SEMI_AFTER, TokenType::BREAK)) {
+                return nullptr;
+            }
+            return finish(makeNode<BreakStatement>(), begin);
+        }
+        case TokenType::CONTINUE: {
+            size_t begin = current;
+            advance();
+            if (!expect(TokenType::SEMICOLON, DiagID::EXPECTED_SEMI_AFTER, TokenType::CONTINUE)) {
+                return nullptr;
+            }
+            return finish(makeNode<ContinueStatement>(), begin);
+        }
+        default:
+            break;
+    }
+
+    if (isDeclarationStart()) {
+        return parseDeclarationStatement();
+    }
+    return parseExpressionStatement();
+}
+
+std::unique_ptr<CompoundStatement> Parser::parseCompoundStatement() {
+    size_t begin = current;
+    if (!expect(TokenType::LEFT_BRACE, DiagID::EXPECTED_LEFT_BRACE)) {
+        return nullptr;
+    }
+
+    NodeList<Statement> statements(memory());
+    while (!check(TokenType::RIGHT_BRACE) && !isAtEnd() && !isTopLevelKeyword() &&
+           !diagnostics->errorLimitReached()) {
+        auto stmt = parseStatement();
+        if (stmt) {
+            statements.push_back(std::move(stmt));
+        } else {
+            synchronizeStatement();
+        }
+    }
+
+    // A missing '}' is reported but the block is kept, so that the rest of
+    // the function survives an unbalanced edit.
+    expect(TokenType::RIGHT_BRACE, DiagID::EXPECTED_RIGHT_BRACE);
+    return finish(makeNode<CompoundStatement>(std::move(statements)), begin);
+}
+
+std::unique_ptr<Statement> Parser::parseDeclarationStatement() {
+    size_t begin = current;
+    TypeSpec type(memory());
+    if (!parseType(type)) {
+        error(DiagID::EXPECTED_TYPE);
+        return nullptr;
+    }
+
+    NodeList<VariableDeclaration> variables(memory());
+    if (!parseVariableList(begin, VariableDeclaration::Kind::LOCAL, type, variables)) {
+        return nullptr;
+    }
+    return finish(makeNode<DeclarationStatement>(std::move(variables)), begin);
+}
+
+std::unique_ptr<Statement> Parser::parseExpressionStatement() {
+    size_t begin = current;
+    std::unique_ptr<Expression> expr;
+    if (!check(TokenType::SEMICOLON)) {
+        expr = parseExpression();
+        if (!expr) {
+            return nullptr;
+        }
+    }
+    if (!expect(TokenType::SEMICOLON, DiagID::EXPECTED_SEMI_AFTER_EXPRESSION)) {
+        return nullptr;
+    }
+    return finish(makeNode<ExpressionStatement>(std::move(expr)), begin);
+}
+
+std::unique_ptr<Statement> Parser::parseIfStatement() {
+    size_t begin = current;
+    advance();  // consume 'if'
+    if (!expect(TokenType::LEFT_PAREN, DiagID::EXPECTED_LEFT_PAREN_AFTER, TokenType::IF)) {
+        return nullptr;
+    }
+    auto condition = parseExpression();
+    if (!condition || !expect(TokenType::RIGHT_PAREN, DiagID::EXPECTED_CONDITION_CLOSE)) {
+        return nullptr;
+    }
+    auto thenStmt = parseStatement();
+    if (!thenStmt) {
+        return nullptr;
+    }
+
+    std::unique_ptr<Statement> elseStmt;
+    if (match(TokenType::ELSE)) {
+        elseStmt = parseStatement();
+        if (!elseStmt) {
+            return nullptr;
+        }
+    }
+    return finish(
+        makeNode<IfStatement>(std::move(condition), std::move(thenStmt), std::move(elseStmt)),
+        begin);
+}
+
+std::unique_ptr<Statement> Parser::parseForStatement() {
+    size_t begin = current;
+    advance();  // consume 'for'
+    if (!expect(TokenType::LEFT_PAREN, DiagID::EXPECTED_LEFT_PAREN_AFTER, TokenType::FOR)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<Statement> init;
+    if (isDeclarationStart()) {
+        init = parseDeclarationStatement();
+    } else {
+        init = parseExpressionStatement();
+    }
+    if (!init) {
+        return nullptr;
+    }
+
+    std::unique_ptr<Expression> condition;
+    if (!check(TokenType::SEMICOLON)) {
+        condition = parseExpression();
+        if (!condition) {
+            return nullptr;
+        }
+    }
+    if (!expect(TokenType::SEMICOLON, DiagID::EXPECTED_SEMI_AFTER_CONDITION)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<Expression> increment;
+    if (!check(TokenType::RIGHT_PAREN)) {
+        increment = parseExpression();
+        if (!increment) {
+            return nullptr;
+        }
+    }
+    if (!expect(TokenType::RIGHT_PAREN, DiagID::EXPECTED_FOR_CLOSE)) {
+        return nullptr;
+    }
+
+    auto body = parseStatement();
+    if (!body) {
+        return nullptr;
+    }
+    return finish(makeNode<ForStatement>(std::move(init), std::move(condition),
+                                         std::move(increment), std::move(body)),
+                  begin);
+}
+
+std::unique_ptr<Statement> Parser::parseWhileStatement() {
+    size_t begin = current;
+    advance();  // consume 'while'
+    if (!expect(TokenType::LEFT_PAREN, DiagID::EXPECTED_LEFT_PAREN_AFTER, TokenType::WHILE)) {
+        return nullptr;
+    }
+    auto condition = parseExpression();
+    if (!condition || !expect(TokenType::RIGHT_PAREN, DiagID::EXPECTED_CONDITION_CLOSE)) {
+        return nullptr;
+    }
+    auto body = parseStatement();
+    if (!body) {
+        return nullptr;
+    }
+    return finish(makeNode<WhileStatement>(std::move(condition), std::move(body)), begin);
+}
+
+std::unique_ptr<Statement> Parser::parseDoStatement() {
+    size_t begin = current;
+    advance();  // consume 'do'
+    auto body = parseStatement();
+    if (!body || !expect(TokenType::WHILE, DiagID::EXPECTED_WHILE_AFTER_DO) ||
+        !expect(TokenType::LEFT_PAREN, DiagID::EXPECTED_LEFT_PAREN_AFTER, TokenType::WHILE)) {
+        return nullptr;
+    }
+    auto condition = parseExpression();
+    if (!condition || !expect(TokenType::RIGHT_PAREN, DiagID::EXPECTED_CONDITION_CLOSE) ||
+        !expect(TokenType::SEMICOLON, DiagID::EXPECTED_SEMI_AFTER, TokenType::WHILE)) {
+        return nullptr;
+    }
+    return finish(makeNode<DoStatement>(std::move(body), std::move(condition)), begin);
+}
+
+std::unique_ptr<Statement> Parser::parseSwitchStatement() {
+    size_t begin = current;
+    advance();  // consume 'switch'
+    if (!expect(TokenType::LEFT_PAREN, DiagID::EXPECTED_LEFT_PAREN_AFTER, TokenType::SWITCH)) {
+        return nullptr;
+    }
+    auto condition = parseExpression();
+    if (!condition || !expect(TokenType::RIGHT_PAREN, DiagID::EXPECTED_CONDITION_CLOSE)) {
+        return nullptr;
+    }
+    auto body = parseStatement();
+    if (!body) {
+        return nullptr;
+    }
+    return finish(makeNode<SwitchStatement>(std::move(condition), std::move(body)), begin);
+}
+
+std::unique_ptr<Statement> Parser::parseCaseStatement() {
+    size_t begin = current;
+    std::unique_ptr<Expression> value;
+    if (advance().type == TokenType::CASE) {
+        value = parseConditional();
+        if (!value) {
+            return nullptr;
+        }
+    }
+    if (!expect(TokenType::COLON, DiagID::EXPECTED_COLON_AFTER_CASE)) {
+        return nullptr;
+    }
+    return finish(makeNode<CaseStatement>(std::move(value)), begin);
+}
+
+std::unique_ptr<Statement> Parser::parseReturnStatement() {
+    size_t begin = current;
+    advance();  // consume 'return'
+    std::unique_ptr<Expression> value;
+    if (!check(TokenType::SEMICOLON)) {
+        value = parseExpression();
+        if (!value) {
+            return nullptr;
+        }
+    }
+    if (!expect(TokenType::SEMICOLON, DiagID::EXPECTED_SEMI_AFTER_RETURN)) {
+        return nullptr;
+    }
+    return finish(makeNode<ReturnStatement>(std::move(value)), begin);
+}
+
+// Expressions
+
+std::unique_ptr<Expression> Parser::parseExpression() {
+    return parseAssignment();
+}
+
+std::unique_ptr<Expression> Parser::parseAssignment() {
+    NestingGuard guard(*this);
+    if (guard.tooDeep()) {
+        return nullptr;
+    }
+
+    size_t begin = current;
+    auto left = parseConditional();
+    if (!left) {
+        return nullptr;
+    }
+
+    BinaryExpression::Operator op;
+    if (assignmentOperator(peek().type, op)) {
+        advance();
+        auto right = parseAssignment();
+        if (!right) {
+            return nullptr;
+        }
+        return finish(makeNode<BinaryExpression>(std::move(left), op, std::move(right)), begin);
+    }
+    return left;
+}
+
+std::unique_ptr<Expression> Parser::parseConditional() {
+    NestingGuard guard(*this);
+    if (guard.tooDeep()) {
+        return nullptr;
+    }
+
+    size_t begin = current;
+    auto condition = parseBinary(1);
+    if (!condition || !match(TokenType::QUESTION)) {
+        return condition;
+    }
+
+    auto trueExpr = parseAssignment();
+    if (!trueExpr || !expect(TokenType::COLON, DiagID::EXPECTED_CONDITIONAL_COLON)) {
+        return nullptr;
+    }
+    auto falseExpr = parseConditional();
+    if (!falseExpr) {
+        return nullptr;
+    }
+    return finish(makeNode<ConditionalExpression>(std::move(condition), std::move(trueExpr),
+                                                  std::move(falseExpr)),
+                  begin);
+}
+
+std::unique_ptr<Expression> Parser::parseBinary(int minPrecedence) {
+    size_t begin = current;
+    auto left = parseUnary();
+    if (!left) {
+        return nullptr;
+    }
+
+    // Each operator folded into `left` deepens the tree by one level, so it
+    // counts towards the nesting limit like a recursive call.
+    int savedDepth = depth;
+    for (;;) {
+        BinaryExpression::Operator op;
+        int precedence = binaryPrecedence(peek().type, op);
+        if (precedence == 0 || precedence < minPrecedence) {
+            break;
+        }
+        if (++depth > MAX_NESTING_DEPTH) {
+            error(DiagID::EXPRESSION_TOO_COMPLEX);
+            depth = savedDepth;
+            return nullptr;
+        }
+        advance();
+        auto right = parseBinary(precedence + 1);
+        if (!right) {
+            depth = savedDepth;
+            return nullptr;
+        }
+        left = finish(makeNode<BinaryExpression>(std::move(left), op, std::move(right)), begin);
+    }
+    depth = savedDepth;
+    return left;
+}
+
+std::unique_ptr<Expression> Parser::parseUnary() {
+    NestingGuard guard(*this);
+    if (guard.tooDeep()) {
+        return nullptr;
+    }
+
+    size_t begin = current;
+
+    UnaryExpression::Operator op;
+    bool isUnary = true;
+    switch (peek().type) {
+        case TokenType::MINUS: op = UnaryExpression::Operator::NEGATE; break;
+        case TokenType::PLUS: op = UnaryExpression::Operator::PLUS; break;
+        case TokenType::NOT: op = UnaryExpression::Operator::NOT; break;
+        case TokenType::BITWISE_NOT: op = UnaryExpression::Operator::BITWISE_NOT; break;
+        case TokenType::PLUS_PLUS: op = UnaryExpression::Operator::PRE_INCREMENT; break;
+        case TokenType::MINUS_MINUS: op = UnaryExpression::Operator::PRE_DECREMENT; break;
+        case TokenType::BITWISE_AND: op = UnaryExpression::Operator::ADDRESS_OF; break;
+        case TokenType::MULTIPLY: op = UnaryExpression::Operator::DEREFERENCE; break;
+        default: isUnary = false; break;
+    }
+    if (isUnary) {
+        advance();
+        auto operand = parseUnary();
+        if (!operand) {
+            return nullptr;
+        }
+        return finish(makeNode<UnaryExpression>(op, std::move(operand)), begin);
+    }
+
+    // C-style cast: '(' type ')' unary
+    if (check(TokenType::LEFT_PAREN) &&
+        (isTypeKeyword(peekAt(1).type) || isAddressSpace(peekAt(1).type))) {
+        advance();
+        TypeSpec type(memory());
+        if (parseType(type) && match(TokenType::RIGHT_PAREN)) {
+            auto operand = parseUnary();
+            if (!operand) {
+                return nullptr;
+            }
+            return finish(makeNode<CastExpression>(type, std::move(operand)), begin);
+        }
+        current = begin;
+    }
+
+    return parsePostfix();
+}
+
+std::unique_ptr<Expression> Parser::parsePostfix() {
+    size_t begin = current;
+    auto expr = parsePrimary();
+    if (!expr) {
+        return nullptr;
+    }
+
+    for (;;) {
+        if (splitAttributeRight) {
+            // Pending half of a ']]'; only the enclosing subscript can consume it.
+            break;
+        }
+        if (match(TokenType::LEFT_PAREN)) {
+            NodeList<Expression> arguments(memory());
+            if (!parseArguments(arguments)) {
+                return nullptr;
+            }
+            expr = finish(makeNode<CallExpression>(std::move(expr), std::move(arguments)), begin);
+        } else if (match(TokenType::LEFT_BRACKET)) {
+            auto index = parseExpression();
+            if (!index) {
+                return nullptr;
+            }
+            if (!consumeRightBracket()) {
+                error(DiagID::EXPECTED_SUBSCRIPT_CLOSE);
+                return nullptr;
+            }
+            expr = finish(makeNode<IndexExpression>(std::move(expr), std::move(index)), begin);
+        } else if (check(TokenType::DOT) || check(TokenType::ARROW)) {
+            bool isArrow = advance().type == TokenType::ARROW;
+            if (!check(TokenType::IDENTIFIER)) {
+                error(DiagID::EXPECTED_MEMBER_NAME);
+                return nullptr;
+            }
+            std::string_view member = advance().lexeme;
+            expr = finish(makeNode<MemberExpression>(std::move(expr), member, isArrow), begin);
+        } else if (check(TokenType::PLUS_PLUS) || check(TokenType::MINUS_MINUS)) {
+            auto op = advance().type == TokenType::PLUS_PLUS
+                          ? UnaryExpression::Operator::POST_INCREMENT
+                          : UnaryExpression::Operator::POST_DECREMENT;
+            expr = finish(makeNode<UnaryExpression>(op, std::move(expr)), begin);
+        } else {
+            break;
+        }
+    }
+    return expr;
+}
+
+std::unique_ptr<Expression> Parser::parsePrimary() {
+    size_t begin = current;
+    const Token& token = peek();
+
+    switch (token.type) {
+        case TokenType::INTEGER_LITERAL:
+            advance();
+            return finish(parseIntegerLiteral(token), begin);
+        case TokenType::FLOAT_LITERAL:
+            advance();
+            return finish(parseFloatLiteral(token), begin);
+        case TokenType::IDENTIFIER:
+            advance();
+            if (token.lexeme == "true" || token.lexeme == "false") {
+                return finish(makeNode<BoolLiteral>(token.lexeme == "true"), begin);
+            }
+            return finish(makeNode<Identifier>(token.lexeme), begin);
+        case TokenType::LEFT_PAREN: {
+            advance();
+            auto expr = parseExpression();
+            if (!expr || !expect(TokenType::RIGHT_PAREN, DiagID::EXPECTED_PAREN_CLOSE)) {
+                return nullptr;
+            }
+            return expr;
+        }
+        default:
+            break;
+    }
+
+    if (isTypeKeyword(token.type)) {
+        TypeSpec type(memory());
+        type.name = advance().lexeme;
+        if (!expect(TokenType::LEFT_PAREN, DiagID::EXPECTED_LEFT_PAREN_AFTER_TYPE)) {
+            return nullptr;
+        }
+        NodeList<Expression> arguments(memory());
+        if (!parseArguments(arguments)) {
+            return nullptr;
+        }
+        return finish(makeNode<ConstructExpression>(type, std::move(arguments)), begin);
+    }
+
+    error(DiagID::EXPECTED_EXPRESSION);
+    return nullptr;
+}
+
+bool Parser::parseArguments(NodeList<Expression>& arguments) {
+    if (!check(TokenType::RIGHT_PAREN)) {
+        do {
+            auto arg = parseAssignment();
+            if (!arg) {
+                return false;
+            }
+            arguments.push_back(std::move(arg));
+        } while (match(TokenType::COMMA));
+    }
+    return expect(TokenType::RIGHT_PAREN, DiagID::EXPECTED_ARGUMENTS_CLOSE);
+}
+
+std::unique_ptr<Expression> Parser::parseIntegerLiteral(const Token& token) {
+    uint64_t value = 0;
+    switch (decodeIntegerLiteral(token, value)) {
+        case LiteralStatus::INVALID:
+            reportLiteral(DiagID::INVALID_INTEGER_LITERAL, token);
+            break;
+        case LiteralStatus::OUT_OF_RANGE:
+            reportLiteral(DiagID::INTEGER_LITERAL_TOO_LARGE, token);
+            break;
+        case LiteralStatus::OK: {
+            // int, or uint with a 'u' suffix; as in C++, a hexadecimal, binary
+            // or octal literal without one may use the sign bit
+            const bool isUnsigned = (token.numericFlags & NUMERIC_SUFFIX_U) || !isDecimal(token);
+            if (value > (isUnsigned ? UINT32_MAX : INT32_MAX)) {
+                reportLiteral(DiagID::INTEGER_LITERAL_OUT_OF_RANGE, token);
+            }
+            break;
+        }
+    }
+    return makeNode<IntegerLiteral>(static_cast<int>(static_cast<uint32_t>(value)));
+}
+
+std::unique_ptr<Expression> Parser::parseFloatLiteral(const Token& token) {
+    float value = 0.0f;
+    switch (decodeFloatLiteral(token, value)) {
+        case LiteralStatus::INVALID:
+            reportLiteral(DiagID::INVALID_FLOAT_LITERAL, token);
+            break;
+        case LiteralStatus::OUT_OF_RANGE:
+            reportLiteral(DiagID::FLOAT_LITERAL_OUT_OF_RANGE, token);
+            break;
+        case LiteralStatus::OK:
+            break;
+    }
+    return makeNode<FloatLiteral>(value);
+}
+
+// Token helpers
+
+const Token& Parser::peek() const {
+    return tokens[current];
+}
+
+const Token& Parser::peekAt(size_t distance) const {
+    size_t index = current + distance;
+    return index < tokens.size() ? tokens[index] : tokens.back();
+}
+
+const Token& Parser::previous() const {
+    return tokens[current > 0 ? current - 1 : 0];
+}
+
+bool Parser::check(TokenType type) const {
+    return peek().type == type;
+}
+
+bool Parser::checkIdentifier(const char* name) const {
+    return peek().type == TokenType::IDENTIFIER && peek().lexeme == name;
+}
+
+bool Parser::match(TokenType type) {
+    if (!check(type)) {
+        return false;
+    }
+    advance();
+    return true;
+}
+
+const Token& Parser::advance() {
+    const Token& token = tokens[current];
+    if (token.type != TokenType::END_OF_FILE) {
+        current++;
+    }
+    return token;
+}
+
+bool Parser::expect(TokenType type, DiagID id) {
+    if (match(type)) {
+        return true;
+    }
+    error(id);
+    return false;
+}
+
+bool Parser::expect(TokenType type, DiagID id, TokenType context) {
+    if (match(type)) {
+        return true;
+    }
+    if (!speculating && !panicMode) {
+        panicMode = true;
+        errorCount++;
+        size_t capacity = diagnostics->getDiagnostics().capacity();
+        diagnostics->report(id, peek().offset, DiagArgKind::TOKEN_TYPE,
+                            static_cast<uint32_t>(context));
+        chargeDiagnostics(capacity);
+    }
+    return false;
+}
+
+bool Parser::consumeRightBracket() {
+    if (match(TokenType::RIGHT_BRACKET)) {
+        return true;
+    }
+    if (check(TokenType::ATTRIBUTE_RIGHT)) {
+        if (splitAttributeRight) {
+            splitAttributeRight = false;
+            advance();
+        } else {
+            splitAttributeRight = true;
+        }
+        return true;
+    }
+    return false;
+}
+
+void Parser::error(DiagID id) {
+    if (speculating || panicMode) {
+        return;
+    }
+    panicMode = true;
+    errorCount++;
+    size_t capacity = diagnostics->getDiagnostics().capacity();
+    diagnostics->report(id, peek().offset);
+    chargeDiagnostics(capacity);
+}
+
+// A bad literal value does not disturb the structure of the parse, so this
+// reports without entering panic mode.
+void Parser::reportLiteral(DiagID id, const Token& token) {
+    if (speculating || panicMode) {
+        return;
+    }
+    if (DiagnosticEngine::getSeverity(id) == Severity::ERROR) {
+        errorCount++;
+    }
+    size_t capacity = diagnostics->getDiagnostics().capacity();
+    diagnostics->report(id, token.offset);
+    chargeDiagnostics(capacity);
+}
+
+void Parser::chargeDiagnostics(size_t previousCapacity) {
+    if (budget) {
+        chargeMemory(MemoryCategory::TABLES,
+                     (diagnostics->getDiagnostics().capacity() - previousCapacity) *
+                         sizeof(Diagnostic));
+    }
+}
+
+void Parser::chargeMemory(MemoryCategory category, size_t bytes) {
+    if (!budget->charge(category, bytes)) {
+        stopForMemoryLimit();
+    }
+}
+
+// Parsing stops as if the input ended at the current token. The enclosing
+// rules unwind through their usual end-of-input paths, and panic mode stays
+// set to suppress their errors. The lexer reports the same diagnostic when the budget
+// runs out while scanning, so it is not repeated.
+void Parser::stopForMemoryLimit() {
+    if (memoryLimitReached) {
+        return;
+    }
+    memoryLimitReached = true;
+    panicMode = true;
+    errorCount++;
+    uint32_t offset = peek().offset;
+    current = tokens.size() - 1;
+
+    const auto& reported = diagnostics->getDiagnostics();
+    for (const Diagnostic& diagnostic : reported) {
+        if (diagnostic.id == DiagID::MEMORY_LIMIT_EXCEEDED) {
+            return;
+        }
+    }
+    size_t capacity = reported.capacity();
+    diagnostics->report(DiagID::MEMORY_LIMIT_EXCEEDED, offset, DiagArgKind::INTEGER,
+                        static_cast<uint32_t>((budget->getLimit() + 1023) / 1024));
+    budget->charge(MemoryCategory::TABLES,
+                   (diagnostics->getDiagnostics().capacity() - capacity) * sizeof(Diagnostic));
+}
+
+SourceRange Parser::rangeFrom(size_t startToken) const {
+    const Token& first = tokens[startToken];
+    const Token& last = previous();
+    uint32_t length = static_cast<uint32_t>(last.lexeme.size());
+    return SourceRange(SourceLocation(first.line, first.column, first.offset),
+                       SourceLocation(last.line, last.column + length, last.endOffset()));
+}
+
+} // namespace msl_parser
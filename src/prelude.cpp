@@ -0,0 +1,454 @@
+#include "msl_parser/prelude.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include "msl_parser/ast/ast_node.h"
+#include "msl_parser/ast/ast_visitor.h"
+#include "msl_parser/binary_file.h"
+#include "msl_parser/parser.h"
+
+namespace msl_parser {
+
+namespace {
+
+constexpr char MAGIC[8] = {'M', 'S', 'L', 'P', 'R', 'L', 'D', '\0'};
+// Bump whenever the layout, TokenType or NodeKind changes
+constexpr uint32_t VERSION = 1;
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+constexpr uint32_t MACRO_FUNCTION_LIKE = 1 << 0;
+constexpr uint32_t MACRO_VARIADIC = 1 << 1;
+
+} // namespace
+
+struct PreludeSnapshot::StringRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct PreludeSnapshot::TokenRecord {
+    StringRef lexeme;
+    uint32_t line;
+    uint32_t column;
+    uint32_t offset;
+    uint8_t type;
+    uint8_t numericFlags;
+    uint8_t flags;
+    uint8_t padding;
+};
+
+struct PreludeSnapshot::MacroRecord {
+    StringRef name;
+    uint32_t firstParameter;
+    uint32_t parameterCount;
+    uint32_t firstBodyToken;
+    uint32_t bodyTokenCount;
+    uint32_t flags;
+};
+
+struct PreludeSnapshot::DeclarationRecord {
+    StringRef name;
+    uint32_t kind;
+    uint32_t firstToken;
+    uint32_t tokenCount;
+};
+
+struct PreludeSnapshot::FileRecord {
+    StringRef path;
+    StringRef includeGuard;
+    uint32_t once;
+};
+
+bool PreludeSnapshot::write(const std::string& path, const Preprocessor& preprocessor,
+                            const std::pmr::vector<Token>& tokens) {
+    BinaryWriter writer;
+    auto tokenRecord = [&](const Token& token) {
+        TokenRecord record = {};
+        record.lexeme = writer.string<StringRef>(token.lexeme);
+        record.line = token.line;
+        record.column = token.column;
+        record.offset = token.offset;
+        record.type = static_cast<uint8_t>(token.type);
+        record.numericFlags = token.numericFlags;
+        record.flags = token.flags;
+        return record;
+    };
+
+    std::vector<TokenRecord> tokenRecords;
+    for (size_t i = 0; i + 1 < tokens.size(); i++) {
+        tokenRecords.push_back(tokenRecord(tokens[i]));
+    }
+
+    std::vector<MacroRecord> macroRecords;
+    std::vector<StringRef> parameters;
+    std::vector<TokenRecord> bodyTokens;
+    std::vector<std::string_view> macroNames;
+    for (const MacroDefinition* definition : preprocessor.getDefinedMacros()) {
+        const MacroDefinition& macro = *definition;
+        MacroRecord record = {};
+        record.name = writer.string<StringRef>(macro.name);
+        record.firstParameter = static_cast<uint32_t>(parameters.size());
+        record.parameterCount = static_cast<uint32_t>(macro.parameters.size());
+        record.firstBodyToken = static_cast<uint32_t>(bodyTokens.size());
+        record.bodyTokenCount = static_cast<uint32_t>(macro.body.size());
+        record.flags = (macro.functionLike ? MACRO_FUNCTION_LIKE : 0) |
+                       (macro.variadic ? MACRO_VARIADIC : 0);
+        for (const std::string& parameter : macro.parameters) {
+            parameters.push_back(writer.string<StringRef>(parameter));
+        }
+        for (const Token& token : macro.body) {
+            bodyTokens.push_back(tokenRecord(token));
+        }
+        macroRecords.push_back(record);
+        macroNames.push_back(macro.name);
+    }
+
+    // Top-level declarations, with the tokens each was parsed from
+    std::vector<DeclarationRecord> declarationRecords;
+    std::vector<std::string_view> declarationNames;
+    DiagnosticEngine diagnostics(0);
+    Parser parser(tokens, &diagnostics);
+    ast::NodeList<ast::Declaration> declarations;
+    while (!parser.isAtEnd()) {
+        size_t begin = parser.getPosition();
+        size_t parsed = declarations.size();
+        parser.parseTopLevelDeclaration(declarations);
+        for (size_t i = parsed; i < declarations.size(); i++) {
+            DeclarationRecord record = {};
+            record.name = writer.string<StringRef>(declarations[i]->getName());
+            record.kind = static_cast<uint32_t>(getNodeKind(declarations[i].get()));
+            record.firstToken = static_cast<uint32_t>(begin);
+            record.tokenCount = static_cast<uint32_t>(parser.getPosition() - begin);
+            declarationRecords.push_back(record);
+            declarationNames.push_back(declarations[i]->getName());
+        }
+    }
+
+    std::vector<FileRecord> fileRecords;
+    for (size_t i = 0; i < preprocessor.files.size(); i++) {
+        const LexedFile& file = *preprocessor.files[i].file;
+        std::string filePath = file.path;
+        if (i == 0) {
+            std::error_code error;
+            std::filesystem::path canonical = std::filesystem::weakly_canonical(filePath, error);
+            filePath = error ? filePath : canonical.string();
+        }
+        FileRecord record = {};
+        record.path = writer.string<StringRef>(filePath);
+        record.includeGuard = writer.string<StringRef>(file.includeGuard);
+        record.once = i == 0 || preprocessor.onceFiles.count(file.path) ? 1 : 0;
+        fileRecords.push_back(record);
+    }
+
+    std::vector<uint32_t> macroBuckets = hashTable(macroNames);
+    std::vector<uint32_t> declarationBuckets = hashTable(declarationNames);
+
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.tokenCount = static_cast<uint32_t>(tokenRecords.size());
+    header.bodyTokenCount = static_cast<uint32_t>(bodyTokens.size());
+    header.parameterCount = static_cast<uint32_t>(parameters.size());
+    header.macroCount = static_cast<uint32_t>(macroRecords.size());
+    header.macroBucketCount = static_cast<uint32_t>(macroBuckets.size());
+    header.declarationCount = static_cast<uint32_t>(declarationRecords.size());
+    header.declarationBucketCount = static_cast<uint32_t>(declarationBuckets.size());
+    header.fileCount = static_cast<uint32_t>(fileRecords.size());
+
+    writer.append(&header, sizeof(header)); // placeholder, rewritten below
+    header.strings = writer.append(writer.getStrings().data(), writer.getStrings().size());
+    header.stringsSize = writer.getStrings().size();
+    header.tokens = writer.section(tokenRecords);
+    header.bodyTokens = writer.section(bodyTokens);
+    header.parameters = writer.section(parameters);
+    header.macros = writer.section(macroRecords);
+    header.macroBuckets = writer.section(macroBuckets);
+    header.declarations = writer.section(declarationRecords);
+    header.declarationBuckets = writer.section(declarationBuckets);
+    header.files = writer.section(fileRecords);
+    std::memcpy(&writer.out[0], &header, sizeof(header));
+
+    return writer.save(path);
+}
+
+std::shared_ptr<const PreludeSnapshot> PreludeSnapshot::open(const std::string& path) {
+    std::shared_ptr<PreludeSnapshot> snapshot(new PreludeSnapshot());
+    if (!snapshot->file.open(path)) {
+        return nullptr;
+    }
+    snapshot->data = snapshot->file.data();
+    snapshot->size = snapshot->file.size();
+    if (!snapshot->validate()) {
+        return nullptr;
+    }
+    return snapshot;
+}
+
+PreludeSnapshot::~PreludeSnapshot() = default;
+
+// Checks the header and that every section lies inside the file. Records
+// are checked when they are read.
+bool PreludeSnapshot::validate() {
+    if (size < sizeof(Header)) {
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.byteOrder != BYTE_ORDER_MARK) {
+        return false;
+    }
+    auto fits = [&](uint64_t offset, uint64_t count, size_t recordSize) {
+        return offset <= size && count <= (size - offset) / recordSize;
+    };
+    bool powerOfTwo = header.macroBucketCount != 0 &&
+                      (header.macroBucketCount & (header.macroBucketCount - 1)) == 0 &&
+                      header.declarationBucketCount != 0 &&
+                      (header.declarationBucketCount & (header.declarationBucketCount - 1)) == 0;
+    return powerOfTwo && fits(header.strings, header.stringsSize, 1) &&
+           fits(header.tokens, header.tokenCount, sizeof(TokenRecord)) &&
+           fits(header.bodyTokens, header.bodyTokenCount, sizeof(TokenRecord)) &&
+           fits(header.parameters, header.parameterCount, sizeof(StringRef)) &&
+           fits(header.macros, header.macroCount, sizeof(MacroRecord)) &&
+           fits(header.macroBuckets, header.macroBucketCount, sizeof(uint32_t)) &&
+           fits(header.declarations, header.declarationCount, sizeof(DeclarationRecord)) &&
+           fits(header.declarationBuckets, header.declarationBucketCount, sizeof(uint32_t)) &&
+           fits(header.files, header.fileCount, sizeof(FileRecord));
+}
+
+template <typename Record>
+bool PreludeSnapshot::read(uint64_t section, uint32_t count, size_t index, Record& record) const {
+    if (index >= count) {
+        return false;
+    }
+    std::memcpy(&record, data + section + index * sizeof(Record), sizeof(Record));
+    return true;
+}
+
+bool PreludeSnapshot::string(const StringRef& ref, std::string_view& text) const {
+    if (ref.offset > header.stringsSize || ref.length > header.stringsSize - ref.offset) {
+        return false;
+    }
+    text = std::string_view(data + header.strings + ref.offset, ref.length);
+    return true;
+}
+
+bool PreludeSnapshot::token(size_t index, uint64_t section, uint32_t count, Token& token) const {
+    TokenRecord record;
+    std::string_view lexeme;
+    if (!read(section, count, index, record) || !string(record.lexeme, lexeme) ||
+        record.type > static_cast<uint8_t>(TokenType::END_OF_FILE)) {
+        return false;
+    }
+    token.type = static_cast<TokenType>(record.type);
+    token.lexeme.assign(lexeme.data(), lexeme.size());
+    token.line = record.line;
+    token.column = record.column;
+    token.offset = record.offset;
+    token.numericFlags = record.numericFlags;
+    token.flags = record.flags;
+    return true;
+}
+
+size_t PreludeSnapshot::getTokenCount() const {
+    return header.tokenCount;
+}
+
+std::pmr::vector<Token> PreludeSnapshot::getTokens(size_t first, size_t count,
+                                                   std::pmr::memory_resource* resource) const {
+    std::pmr::vector<Token> tokens(resource ? resource : std::pmr::get_default_resource());
+    Token token(TokenType::END_OF_FILE, "", 1, 1);
+    size_t end = first + std::min(count, getTokenCount() - std::min(first, getTokenCount()));
+    tokens.reserve(end - first + 1);
+    uint32_t endOffset = 0;
+    for (size_t i = first; i < end; i++) {
+        if (this->token(i, header.tokens, header.tokenCount, token)) {
+            endOffset = token.endOffset();
+            tokens.push_back(token);
+        }
+    }
+    const Token* last = tokens.empty() ? nullptr : &tokens.back();
+    tokens.emplace_back(TokenType::END_OF_FILE, "", last ? last->line : 1,
+                        last ? last->column + static_cast<uint32_t>(last->lexeme.size()) : 1,
+                        endOffset);
+    return tokens;
+}
+
+size_t PreludeSnapshot::getDeclarationCount() const {
+    return header.declarationCount;
+}
+
+bool PreludeSnapshot::getDeclaration(size_t index, Declaration& declaration) const {
+    DeclarationRecord record;
+    if (!read(header.declarations, header.declarationCount, index, record) ||
+        !string(record.name, declaration.name) ||
+        record.kind >= static_cast<uint32_t>(NodeKind::NUM_NODE_KINDS)) {
+        return false;
+    }
+    declaration.kind = static_cast<NodeKind>(record.kind);
+    declaration.firstToken = record.firstToken;
+    declaration.tokenCount = record.tokenCount;
+    return true;
+}
+
+bool PreludeSnapshot::findDeclaration(std::string_view name, Declaration& declaration) const {
+    const uint32_t mask = header.declarationBucketCount - 1;
+    uint32_t bucket = hashName(name) & mask;
+    for (uint32_t probe = 0; probe < header.declarationBucketCount; probe++) {
+        uint32_t entry = 0;
+        read(header.declarationBuckets, header.declarationBucketCount, bucket, entry);
+        if (entry == 0) {
+            return false;
+        }
+        if (getDeclaration(entry - 1, declaration) && declaration.name == name) {
+            return true;
+        }
+        bucket = (bucket + 1) & mask;
+    }
+    return false;
+}
+
+// Declarations of one name share a probe sequence, and were inserted in
+// prelude order, so they are found in that order.
+void PreludeSnapshot::findDeclarations(std::string_view name,
+                                       std::vector<Declaration>& declarations) const {
+    const uint32_t mask = header.declarationBucketCount - 1;
+    uint32_t bucket = hashName(name) & mask;
+    for (uint32_t probe = 0; probe < header.declarationBucketCount; probe++) {
+        uint32_t entry = 0;
+        read(header.declarationBuckets, header.declarationBucketCount, bucket, entry);
+        if (entry == 0) {
+            return;
+        }
+        Declaration declaration;
+        if (getDeclaration(entry - 1, declaration) && declaration.name == name) {
+            declarations.push_back(declaration);
+        }
+        bucket = (bucket + 1) & mask;
+    }
+}
+
+size_t PreludeSnapshot::getMacroCount() const {
+    return header.macroCount;
+}
+
+// Index + 1 of the macro named `name`, or 0.
+uint32_t PreludeSnapshot::findMacroIndex(std::string_view name) const {
+    const uint32_t mask = header.macroBucketCount - 1;
+    uint32_t bucket = hashName(name) & mask;
+    for (uint32_t probe = 0; probe < header.macroBucketCount; probe++) {
+        uint32_t entry = 0;
+        read(header.macroBuckets, header.macroBucketCount, bucket, entry);
+        if (entry == 0) {
+            return 0;
+        }
+        MacroRecord record;
+        std::string_view macroName;
+        if (read(header.macros, header.macroCount, entry - 1, record) &&
+            string(record.name, macroName) && macroName == name) {
+            return entry;
+        }
+        bucket = (bucket + 1) & mask;
+    }
+    return 0;
+}
+
+bool PreludeSnapshot::hasMacro(std::string_view name) const {
+    return findMacroIndex(name) != 0;
+}
+
+bool PreludeSnapshot::findMacro(std::string_view name, MacroDefinition& macro) const {
+    uint32_t entry = findMacroIndex(name);
+    MacroRecord record;
+    if (entry == 0 || !read(header.macros, header.macroCount, entry - 1, record)) {
+        return false;
+    }
+    macro.name = std::string(name);
+    macro.functionLike = record.flags & MACRO_FUNCTION_LIKE;
+    macro.variadic = record.flags & MACRO_VARIADIC;
+    macro.parameters.clear();
+    macro.body.clear();
+    for (uint32_t i = 0; i < record.parameterCount; i++) {
+        StringRef ref;
+        std::string_view parameter;
+        if (!read(header.parameters, header.parameterCount, size_t(record.firstParameter) + i,
+                  ref) ||
+            !string(ref, parameter)) {
+            return false;
+        }
+        macro.parameters.emplace_back(parameter);
+    }
+    Token token(TokenType::END_OF_FILE, "", 0, 0);
+    for (uint32_t i = 0; i < record.bodyTokenCount; i++) {
+        if (!this->token(size_t(record.firstBodyToken) + i, header.bodyTokens,
+                         header.bodyTokenCount, token)) {
+            return false;
+        }
+        macro.body.push_back(token);
+    }
+    return true;
+}
+
+bool PreludeSnapshot::findFile(std::string_view path, std::string_view& includeGuard,
+                               bool& once) const {
+    FileRecord record;
+    for (size_t i = 0; read(header.files, header.fileCount, i, record); i++) {
+        std::string_view filePath;
+        if (string(record.path, filePath) && filePath == path &&
+            string(record.includeGuard, includeGuard)) {
+            once = record.once != 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+// PreludeDeclarations
+
+struct PreludeDeclarations::Parsed {
+    std::pmr::vector<Token> tokens;
+    ast::NodeList<ast::Declaration> declarations;
+};
+
+PreludeDeclarations::PreludeDeclarations(std::shared_ptr<const PreludeSnapshot> snapshot)
+    : snapshot(std::move(snapshot)) {}
+
+PreludeDeclarations::~PreludeDeclarations() = default;
+
+const std::vector<ast::Declaration*>& PreludeDeclarations::find(std::string_view name) const {
+    static const std::vector<ast::Declaration*> none;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = names.find(name);
+    if (it != names.end()) {
+        return it->second;
+    }
+    std::vector<PreludeSnapshot::Declaration> records;
+    snapshot->findDeclarations(name, records);
+    if (records.empty()) {
+        return none;
+    }
+    std::vector<ast::Declaration*>& found = names[records[0].name];
+    for (const PreludeSnapshot::Declaration& record : records) {
+        std::unique_ptr<Parsed>& range = parsed[record.firstToken];
+        if (!range) {
+            range = std::make_unique<Parsed>();
+            range->tokens = snapshot->getTokens(record.firstToken, record.tokenCount);
+            DiagnosticEngine diagnostics(0);
+            Parser parser(range->tokens, &diagnostics);
+            parser.parseTopLevelDeclaration(range->declarations);
+        }
+        for (const auto& declaration : range->declarations) {
+            if (declaration->getName() == name &&
+                std::find(found.begin(), found.end(), declaration.get()) == found.end()) {
+                found.push_back(declaration.get());
+            }
+        }
+    }
+    return found;
+}
+
+size_t PreludeDeclarations::getParsedCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return parsed.size();
+}
+
+} // namespace msl_parser
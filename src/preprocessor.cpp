@@ -0,0 +1,1336 @@
+#include "msl_parser/preprocessor.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include "msl_parser/lexer.h"
+#include "msl_parser/numeric_literal.h"
+#include "msl_parser/prelude.h"
+#include "msl_parser/stats.h"
+
+namespace msl_parser {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Headers of the Metal standard library. The parser knows their types and
+// functions, so including them needs no file.
+constexpr const char* metalStandardHeaders[] = {
+    "metal_stdlib",   "metal_atomic",   "metal_common",   "metal_compute",
+    "metal_geometric", "metal_graphics", "metal_integer",  "metal_math",
+    "metal_matrix",   "metal_pack",     "metal_relational", "metal_texture",
+    "metal_types",    "simd/simd.h",
+};
+
+bool isMetalStandardHeader(const std::string& name) {
+    for (const char* header : metalStandardHeaders) {
+        if (name == header) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Identifiers and keywords; keywords may be macro names too.
+bool isIdentifierLike(const Token& token) {
+    if (token.lexeme.empty()) {
+        return false;
+    }
+    char c = token.lexeme[0];
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+bool isDirectiveStart(const Token& token) {
+    return token.type == TokenType::HASH && (token.flags & TOKEN_AT_LINE_START);
+}
+
+void relocate(Token& token, const Token& location) {
+    token.offset = location.offset;
+    token.line = location.line;
+    token.column = location.column;
+}
+
+// The macro of an include guard around the whole file: the first directive
+// is "#ifndef X", "#if !defined X" or "#if !defined(X)", and the #endif
+// closing it is the last thing in the file, with no #else or #elif at its
+// level. Empty when there is none.
+std::string findIncludeGuard(const std::pmr::vector<Token>& tokens) {
+    const size_t end = tokens.size() - 1; // END_OF_FILE
+    auto lineEnd = [&](size_t i) {
+        do {
+            i++;
+        } while (i < end && !(tokens[i].flags & TOKEN_AT_LINE_START));
+        return i;
+    };
+    if (end == 0 || !isDirectiveStart(tokens[0])) {
+        return "";
+    }
+    const size_t first = lineEnd(0);
+    const Token* operands = tokens.data() + 2;
+    const size_t count = first > 2 ? first - 2 : 0;
+    std::string_view opening = first > 1 ? std::string_view(tokens[1].lexeme) : "";
+    std::string guard;
+    if (opening == "ifndef" && count == 1 && isIdentifierLike(operands[0])) {
+        guard = std::string(operands[0].lexeme);
+    } else if (opening == "if" && count >= 3 && operands[0].type == TokenType::NOT &&
+               operands[1].lexeme == "defined") {
+        if (count == 3 && isIdentifierLike(operands[2])) {
+            guard = std::string(operands[2].lexeme);
+        } else if (count == 5 && operands[2].type == TokenType::LEFT_PAREN &&
+                   isIdentifierLike(operands[3]) && operands[4].type == TokenType::RIGHT_PAREN) {
+            guard = std::string(operands[3].lexeme);
+        }
+    }
+    if (guard.empty()) {
+        return "";
+    }
+
+    int depth = 1;
+    for (size_t i = first; i < end; i = lineEnd(i)) {
+        if (depth == 0) {
+            return ""; // something after the closing #endif
+        }
+        if (!isDirectiveStart(tokens[i]) || i + 1 == end ||
+            (tokens[i + 1].flags & TOKEN_AT_LINE_START)) {
+            continue;
+        }
+        std::string_view name(tokens[i + 1].lexeme);
+        if (name == "if" || name == "ifdef" || name == "ifndef") {
+            depth++;
+        } else if (name == "endif") {
+            depth--;
+        } else if (depth == 1 && (name == "else" || name == "elif")) {
+            return "";
+        }
+    }
+    return depth == 0 ? guard : "";
+}
+
+std::string canonicalPath(const std::string& path) {
+    std::error_code error;
+    fs::path canonical = fs::weakly_canonical(path, error);
+    return error ? path : canonical.string();
+}
+
+// Evaluates the expression of an #if or #elif after macro expansion, with
+// C's operators and precedence over 64-bit integers. Identifiers left over
+// after expansion are 0, except `true`.
+class ConditionEvaluator {
+public:
+    explicit ConditionEvaluator(const std::vector<Token>& tokens) : tokens(tokens) {}
+
+    // Returns false and sets `errorIndex` and `errorId` when the expression
+    // is malformed.
+    bool evaluate(int64_t& value) {
+        value = conditional();
+        if (!failed && position < tokens.size()) {
+            fail(DiagID::INVALID_CONDITION);
+        }
+        return !failed;
+    }
+
+    DiagID errorId = DiagID::INVALID_CONDITION;
+    size_t errorIndex = 0;
+
+private:
+    const std::vector<Token>& tokens;
+    size_t position = 0;
+    int unevaluated = 0;  // > 0 inside the skipped operand of &&, || and ?:
+    int depth = 0;        // recursive conditional() and unary() calls
+    bool failed = false;
+
+    // Counts a level of recursion for as long as it lives
+    class Nested {
+    public:
+        explicit Nested(int& depth) : depth(depth) { depth++; }
+        ~Nested() { depth--; }
+
+    private:
+        int& depth;
+    };
+
+    bool tooDeep() {
+        if (depth <= Preprocessor::MAX_CONDITION_DEPTH) {
+            return false;
+        }
+        fail(DiagID::CONDITION_TOO_DEEP);
+        return true;
+    }
+
+    bool match(TokenType type) {
+        if (!failed && position < tokens.size() && tokens[position].type == type) {
+            position++;
+            return true;
+        }
+        return false;
+    }
+
+    int64_t fail(DiagID id) {
+        if (!failed) {
+            failed = true;
+            errorId = id;
+            errorIndex = position;
+        }
+        return 0;
+    }
+
+    static int precedence(TokenType type) {
+        switch (type) {
+            case TokenType::OR: return 1;
+            case TokenType::AND: return 2;
+            case TokenType::BITWISE_OR: return 3;
+            case TokenType::BITWISE_XOR: return 4;
+            case TokenType::BITWISE_AND: return 5;
+            case TokenType::EQUAL:
+            case TokenType::NOT_EQUAL: return 6;
+            case TokenType::LESS_THAN:
+            case TokenType::GREATER_THAN:
+            case TokenType::LESS_EQUAL:
+            case TokenType::GREATER_EQUAL: return 7;
+            case TokenType::LEFT_SHIFT:
+            case TokenType::RIGHT_SHIFT: return 8;
+            case TokenType::PLUS:
+            case TokenType::MINUS: return 9;
+            case TokenType::MULTIPLY:
+            case TokenType::DIVIDE:
+            case TokenType::MODULO: return 10;
+            default: return 0;
+        }
+    }
+
+    int64_t conditional() {
+        Nested nested(depth);
+        if (tooDeep()) {
+            return 0;
+        }
+        int64_t condition = binary(1);
+        if (!match(TokenType::QUESTION)) {
+            return condition;
+        }
+        unevaluated += condition ? 0 : 1;
+        int64_t whenTrue = conditional();
+        unevaluated -= condition ? 0 : 1;
+        if (!match(TokenType::COLON)) {
+            return fail(DiagID::INVALID_CONDITION);
+        }
+        unevaluated += condition ? 1 : 0;
+        int64_t whenFalse = conditional();
+        unevaluated -= condition ? 1 : 0;
+        return condition ? whenTrue : whenFalse;
+    }
+
+    int64_t binary(int minPrecedence) {
+        int64_t left = unary();
+        while (!failed && position < tokens.size()) {
+            TokenType op = tokens[position].type;
+            int opPrecedence = precedence(op);
+            if (opPrecedence < minPrecedence || opPrecedence == 0) {
+                break;
+            }
+            position++;
+            // The right operand of && and || is parsed but not evaluated
+            // when the left one decides the result.
+            bool skip = (op == TokenType::AND && !left) || (op == TokenType::OR && left);
+            unevaluated += skip ? 1 : 0;
+            int64_t right = binary(opPrecedence + 1);
+            unevaluated -= skip ? 1 : 0;
+            left = apply(op, left, right);
+        }
+        return left;
+    }
+
+    int64_t apply(TokenType op, int64_t left, int64_t right) {
+        // Wrapping arithmetic, as unsigned
+        uint64_t l = static_cast<uint64_t>(left);
+        uint64_t r = static_cast<uint64_t>(right);
+        switch (op) {
+            case TokenType::OR: return left || right;
+            case TokenType::AND: return left && right;
+            case TokenType::BITWISE_OR: return static_cast<int64_t>(l | r);
+            case TokenType::BITWISE_XOR: return static_cast<int64_t>(l ^ r);
+            case TokenType::BITWISE_AND: return static_cast<int64_t>(l & r);
+            case TokenType::EQUAL: return left == right;
+            case TokenType::NOT_EQUAL: return left != right;
+            case TokenType::LESS_THAN: return left < right;
+            case TokenType::GREATER_THAN: return left > right;
+            case TokenType::LESS_EQUAL: return left <= right;
+            case TokenType::GREATER_EQUAL: return left >= right;
+            case TokenType::LEFT_SHIFT: return static_cast<int64_t>(l << (r & 63));
+            case TokenType::RIGHT_SHIFT: return left >> (r & 63);
+            case TokenType::PLUS: return static_cast<int64_t>(l + r);
+            case TokenType::MINUS: return static_cast<int64_t>(l - r);
+            case TokenType::MULTIPLY: return static_cast<int64_t>(l * r);
+            case TokenType::DIVIDE:
+            case TokenType::MODULO:
+                if (right == 0) {
+                    return unevaluated > 0 ? 0 : fail(DiagID::DIVISION_BY_ZERO_IN_CONDITION);
+                }
+                if (right == -1) {
+                    return op == TokenType::DIVIDE ? static_cast<int64_t>(0 - l) : 0;
+                }
+                return op == TokenType::DIVIDE ? left / right : left % right;
+            default: return 0;
+        }
+    }
+
+    int64_t unary() {
+        Nested nested(depth);
+        if (failed || position >= tokens.size()) {
+            return fail(DiagID::INVALID_CONDITION);
+        }
+        if (tooDeep()) {
+            return 0;
+        }
+        const Token& token = tokens[position];
+        switch (token.type) {
+            case TokenType::NOT:
+                position++;
+                return !unary();
+            case TokenType::BITWISE_NOT:
+                position++;
+                return ~unary();
+            case TokenType::MINUS:
+                position++;
+                return static_cast<int64_t>(0 - static_cast<uint64_t>(unary()));
+            case TokenType::PLUS:
+                position++;
+                return unary();
+            case TokenType::LEFT_PAREN: {
+                position++;
+                int64_t value = conditional();
+                if (!match(TokenType::RIGHT_PAREN)) {
+                    return fail(DiagID::INVALID_CONDITION);
+                }
+                return value;
+            }
+            case TokenType::INTEGER_LITERAL: {
+                uint64_t value = 0;
+                if (decodeIntegerLiteral(token, value) != LiteralStatus::OK) {
+                    return fail(DiagID::INVALID_CONDITION);
+                }
+                position++;
+                return static_cast<int64_t>(value);
+            }
+            default:
+                if (isIdentifierLike(token)) {
+                    position++;
+                    return token.lexeme == "true";
+                }
+                return fail(DiagID::INVALID_CONDITION);
+        }
+    }
+};
+
+} // namespace
+
+// LexedFile
+
+std::shared_ptr<LexedFile> LexedFile::lex(std::string path, std::string source) {
+    auto file = std::make_shared<LexedFile>();
+    file->path = std::move(path);
+    file->source = std::move(source);
+    file->size = file->source.size();
+    // Lexed without an error limit; the preprocessor replays the
+    // diagnostics of the parts it does not skip.
+    DiagnosticEngine engine(0);
+    file->tokens = Lexer(file->source, &engine).scanTokens();
+    file->diagnostics = engine.getDiagnostics();
+    file->includeGuard = findIncludeGuard(file->tokens);
+    return file;
+}
+
+// HeaderCache
+
+HeaderCache& HeaderCache::processCache() {
+    static HeaderCache cache;
+    return cache;
+}
+
+std::shared_ptr<const LexedFile> HeaderCache::get(const std::string& path) {
+    std::error_code error;
+    uint64_t size = fs::file_size(path, error);
+    if (error) {
+        return nullptr;
+    }
+    int64_t modificationTime = fs::last_write_time(path, error).time_since_epoch().count();
+    if (error) {
+        return nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = files.find(path);
+        if (it != files.end() && it->second->size == size &&
+            it->second->modificationTime == modificationTime) {
+            return it->second;
+        }
+    }
+
+    // Read and lex outside the lock, so other threads can use the cache
+    std::string source;
+    if (loader) {
+        if (!loader(path, size, modificationTime, source)) {
+            return nullptr;
+        }
+    } else {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            return nullptr;
+        }
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        source = buffer.str();
+    }
+    std::shared_ptr<LexedFile> file = LexedFile::lex(path, std::move(source));
+    file->size = size;
+    file->modificationTime = modificationTime;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    lexCount++;
+    std::shared_ptr<const LexedFile>& entry = files[path];
+    // Another thread may have lexed the same version meanwhile
+    if (!entry || entry->size != size || entry->modificationTime != modificationTime) {
+        entry = std::move(file);
+    }
+    return entry;
+}
+
+void HeaderCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    files.clear();
+}
+
+size_t HeaderCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return files.size();
+}
+
+uint64_t HeaderCache::getLexCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lexCount;
+}
+
+// Preprocessor
+
+struct Preprocessor::Macro : MacroDefinition {
+    bool undefined = false;  // #undef'd, hiding the prelude's definition
+
+    int parameterIndex(const Token& token) const {
+        if (!functionLike || !isIdentifierLike(token)) {
+            return -1;
+        }
+        for (size_t i = 0; i < parameters.size(); i++) {
+            if (std::string_view(token.lexeme) == parameters[i]) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    bool sameDefinition(const Macro& other) const {
+        if (functionLike != other.functionLike || variadic != other.variadic ||
+            parameters != other.parameters || body.size() != other.body.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < body.size(); i++) {
+            if (body[i].type != other.body[i].type || body[i].lexeme != other.body[i].lexeme) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+struct Preprocessor::Conditional {
+    uint32_t offset;    // of the opening directive
+    bool parentActive;  // the enclosing block is not skipped
+    bool active;        // the current branch is not skipped
+    bool taken;         // some branch has been taken
+    bool seenElse;
+};
+
+// Expands macros in a token stream. Tokens come from a stack of contexts,
+// one per macro expansion in progress, above the tokens of the file being
+// read. A macro is disabled while its expansion is on the stack, and a
+// name read while its macro is disabled is marked TOKEN_NO_EXPAND for good.
+// A barrier context ends the stream when it runs out, which is how macro
+// arguments and #if expressions are expanded on their own.
+class Preprocessor::Expander {
+public:
+    // The file being read: tokens in [cursor, end) with offsets relative to
+    // `base`. Reading stops before a directive.
+    const Token* cursor = nullptr;
+    const Token* end = nullptr;
+    uint32_t base = 0;
+
+    explicit Expander(Preprocessor& preprocessor) : preprocessor(preprocessor) {}
+
+    // The next fully expanded token; false at the end of the stream.
+    bool next(Token& token) {
+        while (!preprocessor.stopped && fetch(token)) {
+            if (token.flags & TOKEN_NO_EXPAND) {
+                return true;
+            }
+            const Macro* macro = preprocessor.findMacro(token);
+            if (!macro) {
+                return true;
+            }
+            if (isDisabled(macro)) {
+                token.flags |= TOKEN_NO_EXPAND;
+                return true;
+            }
+            if (macro->functionLike && !nextIsLeftParen()) {
+                return true;
+            }
+            Arguments arguments;
+            if (macro->functionLike && !collectArguments(*macro, token, arguments)) {
+                continue;
+            }
+            std::vector<Token> expansion = substitute(*macro, token, arguments.spans);
+            preprocessor.expandedTokens += expansion.size();
+            if (preprocessor.expandedTokens > MAX_EXPANDED_TOKENS) {
+                preprocessor.stop(DiagID::MACRO_EXPANSION_TOO_LARGE, token.offset);
+                return false;
+            }
+            push(std::move(expansion), macro);
+        }
+        return false;
+    }
+
+    // Expands `tokens` on their own.
+    std::vector<Token> expand(std::vector<Token> tokens) {
+        push(std::move(tokens), nullptr);
+        return drain();
+    }
+
+private:
+    // Tokens in [first, last) of storage that outlives the span
+    struct TokenSpan {
+        const Token* first;
+        const Token* last;
+
+        const Token* begin() const { return first; }
+        const Token* end() const { return last; }
+        bool empty() const { return first == last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+        const Token& operator[](size_t index) const { return first[index]; }
+    };
+
+    // The arguments of a macro call: spans of the context the call was read
+    // from, or of `copied` when the call was read from the file or ran past
+    // the end of its context
+    struct Arguments {
+        std::vector<TokenSpan> spans;
+        std::vector<Token> copied;
+    };
+
+    // Reads [position, end), of `tokens` or of storage further down the
+    // stack. Moving a context keeps its tokens where they are.
+    struct Context {
+        std::vector<Token> tokens;
+        const Token* position;
+        const Token* end;
+        const Macro* macro;  // nullptr for a barrier
+    };
+
+    Preprocessor& preprocessor;
+    std::vector<Context> contexts;
+    int argumentDepth = 0;  // arguments being expanded inside one another
+
+    void push(std::vector<Token> tokens, const Macro* macro) {
+        const Token* begin = tokens.data();
+        const Token* end = begin + tokens.size();
+        contexts.push_back({std::move(tokens), begin, end, macro});
+    }
+
+    // Everything up to the barrier on top of the stack
+    std::vector<Token> drain() {
+        std::vector<Token> result;
+        Token token(TokenType::END_OF_FILE, "", 0, 0);
+        while (next(token)) {
+            result.push_back(std::move(token));
+        }
+        // Everything above the barrier has run out and been popped
+        contexts.pop_back();
+        return result;
+    }
+
+    // Expands a macro argument on its own, in place.
+    std::vector<Token> expandArgument(TokenSpan argument, const Token& name) {
+        if (argumentDepth >= MAX_MACRO_ARGUMENT_DEPTH) {
+            preprocessor.stop(DiagID::MACRO_ARGUMENTS_TOO_DEEP, name.offset);
+            return {};
+        }
+        argumentDepth++;
+        contexts.push_back({{}, argument.begin(), argument.end(), nullptr});
+        std::vector<Token> result = drain();
+        argumentDepth--;
+        return result;
+    }
+
+    bool fetch(Token& token) {
+        while (!contexts.empty()) {
+            Context& context = contexts.back();
+            if (context.position != context.end) {
+                token = *context.position++;
+                return true;
+            }
+            if (!context.macro) {
+                return false;
+            }
+            contexts.pop_back();
+        }
+        if (cursor == end || isDirectiveStart(*cursor)) {
+            return false;
+        }
+        token = *cursor++;
+        token.offset += base;
+        return true;
+    }
+
+    bool nextIsLeftParen() {
+        while (!contexts.empty()) {
+            const Context& context = contexts.back();
+            if (context.position != context.end) {
+                return context.position->type == TokenType::LEFT_PAREN;
+            }
+            if (!context.macro) {
+                return false;
+            }
+            contexts.pop_back();
+        }
+        return cursor != end && cursor->type == TokenType::LEFT_PAREN;
+    }
+
+    bool isDisabled(const Macro* macro) const {
+        for (const Context& context : contexts) {
+            if (context.macro == macro) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The ')' closing the '(' before `begin`, or nullptr
+    static const Token* findClosingParen(const Token* begin, const Token* end) {
+        int depth = 0;
+        for (const Token* token = begin; token != end; token++) {
+            if (token->type == TokenType::LEFT_PAREN) {
+                depth++;
+            } else if (token->type == TokenType::RIGHT_PAREN && depth-- == 0) {
+                return token;
+            }
+        }
+        return nullptr;
+    }
+
+    bool collectArguments(const Macro& macro, const Token& name, Arguments& arguments) {
+        // The tokens between the parentheses, read in place when the call
+        // lies within the top context
+        const Token* first = nullptr;
+        const Token* last = nullptr;
+        if (!contexts.empty()) {
+            Context& context = contexts.back();
+            last = findClosingParen(context.position + 1, context.end);
+            if (last) {
+                first = context.position + 1;
+                context.position = last + 1;
+            }
+        }
+        if (!last) {
+            Token token(TokenType::END_OF_FILE, "", 0, 0);
+            fetch(token); // consume (
+            int depth = 0;
+            while (true) {
+                if (!fetch(token)) {
+                    preprocessor.report(DiagID::UNTERMINATED_MACRO_CALL, name.offset);
+                    return false;
+                }
+                if (token.type == TokenType::LEFT_PAREN) {
+                    depth++;
+                } else if (token.type == TokenType::RIGHT_PAREN && depth-- == 0) {
+                    break;
+                }
+                arguments.copied.push_back(std::move(token));
+            }
+            first = arguments.copied.data();
+            last = first + arguments.copied.size();
+        }
+
+        const size_t parameterCount = macro.parameters.size();
+        std::vector<TokenSpan>& spans = arguments.spans;
+        const Token* start = first;
+        int depth = 0;
+        for (const Token* token = first; token != last; token++) {
+            if (token->type == TokenType::LEFT_PAREN) {
+                depth++;
+            } else if (token->type == TokenType::RIGHT_PAREN) {
+                depth--;
+            } else if (token->type == TokenType::COMMA && depth == 0 &&
+                       !(macro.variadic && spans.size() + 1 == parameterCount)) {
+                spans.push_back({start, token});
+                start = token + 1;
+            }
+        }
+        spans.push_back({start, last});
+
+        // "F()" passes no arguments to a macro without parameters, and an
+        // empty __VA_ARGS__ may be left out.
+        if (parameterCount == 0 && spans.size() == 1 && spans[0].empty()) {
+            spans.clear();
+        }
+        if (macro.variadic && spans.size() + 1 == parameterCount) {
+            spans.push_back({last, last});
+        }
+        if (spans.size() != parameterCount) {
+            Diagnostic diagnostic;
+            diagnostic.id = DiagID::MACRO_ARGUMENT_COUNT;
+            diagnostic.argCount = 2;
+            diagnostic.argKinds[0] = DiagArgKind::INTEGER;
+            diagnostic.argKinds[1] = DiagArgKind::INTEGER;
+            diagnostic.args[0] = static_cast<uint32_t>(parameterCount);
+            diagnostic.args[1] = static_cast<uint32_t>(spans.size());
+            diagnostic.offset = name.offset;
+            preprocessor.report(diagnostic);
+            return false;
+        }
+        return true;
+    }
+
+    // The replacement list with parameters replaced, '#' and '##' applied,
+    // and located at the macro name. Each argument is expanded at most once.
+    std::vector<Token> substitute(const Macro& macro, const Token& name,
+                                  const std::vector<TokenSpan>& arguments) {
+        const std::vector<Token>& body = macro.body;
+        std::vector<std::vector<Token>> expanded(arguments.size());
+        std::vector<bool> isExpanded(arguments.size(), false);
+        std::vector<Token> result;
+        bool previousEmpty = true;  // nothing to paste onto
+
+        for (size_t i = 0; i < body.size(); i++) {
+            const Token& token = body[i];
+            if (token.type == TokenType::HASH && macro.functionLike) {
+                // Checked when the macro was defined: a parameter follows
+                result.push_back(stringize(arguments[macro.parameterIndex(body[++i])], name));
+                previousEmpty = false;
+                continue;
+            }
+            if (token.type == TokenType::HASH_HASH) {
+                const Token& operand = body[++i];
+                int parameter = macro.parameterIndex(operand);
+                Token located = operand;
+                relocate(located, name);
+                TokenSpan right = parameter >= 0 ? arguments[parameter]
+                                                 : TokenSpan{&located, &located + 1};
+                if (!right.empty()) {
+                    size_t first = 0;
+                    if (!previousEmpty) {
+                        first = paste(result.back(), right[0]) ? 1 : 0;
+                    }
+                    result.insert(result.end(), right.begin() + first, right.end());
+                    previousEmpty = false;
+                }
+                continue;
+            }
+            int parameter = macro.parameterIndex(token);
+            if (parameter >= 0) {
+                // Arguments are expanded first, unless they are pasted
+                bool pasted = i + 1 < body.size() && body[i + 1].type == TokenType::HASH_HASH;
+                if (pasted) {
+                    const TokenSpan& argument = arguments[parameter];
+                    result.insert(result.end(), argument.begin(), argument.end());
+                    previousEmpty = argument.empty();
+                    continue;
+                }
+                if (!isExpanded[parameter]) {
+                    expanded[parameter] = expandArgument(arguments[parameter], name);
+                    isExpanded[parameter] = true;
+                }
+                result.insert(result.end(), expanded[parameter].begin(),
+                              expanded[parameter].end());
+                previousEmpty = expanded[parameter].empty();
+                continue;
+            }
+            result.push_back(token);
+            relocate(result.back(), name);
+            previousEmpty = false;
+        }
+        return result;
+    }
+
+    static Token stringize(TokenSpan argument, const Token& location) {
+        std::string text = "\"";
+        for (size_t i = 0; i < argument.size(); i++) {
+            const Token& token = argument[i];
+            if (i > 0 && token.offset > argument[i - 1].endOffset()) {
+                text += ' ';
+            }
+            for (char c : token.lexeme) {
+                if (token.type == TokenType::STRING_LITERAL && (c == '"' || c == '\\')) {
+                    text += '\\';
+                }
+                text += c;
+            }
+        }
+        text += '"';
+        Token result(TokenType::STRING_LITERAL, text, location.line, location.column,
+                     location.offset);
+        return result;
+    }
+
+    // Joins `right` onto `left`. Returns false, leaving both alone, when the
+    // spellings do not form a single token.
+    bool paste(Token& left, const Token& right) {
+        std::string spelling = std::string(left.lexeme) + std::string(right.lexeme);
+        DiagnosticEngine engine(0);
+        std::pmr::vector<Token> tokens = Lexer(spelling, &engine).scanTokens();
+        if (tokens.size() != 2 || engine.hasErrors()) {
+            preprocessor.report(DiagID::INVALID_PASTE, left.offset);
+            return false;
+        }
+        left.type = tokens[0].type;
+        left.numericFlags = tokens[0].numericFlags;
+        left.lexeme = spelling;
+        left.flags &= ~TOKEN_NO_EXPAND;
+        return true;
+    }
+};
+
+Preprocessor::Preprocessor(DiagnosticEngine* diagnostics, HeaderCache* cache)
+    : diagnostics(diagnostics), cache(cache ? cache : &HeaderCache::processCache()) {}
+
+Preprocessor::~Preprocessor() = default;
+
+void Preprocessor::addSearchPath(const std::string& directory) {
+    searchPaths.push_back(directory);
+}
+
+void Preprocessor::define(const std::string& name, const std::string& definition) {
+    std::string text = "#define " + name + " " + definition;
+    std::pmr::vector<Token> tokens = Lexer(text).scanTokens();
+    std::vector<Token> line(tokens.begin(), tokens.end() - 1);
+    // Not from any file; problems are reported at the start of the main file
+    for (Token& token : line) {
+        token.offset = 0;
+    }
+    defineMacro(line);
+}
+
+void Preprocessor::setPrelude(std::shared_ptr<const PreludeSnapshot> snapshot) {
+    prelude = std::move(snapshot);
+}
+
+void Preprocessor::undefine(const std::string& name) {
+    removeMacro(name);
+}
+
+bool Preprocessor::isDefined(std::string_view name) const {
+    return findMacro(name) != nullptr;
+}
+
+std::pmr::vector<Token> Preprocessor::preprocess(const std::string& source,
+                                                 const std::string& fileName,
+                                                 std::pmr::memory_resource* resource) {
+    MSL_PARSER_STATS(ScopedPhase phase("preprocess"));
+    files.clear();
+    fileIndices.clear();
+    resolvedIncludes.clear();
+    includeGuards.clear();
+    onceFiles.clear();
+    skippedIncludes = 0;
+    includeDepth = 0;
+    stopped = diagnostics && diagnostics->errorLimitReached();
+    expandedTokens = 0;
+
+    std::shared_ptr<const LexedFile> main = LexedFile::lex(fileName, source);
+    files.push_back({main, 0});
+    nextBase = main->size + 1;
+    if (!fileName.empty()) {
+        fileIndices[canonicalPath(fileName)] = 0;
+    }
+
+    std::pmr::vector<Token> output(resource ? resource : std::pmr::get_default_resource());
+    output.reserve(main->tokens.size());
+    processFile(0, output);
+    output.push_back(main->tokens.back());
+    return output;
+}
+
+const Preprocessor::SourceFile* Preprocessor::findFile(uint32_t offset) const {
+    auto it = std::upper_bound(files.begin(), files.end(), offset,
+                               [](uint32_t value, const SourceFile& file) {
+                                   return value < file.base;
+                               });
+    if (it == files.begin()) {
+        return nullptr;
+    }
+    --it;
+    return offset - it->base <= it->file->size ? &*it : nullptr;
+}
+
+void Preprocessor::printDiagnostics(std::ostream& out, const DiagnosticEngine& engine) const {
+    std::vector<std::unique_ptr<DiagnosticPrinter>> printers(files.size());
+    for (const Diagnostic& diagnostic : engine.getDiagnostics()) {
+        const SourceFile* file = findFile(diagnostic.offset);
+        if (!file) {
+            file = &files.front();
+        }
+        size_t index = static_cast<size_t>(file - files.data());
+        if (!printers[index]) {
+            printers[index] =
+                std::make_unique<DiagnosticPrinter>(file->file->source, file->file->path);
+        }
+        Diagnostic local = diagnostic;
+        local.offset = diagnostic.offset >= file->base ? diagnostic.offset - file->base : 0;
+        out << printers[index]->render(local);
+    }
+}
+
+void Preprocessor::processFile(size_t fileIndex, std::pmr::vector<Token>& output) {
+    // `files` may grow while this file includes others
+    const std::shared_ptr<const LexedFile> file = files[fileIndex].file;
+    const uint32_t base = files[fileIndex].base;
+    const std::vector<Diagnostic>& lexerDiagnostics = file->diagnostics;
+    size_t nextDiagnostic = 0;
+    std::vector<Conditional> conditionals;
+
+    Expander expander(*this);
+    expander.cursor = file->tokens.data();
+    expander.end = file->tokens.data() + file->tokens.size() - 1; // before END_OF_FILE
+    expander.base = base;
+    const Token*& cursor = expander.cursor;
+
+    // Lexer diagnostics before `offset` are reported, unless they are in a
+    // skipped block
+    auto replayDiagnostics = [&](uint32_t offset, bool active) {
+        for (; nextDiagnostic < lexerDiagnostics.size() &&
+               lexerDiagnostics[nextDiagnostic].offset < offset;
+             nextDiagnostic++) {
+            if (active) {
+                Diagnostic diagnostic = lexerDiagnostics[nextDiagnostic];
+                diagnostic.offset += base;
+                report(diagnostic);
+            }
+        }
+    };
+
+    while (!stopped && cursor != expander.end) {
+        bool active = conditionals.empty() || conditionals.back().active;
+        if (isDirectiveStart(*cursor)) {
+            std::vector<Token> line;
+            do {
+                line.push_back(*cursor++);
+                line.back().offset += base;
+            } while (cursor != expander.end && !(cursor->flags & TOKEN_AT_LINE_START));
+            replayDiagnostics(cursor->offset, active);
+            directive(fileIndex, line, conditionals, output);
+            continue;
+        }
+        if (!active) {
+            while (cursor != expander.end && !isDirectiveStart(*cursor)) {
+                cursor++;
+            }
+            replayDiagnostics(cursor->offset, false);
+            continue;
+        }
+        Token token(TokenType::END_OF_FILE, "", 0, 0);
+        while (expander.next(token)) {
+            output.push_back(std::move(token));
+        }
+        replayDiagnostics(cursor->offset, true);
+    }
+
+    if (!stopped && !conditionals.empty()) {
+        report(DiagID::UNTERMINATED_CONDITIONAL, conditionals.back().offset);
+    }
+    replayDiagnostics(static_cast<uint32_t>(file->size + 1), !stopped);
+}
+
+void Preprocessor::directive(size_t fileIndex, const std::vector<Token>& line,
+                             std::vector<Conditional>& conditionals,
+                             std::pmr::vector<Token>& output) {
+    if (line.size() == 1) {
+        return; // null directive
+    }
+    const std::string_view name(line[1].lexeme);
+    const bool active = conditionals.empty() || conditionals.back().active;
+
+    if (name == "if" || name == "ifdef" || name == "ifndef") {
+        Conditional conditional{line[0].offset, active, false, false, false};
+        if (active) {
+            bool value = false;
+            if (name == "if") {
+                value = evaluateCondition(line);
+            } else if (line.size() < 3 || !isIdentifierLike(line[2])) {
+                report(DiagID::EXPECTED_MACRO_NAME,
+                       line.size() < 3 ? line[1].endOffset() : line[2].offset);
+            } else {
+                value = isDefined(std::string_view(line[2].lexeme)) == (name == "ifdef");
+                extraTokens(line, 3);
+            }
+            conditional.active = value;
+            conditional.taken = value;
+        }
+        conditionals.push_back(conditional);
+        return;
+    }
+    if (name == "elif" || name == "else" || name == "endif") {
+        if (conditionals.empty()) {
+            report(DiagID::UNMATCHED_CONDITIONAL, line[0].offset);
+            return;
+        }
+        Conditional& conditional = conditionals.back();
+        if (name == "endif") {
+            if (conditional.parentActive) {
+                extraTokens(line, 2);
+            }
+            conditionals.pop_back();
+            return;
+        }
+        if (conditional.seenElse) {
+            report(DiagID::ELSE_AFTER_ELSE, line[0].offset);
+        }
+        if (name == "else") {
+            conditional.seenElse = true;
+            if (conditional.parentActive) {
+                extraTokens(line, 2);
+            }
+            conditional.active = conditional.parentActive && !conditional.taken;
+        } else {
+            // The condition is only evaluated when no earlier branch was taken
+            conditional.active = conditional.parentActive && !conditional.taken &&
+                                 evaluateCondition(line);
+        }
+        conditional.taken = conditional.taken || conditional.active;
+        return;
+    }
+    if (!active) {
+        return; // anything goes in skipped blocks
+    }
+
+    if (name == "include") {
+        include(fileIndex, line, output);
+    } else if (name == "define") {
+        defineMacro(line);
+    } else if (name == "undef") {
+        if (line.size() < 3 || !isIdentifierLike(line[2])) {
+            report(DiagID::EXPECTED_MACRO_NAME,
+                   line.size() < 3 ? line[1].endOffset() : line[2].offset);
+            return;
+        }
+        removeMacro(std::string_view(line[2].lexeme));
+        extraTokens(line, 3);
+    } else if (name == "error") {
+        report(DiagID::ERROR_DIRECTIVE, line[0].offset);
+    } else if (name == "warning") {
+        report(DiagID::WARNING_DIRECTIVE, line[0].offset);
+    } else if (name == "pragma") {
+        if (line.size() > 2 && line[2].lexeme == "once") {
+            onceFiles.insert(files[fileIndex].file->path);
+        }
+    } else if (name == "line") {
+        // Accepted and ignored
+    } else {
+        report(DiagID::INVALID_DIRECTIVE, line[1].offset);
+    }
+}
+
+void Preprocessor::include(size_t fileIndex, const std::vector<Token>& line,
+                           std::pmr::vector<Token>& output) {
+    std::vector<Token> operand(line.begin() + 2, line.end());
+    // A computed include: the operand is expanded first
+    if (!operand.empty() && operand[0].type != TokenType::STRING_LITERAL &&
+        operand[0].type != TokenType::LESS_THAN) {
+        operand = Expander(*this).expand(std::move(operand));
+    }
+
+    std::string name;
+    bool quoted = false;
+    size_t used = 0;
+    if (!operand.empty() && operand[0].type == TokenType::STRING_LITERAL &&
+        operand[0].lexeme.size() >= 2) {
+        name = std::string(operand[0].lexeme.substr(1, operand[0].lexeme.size() - 2));
+        quoted = true;
+        used = 1;
+    } else if (!operand.empty() && operand[0].type == TokenType::LESS_THAN) {
+        for (used = 1; used < operand.size() && operand[used].type != TokenType::GREATER_THAN;
+             used++) {
+            name += operand[used].lexeme;
+        }
+        used++;
+    }
+    if (name.empty() || used > operand.size()) {
+        report(DiagID::EXPECTED_INCLUDE_NAME,
+               operand.empty() ? line[1].endOffset() : operand[0].offset);
+        return;
+    }
+    if (used < operand.size()) {
+        report(DiagID::EXTRA_TOKENS_AFTER_DIRECTIVE, operand[used].offset);
+    }
+
+    if (includeDepth >= MAX_INCLUDE_DEPTH) {
+        report(DiagID::INCLUDE_TOO_DEEP, line[0].offset);
+        return;
+    }
+    // Quoted includes resolve relative to the including file
+    const std::string& includer = files[fileIndex].file->path;
+    std::string key = (quoted ? includer + '"' : std::string("<")) + name;
+    auto resolved = resolvedIncludes.find(key);
+    if (resolved == resolvedIncludes.end()) {
+        resolved = resolvedIncludes.emplace(key, findInclude(name, quoted, includer)).first;
+    }
+    const std::string& path = resolved->second;
+    if (!path.empty() && isIncluded(path)) {
+        skippedIncludes++;
+        return;
+    }
+    std::shared_ptr<const LexedFile> file = path.empty() ? nullptr : cache->get(path);
+    if (!file) {
+        if (!isMetalStandardHeader(name)) {
+            report(DiagID::INCLUDE_NOT_FOUND, operand[0].offset);
+        }
+        return;
+    }
+    if (!file->includeGuard.empty()) {
+        includeGuards[path] = file->includeGuard;
+    }
+    size_t index = addFile(std::move(file));
+    includeDepth++;
+    processFile(index, output);
+    includeDepth--;
+}
+
+void Preprocessor::defineMacro(const std::vector<Token>& line) {
+    if (line.size() < 3 || !isIdentifierLike(line[2]) || line[2].lexeme == "defined") {
+        report(DiagID::EXPECTED_MACRO_NAME,
+               line.size() < 3 ? line[1].endOffset() : line[2].offset);
+        return;
+    }
+    auto macro = std::make_unique<Macro>();
+    macro->name = std::string(line[2].lexeme);
+    size_t i = 3;
+
+    // Function-like when '(' follows the name without a space
+    if (i < line.size() && line[i].type == TokenType::LEFT_PAREN &&
+        line[i].offset == line[2].endOffset()) {
+        macro->functionLike = true;
+        i++;
+        bool expectParameter = true;
+        while (true) {
+            if (i >= line.size()) {
+                report(DiagID::EXPECTED_MACRO_PARAMETER, line.back().endOffset());
+                return;
+            }
+            const Token& token = line[i++];
+            if (token.type == TokenType::RIGHT_PAREN &&
+                (!expectParameter || macro->parameters.empty())) {
+                break;
+            }
+            if (expectParameter && isIdentifierLike(token) && !macro->variadic) {
+                macro->parameters.emplace_back(token.lexeme);
+                expectParameter = false;
+            } else if (expectParameter && token.type == TokenType::DOT && i + 1 < line.size() &&
+                       line[i].type == TokenType::DOT && line[i + 1].type == TokenType::DOT) {
+                macro->parameters.emplace_back("__VA_ARGS__");
+                macro->variadic = true;
+                expectParameter = false;
+                i += 2;
+            } else if (!expectParameter && token.type == TokenType::COMMA && !macro->variadic) {
+                expectParameter = true;
+            } else {
+                report(DiagID::EXPECTED_MACRO_PARAMETER, token.offset);
+                return;
+            }
+        }
+    }
+
+    macro->body.assign(line.begin() + static_cast<std::ptrdiff_t>(i), line.end());
+    for (Token& token : macro->body) {
+        token.flags = 0;
+    }
+    const std::vector<Token>& body = macro->body;
+    if (!body.empty() && (body.front().type == TokenType::HASH_HASH ||
+                          body.back().type == TokenType::HASH_HASH)) {
+        report(DiagID::PASTE_AT_EDGE,
+               body.front().type == TokenType::HASH_HASH ? body.front().offset
+                                                         : body.back().offset);
+        return;
+    }
+    if (macro->functionLike) {
+        for (size_t j = 0; j < body.size(); j++) {
+            if (body[j].type == TokenType::HASH &&
+                (j + 1 == body.size() || macro->parameterIndex(body[j + 1]) < 0)) {
+                report(DiagID::INVALID_STRINGIFY, body[j].offset);
+                return;
+            }
+        }
+    }
+
+    const Macro* existing = findMacro(std::string_view(macro->name));
+    if (existing && !existing->sameDefinition(*macro)) {
+        report(DiagID::MACRO_REDEFINED, line[2].offset);
+    }
+    macros.erase(std::string_view(macro->name));
+    std::string_view key(macro->name);
+    macros.emplace(key, std::move(macro));
+}
+
+// `defined NAME` and `defined(NAME)` are replaced before the expression
+// is expanded, so the names in them are not.
+bool Preprocessor::evaluateCondition(const std::vector<Token>& line) {
+    std::vector<Token> tokens;
+    for (size_t i = 2; i < line.size(); i++) {
+        if (line[i].lexeme != "defined") {
+            tokens.push_back(line[i]);
+            continue;
+        }
+        bool parenthesized = i + 1 < line.size() && line[i + 1].type == TokenType::LEFT_PAREN;
+        size_t nameIndex = i + (parenthesized ? 2 : 1);
+        if (nameIndex >= line.size() || !isIdentifierLike(line[nameIndex]) ||
+            (parenthesized &&
+             (nameIndex + 1 >= line.size() || line[nameIndex + 1].type != TokenType::RIGHT_PAREN))) {
+            report(DiagID::EXPECTED_MACRO_NAME,
+                   nameIndex < line.size() ? line[nameIndex].offset : line.back().endOffset());
+            return false;
+        }
+        bool defined = isDefined(std::string_view(line[nameIndex].lexeme));
+        tokens.emplace_back(TokenType::INTEGER_LITERAL, defined ? "1" : "0", line[i].line,
+                            line[i].column, line[i].offset);
+        i = nameIndex + (parenthesized ? 1 : 0);
+    }
+
+    std::vector<Token> expanded = Expander(*this).expand(std::move(tokens));
+    ConditionEvaluator evaluator(expanded);
+    int64_t value = 0;
+    if (!evaluator.evaluate(value)) {
+        report(evaluator.errorId, evaluator.errorIndex < expanded.size()
+                                      ? expanded[evaluator.errorIndex].offset
+                                      : line.back().endOffset());
+        return false;
+    }
+    return value != 0;
+}
+
+// The canonical path of the first candidate that exists, or an empty
+// string.
+std::string Preprocessor::findInclude(const std::string& name, bool quoted,
+                                      const std::string& includer) {
+    std::vector<fs::path> candidates;
+    if (quoted && !includer.empty()) {
+        candidates.push_back(fs::path(includer).parent_path() / name);
+    }
+    for (const std::string& directory : searchPaths) {
+        candidates.push_back(fs::path(directory) / name);
+    }
+    for (const fs::path& candidate : candidates) {
+        std::error_code error;
+        if (fs::is_regular_file(candidate, error)) {
+            return canonicalPath(candidate.string());
+        }
+    }
+    return "";
+}
+
+// Whether including `path` again would produce nothing, because it is
+// marked "#pragma once" or its include guard is defined. The answer comes
+// from what is known about the file already; it is not read.
+bool Preprocessor::isIncluded(const std::string& path) const {
+    if (onceFiles.count(path)) {
+        return true;
+    }
+    auto guard = includeGuards.find(path);
+    if (guard != includeGuards.end()) {
+        return isDefined(guard->second);
+    }
+    std::string_view preludeGuard;
+    bool once = false;
+    if (prelude && prelude->findFile(path, preludeGuard, once)) {
+        return once || (!preludeGuard.empty() && isDefined(preludeGuard));
+    }
+    return false;
+}
+
+// Each file gets one offset range per preprocess() call, however often it
+// is included.
+size_t Preprocessor::addFile(std::shared_ptr<const LexedFile> file) {
+    auto it = fileIndices.find(file->path);
+    if (it != fileIndices.end() && files[it->second].file == file) {
+        return it->second;
+    }
+    size_t index = files.size();
+    files.push_back({file, static_cast<uint32_t>(nextBase)});
+    nextBase += file->size + 1;
+    fileIndices[file->path] = index;
+    return index;
+}
+
+const Preprocessor::Macro* Preprocessor::findMacro(const Token& token) const {
+    if ((macros.empty() && !prelude) || !isIdentifierLike(token)) {
+        return nullptr;
+    }
+    return findMacro(std::string_view(token.lexeme));
+}
+
+const Preprocessor::Macro* Preprocessor::findMacro(std::string_view name) const {
+    auto it = macros.find(name);
+    if (it != macros.end()) {
+        return it->second->undefined ? nullptr : it->second.get();
+    }
+    auto macro = std::make_unique<Macro>();
+    if (!prelude || !prelude->findMacro(name, *macro)) {
+        return nullptr;
+    }
+    std::string_view key(macro->name);
+    return macros.emplace(key, std::move(macro)).first->second.get();
+}
+
+void Preprocessor::removeMacro(std::string_view name) {
+    macros.erase(name);
+    if (prelude && prelude->hasMacro(name)) {
+        auto macro = std::make_unique<Macro>();
+        macro->name = std::string(name);
+        macro->undefined = true;
+        std::string_view key(macro->name);
+        macros.emplace(key, std::move(macro));
+    }
+}
+
+std::vector<const MacroDefinition*> Preprocessor::getDefinedMacros() const {
+    std::vector<const MacroDefinition*> defined;
+    for (const auto& entry : macros) {
+        if (!entry.second->undefined) {
+            defined.push_back(entry.second.get());
+        }
+    }
+    // In a stable order, so the same prelude always gives the same snapshot
+    std::sort(defined.begin(), defined.end(),
+              [](const MacroDefinition* a, const MacroDefinition* b) { return a->name < b->name; });
+    return defined;
+}
+
+void Preprocessor::extraTokens(const std::vector<Token>& line, size_t expected) {
+    if (line.size() > expected) {
+        report(DiagID::EXTRA_TOKENS_AFTER_DIRECTIVE, line[expected].offset);
+    }
+}
+
+void Preprocessor::report(DiagID id, uint32_t offset) {
+    if (diagnostics && !stopped) {
+        diagnostics->report(id, offset);
+        stopped = stopped || diagnostics->errorLimitReached();
+    }
+}
+
+void Preprocessor::report(const Diagnostic& diagnostic) {
+    if (diagnostics && !stopped) {
+        diagnostics->report(diagnostic);
+        stopped = stopped || diagnostics->errorLimitReached();
+    }
+}
+
+void Preprocessor::stop(DiagID id, uint32_t offset) {
+    report(id, offset);
+    stopped = true;
+}
+
+} // namespace msl_parser
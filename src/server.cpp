@@ -0,0 +1,563 @@
+#include "msl_parser/server.h"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define MSL_PARSER_HAVE_UNIX_SOCKETS 1
+#endif
+
+namespace msl_parser {
+
+namespace {
+
+constexpr size_t NUM_MODES = 3;
+// The buffer each worker keeps for its arena; most requests fit in it
+constexpr size_t ARENA_BUFFER_SIZE = 1024 * 1024;
+
+void put32(std::string& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out += static_cast<char>((value >> shift) & 0xff);
+    }
+}
+
+uint32_t get32(const char* data) {
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; i--) {
+        value = (value << 8) | static_cast<unsigned char>(data[i]);
+    }
+    return value;
+}
+
+std::string encodeResponse(uint32_t id, ResponseStatus status, const std::string& payload) {
+    std::string frame;
+    frame.reserve(protocol::RESPONSE_HEADER_SIZE + payload.size());
+    put32(frame, static_cast<uint32_t>(protocol::RESPONSE_HEADER_SIZE - 4 + payload.size()));
+    put32(frame, id);
+    frame += static_cast<char>(status);
+    frame.append(3, '\0');
+    frame += payload;
+    return frame;
+}
+
+#if MSL_PARSER_HAVE_UNIX_SOCKETS
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL; // a closed peer is an error, not SIGPIPE
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+bool writeAll(int socket, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::send(socket, data, size, SEND_FLAGS);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// False at end of stream as well as on errors.
+bool readAll(int socket, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t count = ::recv(socket, data, size, 0);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        data += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+
+bool makeAddress(const std::string& path, sockaddr_un& address, std::string& error) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        error = "invalid socket path: " + path;
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+#endif // MSL_PARSER_HAVE_UNIX_SOCKETS
+
+} // namespace
+
+// A fixed pool of worker threads, each with an arena that is released
+// after every task. The arena's first buffer is allocated once and kept,
+// so requests that fit in it allocate nothing.
+class ParseServer::WorkQueue {
+public:
+    using Task = std::function<void(std::pmr::memory_resource*)>;
+
+    explicit WorkQueue(unsigned threads) {
+        for (unsigned i = 0; i < threads; i++) {
+            workers.emplace_back([this]() { work(); });
+        }
+    }
+
+    // Runs the tasks still queued first.
+    ~WorkQueue() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        available.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    void push(Task task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        available.notify_one();
+    }
+
+    void waitIdle() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]() { return tasks.empty() && running == 0; });
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable available;
+    std::condition_variable idle;
+    std::deque<Task> tasks;
+    std::vector<std::thread> workers;
+    size_t running = 0;
+    bool stopping = false;
+
+    void work() {
+        std::unique_ptr<std::byte[]> buffer(new std::byte[ARENA_BUFFER_SIZE]);
+        // release() frees only what was allocated beyond the buffer
+        std::pmr::monotonic_buffer_resource arena(buffer.get(), ARENA_BUFFER_SIZE);
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            available.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;
+            }
+            Task task = std::move(tasks.front());
+            tasks.pop_front();
+            running++;
+            lock.unlock();
+            task(&arena);
+            arena.release();
+            lock.lock();
+            running--;
+            if (tasks.empty() && running == 0) {
+                idle.notify_all();
+            }
+        }
+    }
+};
+
+struct ParseServer::Connection {
+    explicit Connection(int socket) : socket(socket) {}
+    ~Connection() {
+#if MSL_PARSER_HAVE_UNIX_SOCKETS
+        ::close(socket);
+#endif
+    }
+
+    int socket;
+    // Responses are written whole, one at a time
+    std::mutex writeMutex;
+    std::thread reader;
+    std::atomic<bool> finished{false};
+    // Set when a write failed or timed out; nothing more is written
+    std::atomic<bool> broken{false};
+    // Requests read but not yet answered
+    std::mutex pendingMutex;
+    std::condition_variable pendingCondition;
+    size_t pending = 0;
+
+    void respond(uint32_t id, ResponseStatus status, const std::string& payload) {
+#if MSL_PARSER_HAVE_UNIX_SOCKETS
+        std::string frame = encodeResponse(id, status, payload);
+        std::lock_guard<std::mutex> lock(writeMutex);
+        // A client that went away or stopped reading is not an error for
+        // the server; it is disconnected, which also ends its reader
+        if (!broken.load() && !writeAll(socket, frame.data(), frame.size())) {
+            broken.store(true);
+            ::shutdown(socket, SHUT_RDWR);
+        }
+#endif
+    }
+
+    // Waits until fewer than `limit` requests are pending, then counts one
+    // more.
+    void beginRequest(size_t limit) {
+        std::unique_lock<std::mutex> lock(pendingMutex);
+        pendingCondition.wait(lock, [&]() { return pending < limit; });
+        pending++;
+    }
+
+    void endRequest() {
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            pending--;
+        }
+        pendingCondition.notify_one();
+    }
+};
+
+ParseServer::ParseServer(ServerOptions options) : options(std::move(options)) {
+    for (size_t mode = 0; mode < NUM_MODES; mode++) {
+        for (bool typeCheck : {false, true}) {
+            BatchOptions batch = this->options.batch;
+            batch.mode = static_cast<BatchMode>(mode);
+            batch.typeCheck = typeCheck;
+            processors.emplace_back(std::move(batch));
+        }
+    }
+    unsigned threads = this->options.threads ? this->options.threads
+                                             : std::max(1u, std::thread::hardware_concurrency());
+    queue = std::make_unique<WorkQueue>(threads);
+}
+
+ParseServer::~ParseServer() {
+    closeAll();
+#if MSL_PARSER_HAVE_UNIX_SOCKETS
+    if (listenSocket >= 0) {
+        ::close(listenSocket);
+        ::unlink(socketPath.c_str());
+    }
+    for (int descriptor : wakePipe) {
+        if (descriptor >= 0) {
+            ::close(descriptor);
+        }
+    }
+#endif
+}
+
+bool ParseServer::listen(const std::string& path, std::string& error) {
+#if MSL_PARSER_HAVE_UNIX_SOCKETS
+    sockaddr_un address;
+    if (!makeAddress(path, address, error)) {
+        return false;
+    }
+    int descriptor = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (descriptor < 0) {
+        error = std::string("cannot create socket: ") + std::strerror(errno);
+        return false;
+    }
+    auto* socketAddress = reinterpret_cast<sockaddr*>(&address);
+    int bound = ::bind(descriptor, socketAddress, sizeof(address));
+    if (bound < 0 && errno == EADDRINUSE) {
+        // Replace the socket file only if no server answers on it
+        int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        bool live = probe >= 0 && ::connect(probe, socketAddress, sizeof(address)) == 0;
+        if (probe >= 0) {
+            ::close(probe);
+        }
+        if (live) {
+            ::close(descriptor);
+            error = "a server is already listening on " + path;
+            return false;
+        }
+        ::unlink(path.c_str());
+        bound = ::bind(descriptor, socketAddress, sizeof(address));
+    }
+    if (bound < 0 || ::listen(descriptor, SOMAXCONN) < 0 || ::pipe(wakePipe) < 0) {
+        error = "cannot listen on " + path + ": " + std::strerror(errno);
+        ::close(descriptor);
+        return false;
+    }
+    listenSocket = descriptor;
+    socketPath = path;
+    return true;
+#else
+    (void)path;
+    error = "Unix domain sockets are not supported on this platform";
+    return false;
+#endif
+}
+
+void ParseServer::stop() {
+#if MSL_PARSER_HAVE_UNIX_SOCKETS
+    if (wakePipe[1] >= 0) {
+        char byte = 0;
+        // Only async-signal-safe calls here
+        ssize_t ignored = ::write(wakePipe[1], &byte, 1);
+        (void)ignored;
+    }
+#endif
+}
+
+void ParseServer::serve() {
+#if MSL_PARSER_HAVE_UNIX_SOCKETS
+    if (listenSocket < 0) {
+        return;
+    }
+    while (true) {
+        pollfd descriptors[2] = {{listenSocket, POLLIN, 0}, {wakePipe[0], POLLIN, 0}};
+        if (::poll(descriptors, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (descriptors[1].revents) {
+            char byte;
+            ssize_t ignored = ::read(wakePipe[0], &byte, 1);
+            (void)ignored;
+            break;
+        }
+        if (!(descriptors[0].revents & POLLIN)) {
+            continue;
+        }
+        int client = ::accept(listenSocket, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+        // Blocked writes fail after this long instead of holding a worker
+        timeval timeout;
+        timeout.tv_sec = static_cast<time_t>(options.sendTimeout.count() / 1000);
+        timeout.tv_usec = static_cast<suseconds_t>(options.sendTimeout.count() % 1000 * 1000);
+        ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        auto connection = std::make_shared<Connection>(client);
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        // Reap connections whose clients have gone
+        for (auto it = connections.begin(); it != connections.end();) {
+            if ((*it)->finished.load()) {
+                (*it)->reader.join();
+                it = connections.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        connections.push_back(connection);
+        connection->reader = std::thread(&ParseServer::readRequests, this, connection);
+    }
+    closeAll();
+#endif
+}
+
+void ParseServer::closeAll() {
+    std::vector<std::shared_ptr<Connection>> open;
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        open.swap(connections);
+    }
+#if MSL_PARSER_HAVE_UNIX_SOCKETS
+    // Readers see the end of the stream; responses can still be written
+    for (const auto& connection : open) {
+        ::shutdown(connection->socket, SHUT_RD);
+    }
+#endif
+    for (const auto& connection : open) {
+        if (connection->reader.joinable()) {
+            connection->reader.join();
+        }
+    }
+    queue->waitIdle();
+}
+
+void ParseServer::readRequests(std::shared_ptr<Connection> connection) {
+#if MSL_PARSER_HAVE_UNIX_SOCKETS
+    const int socket = connection->socket;
+    const size_t maxPending = std::max<size_t>(1, options.maxPendingRequests);
+    std::string frame;
+    char sizeField[4];
+    while (true) {
+        // Leave further requests in the socket until there is room; the
+        // client's writes block once its buffers are full
+        connection->beginRequest(maxPending);
+        if (!readAll(socket, sizeField, sizeof(sizeField))) {
+            connection->endRequest();
+            break;
+        }
+        uint32_t size = get32(sizeField);
+        if (size < protocol::REQUEST_HEADER_SIZE - 4 || size > options.maxRequestSize) {
+            // The stream cannot be resynchronized after a bad size
+            connection->respond(0, ResponseStatus::BAD_REQUEST, "invalid request size");
+            connection->endRequest();
+            break;
+        }
+        frame.resize(size);
+        if (!readAll(socket, &frame[0], size)) {
+            connection->endRequest();
+            break;
+        }
+        ParseRequest request;
+        request.id = get32(frame.data());
+        uint8_t mode = static_cast<uint8_t>(frame[4]);
+        request.flags = static_cast<uint8_t>(frame[5]);
+        uint32_t pathLength = get32(frame.data() + 8);
+        if (mode >= NUM_MODES || pathLength > size - (protocol::REQUEST_HEADER_SIZE - 4)) {
+            connection->respond(request.id, ResponseStatus::BAD_REQUEST, "malformed request");
+            connection->endRequest();
+            continue;
+        }
+        request.mode = static_cast<BatchMode>(mode);
+        const size_t pathOffset = protocol::REQUEST_HEADER_SIZE - 4;
+        request.path.assign(frame, pathOffset, pathLength);
+        request.source.assign(frame, pathOffset + pathLength, std::string::npos);
+        queue->push([this, connection, request = std::move(request)](
+                        std::pmr::memory_resource* arena) mutable {
+            handle(connection, std::move(request), arena);
+        });
+    }
+    connection->finished.store(true);
+#else
+    (void)connection;
+#endif
+}
+
+void ParseServer::handle(const std::shared_ptr<Connection>& connection, ParseRequest request,
+                         std::pmr::memory_resource* arena) {
+    bool typeCheck = (request.flags & protocol::TYPE_CHECK) != 0;
+    const BatchProcessor& processor =
+        processors[static_cast<size_t>(request.mode) * 2 + (typeCheck ? 1 : 0)];
+    std::string payload;
+    bool ok = (request.flags & protocol::READ_FILE)
+                  ? processor.processFile(request.path, payload, arena)
+                  : processor.processSource(request.path, request.source, payload, arena);
+    requestCount.fetch_add(1);
+    connection->respond(request.id, ok ? ResponseStatus::OK : ResponseStatus::ERRORS, payload);
+    connection->endRequest();
+}
+
+// ParseClient
+
+ParseClient::~ParseClient() {
+    close();
+}
+
+bool ParseClient::connect(const std::string& socketPath, std::string& error) {
+    close();
+#if MSL_PARSER_HAVE_UNIX_SOCKETS
+    sockaddr_un address;
+    if (!makeAddress(socketPath, address, error)) {
+        return false;
+    }
+    int descriptor = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (descriptor < 0 ||
+        ::connect(descriptor, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        error = "cannot connect to " + socketPath + ": " + std::strerror(errno);
+        if (descriptor >= 0) {
+            ::close(descriptor);
+        }
+        return false;
+    }
+    socket = descriptor;
+    return true;
+#else
+    (void)socketPath;
+    error = "Unix domain sockets are not supported on this platform";
+    return false;
+#endif
+}
+
+void ParseClient::close() {
+#if MSL_PARSER_HAVE_UNIX_SOCKETS
+    if (socket >= 0) {
+        ::close(socket);
+    }
+#endif
+    socket = -1;
+    pending.clear();
+}
+
+uint32_t ParseClient::send(ParseRequest request) {
+    if (socket < 0) {
+        return 0;
+    }
+    if (request.id == 0) {
+        request.id = nextId++;
+    }
+    std::string frame;
+    frame.reserve(protocol::REQUEST_HEADER_SIZE + request.path.size() + request.source.size());
+    put32(frame, static_cast<uint32_t>(protocol::REQUEST_HEADER_SIZE - 4 + request.path.size() +
+                                       request.source.size()));
+    put32(frame, request.id);
+    frame += static_cast<char>(request.mode);
+    frame += static_cast<char>(request.flags);
+    frame.append(2, '\0');
+    put32(frame, static_cast<uint32_t>(request.path.size()));
+    frame += request.path;
+    frame += request.source;
+#if MSL_PARSER_HAVE_UNIX_SOCKETS
+    if (!writeAll(socket, frame.data(), frame.size())) {
+        close();
+        return 0;
+    }
+#endif
+    return request.id;
+}
+
+bool ParseClient::readFrame(ParseResponse& response) {
+#if MSL_PARSER_HAVE_UNIX_SOCKETS
+    char header[protocol::RESPONSE_HEADER_SIZE];
+    if (socket < 0 || !readAll(socket, header, sizeof(header))) {
+        close();
+        return false;
+    }
+    uint32_t size = get32(header);
+    if (size < protocol::RESPONSE_HEADER_SIZE - 4) {
+        close();
+        return false;
+    }
+    response.id = get32(header + 4);
+    response.status = static_cast<ResponseStatus>(header[8]);
+    response.payload.resize(size - (protocol::RESPONSE_HEADER_SIZE - 4));
+    if (!response.payload.empty() &&
+        !readAll(socket, &response.payload[0], response.payload.size())) {
+        close();
+        return false;
+    }
+    return true;
+#else
+    (void)response;
+    return false;
+#endif
+}
+
+bool ParseClient::receive(ParseResponse& response) {
+    if (!pending.empty()) {
+        response = std::move(pending.front());
+        pending.erase(pending.begin());
+        return true;
+    }
+    return readFrame(response);
+}
+
+bool ParseClient::request(ParseRequest request, ParseResponse& response) {
+    uint32_t id = send(std::move(request));
+    if (id == 0) {
+        return false;
+    }
+    while (readFrame(response)) {
+        if (response.id == id) {
+            return true;
+        }
+        pending.push_back(std::move(response));
+    }
+    return false;
+}
+
+} // namespace msl_parser
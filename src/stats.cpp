@@ -0,0 +1,172 @@
+#include "msl_parser/stats.h"
+#include <cstring>
+#include "msl_parser/ast/ast_node.h"
+
+namespace msl_parser {
+
+namespace {
+
+void writeString(std::ostream& out, const char* text) {
+    out << '"';
+    for (const char* p = text; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            out << '\\';
+        }
+        out << *p;
+    }
+    out << '"';
+}
+
+void writeMicroseconds(std::ostream& out, uint64_t nanoseconds) {
+    out << nanoseconds / 1000 << '.';
+    uint64_t fraction = nanoseconds % 1000;
+    out << static_cast<char>('0' + fraction / 100) << static_cast<char>('0' + fraction / 10 % 10)
+        << static_cast<char>('0' + fraction % 10);
+}
+
+class KindVisitor : public ast::ASTVisitor {
+public:
+    NodeKind kind = NodeKind::NUM_NODE_KINDS;
+
+#define AST_NODE(CLASS) \
+    void visit##CLASS(ast::CLASS*) override { kind = NodeKind::CLASS; }
+#include "msl_parser/ast/ast_nodes.def"
+#undef AST_NODE
+};
+
+} // namespace
+
+const char* nodeKindToString(NodeKind kind) {
+    switch (kind) {
+#define AST_NODE(CLASS)                                                    \
+        case NodeKind::CLASS: return #CLASS;
+#include "msl_parser/ast/ast_nodes.def"
+#undef AST_NODE
+        default: return "unknown";
+    }
+}
+
+NodeKind getNodeKind(ast::ASTNode* node) {
+    KindVisitor visitor;
+    node->accept(&visitor);
+    return visitor.kind;
+}
+
+void Stats::reset() {
+    uint32_t open = openPhases; // scopes still running will close against the new origin
+    *this = Stats();
+    openPhases = open;
+}
+
+uint64_t Stats::phaseNanoseconds(const char* name) const {
+    uint64_t total = 0;
+    for (const auto& phase : phases) {
+        if (std::strcmp(phase.name, name) == 0) {
+            total += phase.durationNanoseconds;
+        }
+    }
+    return total;
+}
+
+uint64_t Stats::totalTokens() const {
+    uint64_t total = 0;
+    for (uint64_t count : tokensByType) {
+        total += count;
+    }
+    return total;
+}
+
+uint64_t Stats::totalNodes() const {
+    uint64_t total = 0;
+    for (uint64_t count : nodesByKind) {
+        total += count;
+    }
+    return total;
+}
+
+void Stats::writeChromeTrace(std::ostream& out) const {
+    uint64_t end = 0;
+    out << "{\"traceEvents\":[";
+    for (size_t i = 0; i < phases.size(); i++) {
+        const PhaseRecord& phase = phases[i];
+        out << (i ? ",\n" : "\n") << "{\"name\":";
+        writeString(out, phase.name);
+        out << ",\"cat\":\"msl_parser\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":";
+        writeMicroseconds(out, phase.startNanoseconds);
+        out << ",\"dur\":";
+        writeMicroseconds(out, phase.durationNanoseconds);
+        out << "}";
+        if (phase.startNanoseconds + phase.durationNanoseconds > end) {
+            end = phase.startNanoseconds + phase.durationNanoseconds;
+        }
+    }
+
+    const char* separator = phases.empty() ? "\n" : ",\n";
+    out << separator << "{\"name\":\"totals\",\"ph\":\"C\",\"pid\":1,\"tid\":1,\"ts\":";
+    writeMicroseconds(out, end);
+    out << ",\"args\":{\"bytes_processed\":" << bytesProcessed << ",\"tokens\":" << totalTokens()
+        << ",\"nodes\":" << totalNodes() << ",\"arena_bytes\":" << arenaBytes
+        << ",\"peak_token_count\":" << peakTokenCount << ",\"peak_token_bytes\":" << peakTokenBytes
+        << "}}";
+
+    out << ",\n{\"name\":\"tokens_by_type\",\"ph\":\"C\",\"pid\":1,\"tid\":1,\"ts\":";
+    writeMicroseconds(out, end);
+    out << ",\"args\":{";
+    bool first = true;
+    for (size_t i = 0; i < NUM_TOKEN_TYPES; i++) {
+        if (tokensByType[i]) {
+            out << (first ? "" : ",");
+            writeString(out, tokenTypeToString(static_cast<TokenType>(i)));
+            out << ":" << tokensByType[i];
+            first = false;
+        }
+    }
+    out << "}}";
+
+    out << ",\n{\"name\":\"nodes_by_kind\",\"ph\":\"C\",\"pid\":1,\"tid\":1,\"ts\":";
+    writeMicroseconds(out, end);
+    out << ",\"args\":{";
+    first = true;
+    for (size_t i = 0; i < NUM_NODE_KINDS; i++) {
+        if (nodesByKind[i]) {
+            out << (first ? "" : ",");
+            writeString(out, nodeKindToString(static_cast<NodeKind>(i)));
+            out << ":" << nodesByKind[i];
+            first = false;
+        }
+    }
+    out << "}}\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+Stats& threadStats() {
+    thread_local Stats stats;
+    return stats;
+}
+
+// ScopedPhase
+
+ScopedPhase::ScopedPhase(const char* name, bool active) : name(name), active(active) {
+    if (active) {
+        threadStats().openPhases++;
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+ScopedPhase::~ScopedPhase() {
+    if (!active) {
+        return;
+    }
+    auto end = std::chrono::steady_clock::now();
+    Stats& stats = threadStats();
+    stats.openPhases--;
+    PhaseRecord record;
+    record.name = name;
+    record.startNanoseconds = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(start - stats.origin).count());
+    record.durationNanoseconds = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    record.depth = stats.openPhases;
+    stats.phases.push_back(record);
+}
+
+} // namespace msl_parser
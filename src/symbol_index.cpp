@@ -0,0 +1,669 @@
+#include "msl_parser/symbol_index.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include "msl_parser/lexer.h"
+#include "msl_parser/parser.h"
+#include "msl_parser/preprocessor.h"
+
+namespace msl_parser {
+
+using namespace ast;
+
+namespace {
+
+constexpr char MAGIC[8] = {'M', 'S', 'L', 'S', 'Y', 'M', 'I', 'X'};
+// Bump whenever the layout or SymbolKind changes
+constexpr uint32_t VERSION = 1;
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// Per-worker arena; most files fit in the first block
+constexpr size_t ARENA_BLOCK_SIZE = 256 * 1024;
+
+// Identifiers that are keywords to the parser, not names worth indexing
+const std::unordered_set<std::string_view> IGNORED_NAMES = {
+    "struct", "const",    "constexpr", "using",  "namespace", "static",   "inline",
+    "typedef", "template", "typename", "sizeof", "true",      "false",    "unsigned",
+    "signed", "enum",     "class",     "volatile", "metal",   "defined"};
+
+bool readFile(const std::string& path, std::string& contents) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+// An entry before it is written, owning its strings.
+struct IndexedEntry {
+    SymbolKind kind;
+    SymbolRole role;
+    std::string name;
+    std::string context;
+    uint32_t line;
+    uint32_t column;
+    uint32_t value;
+};
+
+struct IndexedFile {
+    bool readable = false;
+    uint64_t contentHash = 0;
+    std::vector<IndexedEntry> entries;
+};
+
+// Collects the entries of one file.
+class FileIndexer {
+public:
+    FileIndexer(const std::string& source, std::vector<IndexedEntry>& entries)
+        : source(source), entries(entries) {}
+
+    void run(const std::string& path, const SymbolIndexOptions& options,
+             std::pmr::memory_resource* resource) {
+        // Errors do not matter here, only what could be recovered
+        DiagnosticEngine diagnostics(0);
+        Lexer lexer(source, &diagnostics, nullptr, resource);
+        raw = lexer.scanTokens();
+        defining.assign(raw.size(), false);
+        directives();
+
+        Preprocessor preprocessor(&diagnostics);
+        for (const std::string& searchPath : options.searchPaths) {
+            preprocessor.addSearchPath(searchPath);
+        }
+        for (const auto& define : options.defines) {
+            preprocessor.define(define.first, define.second);
+        }
+        std::pmr::vector<Token> tokens = preprocessor.preprocess(source, path, resource);
+        Parser parser(tokens, &diagnostics, nullptr, resource);
+        std::unique_ptr<TranslationUnit> unit = parser.parse();
+        for (const auto& declaration : unit->getDeclarations()) {
+            this->declaration(declaration.get());
+        }
+        references();
+    }
+
+private:
+    const std::string& source;
+    std::vector<IndexedEntry>& entries;
+    std::pmr::vector<Token> raw;
+    // Raw tokens that name a definition, or belong to #include lines and
+    // directive names, and so are not references
+    std::vector<bool> defining;
+
+    void add(SymbolKind kind, SymbolRole role, std::string_view name, std::string_view context,
+             uint32_t line, uint32_t column, uint32_t value = 0) {
+        entries.push_back(
+            {kind, role, std::string(name), std::string(context), line, column, value});
+    }
+
+    // Macro definitions, and the tokens of directives that are not names
+    void directives() {
+        for (size_t i = 0; i + 1 < raw.size(); i++) {
+            if (raw[i].type != TokenType::HASH || !(raw[i].flags & TOKEN_AT_LINE_START)) {
+                continue;
+            }
+            const Token& directive = raw[i + 1];
+            if (directive.type != TokenType::IDENTIFIER ||
+                (directive.flags & TOKEN_AT_LINE_START)) {
+                continue;
+            }
+            defining[i + 1] = true;
+            if (directive.lexeme == "include" || directive.lexeme == "import" ||
+                directive.lexeme == "pragma") {
+                for (size_t j = i + 2; j < raw.size() && !(raw[j].flags & TOKEN_AT_LINE_START);
+                     j++) {
+                    defining[j] = true;
+                }
+            } else if (directive.lexeme == "define" && i + 2 < raw.size() &&
+                       raw[i + 2].type == TokenType::IDENTIFIER &&
+                       !(raw[i + 2].flags & TOKEN_AT_LINE_START)) {
+                const Token& name = raw[i + 2];
+                defining[i + 2] = true;
+                add(SymbolKind::MACRO, SymbolRole::DEFINITION, name.lexeme, "", name.line,
+                    name.column);
+            }
+        }
+    }
+
+    // The raw token naming `declaration`: the first identifier spelled like
+    // its name inside its range. Null when a macro produced the name.
+    const Token* nameToken(const Declaration* declaration) {
+        const SourceRange& range = declaration->getSourceRange();
+        auto it = std::lower_bound(raw.begin(), raw.end(), range.start.offset,
+                                   [](const Token& token, int offset) {
+                                       return static_cast<int>(token.offset) < offset;
+                                   });
+        for (; it != raw.end() && static_cast<int>(it->offset) < range.end.offset; ++it) {
+            if (it->type == TokenType::IDENTIFIER &&
+                std::string_view(it->lexeme) == declaration->getName()) {
+                defining[static_cast<size_t>(it - raw.begin())] = true;
+                return &*it;
+            }
+        }
+        return nullptr;
+    }
+
+    void define(SymbolKind kind, SymbolRole role, const Declaration* declaration,
+                std::string_view context = "", uint32_t value = 0) {
+        const Token* name = nameToken(declaration);
+        const SourceLocation& start = declaration->getSourceRange().start;
+        add(kind, role, declaration->getName(), context,
+            name ? name->line : static_cast<uint32_t>(start.line),
+            name ? name->column : static_cast<uint32_t>(start.column), value);
+    }
+
+    void declaration(Declaration* declaration) {
+        const SourceRange& range = declaration->getSourceRange();
+        // Skip declarations from included headers; they are indexed as
+        // files of their own
+        if (range.start.line == 0 || static_cast<size_t>(range.start.offset) >= source.size() ||
+            declaration->getName().empty()) {
+            return;
+        }
+        switch (getNodeKind(declaration)) {
+            case NodeKind::FunctionDeclaration: {
+                auto* function = static_cast<FunctionDeclaration*>(declaration);
+                define(SymbolKind::FUNCTION,
+                       function->getBody() ? SymbolRole::DEFINITION : SymbolRole::DECLARATION,
+                       function);
+                for (const auto& parameter : function->getParameters()) {
+                    bindings(function, parameter.get());
+                }
+                break;
+            }
+            case NodeKind::StructDeclaration:
+                define(SymbolKind::STRUCT, SymbolRole::DEFINITION, declaration);
+                break;
+            case NodeKind::VariableDeclaration:
+                define(SymbolKind::VARIABLE, SymbolRole::DEFINITION, declaration);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void bindings(FunctionDeclaration* function, VariableDeclaration* parameter) {
+        for (const Attribute& attribute : parameter->getAttributes()) {
+            SymbolKind kind;
+            if (attribute.name == "buffer") {
+                kind = SymbolKind::BUFFER;
+            } else if (attribute.name == "texture") {
+                kind = SymbolKind::TEXTURE;
+            } else if (attribute.name == "sampler") {
+                kind = SymbolKind::SAMPLER;
+            } else {
+                continue;
+            }
+            // Only literal slots; a macro or expression cannot be resolved
+            // per file
+            char* end = nullptr;
+            unsigned long slot = std::strtoul(attribute.argument.c_str(), &end, 0);
+            if (attribute.argument.empty() || *end != '\0') {
+                continue;
+            }
+            define(kind, SymbolRole::BINDING, parameter, function->getName(),
+                   static_cast<uint32_t>(slot));
+        }
+    }
+
+    // One entry per name used, at its first use
+    void references() {
+        std::unordered_map<std::string_view, size_t> seen;
+        for (size_t i = 0; i < raw.size(); i++) {
+            const Token& token = raw[i];
+            if (token.type != TokenType::IDENTIFIER || defining[i] ||
+                IGNORED_NAMES.count(token.lexeme)) {
+                continue;
+            }
+            auto inserted = seen.emplace(token.lexeme, entries.size());
+            if (inserted.second) {
+                add(SymbolKind::NAME, SymbolRole::REFERENCE, token.lexeme, "", token.line,
+                    token.column, 1);
+            } else {
+                entries[inserted.first->second].value++;
+            }
+        }
+    }
+};
+
+} // namespace
+
+const char* symbolKindToString(SymbolKind kind) {
+    switch (kind) {
+        case SymbolKind::FUNCTION: return "function";
+        case SymbolKind::STRUCT: return "struct";
+        case SymbolKind::VARIABLE: return "variable";
+        case SymbolKind::MACRO: return "macro";
+        case SymbolKind::BUFFER: return "buffer";
+        case SymbolKind::TEXTURE: return "texture";
+        case SymbolKind::SAMPLER: return "sampler";
+        case SymbolKind::NAME: return "name";
+    }
+    return "unknown";
+}
+
+struct SymbolIndex::StringRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct SymbolIndex::FileRecord {
+    StringRef path;
+    // Range of the fileEntries section
+    uint32_t firstEntry;
+    uint32_t entryCount;
+    uint64_t contentHash;
+};
+
+struct SymbolIndex::EntryRecord {
+    StringRef name;
+    StringRef context;
+    uint32_t file;
+    uint32_t line;
+    uint32_t column;
+    uint32_t value;
+    uint8_t kind;
+    uint8_t role;
+    uint16_t padding;
+};
+
+struct SymbolIndex::NameRecord {
+    StringRef name;
+    uint32_t firstEntry;
+    uint32_t entryCount;
+};
+
+bool SymbolIndex::build(const std::vector<std::string>& files, const std::string& path,
+                        const SymbolIndexOptions& options, std::string& error,
+                        const SymbolIndex* previous, BuildStats* stats) {
+    // Unchanged files are recognized by path and content hash
+    std::unordered_map<std::string_view, size_t> previousFiles;
+    if (previous) {
+        for (size_t i = 0; i < previous->getFileCount(); i++) {
+            std::string_view previousPath;
+            uint64_t hash;
+            if (previous->getFile(i, previousPath, hash)) {
+                previousFiles.emplace(previousPath, i);
+            }
+        }
+    }
+
+    std::vector<IndexedFile> indexed(files.size());
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> reused{0};
+    auto work = [&]() {
+        std::pmr::monotonic_buffer_resource arena(ARENA_BLOCK_SIZE);
+        std::string source;
+        for (size_t index = next.fetch_add(1); index < files.size(); index = next.fetch_add(1)) {
+            IndexedFile& file = indexed[index];
+            if (!readFile(files[index], source)) {
+                continue;
+            }
+            file.readable = true;
+            file.contentHash = hashContent(source);
+            auto match = previousFiles.find(files[index]);
+            std::string_view previousPath;
+            uint64_t previousHash = 0;
+            if (match != previousFiles.end() &&
+                previous->getFile(match->second, previousPath, previousHash) &&
+                previousHash == file.contentHash) {
+                for (const SymbolEntry& entry : previous->getFileEntries(match->second)) {
+                    file.entries.push_back({entry.kind, entry.role, std::string(entry.name),
+                                            std::string(entry.context), entry.line,
+                                            entry.column, entry.value});
+                }
+                reused.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            FileIndexer(source, file.entries).run(files[index], options, &arena);
+            arena.release();
+        }
+    };
+    size_t jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::min(jobs, std::max<size_t>(files.size(), 1));
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < jobs; i++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    // Entries sorted by name, definitions first; the files are numbered
+    // in the order given, leaving out unreadable ones
+    struct Sorted {
+        const IndexedEntry* entry;
+        uint32_t file;
+    };
+    std::vector<Sorted> sorted;
+    std::vector<uint32_t> fileNumbers(files.size(), 0);
+    uint32_t fileCount = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        if (!indexed[i].readable) {
+            continue;
+        }
+        fileNumbers[i] = fileCount++;
+        for (const IndexedEntry& entry : indexed[i].entries) {
+            sorted.push_back({&entry, fileNumbers[i]});
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Sorted& a, const Sorted& b) {
+        const IndexedEntry& x = *a.entry;
+        const IndexedEntry& y = *b.entry;
+        if (x.name != y.name) {
+            return x.name < y.name;
+        }
+        if (x.role != y.role) {
+            return x.role < y.role;
+        }
+        if (a.file != b.file) {
+            return a.file < b.file;
+        }
+        return x.line != y.line ? x.line < y.line : x.column < y.column;
+    });
+
+    BinaryWriter writer;
+    std::vector<EntryRecord> entryRecords;
+    std::vector<NameRecord> nameRecords;
+    std::vector<std::string_view> names;
+    std::vector<uint32_t> bindings;
+    std::vector<uint32_t> fileEntryCounts(fileCount, 0);
+    entryRecords.reserve(sorted.size());
+    for (const Sorted& item : sorted) {
+        const IndexedEntry& entry = *item.entry;
+        auto index = static_cast<uint32_t>(entryRecords.size());
+        EntryRecord record = {};
+        record.name = writer.string<StringRef>(entry.name);
+        record.context = writer.string<StringRef>(entry.context);
+        record.file = item.file;
+        record.line = entry.line;
+        record.column = entry.column;
+        record.value = entry.value;
+        record.kind = static_cast<uint8_t>(entry.kind);
+        record.role = static_cast<uint8_t>(entry.role);
+        entryRecords.push_back(record);
+        fileEntryCounts[item.file]++;
+        if (entry.role == SymbolRole::BINDING) {
+            bindings.push_back(index);
+        }
+        if (names.empty() || names.back() != entry.name) {
+            names.push_back(entry.name);
+            nameRecords.push_back({record.name, index, 0});
+        }
+        nameRecords.back().entryCount++;
+    }
+    std::sort(bindings.begin(), bindings.end(), [&](uint32_t a, uint32_t b) {
+        const EntryRecord& x = entryRecords[a];
+        const EntryRecord& y = entryRecords[b];
+        if (x.kind != y.kind) {
+            return x.kind < y.kind;
+        }
+        if (x.value != y.value) {
+            return x.value < y.value;
+        }
+        return x.file != y.file ? x.file < y.file : x.line < y.line;
+    });
+
+    std::vector<FileRecord> fileRecords;
+    uint32_t firstEntry = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        if (!indexed[i].readable) {
+            continue;
+        }
+        FileRecord record = {};
+        record.path = writer.string<StringRef>(files[i]);
+        record.firstEntry = firstEntry;
+        record.entryCount = fileEntryCounts[fileRecords.size()];
+        record.contentHash = indexed[i].contentHash;
+        firstEntry += record.entryCount;
+        fileRecords.push_back(record);
+    }
+    // Entry indexes grouped by file
+    std::vector<uint32_t> fileEntries(entryRecords.size());
+    std::vector<uint32_t> fill(fileCount, 0);
+    for (uint32_t i = 0; i < entryRecords.size(); i++) {
+        const FileRecord& file = fileRecords[entryRecords[i].file];
+        fileEntries[file.firstEntry + fill[entryRecords[i].file]++] = i;
+    }
+    std::vector<uint32_t> nameBuckets = hashTable(names);
+
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.fileCount = fileCount;
+    header.entryCount = static_cast<uint32_t>(entryRecords.size());
+    header.nameCount = static_cast<uint32_t>(nameRecords.size());
+    header.nameBucketCount = static_cast<uint32_t>(nameBuckets.size());
+    header.bindingCount = static_cast<uint32_t>(bindings.size());
+
+    writer.append(&header, sizeof(header)); // placeholder, rewritten below
+    header.strings = writer.append(writer.getStrings().data(), writer.getStrings().size());
+    header.stringsSize = writer.getStrings().size();
+    header.files = writer.section(fileRecords);
+    header.entries = writer.section(entryRecords);
+    header.names = writer.section(nameRecords);
+    header.nameBuckets = writer.section(nameBuckets);
+    header.bindings = writer.section(bindings);
+    header.fileEntries = writer.section(fileEntries);
+    std::memcpy(&writer.out[0], &header, sizeof(header));
+
+    if (stats) {
+        stats->reused = reused.load();
+        stats->indexed = fileCount - stats->reused;
+        stats->unreadable = files.size() - fileCount;
+    }
+    if (!writer.save(path)) {
+        error = "cannot write '" + path + "'";
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<const SymbolIndex> SymbolIndex::open(const std::string& path) {
+    std::shared_ptr<SymbolIndex> index(new SymbolIndex());
+    if (!index->file.open(path)) {
+        return nullptr;
+    }
+    index->data = index->file.data();
+    index->size = index->file.size();
+    if (!index->validate()) {
+        return nullptr;
+    }
+    return index;
+}
+
+// Checks the header and that every section lies inside the file. Records
+// are checked when they are read.
+bool SymbolIndex::validate() {
+    if (size < sizeof(Header)) {
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.byteOrder != BYTE_ORDER_MARK) {
+        return false;
+    }
+    auto fits = [&](uint64_t offset, uint64_t count, size_t recordSize) {
+        return offset <= size && count <= (size - offset) / recordSize;
+    };
+    bool powerOfTwo =
+        header.nameBucketCount != 0 && (header.nameBucketCount & (header.nameBucketCount - 1)) == 0;
+    return powerOfTwo && fits(header.strings, header.stringsSize, 1) &&
+           fits(header.files, header.fileCount, sizeof(FileRecord)) &&
+           fits(header.entries, header.entryCount, sizeof(EntryRecord)) &&
+           fits(header.names, header.nameCount, sizeof(NameRecord)) &&
+           fits(header.nameBuckets, header.nameBucketCount, sizeof(uint32_t)) &&
+           fits(header.bindings, header.bindingCount, sizeof(uint32_t)) &&
+           fits(header.fileEntries, header.entryCount, sizeof(uint32_t));
+}
+
+template <typename Record>
+bool SymbolIndex::read(uint64_t section, uint32_t count, size_t index, Record& record) const {
+    if (index >= count) {
+        return false;
+    }
+    std::memcpy(&record, data + section + index * sizeof(Record), sizeof(Record));
+    return true;
+}
+
+bool SymbolIndex::string(const StringRef& ref, std::string_view& text) const {
+    if (ref.offset > header.stringsSize || ref.length > header.stringsSize - ref.offset) {
+        return false;
+    }
+    text = std::string_view(data + header.strings + ref.offset, ref.length);
+    return true;
+}
+
+size_t SymbolIndex::getFileCount() const {
+    return header.fileCount;
+}
+
+size_t SymbolIndex::getEntryCount() const {
+    return header.entryCount;
+}
+
+bool SymbolIndex::getFile(size_t index, std::string_view& path, uint64_t& contentHash) const {
+    FileRecord record;
+    if (!read(header.files, header.fileCount, index, record) || !string(record.path, path)) {
+        return false;
+    }
+    contentHash = record.contentHash;
+    return true;
+}
+
+bool SymbolIndex::entry(size_t index, SymbolEntry& entry) const {
+    EntryRecord record;
+    FileRecord file;
+    if (!read(header.entries, header.entryCount, index, record) ||
+        !read(header.files, header.fileCount, record.file, file) ||
+        !string(record.name, entry.name) || !string(record.context, entry.context) ||
+        !string(file.path, entry.file) || record.kind > static_cast<uint8_t>(SymbolKind::NAME) ||
+        record.role > static_cast<uint8_t>(SymbolRole::BINDING)) {
+        return false;
+    }
+    entry.kind = static_cast<SymbolKind>(record.kind);
+    entry.role = static_cast<SymbolRole>(record.role);
+    entry.line = record.line;
+    entry.column = record.column;
+    entry.value = record.value;
+    return true;
+}
+
+bool SymbolIndex::findName(std::string_view name, uint32_t& first, uint32_t& count) const {
+    const uint32_t mask = header.nameBucketCount - 1;
+    uint32_t bucket = hashName(name) & mask;
+    for (uint32_t probe = 0; probe < header.nameBucketCount; probe++) {
+        uint32_t slot = 0;
+        read(header.nameBuckets, header.nameBucketCount, bucket, slot);
+        if (slot == 0) {
+            return false;
+        }
+        NameRecord record;
+        std::string_view recordName;
+        if (read(header.names, header.nameCount, slot - 1, record) &&
+            string(record.name, recordName) && recordName == name) {
+            first = record.firstEntry;
+            count = record.entryCount;
+            return true;
+        }
+        bucket = (bucket + 1) & mask;
+    }
+    return false;
+}
+
+std::vector<SymbolEntry> SymbolIndex::findDefinitions(std::string_view name) const {
+    std::vector<SymbolEntry> found;
+    uint32_t first, count;
+    if (!findName(name, first, count)) {
+        return found;
+    }
+    // Definitions and declarations sort first
+    SymbolEntry entry;
+    for (uint32_t i = first; i < first + count && this->entry(i, entry) &&
+                             entry.role <= SymbolRole::DECLARATION;
+         i++) {
+        found.push_back(entry);
+    }
+    return found;
+}
+
+std::vector<SymbolEntry> SymbolIndex::findReferences(std::string_view name) const {
+    std::vector<SymbolEntry> found;
+    uint32_t first, count;
+    if (!findName(name, first, count)) {
+        return found;
+    }
+    SymbolEntry entry;
+    for (uint32_t i = first; i < first + count; i++) {
+        if (this->entry(i, entry) && entry.role == SymbolRole::REFERENCE) {
+            found.push_back(entry);
+        }
+    }
+    return found;
+}
+
+std::vector<SymbolEntry> SymbolIndex::findBindings(SymbolKind kind, uint32_t slot) const {
+    // The first binding at or after (kind, slot)
+    auto before = [&](uint32_t position) {
+        uint32_t index = 0;
+        EntryRecord record;
+        if (!read(header.bindings, header.bindingCount, position, index) ||
+            !read(header.entries, header.entryCount, index, record)) {
+            return false;
+        }
+        return record.kind != static_cast<uint8_t>(kind) ? record.kind < static_cast<uint8_t>(kind)
+                                                          : record.value < slot;
+    };
+    uint32_t low = 0;
+    uint32_t high = header.bindingCount;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (before(middle)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    std::vector<SymbolEntry> found;
+    SymbolEntry entry;
+    for (uint32_t position = low; position < header.bindingCount; position++) {
+        uint32_t index = 0;
+        if (!read(header.bindings, header.bindingCount, position, index) ||
+            !this->entry(index, entry) || entry.kind != kind || entry.value != slot) {
+            break;
+        }
+        found.push_back(entry);
+    }
+    return found;
+}
+
+std::vector<SymbolEntry> SymbolIndex::getFileEntries(size_t file) const {
+    std::vector<SymbolEntry> found;
+    FileRecord record;
+    if (!read(header.files, header.fileCount, file, record)) {
+        return found;
+    }
+    SymbolEntry entry;
+    for (uint32_t i = 0; i < record.entryCount; i++) {
+        uint32_t index = 0;
+        if (read(header.fileEntries, header.entryCount, size_t(record.firstEntry) + i, index) &&
+            this->entry(index, entry)) {
+            found.push_back(entry);
+        }
+    }
+    return found;
+}
+
+} // namespace msl_parser
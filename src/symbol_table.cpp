@@ -0,0 +1,364 @@
+#include "msl_parser/symbol_table.h"
+#include <cstring>
+#include <unordered_map>
+#include "msl_parser/ast/recursive_visitor.h"
+#include "msl_parser/hash.h"
+#include "msl_parser/prelude.h"
+#include "msl_parser/stats.h"
+
+namespace msl_parser {
+
+using namespace ast;
+
+namespace {
+
+size_t hashField(const StructDeclaration* owner, uint32_t name) {
+    auto key = reinterpret_cast<std::uintptr_t>(owner) ^ (uint64_t(name) * 0x9e3779b97f4a7c15ull);
+    return static_cast<size_t>(key ^ (key >> 29));
+}
+
+} // namespace
+
+// NameTable
+
+size_t NameTable::findBucket(std::string_view name, uint32_t hash) const {
+    const size_t mask = buckets.size() - 1;
+    size_t bucket = hash & mask;
+    while (buckets[bucket] != 0) {
+        uint32_t id = buckets[bucket] - 1;
+        if (hashes[id] == hash && names[id] == name) {
+            break;
+        }
+        bucket = (bucket + 1) & mask;
+    }
+    return bucket;
+}
+
+// Keeps the table at most half full.
+void NameTable::grow() {
+    buckets.assign(buckets.empty() ? 64 : buckets.size() * 2, 0);
+    const size_t mask = buckets.size() - 1;
+    for (uint32_t id = 0; id < names.size(); id++) {
+        size_t bucket = hashes[id] & mask;
+        while (buckets[bucket] != 0) {
+            bucket = (bucket + 1) & mask;
+        }
+        buckets[bucket] = id + 1;
+    }
+}
+
+uint32_t NameTable::intern(std::string_view name) {
+    if ((names.size() + 1) * 2 > buckets.size()) {
+        grow();
+    }
+    uint32_t hash = hashName(name);
+    size_t bucket = findBucket(name, hash);
+    if (buckets[bucket] != 0) {
+        return buckets[bucket] - 1;
+    }
+    char* copy = static_cast<char*>(storage.allocate(name.size() + 1, 1));
+    std::memcpy(copy, name.data(), name.size());
+    copy[name.size()] = '\0';
+    uint32_t id = static_cast<uint32_t>(names.size());
+    names.emplace_back(copy, name.size());
+    hashes.push_back(hash);
+    buckets[bucket] = id + 1;
+    return id;
+}
+
+void NameTable::clear() {
+    buckets.clear();
+    names.clear();
+    hashes.clear();
+    storage.release();
+}
+
+uint32_t NameTable::find(std::string_view name) const {
+    if (buckets.empty()) {
+        return NO_NAME;
+    }
+    size_t bucket = findBucket(name, hashName(name));
+    return buckets[bucket] != 0 ? buckets[bucket] - 1 : NO_NAME;
+}
+
+// SymbolTable
+
+void SymbolTable::pushScope() {
+    scopeMarks.push_back(undoLog.size());
+}
+
+void SymbolTable::popScope() {
+    if (scopeMarks.empty()) {
+        return;
+    }
+    size_t mark = scopeMarks.back();
+    scopeMarks.pop_back();
+    while (undoLog.size() > mark) {
+        bindings[undoLog.back().name] = undoLog.back().previous;
+        undoLog.pop_back();
+    }
+}
+
+void SymbolTable::clear() {
+    names.clear();
+    bindings.clear();
+    undoLog.clear();
+    scopeMarks.clear();
+    fields.clear();
+    fieldCount = 0;
+}
+
+void SymbolTable::declare(uint32_t name, Declaration* declaration) {
+    if (name >= bindings.size()) {
+        bindings.resize(names.size(), nullptr);
+    }
+    // Nothing to undo at global scope, which is never popped
+    if (!scopeMarks.empty()) {
+        undoLog.push_back({name, bindings[name]});
+    }
+    bindings[name] = declaration;
+}
+
+void SymbolTable::declareGlobal(uint32_t name, Declaration* declaration) {
+    if (name >= bindings.size()) {
+        bindings.resize(names.size(), nullptr);
+    }
+    bindings[name] = declaration;
+}
+
+size_t SymbolTable::findField(const StructDeclaration* owner, uint32_t name) const {
+    const size_t mask = fields.size() - 1;
+    size_t bucket = hashField(owner, name) & mask;
+    while (fields[bucket].owner && (fields[bucket].owner != owner || fields[bucket].name != name)) {
+        bucket = (bucket + 1) & mask;
+    }
+    return bucket;
+}
+
+void SymbolTable::declareField(const StructDeclaration* owner, uint32_t name,
+                               VariableDeclaration* field) {
+    if ((fieldCount + 1) * 2 > fields.size()) {
+        std::vector<Field> old(fields.empty() ? 64 : fields.size() * 2);
+        old.swap(fields);
+        for (const Field& entry : old) {
+            if (entry.owner) {
+                fields[findField(entry.owner, entry.name)] = entry;
+            }
+        }
+    }
+    Field& entry = fields[findField(owner, name)];
+    if (!entry.owner) {
+        fieldCount++;
+    }
+    entry = {owner, name, field};
+}
+
+VariableDeclaration* SymbolTable::lookupField(const StructDeclaration* owner,
+                                              uint32_t name) const {
+    if (fields.empty() || !owner) {
+        return nullptr;
+    }
+    const Field& entry = fields[findField(owner, name)];
+    return entry.owner ? entry.field : nullptr;
+}
+
+// NameResolver
+
+class NameResolver::Pass : public RecursiveASTVisitor {
+public:
+    explicit Pass(NameResolver& resolver)
+        : resolver(resolver), symbols(resolver.symbols), prelude(resolver.prelude.get()) {}
+
+    void visitIdentifier(Identifier* node) override {
+        Declaration* declaration = lookup(node->getName());
+        node->setDeclaration(declaration);
+        if (declaration) {
+            resolver.resolved++;
+            auto it = variableTypes.find(declaration);
+            if (it != variableTypes.end()) {
+                setStruct(node, it->second);
+            }
+        } else {
+            resolver.unresolved++;
+        }
+    }
+
+    void visitMemberExpression(MemberExpression* node) override {
+        traverse(node->getBase());
+        const StructDeclaration* owner = structOf(node->getBase());
+        VariableDeclaration* field =
+            symbols.lookupField(owner, symbols.getNames().find(node->getMember()));
+        node->setField(field);
+        if (field) {
+            setStruct(node, findStruct(field->getType()));
+        }
+    }
+
+    void visitIndexExpression(IndexExpression* node) override {
+        traverse(node->getBase());
+        const StructDeclaration* element = structOf(node->getBase());
+        traverse(node->getIndex());
+        setStruct(node, element);
+    }
+
+    void visitUnaryExpression(UnaryExpression* node) override {
+        traverse(node->getOperand());
+        if (node->getOperator() == UnaryExpression::Operator::DEREFERENCE) {
+            setStruct(node, structOf(node->getOperand()));
+        }
+    }
+
+    void visitVariableDeclaration(VariableDeclaration* node) override {
+        traverse(node->getArraySize());
+        if (const StructDeclaration* type = findStruct(node->getType())) {
+            variableTypes[node] = type;
+        }
+        if (node->getKind() == VariableDeclaration::Kind::FIELD) {
+            symbols.declareField(currentStruct, symbols.getNames().intern(node->getName()), node);
+        } else {
+            // In scope in its own initializer, as in C++
+            symbols.declare(node->getName(), node);
+        }
+        traverse(node->getInitializer());
+    }
+
+    void visitCompoundStatement(CompoundStatement* node) override {
+        symbols.pushScope();
+        RecursiveASTVisitor::visitCompoundStatement(node);
+        symbols.popScope();
+    }
+
+    void visitForStatement(ForStatement* node) override {
+        symbols.pushScope();
+        RecursiveASTVisitor::visitForStatement(node);
+        symbols.popScope();
+    }
+
+    void visitFunctionDeclaration(FunctionDeclaration* node) override {
+        findStruct(node->getReturnType());
+        // Visible in its own body, for recursion
+        symbols.declare(node->getName(), node);
+        symbols.pushScope();
+        RecursiveASTVisitor::visitFunctionDeclaration(node);
+        symbols.popScope();
+    }
+
+    void visitStructDeclaration(StructDeclaration* node) override {
+        uint32_t name = symbols.getNames().intern(node->getName());
+        symbols.declare(name, node);
+        if (name >= structs.size()) {
+            structs.resize(name + 1, nullptr);
+        }
+        structs[name] = node;
+        const StructDeclaration* outer = currentStruct;
+        currentStruct = node;
+        RecursiveASTVisitor::visitStructDeclaration(node);
+        currentStruct = outer;
+    }
+
+protected:
+    const char* passName() const override { return "resolve"; }
+
+private:
+    NameResolver& resolver;
+    SymbolTable& symbols;
+    const PreludeDeclarations* prelude;
+    // By name ID: names already looked up in the prelude
+    std::vector<bool> preludeChecked;
+    // Structs by name ID
+    std::vector<const StructDeclaration*> structs;
+    std::unordered_map<const Declaration*, const StructDeclaration*> variableTypes;
+    const StructDeclaration* currentStruct = nullptr;
+    // The struct type of the expression visited last, so a member access
+    // can look at its base once the base has been resolved
+    const Expression* typedExpression = nullptr;
+    const StructDeclaration* expressionStruct = nullptr;
+
+    // The innermost declaration of `name`, or the prelude's when the unit
+    // has none. Prelude declarations are bound as globals when first used.
+    Declaration* lookup(std::string_view name) {
+        Declaration* declaration = symbols.lookup(name);
+        if (declaration || !prelude) {
+            return declaration;
+        }
+        uint32_t id = symbols.getNames().intern(name);
+        if (id >= preludeChecked.size()) {
+            preludeChecked.resize(symbols.getNames().size(), false);
+        }
+        if (preludeChecked[id]) {
+            return nullptr;
+        }
+        preludeChecked[id] = true;
+        const std::vector<Declaration*>& declarations = prelude->find(name);
+        if (declarations.empty()) {
+            return nullptr;
+        }
+        // The last declaration is the one visible after the prelude
+        declaration = declarations.back();
+        symbols.declareGlobal(id, declaration);
+        switch (getNodeKind(declaration)) {
+            case NodeKind::StructDeclaration: {
+                auto* type = static_cast<StructDeclaration*>(declaration);
+                if (id >= structs.size()) {
+                    structs.resize(id + 1, nullptr);
+                }
+                structs[id] = type;
+                for (const auto& field : type->getFields()) {
+                    symbols.declareField(type, symbols.getNames().intern(field->getName()),
+                                         field.get());
+                    findStruct(field->getType());
+                }
+                break;
+            }
+            case NodeKind::VariableDeclaration: {
+                auto* variable = static_cast<VariableDeclaration*>(declaration);
+                if (const StructDeclaration* type = findStruct(variable->getType())) {
+                    variableTypes[variable] = type;
+                }
+                break;
+            }
+            case NodeKind::FunctionDeclaration:
+                for (Declaration* overload : declarations) {
+                    if (getNodeKind(overload) != NodeKind::FunctionDeclaration) {
+                        continue;
+                    }
+                    auto* function = static_cast<FunctionDeclaration*>(overload);
+                    findStruct(function->getReturnType());
+                    for (const auto& parameter : function->getParameters()) {
+                        findStruct(parameter->getType());
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+        return declaration;
+    }
+
+    const StructDeclaration* findStruct(const TypeSpec& type) {
+        Declaration* declaration = lookup(type.name);
+        uint32_t name = symbols.getNames().find(type.name);
+        return declaration && name < structs.size() && declaration == structs[name]
+                   ? structs[name]
+                   : nullptr;
+    }
+
+    void setStruct(const Expression* expression, const StructDeclaration* type) {
+        typedExpression = expression;
+        expressionStruct = type;
+    }
+
+    const StructDeclaration* structOf(const Expression* expression) const {
+        return expression == typedExpression ? expressionStruct : nullptr;
+    }
+};
+
+void NameResolver::resolve(TranslationUnit* unit) {
+    symbols.clear();
+    resolved = 0;
+    unresolved = 0;
+    Pass pass(*this);
+    pass.traverse(unit);
+}
+
+} // namespace msl_parser
@@ -124,6 +124,10 @@ const char* tokenTypeToString(TokenType type) {
         case TokenType::ATTRIBUTE_LEFT: return "ATTRIBUTE_LEFT";
         case TokenType::ATTRIBUTE_RIGHT: return "ATTRIBUTE_RIGHT";
         
+        // Preprocessor
+        case TokenType::HASH: return "HASH";
+        case TokenType::HASH_HASH: return "HASH_HASH";
+        
         // Special
         case TokenType::END_OF_FILE: return "END_OF_FILE";
         
@@ -131,4 +135,96 @@ const char* tokenTypeToString(TokenType type) {
     }
 }
 
+const char* tokenTypeSpelling(TokenType type) {
+    switch (type) {
+        case TokenType::VOID: return "void";
+        case TokenType::BOOL: return "bool";
+        case TokenType::INT: return "int";
+        case TokenType::UINT: return "uint";
+        case TokenType::SHORT: return "short";
+        case TokenType::USHORT: return "ushort";
+        case TokenType::CHAR: return "char";
+        case TokenType::UCHAR: return "uchar";
+        case TokenType::FLOAT: return "float";
+        case TokenType::HALF: return "half";
+        case TokenType::DOUBLE: return "double";
+        case TokenType::FLOAT2: return "float2";
+        case TokenType::FLOAT3: return "float3";
+        case TokenType::FLOAT4: return "float4";
+        case TokenType::INT2: return "int2";
+        case TokenType::INT3: return "int3";
+        case TokenType::INT4: return "int4";
+        case TokenType::UINT2: return "uint2";
+        case TokenType::UINT3: return "uint3";
+        case TokenType::UINT4: return "uint4";
+        case TokenType::FLOAT2X2: return "float2x2";
+        case TokenType::FLOAT3X3: return "float3x3";
+        case TokenType::FLOAT4X4: return "float4x4";
+        case TokenType::IF: return "if";
+        case TokenType::ELSE: return "else";
+        case TokenType::FOR: return "for";
+        case TokenType::WHILE: return "while";
+        case TokenType::DO: return "do";
+        case TokenType::SWITCH: return "switch";
+        case TokenType::CASE: return "case";
+        case TokenType::DEFAULT: return "default";
+        case TokenType::BREAK: return "break";
+        case TokenType::CONTINUE: return "continue";
+        case TokenType::RETURN: return "return";
+        case TokenType::KERNEL: return "kernel";
+        case TokenType::VERTEX: return "vertex";
+        case TokenType::FRAGMENT: return "fragment";
+        case TokenType::DEVICE: return "device";
+        case TokenType::CONSTANT: return "constant";
+        case TokenType::THREAD: return "thread";
+        case TokenType::THREADGROUP: return "threadgroup";
+        case TokenType::PLUS: return "+";
+        case TokenType::MINUS: return "-";
+        case TokenType::MULTIPLY: return "*";
+        case TokenType::DIVIDE: return "/";
+        case TokenType::MODULO: return "%";
+        case TokenType::ASSIGN: return "=";
+        case TokenType::PLUS_ASSIGN: return "+=";
+        case TokenType::MINUS_ASSIGN: return "-=";
+        case TokenType::MULTIPLY_ASSIGN: return "*=";
+        case TokenType::DIVIDE_ASSIGN: return "/=";
+        case TokenType::MODULO_ASSIGN: return "%=";
+        case TokenType::EQUAL: return "==";
+        case TokenType::NOT_EQUAL: return "!=";
+        case TokenType::LESS_THAN: return "<";
+        case TokenType::GREATER_THAN: return ">";
+        case TokenType::LESS_EQUAL: return "<=";
+        case TokenType::GREATER_EQUAL: return ">=";
+        case TokenType::AND: return "&&";
+        case TokenType::OR: return "||";
+        case TokenType::NOT: return "!";
+        case TokenType::BITWISE_AND: return "&";
+        case TokenType::BITWISE_OR: return "|";
+        case TokenType::BITWISE_XOR: return "^";
+        case TokenType::BITWISE_NOT: return "~";
+        case TokenType::LEFT_SHIFT: return "<<";
+        case TokenType::RIGHT_SHIFT: return ">>";
+        case TokenType::PLUS_PLUS: return "++";
+        case TokenType::MINUS_MINUS: return "--";
+        case TokenType::QUESTION: return "?";
+        case TokenType::COLON: return ":";
+        case TokenType::LEFT_PAREN: return "(";
+        case TokenType::RIGHT_PAREN: return ")";
+        case TokenType::LEFT_BRACE: return "{";
+        case TokenType::RIGHT_BRACE: return "}";
+        case TokenType::LEFT_BRACKET: return "[";
+        case TokenType::RIGHT_BRACKET: return "]";
+        case TokenType::SEMICOLON: return ";";
+        case TokenType::COMMA: return ",";
+        case TokenType::DOT: return ".";
+        case TokenType::ARROW: return "->";
+        case TokenType::SCOPE_RESOLUTION: return "::";
+        case TokenType::ATTRIBUTE_LEFT: return "[[";
+        case TokenType::ATTRIBUTE_RIGHT: return "]]";
+        case TokenType::HASH: return "#";
+        case TokenType::HASH_HASH: return "##";
+        default: return tokenTypeToString(type);
+    }
+}
+
 } // namespace msl_parser
\ No newline at end of file
@@ -0,0 +1,57 @@
+#include "msl_parser/trivia.h"
+
+namespace msl_parser {
+
+TriviaTable::TriviaTable(std::string_view source, const std::pmr::vector<Token>& tokens) {
+    firstPiece.reserve(tokens.size() + 1);
+    uint32_t position = 0;
+    for (const Token& token : tokens) {
+        firstPiece.push_back(static_cast<uint32_t>(pieces.size()));
+        split(source, position, token.offset);
+        position = token.endOffset();
+    }
+    firstPiece.push_back(static_cast<uint32_t>(pieces.size()));
+}
+
+uint32_t TriviaTable::leadingLength(size_t index) const {
+    Range range = leading(index);
+    return range.empty() ? 0 : range.last[-1].offset + range.last[-1].length - range.first->offset;
+}
+
+// Splits the gap [begin, end) the way Lexer::scanToken skipped it.
+void TriviaTable::split(std::string_view source, uint32_t begin, uint32_t end) {
+    uint32_t position = begin;
+    while (position < end) {
+        uint32_t start = position;
+        char c = source[position++];
+        TriviaKind kind;
+        if (c == ' ' || c == '\t' || c == '\r') {
+            while (position < end &&
+                   (source[position] == ' ' || source[position] == '\t' || source[position] == '\r')) {
+                position++;
+            }
+            kind = TriviaKind::WHITESPACE;
+        } else if (c == '\n') {
+            kind = TriviaKind::NEWLINE;
+        } else if (c == '/' && position < end && source[position] == '/') {
+            while (position < end && source[position] != '\n') {
+                position++;
+            }
+            kind = TriviaKind::LINE_COMMENT;
+        } else if (c == '/' && position < end && source[position] == '*') {
+            size_t close = source.substr(0, end).find("*/", position + 1);
+            position = close == std::string_view::npos ? end : static_cast<uint32_t>(close + 2);
+            kind = TriviaKind::BLOCK_COMMENT;
+        } else if (c == '\\' && position < end &&
+                   (source[position] == '\n' ||
+                    (source[position] == '\r' && position + 1 < end && source[position + 1] == '\n'))) {
+            position += source[position] == '\r' ? 2 : 1;
+            kind = TriviaKind::LINE_CONTINUATION;
+        } else {
+            kind = TriviaKind::SKIPPED;
+        }
+        pieces.push_back({start, position - start, kind});
+    }
+}
+
+} // namespace msl_parser
@@ -0,0 +1,842 @@
+#include "msl_parser/type_checker.h"
+#include <algorithm>
+#include <unordered_map>
+#include "msl_parser/ast/recursive_visitor.h"
+#include "msl_parser/prelude.h"
+#include "msl_parser/stats.h"
+
+namespace msl_parser {
+
+using namespace ast;
+
+namespace {
+
+// How the result of a built-in function is typed from its arguments.
+enum class BuiltinResult : uint8_t {
+    COMPONENT_WISE,  // the widest argument: a vector if any argument is one
+    ELEMENT,         // the element type of the first argument (dot, length, ...)
+    BOOL_LIKE,       // a bool, or bool vector, shaped like the first argument
+    BOOL,
+    TRANSPOSE
+};
+
+const std::unordered_map<std::string_view, BuiltinResult>& builtinFunctions() {
+    static const std::unordered_map<std::string_view, BuiltinResult> functions = [] {
+        std::unordered_map<std::string_view, BuiltinResult> table;
+        for (const char* name :
+             {"abs",     "acos",      "asin",       "atan",    "atan2",   "ceil",   "clamp",
+              "copysign", "cos",      "cosh",       "cross",   "degrees", "exp",    "exp2",
+              "exp10",   "faceforward", "fdim",     "floor",   "fma",     "fmax",   "fmin",
+              "fmod",    "fract",     "log",        "log2",    "log10",   "max",    "min",
+              "mix",     "normalize", "pow",        "powr",    "radians", "reflect", "refract",
+              "rint",    "round",     "rsqrt",      "saturate", "select", "sign",   "sin",
+              "sinh",    "smoothstep", "sqrt",      "step",    "tan",     "tanh",   "trunc"}) {
+            table.emplace(name, BuiltinResult::COMPONENT_WISE);
+        }
+        for (const char* name : {"dot", "length", "length_squared", "distance",
+                                 "distance_squared", "determinant"}) {
+            table.emplace(name, BuiltinResult::ELEMENT);
+        }
+        for (const char* name : {"isnan", "isinf", "isfinite", "isnormal", "signbit"}) {
+            table.emplace(name, BuiltinResult::BOOL_LIKE);
+        }
+        table.emplace("all", BuiltinResult::BOOL);
+        table.emplace("any", BuiltinResult::BOOL);
+        table.emplace("transpose", BuiltinResult::TRANSPOSE);
+        return table;
+    }();
+    return functions;
+}
+
+bool isFloatingPoint(ScalarType type) {
+    return type == ScalarType::HALF || type == ScalarType::FLOAT;
+}
+
+// The usual arithmetic conversions: types below int are promoted to int,
+// then the higher-ranked type wins.
+ScalarType commonScalar(ScalarType a, ScalarType b) {
+    if (a < ScalarType::INT) {
+        a = ScalarType::INT;
+    }
+    if (b < ScalarType::INT) {
+        b = ScalarType::INT;
+    }
+    return a > b ? a : b;
+}
+
+// Finds the callee of a call by name.
+class IdentifierFinder : public ASTVisitor {
+public:
+    Identifier* identifier = nullptr;
+
+#define AST_NODE(CLASS) \
+    void visit##CLASS(CLASS* node) override { found(node); }
+#include "msl_parser/ast/ast_nodes.def"
+#undef AST_NODE
+
+private:
+    void found(Identifier* node) { identifier = node; }
+    void found(ASTNode*) {}
+};
+
+uint32_t offsetOf(const ASTNode* node) {
+    return static_cast<uint32_t>(node->getSourceRange().start.offset);
+}
+
+// The index of a swizzle letter in its set ("xyzw" or "rgba"), or -1.
+int swizzleIndex(char c, const char* set) {
+    for (int i = 0; i < 4; i++) {
+        if (set[i] == c) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+} // namespace
+
+class TypeChecker::Pass : public RecursiveASTVisitor {
+public:
+    Pass(TypeChecker& checker)
+        : types(checker.types), symbols(checker.resolver.getSymbols()),
+          prelude(checker.resolver.getPrelude().get()), diagnostics(checker.diagnostics) {}
+
+    // Expressions, typed after their operands
+
+    void visitIntegerLiteral(IntegerLiteral* node) override {
+        node->setTypeId(TypeTable::scalar(ScalarType::INT));
+    }
+
+    void visitFloatLiteral(FloatLiteral* node) override {
+        node->setTypeId(TypeTable::scalar(ScalarType::FLOAT));
+    }
+
+    void visitBoolLiteral(BoolLiteral* node) override {
+        node->setTypeId(TypeTable::scalar(ScalarType::BOOL));
+    }
+
+    void visitIdentifier(Identifier* node) override {
+        Declaration* declaration = node->getDeclaration();
+        bool variable = declaration && getNodeKind(declaration) == NodeKind::VariableDeclaration;
+        node->setTypeId(variable ? variableType(static_cast<VariableDeclaration*>(declaration))
+                                 : TypeTable::UNKNOWN);
+    }
+
+    void visitUnaryExpression(UnaryExpression* node) override {
+        traverse(node->getOperand());
+        node->setTypeId(unary(node->getOperator(), node->getOperand()->getTypeId(), node));
+    }
+
+    void visitBinaryExpression(BinaryExpression* node) override {
+        traverse(node->getLeft());
+        traverse(node->getRight());
+        node->setTypeId(binary(node));
+    }
+
+    void visitConditionalExpression(ConditionalExpression* node) override {
+        RecursiveASTVisitor::visitConditionalExpression(node);
+        checkCondition(node->getCondition());
+        TypeId left = node->getTrueExpression()->getTypeId();
+        TypeId right = node->getFalseExpression()->getTypeId();
+        TypeId result = TypeTable::UNKNOWN;
+        if (left == right || right == TypeTable::UNKNOWN) {
+            result = left;
+        } else if (left == TypeTable::UNKNOWN) {
+            result = right;
+        } else if (isArithmetic(left) && isArithmetic(right)) {
+            result = arithmetic(BinaryExpression::Operator::ADD, left, right);
+        } else if (convertible(right, left)) {
+            result = left;
+        } else if (convertible(left, right)) {
+            result = right;
+        }
+        if (result == TypeTable::UNKNOWN && left != TypeTable::UNKNOWN &&
+            right != TypeTable::UNKNOWN) {
+            report(DiagID::INCOMPATIBLE_TYPES, node->getFalseExpression());
+        }
+        node->setTypeId(result);
+    }
+
+    void visitCallExpression(CallExpression* node) override {
+        RecursiveASTVisitor::visitCallExpression(node);
+        node->setTypeId(call(node));
+    }
+
+    void visitConstructExpression(ConstructExpression* node) override {
+        RecursiveASTVisitor::visitConstructExpression(node);
+        TypeId type = typeOf(node->getType());
+        construct(type, node->getArguments(), node);
+        node->setTypeId(type);
+    }
+
+    void visitCastExpression(CastExpression* node) override {
+        RecursiveASTVisitor::visitCastExpression(node);
+        node->setTypeId(typeOf(node->getType()));
+    }
+
+    void visitMemberExpression(MemberExpression* node) override {
+        traverse(node->getBase());
+        node->setTypeId(member(node));
+    }
+
+    void visitIndexExpression(IndexExpression* node) override {
+        traverse(node->getBase());
+        traverse(node->getIndex());
+        const Type& base = types.get(node->getBase()->getTypeId());
+        TypeId result = TypeTable::UNKNOWN;
+        switch (base.kind) {
+            case TypeKind::VECTOR:
+                result = TypeTable::scalar(base.scalar);
+                break;
+            case TypeKind::MATRIX:  // a column
+                result = TypeTable::vector(base.scalar, base.rows);
+                break;
+            case TypeKind::POINTER:
+            case TypeKind::ARRAY:
+                result = base.element;
+                break;
+            case TypeKind::UNKNOWN:
+            case TypeKind::OPAQUE:  // e.g. array<T, N>
+                break;
+            default:
+                report(DiagID::NOT_SUBSCRIPTABLE, node->getBase());
+                break;
+        }
+        node->setTypeId(result);
+    }
+
+    // Declarations and statements
+
+    void visitVariableDeclaration(VariableDeclaration* node) override {
+        TypeId type = typeOf(node->getType());
+        if (node->getArraySize()) {
+            traverse(node->getArraySize());
+            type = types.array(type);
+        }
+        variableTypes[node] = type;
+        if (Expression* initializer = node->getInitializer()) {
+            traverse(initializer);
+            checkConversion(initializer, type);
+        }
+    }
+
+    void visitFunctionDeclaration(FunctionDeclaration* node) override {
+        for (const auto& parameter : node->getParameters()) {
+            traverse(parameter.get());
+        }
+        returnTypes[node] = typeOf(node->getReturnType());
+        // A definition replaces its prototype
+        auto& overloads = functions[node->getName()];
+        auto previous = std::find_if(overloads.begin(), overloads.end(),
+                                     [&](const FunctionDeclaration* other) {
+                                         return sameParameters(node, other);
+                                     });
+        if (previous != overloads.end()) {
+            *previous = node;
+        } else {
+            overloads.push_back(node);
+        }
+        const FunctionDeclaration* outer = currentFunction;
+        currentFunction = node;
+        traverse(node->getBody());
+        currentFunction = outer;
+    }
+
+    void visitReturnStatement(ReturnStatement* node) override {
+        RecursiveASTVisitor::visitReturnStatement(node);
+        if (!currentFunction) {
+            return;
+        }
+        TypeId returnType = returnTypes[currentFunction];
+        if (returnType == TypeTable::VOID) {
+            if (node->getValue() && node->getValue()->getTypeId() != TypeTable::VOID) {
+                report(DiagID::RETURN_VALUE_IN_VOID_FUNCTION, node->getValue());
+            }
+        } else if (!node->getValue()) {
+            if (returnType != TypeTable::UNKNOWN) {
+                report(DiagID::MISSING_RETURN_VALUE, node);
+            }
+        } else {
+            checkConversion(node->getValue(), returnType);
+        }
+    }
+
+    void visitIfStatement(IfStatement* node) override {
+        RecursiveASTVisitor::visitIfStatement(node);
+        checkCondition(node->getCondition());
+    }
+
+    void visitForStatement(ForStatement* node) override {
+        RecursiveASTVisitor::visitForStatement(node);
+        if (node->getCondition()) {
+            checkCondition(node->getCondition());
+        }
+    }
+
+    void visitWhileStatement(WhileStatement* node) override {
+        RecursiveASTVisitor::visitWhileStatement(node);
+        checkCondition(node->getCondition());
+    }
+
+    void visitDoStatement(DoStatement* node) override {
+        RecursiveASTVisitor::visitDoStatement(node);
+        checkCondition(node->getCondition());
+    }
+
+protected:
+    const char* passName() const override { return "typecheck"; }
+
+private:
+    TypeTable& types;
+    const SymbolTable& symbols;
+    const PreludeDeclarations* prelude;
+    DiagnosticEngine* diagnostics;
+    std::unordered_map<const Declaration*, TypeId> variableTypes;
+    std::unordered_map<const Declaration*, TypeId> returnTypes;
+    // Overloads by name, in declaration order
+    std::unordered_map<std::string_view, std::vector<const FunctionDeclaration*>> functions;
+    const FunctionDeclaration* currentFunction = nullptr;
+
+    bool sameParameters(const FunctionDeclaration* a, const FunctionDeclaration* b) {
+        const auto& left = a->getParameters();
+        const auto& right = b->getParameters();
+        if (left.size() != right.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < left.size(); i++) {
+            if (variableTypes[left[i].get()] != variableTypes[right[i].get()]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void report(DiagID id, const ASTNode* node) {
+        if (diagnostics) {
+            diagnostics->report(id, offsetOf(node));
+        }
+    }
+
+    bool isArithmetic(TypeId id) const {
+        TypeKind kind = types.get(id).kind;
+        return kind == TypeKind::SCALAR || kind == TypeKind::VECTOR || kind == TypeKind::MATRIX;
+    }
+
+    TypeId typeOf(const TypeSpec& spec) {
+        TypeId type = TypeTable::findBuiltin(spec.name);
+        if (type == TypeTable::UNKNOWN) {
+            // Structs are global; one declared later is found too
+            type = structType(symbols.lookup(spec.name));
+            if (type == TypeTable::UNKNOWN) {
+                type = types.opaque(spec.name);
+            }
+        }
+        for (int i = 0; i < spec.pointerDepth; i++) {
+            type = types.pointer(type, spec.addressSpace);
+        }
+        return type;
+    }
+
+    // The type of `declaration` if it is a struct, or UNKNOWN.
+    TypeId structType(Declaration* declaration) {
+        if (!declaration || getNodeKind(declaration) != NodeKind::StructDeclaration) {
+            return TypeTable::UNKNOWN;
+        }
+        return types.structType(static_cast<const StructDeclaration*>(declaration));
+    }
+
+    // The type of a variable, parameter or field. Those of the prelude are
+    // never visited; their types are worked out from the declaration alone,
+    // leaving the prelude's nodes as they are.
+    TypeId variableType(VariableDeclaration* variable) {
+        auto it = variableTypes.find(variable);
+        if (it != variableTypes.end()) {
+            return it->second;
+        }
+        TypeId type = typeOf(variable->getType());
+        if (variable->getArraySize()) {
+            type = types.array(type);
+        }
+        variableTypes.emplace(variable, type);
+        return type;
+    }
+
+    // Adds the prelude's overloads of `name` ahead of the unit's, as if the
+    // prelude were included first.
+    void declarePreludeFunctions(std::string_view name) {
+        if (!prelude) {
+            return;
+        }
+        size_t position = 0;
+        for (Declaration* declaration : prelude->find(name)) {
+            if (getNodeKind(declaration) != NodeKind::FunctionDeclaration ||
+                returnTypes.count(declaration)) {
+                continue;
+            }
+            auto* function = static_cast<FunctionDeclaration*>(declaration);
+            for (const auto& parameter : function->getParameters()) {
+                variableType(parameter.get());
+            }
+            returnTypes[function] = typeOf(function->getReturnType());
+            auto& overloads = functions[function->getName()];
+            overloads.insert(overloads.begin() + position++, function);
+        }
+    }
+
+    // Implicit conversions: between scalars, from a scalar to a vector, and
+    // from an array to a pointer to its elements.
+    bool convertible(TypeId from, TypeId to) const {
+        if (from == to || from == TypeTable::UNKNOWN || to == TypeTable::UNKNOWN) {
+            return true;
+        }
+        const Type& source = types.get(from);
+        const Type& target = types.get(to);
+        if (source.kind == TypeKind::SCALAR) {
+            return target.kind == TypeKind::SCALAR || target.kind == TypeKind::VECTOR;
+        }
+        if (source.kind == TypeKind::ARRAY && target.kind == TypeKind::POINTER) {
+            return source.element == target.element;
+        }
+        // Pointers convert between address spaces only as the same type;
+        // opaque types are left to the Metal compiler
+        if (source.kind == TypeKind::POINTER && target.kind == TypeKind::POINTER) {
+            return source.element == target.element;
+        }
+        return source.kind == TypeKind::OPAQUE || target.kind == TypeKind::OPAQUE;
+    }
+
+    void checkConversion(const Expression* expression, TypeId to) {
+        if (types.get(to).kind == TypeKind::ARRAY) {
+            return;  // initializer lists are not parsed
+        }
+        if (!convertible(expression->getTypeId(), to)) {
+            report(DiagID::INCOMPATIBLE_TYPES, expression);
+        }
+    }
+
+    void checkCondition(const Expression* condition) {
+        TypeKind kind = types.get(condition->getTypeId()).kind;
+        if (kind != TypeKind::SCALAR && kind != TypeKind::POINTER && kind != TypeKind::UNKNOWN &&
+            kind != TypeKind::OPAQUE) {
+            report(DiagID::INVALID_CONDITION_TYPE, condition);
+        }
+    }
+
+    // The result of `left op right` for an arithmetic operator, or UNKNOWN
+    // when the operands do not allow it.
+    TypeId arithmetic(BinaryExpression::Operator op, TypeId left, TypeId right) {
+        using Op = BinaryExpression::Operator;
+        const Type& l = types.get(left);
+        const Type& r = types.get(right);
+
+        if (l.kind == TypeKind::POINTER || l.kind == TypeKind::ARRAY) {
+            if ((op == Op::ADD || op == Op::SUBTRACT) && r.kind == TypeKind::SCALAR &&
+                !isFloatingPoint(r.scalar)) {
+                // An array decays to a pointer to its first element
+                return l.kind == TypeKind::POINTER ? left
+                                                   : types.pointer(l.element, AddressSpace::NONE);
+            }
+            if (op == Op::SUBTRACT && left == right) {
+                return TypeTable::scalar(ScalarType::INT);
+            }
+            return TypeTable::UNKNOWN;
+        }
+        if (!isArithmetic(left) || !isArithmetic(right)) {
+            return TypeTable::UNKNOWN;
+        }
+        ScalarType element = commonScalar(l.scalar, r.scalar);
+        if (op == Op::MODULO && isFloatingPoint(element)) {
+            return TypeTable::UNKNOWN;
+        }
+
+        if (l.kind == TypeKind::MATRIX || r.kind == TypeKind::MATRIX) {
+            if (l.kind == TypeKind::MATRIX && r.kind == TypeKind::MATRIX) {
+                if (op == Op::MULTIPLY && l.columns == r.rows && l.scalar == r.scalar) {
+                    return TypeTable::matrix(l.scalar, r.columns, l.rows);
+                }
+                return (op == Op::ADD || op == Op::SUBTRACT) && left == right ? left
+                                                                               : TypeTable::UNKNOWN;
+            }
+            const Type& matrix = l.kind == TypeKind::MATRIX ? l : r;
+            const Type& other = l.kind == TypeKind::MATRIX ? r : l;
+            if (other.kind == TypeKind::SCALAR) {
+                bool allowed = op == Op::MULTIPLY || (op == Op::DIVIDE && &matrix == &l);
+                return allowed ? (&matrix == &l ? left : right) : TypeTable::UNKNOWN;
+            }
+            if (op != Op::MULTIPLY || other.scalar != matrix.scalar) {
+                return TypeTable::UNKNOWN;
+            }
+            if (&matrix == &l && other.rows == matrix.columns) {  // M * v
+                return TypeTable::vector(matrix.scalar, matrix.rows);
+            }
+            if (&matrix == &r && other.rows == matrix.rows) {     // v * M
+                return TypeTable::vector(matrix.scalar, matrix.columns);
+            }
+            return TypeTable::UNKNOWN;
+        }
+
+        if (l.kind == TypeKind::VECTOR && r.kind == TypeKind::VECTOR) {
+            return left == right ? left : TypeTable::UNKNOWN;
+        }
+        if (l.kind == TypeKind::VECTOR) {
+            return left;
+        }
+        if (r.kind == TypeKind::VECTOR) {
+            return right;
+        }
+        return TypeTable::scalar(element);
+    }
+
+    TypeId binary(BinaryExpression* node) {
+        using Op = BinaryExpression::Operator;
+        Op op = node->getOperator();
+        TypeId left = node->getLeft()->getTypeId();
+        TypeId right = node->getRight()->getTypeId();
+        if (left == TypeTable::UNKNOWN || right == TypeTable::UNKNOWN) {
+            return op == Op::ASSIGN || node->isAssignment() ? left : TypeTable::UNKNOWN;
+        }
+
+        if (op == Op::ASSIGN) {
+            checkConversion(node->getRight(), left);
+            return left;
+        }
+        if (node->isAssignment()) {
+            static const Op ARITHMETIC_OF[] = {Op::ADD, Op::SUBTRACT, Op::MULTIPLY, Op::DIVIDE,
+                                               Op::MODULO};
+            Op arithmeticOp = ARITHMETIC_OF[static_cast<int>(op) - static_cast<int>(Op::ADD_ASSIGN)];
+            TypeId result = arithmetic(arithmeticOp, left, right);
+            if (result == TypeTable::UNKNOWN) {
+                report(DiagID::INVALID_OPERANDS, node);
+            } else if (!convertible(result, left)) {
+                report(DiagID::INCOMPATIBLE_TYPES, node->getRight());
+            }
+            return left;
+        }
+
+        TypeId result = TypeTable::UNKNOWN;
+        switch (op) {
+            case Op::LOGICAL_AND:
+            case Op::LOGICAL_OR: {
+                TypeKind l = types.get(left).kind;
+                TypeKind r = types.get(right).kind;
+                if ((l == TypeKind::SCALAR || l == TypeKind::POINTER) &&
+                    (r == TypeKind::SCALAR || r == TypeKind::POINTER)) {
+                    result = TypeTable::scalar(ScalarType::BOOL);
+                }
+                break;
+            }
+            case Op::EQUAL:
+            case Op::NOT_EQUAL:
+            case Op::LESS_THAN:
+            case Op::GREATER_THAN:
+            case Op::LESS_EQUAL:
+            case Op::GREATER_EQUAL: {
+                if (types.get(left).kind == TypeKind::POINTER && left == right) {
+                    result = TypeTable::scalar(ScalarType::BOOL);
+                    break;
+                }
+                TypeId compared = arithmetic(Op::SUBTRACT, left, right);
+                const Type& type = types.get(compared);
+                if (type.kind == TypeKind::SCALAR || type.kind == TypeKind::VECTOR) {
+                    result = TypeTable::vector(ScalarType::BOOL, type.rows);
+                }
+                break;
+            }
+            case Op::BITWISE_AND:
+            case Op::BITWISE_OR:
+            case Op::BITWISE_XOR:
+            case Op::LEFT_SHIFT:
+            case Op::RIGHT_SHIFT: {
+                TypeId combined = arithmetic(Op::ADD, left, right);
+                const Type& type = types.get(combined);
+                bool integral = (type.kind == TypeKind::SCALAR || type.kind == TypeKind::VECTOR) &&
+                                !isFloatingPoint(type.scalar) &&
+                                !isFloatingPoint(types.get(left).scalar) &&
+                                !isFloatingPoint(types.get(right).scalar);
+                if (integral) {
+                    // A shift has the type of its left operand
+                    bool shift = op == Op::LEFT_SHIFT || op == Op::RIGHT_SHIFT;
+                    result = shift && types.get(left).kind == TypeKind::VECTOR ? left : combined;
+                }
+                break;
+            }
+            default:
+                result = arithmetic(op, left, right);
+                break;
+        }
+        if (result == TypeTable::UNKNOWN) {
+            report(DiagID::INVALID_OPERANDS, node);
+        }
+        return result;
+    }
+
+    TypeId unary(UnaryExpression::Operator op, TypeId operand, UnaryExpression* node) {
+        using Op = UnaryExpression::Operator;
+        if (operand == TypeTable::UNKNOWN) {
+            return TypeTable::UNKNOWN;
+        }
+        const Type& type = types.get(operand);
+        bool numeric = type.kind == TypeKind::SCALAR || type.kind == TypeKind::VECTOR;
+        TypeId result = TypeTable::UNKNOWN;
+        switch (op) {
+            case Op::NEGATE:
+            case Op::PLUS:
+                result = isArithmetic(operand) ? operand : TypeTable::UNKNOWN;
+                break;
+            case Op::NOT:
+                if (numeric) {
+                    result = TypeTable::vector(ScalarType::BOOL, type.rows);
+                } else if (type.kind == TypeKind::POINTER) {
+                    result = TypeTable::scalar(ScalarType::BOOL);
+                }
+                break;
+            case Op::BITWISE_NOT:
+                result = numeric && !isFloatingPoint(type.scalar) ? operand : TypeTable::UNKNOWN;
+                break;
+            case Op::PRE_INCREMENT:
+            case Op::PRE_DECREMENT:
+            case Op::POST_INCREMENT:
+            case Op::POST_DECREMENT:
+                result = numeric || type.kind == TypeKind::POINTER ? operand : TypeTable::UNKNOWN;
+                break;
+            case Op::ADDRESS_OF:
+                return types.pointer(operand, AddressSpace::NONE);
+            case Op::DEREFERENCE:
+                if (type.kind == TypeKind::POINTER || type.kind == TypeKind::ARRAY) {
+                    result = type.element;
+                } else if (type.kind == TypeKind::OPAQUE) {
+                    return TypeTable::UNKNOWN;
+                }
+                break;
+        }
+        if (result == TypeTable::UNKNOWN) {
+            report(DiagID::INVALID_UNARY_OPERAND, node);
+        }
+        return result;
+    }
+
+    // Components `arguments` provide to a vector or matrix constructor, or
+    // -1 if that is unknown.
+    int components(const NodeList<Expression>& arguments) const {
+        int count = 0;
+        for (const auto& argument : arguments) {
+            const Type& type = types.get(argument->getTypeId());
+            if (type.kind == TypeKind::SCALAR) {
+                count += 1;
+            } else if (type.kind == TypeKind::VECTOR) {
+                count += type.rows;
+            } else if (type.kind == TypeKind::MATRIX) {
+                count += type.rows * type.columns;
+            } else {
+                return -1;
+            }
+        }
+        return count;
+    }
+
+    void construct(TypeId target, const NodeList<Expression>& arguments,
+                   const Expression* node) {
+        const Type& type = types.get(target);
+        int expected;
+        switch (type.kind) {
+            case TypeKind::SCALAR:
+                expected = 1;
+                break;
+            case TypeKind::VECTOR:
+                expected = type.rows;
+                break;
+            case TypeKind::MATRIX:
+                expected = type.rows * type.columns;
+                break;
+            default:
+                return;
+        }
+        int given = components(arguments);
+        if (given < 0) {
+            return;
+        }
+        // One scalar fills a vector, or the diagonal of a matrix
+        bool splat = arguments.size() == 1 && types.get(arguments[0]->getTypeId()).kind ==
+                                                  TypeKind::SCALAR;
+        if (given != expected && !splat) {
+            if (diagnostics) {
+                Diagnostic diagnostic;
+                diagnostic.id = DiagID::CONSTRUCTOR_COMPONENTS;
+                diagnostic.argCount = 2;
+                diagnostic.argKinds[0] = DiagArgKind::INTEGER;
+                diagnostic.argKinds[1] = DiagArgKind::INTEGER;
+                diagnostic.args[0] = static_cast<uint32_t>(expected);
+                diagnostic.args[1] = static_cast<uint32_t>(given);
+                diagnostic.offset = offsetOf(node);
+                diagnostics->report(diagnostic);
+            }
+        }
+    }
+
+    TypeId call(CallExpression* node) {
+        const auto& arguments = node->getArguments();
+        // Calls through a member, e.g. texture.sample(...), are not typed
+        IdentifierFinder finder;
+        node->getCallee()->accept(&finder);
+        Identifier* callee = finder.identifier;
+        if (!callee) {
+            return TypeTable::UNKNOWN;
+        }
+        if (Declaration* declaration = callee->getDeclaration()) {
+            TypeId type = structType(declaration);
+            if (type != TypeTable::UNKNOWN) {
+                return type;
+            }
+            if (!returnTypes.count(declaration) &&
+                getNodeKind(declaration) == NodeKind::FunctionDeclaration) {
+                declarePreludeFunctions(callee->getName());
+            }
+            if (returnTypes.count(declaration)) {
+                return callFunction(functions[callee->getName()], arguments, node);
+            }
+            return TypeTable::UNKNOWN;
+        }
+        // half4(...), uchar2(...) and other types without a keyword
+        TypeId type = TypeTable::findBuiltin(callee->getName());
+        if (type != TypeTable::UNKNOWN) {
+            construct(type, arguments, node);
+            return type;
+        }
+        auto builtin = builtinFunctions().find(callee->getName());
+        if (builtin == builtinFunctions().end() || arguments.empty()) {
+            return TypeTable::UNKNOWN;
+        }
+        TypeId first = arguments[0]->getTypeId();
+        const Type& firstType = types.get(first);
+        switch (builtin->second) {
+            case BuiltinResult::COMPONENT_WISE:
+                for (const auto& argument : arguments) {
+                    if (types.get(argument->getTypeId()).kind == TypeKind::VECTOR) {
+                        return argument->getTypeId();
+                    }
+                }
+                return first;
+            case BuiltinResult::ELEMENT:
+                return isArithmetic(first) ? TypeTable::scalar(firstType.scalar)
+                                           : TypeTable::UNKNOWN;
+            case BuiltinResult::BOOL_LIKE:
+                return firstType.kind == TypeKind::SCALAR || firstType.kind == TypeKind::VECTOR
+                           ? TypeTable::vector(ScalarType::BOOL, firstType.rows)
+                           : TypeTable::UNKNOWN;
+            case BuiltinResult::BOOL:
+                return TypeTable::scalar(ScalarType::BOOL);
+            case BuiltinResult::TRANSPOSE:
+                return firstType.kind == TypeKind::MATRIX
+                           ? TypeTable::matrix(firstType.scalar, firstType.rows, firstType.columns)
+                           : TypeTable::UNKNOWN;
+        }
+        return TypeTable::UNKNOWN;
+    }
+
+    // Arguments are checked against the parameters when the function is
+    // not overloaded; otherwise the first overload they fit is used.
+    TypeId callFunction(const std::vector<const FunctionDeclaration*>& overloads,
+                        const NodeList<Expression>& arguments,
+                        const Expression* node) {
+        for (const FunctionDeclaration* function : overloads) {
+            const auto& parameters = function->getParameters();
+            if (overloads.size() == 1 && parameters.size() != arguments.size()) {
+                if (diagnostics) {
+                    Diagnostic diagnostic;
+                    diagnostic.id = DiagID::FUNCTION_ARGUMENT_COUNT;
+                    diagnostic.argCount = 2;
+                    diagnostic.argKinds[0] = DiagArgKind::INTEGER;
+                    diagnostic.argKinds[1] = DiagArgKind::INTEGER;
+                    diagnostic.args[0] = static_cast<uint32_t>(parameters.size());
+                    diagnostic.args[1] = static_cast<uint32_t>(arguments.size());
+                    diagnostic.offset = offsetOf(node);
+                    diagnostics->report(diagnostic);
+                }
+                return returnTypes[function];
+            }
+            bool fits = parameters.size() == arguments.size();
+            for (size_t i = 0; fits && i < arguments.size(); i++) {
+                TypeId parameter = variableTypes[parameters[i].get()];
+                if (!convertible(arguments[i]->getTypeId(), parameter)) {
+                    if (overloads.size() == 1) {
+                        report(DiagID::INCOMPATIBLE_TYPES, arguments[i].get());
+                    } else {
+                        fits = false;
+                    }
+                }
+            }
+            if (fits) {
+                return returnTypes[function];
+            }
+        }
+        return TypeTable::UNKNOWN;
+    }
+
+    TypeId member(MemberExpression* node) {
+        TypeId baseId = node->getBase()->getTypeId();
+        const Type* base = &types.get(baseId);
+        if (node->isArrow()) {
+            if (base->kind == TypeKind::UNKNOWN || base->kind == TypeKind::OPAQUE) {
+                return TypeTable::UNKNOWN;
+            }
+            if (base->kind != TypeKind::POINTER) {
+                report(DiagID::INVALID_MEMBER_BASE, node);
+                return TypeTable::UNKNOWN;
+            }
+            base = &types.get(base->element);
+        }
+        switch (base->kind) {
+            case TypeKind::STRUCT: {
+                VariableDeclaration* field = node->getField();
+                if (!field) {
+                    field = symbols.lookupField(base->structDeclaration,
+                                                symbols.getNames().find(node->getMember()));
+                    node->setField(field);
+                }
+                if (!field) {
+                    report(DiagID::NO_SUCH_FIELD, node);
+                    return TypeTable::UNKNOWN;
+                }
+                return variableType(field);
+            }
+            case TypeKind::VECTOR:
+                if (!node->isArrow()) {
+                    return swizzle(*base, node);
+                }
+                break;
+            case TypeKind::UNKNOWN:
+            case TypeKind::OPAQUE:
+                return TypeTable::UNKNOWN;
+            default:
+                break;
+        }
+        report(DiagID::INVALID_MEMBER_BASE, node);
+        return TypeTable::UNKNOWN;
+    }
+
+    // `v.xy`, `v.bgra`: one to four components, all from one letter set
+    TypeId swizzle(const Type& vector, MemberExpression* node) {
+        const std::pmr::string& letters = node->getMember();
+        const char* set = swizzleIndex(letters[0], "xyzw") >= 0 ? "xyzw" : "rgba";
+        bool valid = !letters.empty() && letters.size() <= 4;
+        for (char c : letters) {
+            int index = swizzleIndex(c, set);
+            valid = valid && index >= 0 && index < vector.rows;
+        }
+        if (!valid) {
+            report(DiagID::INVALID_SWIZZLE, node);
+            return TypeTable::UNKNOWN;
+        }
+        return TypeTable::vector(vector.scalar, static_cast<int>(letters.size()));
+    }
+};
+
+TypeChecker::TypeChecker(DiagnosticEngine* diagnostics) : diagnostics(diagnostics) {}
+
+void TypeChecker::check(TranslationUnit* unit) {
+    resolver.resolve(unit);
+    Pass pass(*this);
+    pass.traverse(unit);
+}
+
+} // namespace msl_parser
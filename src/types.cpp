@@ -0,0 +1,195 @@
+#include "msl_parser/types.h"
+
+namespace msl_parser {
+
+using namespace ast;
+
+namespace {
+
+const char* const SCALAR_NAMES[] = {"bool", "char", "uchar", "short", "ushort",
+                                    "int", "uint", "half", "float"};
+
+// <stdint.h> spellings of the integer types
+struct ScalarAlias {
+    const char* name;
+    ScalarType type;
+};
+const ScalarAlias SCALAR_ALIASES[] = {
+    {"int8_t", ScalarType::CHAR},    {"uint8_t", ScalarType::UCHAR},
+    {"int16_t", ScalarType::SHORT},  {"uint16_t", ScalarType::USHORT},
+    {"int32_t", ScalarType::INT},    {"uint32_t", ScalarType::UINT},
+    {"unsigned", ScalarType::UINT},
+};
+
+bool findScalar(std::string_view name, ScalarType& type) {
+    for (size_t i = 0; i < TypeTable::NUM_SCALARS; i++) {
+        if (name == SCALAR_NAMES[i]) {
+            type = static_cast<ScalarType>(i);
+            return true;
+        }
+    }
+    for (const ScalarAlias& alias : SCALAR_ALIASES) {
+        if (name == alias.name) {
+            type = alias.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool isDimension(char c) {
+    return c >= '2' && c <= '4';
+}
+
+} // namespace
+
+TypeTable::TypeTable() {
+    types.resize(NUM_BUILTIN_TYPES);
+    types[VOID].kind = TypeKind::VOID;
+    for (size_t i = 0; i < NUM_SCALARS; i++) {
+        auto scalarType = static_cast<ScalarType>(i);
+        Type& type = types[scalar(scalarType)];
+        type.kind = TypeKind::SCALAR;
+        type.scalar = scalarType;
+        for (int size = 2; size <= 4; size++) {
+            Type& vectorType = types[vector(scalarType, size)];
+            vectorType.kind = TypeKind::VECTOR;
+            vectorType.scalar = scalarType;
+            vectorType.rows = static_cast<uint8_t>(size);
+        }
+    }
+    for (ScalarType scalarType : {ScalarType::FLOAT, ScalarType::HALF}) {
+        for (int columns = 2; columns <= 4; columns++) {
+            for (int rows = 2; rows <= 4; rows++) {
+                Type& type = types[matrix(scalarType, columns, rows)];
+                type.kind = TypeKind::MATRIX;
+                type.scalar = scalarType;
+                type.columns = static_cast<uint8_t>(columns);
+                type.rows = static_cast<uint8_t>(rows);
+            }
+        }
+    }
+}
+
+// Returns UNKNOWN once all 16-bit IDs are taken.
+TypeId TypeTable::add(const Type& type) {
+    if (types.size() > UINT16_MAX) {
+        return UNKNOWN;
+    }
+    types.push_back(type);
+    return static_cast<TypeId>(types.size() - 1);
+}
+
+TypeId TypeTable::pointer(TypeId pointee, AddressSpace addressSpace) {
+    uint64_t key = (uint64_t(TypeKind::POINTER) << 40) | (uint64_t(addressSpace) << 32) | pointee;
+    auto it = derived.find(key);
+    if (it != derived.end()) {
+        return it->second;
+    }
+    Type type;
+    type.kind = TypeKind::POINTER;
+    type.addressSpace = addressSpace;
+    type.element = pointee;
+    TypeId id = add(type);
+    derived.emplace(key, id);
+    return id;
+}
+
+TypeId TypeTable::array(TypeId element) {
+    uint64_t key = (uint64_t(TypeKind::ARRAY) << 40) | element;
+    auto it = derived.find(key);
+    if (it != derived.end()) {
+        return it->second;
+    }
+    Type type;
+    type.kind = TypeKind::ARRAY;
+    type.element = element;
+    TypeId id = add(type);
+    derived.emplace(key, id);
+    return id;
+}
+
+TypeId TypeTable::structType(const StructDeclaration* declaration) {
+    auto it = structs.find(declaration);
+    if (it != structs.end()) {
+        return it->second;
+    }
+    Type type;
+    type.kind = TypeKind::STRUCT;
+    type.structDeclaration = declaration;
+    TypeId id = add(type);
+    structs.emplace(declaration, id);
+    return id;
+}
+
+TypeId TypeTable::opaque(std::string_view name) {
+    uint32_t nameId = names.intern(name);
+    uint64_t key = (uint64_t(TypeKind::OPAQUE) << 40) | nameId;
+    auto it = derived.find(key);
+    if (it != derived.end()) {
+        return it->second;
+    }
+    Type type;
+    type.kind = TypeKind::OPAQUE;
+    type.name = names.getName(nameId);
+    TypeId id = add(type);
+    derived.emplace(key, id);
+    return id;
+}
+
+TypeId TypeTable::findBuiltin(std::string_view name) {
+    if (name.substr(0, 7) == "metal::") {
+        name.remove_prefix(7);
+    }
+    // Packed vectors have the alignment of their elements but the same
+    // operations as the other vectors
+    if (name.substr(0, 7) == "packed_") {
+        name.remove_prefix(7);
+    }
+    if (name == "void") {
+        return VOID;
+    }
+    ScalarType type;
+    if (findScalar(name, type)) {
+        return scalar(type);
+    }
+    size_t length = name.size();
+    if (length > 1 && isDimension(name[length - 1]) && findScalar(name.substr(0, length - 1), type)) {
+        return vector(type, name[length - 1] - '0');
+    }
+    if (length > 3 && name[length - 2] == 'x' && isDimension(name[length - 1]) &&
+        isDimension(name[length - 3]) && findScalar(name.substr(0, length - 3), type)) {
+        return matrix(type, name[length - 3] - '0', name[length - 1] - '0');
+    }
+    return UNKNOWN;
+}
+
+std::string TypeTable::getName(TypeId id) const {
+    const Type& type = types[id];
+    switch (type.kind) {
+        case TypeKind::VOID:
+            return "void";
+        case TypeKind::SCALAR:
+            return SCALAR_NAMES[static_cast<size_t>(type.scalar)];
+        case TypeKind::VECTOR:
+            return SCALAR_NAMES[static_cast<size_t>(type.scalar)] + std::to_string(type.rows);
+        case TypeKind::MATRIX:
+            return SCALAR_NAMES[static_cast<size_t>(type.scalar)] +
+                   std::to_string(type.columns) + "x" + std::to_string(type.rows);
+        case TypeKind::POINTER: {
+            static const char* const SPACES[] = {"", "device ", "constant ", "thread ",
+                                                 "threadgroup "};
+            return SPACES[static_cast<size_t>(type.addressSpace)] + getName(type.element) + "*";
+        }
+        case TypeKind::ARRAY:
+            return getName(type.element) + "[]";
+        case TypeKind::STRUCT:
+            return std::string(type.structDeclaration->getName());
+        case TypeKind::OPAQUE:
+            return std::string(type.name);
+        default:
+            return "<unknown>";
+    }
+}
+
+} // namespace msl_parser
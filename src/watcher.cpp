@@ -0,0 +1,333 @@
+#include "msl_parser/watcher.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <filesystem>
+#include <memory_resource>
+#include <set>
+#include <thread>
+#include "msl_parser/json.h"
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#define MSL_PARSER_HAVE_INOTIFY 1
+#endif
+
+namespace msl_parser {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Per-worker arena; most files fit in the first block
+constexpr size_t ARENA_BLOCK_SIZE = 256 * 1024;
+
+#if MSL_PARSER_HAVE_INOTIFY
+// Saves, whether written in place or renamed over the file, creations and
+// deletions; not reads or attribute changes
+constexpr uint32_t WATCH_MASK =
+    IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+#endif
+
+std::string canonicalPath(const std::string& path) {
+    std::error_code error;
+    fs::path canonical = fs::weakly_canonical(path, error);
+    return error ? path : canonical.string();
+}
+
+} // namespace
+
+ShaderWatcher::ShaderWatcher(WatchOptions options)
+    : options(std::move(options)), processor(this->options.batch) {}
+
+ShaderWatcher::~ShaderWatcher() {
+#if MSL_PARSER_HAVE_INOTIFY
+    for (int descriptor : {watchDescriptor, wakePipe[0], wakePipe[1]}) {
+        if (descriptor >= 0) {
+            ::close(descriptor);
+        }
+    }
+#endif
+}
+
+bool ShaderWatcher::start(const std::vector<std::string>& inputs, std::string& out,
+                          std::string& error) {
+    std::vector<std::string> files;
+    if (!expandInputs(inputs, files, error)) {
+        return false;
+    }
+    for (const std::string& input : inputs) {
+        std::error_code ec;
+        if (input[0] != '@' && fs::is_directory(input, ec)) {
+            roots.push_back(canonicalPath(input));
+        }
+    }
+
+#if MSL_PARSER_HAVE_INOTIFY
+    watchDescriptor = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watchDescriptor >= 0 && ::pipe(wakePipe) < 0) {
+        ::close(watchDescriptor);
+        watchDescriptor = -1;
+    }
+    for (const std::string& root : roots) {
+        watchDirectory(root, true);
+    }
+    for (const std::string& searchPath : options.batch.searchPaths) {
+        watchDirectory(canonicalPath(searchPath), false);
+    }
+#endif
+
+    std::vector<std::string> added;
+    for (const std::string& file : files) {
+        if (!shaderPaths.count(canonicalPath(file))) {
+            addShader(file);
+            added.push_back(file);
+        }
+    }
+    process(added, out);
+    return true;
+}
+
+bool ShaderWatcher::wait(std::chrono::milliseconds timeout, std::string& out) {
+#if MSL_PARSER_HAVE_INOTIFY
+    if (watchDescriptor < 0) {
+        return false;
+    }
+    std::vector<std::string> paths;
+    while (true) {
+        // Once something changed, only wait for the burst to settle
+        auto wait = paths.empty() ? timeout : options.settle;
+        pollfd descriptors[2] = {{watchDescriptor, POLLIN, 0}, {wakePipe[0], POLLIN, 0}};
+        int ready = ::poll(descriptors, 2, static_cast<int>(wait.count()));
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (descriptors[1].revents) {
+            return false; // the byte stays, so later calls return too
+        }
+        if (ready == 0) {
+            break;
+        }
+        readEvents(paths);
+    }
+    if (!paths.empty()) {
+        update(paths, out);
+    }
+    return true;
+#else
+    (void)timeout;
+    (void)out;
+    return false;
+#endif
+}
+
+size_t ShaderWatcher::update(const std::vector<std::string>& paths, std::string& out) {
+    std::set<std::string> affected;
+    std::set<std::string> removed;
+    bool appeared = false;
+    for (const std::string& path : paths) {
+        const std::string canonical = canonicalPath(path);
+        std::error_code ec;
+        fs::file_status status = fs::status(canonical, ec);
+        const bool exists = !ec && fs::exists(status);
+
+        auto shader = shaderPaths.find(canonical);
+        if (shader != shaderPaths.end()) {
+            (exists ? affected : removed).insert(shader->second);
+        } else if (exists && fs::is_directory(status) && isBelowRoot(canonical)) {
+            // Files may have been created before the watch was
+            watchDirectory(canonical, true);
+            for (fs::recursive_directory_iterator it(canonical, ec), end; !ec && it != end;
+                 it.increment(ec)) {
+                std::string file = it->path().string();
+                if (it->path().extension() == ".metal" && it->is_regular_file(ec) &&
+                    !shaderPaths.count(canonicalPath(file))) {
+                    addShader(file);
+                    affected.insert(file);
+                }
+            }
+        } else if (exists && fs::path(canonical).extension() == ".metal" &&
+                   fs::is_regular_file(status) && isBelowRoot(canonical)) {
+            addShader(canonical);
+            affected.insert(canonical);
+        }
+
+        auto users = dependents.find(canonical);
+        if (users != dependents.end()) {
+            affected.insert(users->second.begin(), users->second.end());
+        } else if (exists && shader == shaderPaths.end()) {
+            appeared = true;
+        }
+    }
+    if (appeared) {
+        for (const auto& [path, shader] : shaders) {
+            if (!shader.ok) {
+                affected.insert(path);
+            }
+        }
+    }
+
+    for (const std::string& path : removed) {
+        affected.erase(path);
+        Shader& shader = shaders[path];
+        for (const std::string& dependency : shader.dependencies) {
+            dependents[dependency].erase(path);
+        }
+        shaderPaths.erase(canonicalPath(path));
+        shaders.erase(path);
+
+        JsonWriter json(out);
+        json.beginObject();
+        json.key("file");
+        json.string(path);
+        json.key("removed");
+        json.boolean(true);
+        json.endObject();
+        out += '\n';
+    }
+    process(std::vector<std::string>(affected.begin(), affected.end()), out);
+    return removed.size() + affected.size();
+}
+
+void ShaderWatcher::stop() {
+#if MSL_PARSER_HAVE_INOTIFY
+    if (wakePipe[1] >= 0) {
+        char byte = 0;
+        // Only async-signal-safe calls here
+        ssize_t ignored = ::write(wakePipe[1], &byte, 1);
+        (void)ignored;
+    }
+#endif
+}
+
+void ShaderWatcher::process(const std::vector<std::string>& files, std::string& out) {
+    struct Result {
+        std::string line;
+        std::vector<std::string> dependencies;
+        bool ok = false;
+    };
+    std::vector<Result> results(files.size());
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        std::pmr::monotonic_buffer_resource arena(ARENA_BLOCK_SIZE);
+        for (size_t index = next.fetch_add(1); index < files.size(); index = next.fetch_add(1)) {
+            Result& result = results[index];
+            result.ok = processor.processFile(files[index], result.line, &arena,
+                                              &result.dependencies);
+            arena.release();
+        }
+    };
+    size_t jobs = options.batch.jobs ? options.batch.jobs
+                                     : std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::min(jobs, std::max<size_t>(files.size(), 1));
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < jobs; i++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    for (size_t i = 0; i < files.size(); i++) {
+        Shader& shader = shaders[files[i]];
+        for (const std::string& dependency : shader.dependencies) {
+            dependents[dependency].erase(files[i]);
+        }
+        shader.dependencies = std::move(results[i].dependencies);
+        shader.ok = results[i].ok;
+        for (const std::string& dependency : shader.dependencies) {
+            dependents[dependency].insert(files[i]);
+            watchDirectory(fs::path(dependency).parent_path().string(), false);
+        }
+        out += results[i].line;
+    }
+}
+
+void ShaderWatcher::addShader(const std::string& path) {
+    const std::string canonical = canonicalPath(path);
+    shaders[path];
+    shaderPaths[canonical] = path;
+    watchDirectory(fs::path(canonical).parent_path().string(), false);
+}
+
+void ShaderWatcher::watchDirectory(const std::string& directory, bool recursive) {
+#if MSL_PARSER_HAVE_INOTIFY
+    if (watchDescriptor < 0) {
+        return;
+    }
+    if (watchedDirectories.insert(directory).second) {
+        int watch = ::inotify_add_watch(watchDescriptor, directory.c_str(), WATCH_MASK);
+        if (watch >= 0) {
+            watches[watch] = directory;
+        } else {
+            watchedDirectories.erase(directory);
+        }
+    }
+    if (recursive) {
+        std::error_code ec;
+        for (fs::recursive_directory_iterator it(directory, ec), end; !ec && it != end;
+             it.increment(ec)) {
+            if (it->is_directory(ec)) {
+                watchDirectory(it->path().string(), false);
+            }
+        }
+    }
+#else
+    (void)directory;
+    (void)recursive;
+#endif
+}
+
+bool ShaderWatcher::isBelowRoot(const std::string& canonical) const {
+    for (const std::string& root : roots) {
+        if (canonical.size() > root.size() && canonical.compare(0, root.size(), root) == 0 &&
+            canonical[root.size()] == '/') {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ShaderWatcher::readEvents(std::vector<std::string>& paths) {
+#if MSL_PARSER_HAVE_INOTIFY
+    alignas(inotify_event) char buffer[64 * 1024];
+    while (true) {
+        ssize_t length = ::read(watchDescriptor, buffer, sizeof(buffer));
+        if (length <= 0) {
+            return; // EAGAIN once drained
+        }
+        for (char* p = buffer; p < buffer + length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(p);
+            p += sizeof(inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were lost; check everything
+                for (const auto& entry : shaders) {
+                    paths.push_back(entry.first);
+                }
+                continue;
+            }
+            auto watch = watches.find(event->wd);
+            if (watch == watches.end()) {
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                // The directory is gone
+                watchedDirectories.erase(watch->second);
+                watches.erase(watch);
+            } else if (event->len > 0) {
+                paths.push_back(watch->second + "/" + event->name);
+            }
+        }
+    }
+#else
+    (void)paths;
+#endif
+}
+
+} // namespace msl_parser
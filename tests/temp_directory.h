@@ -0,0 +1,60 @@
+#ifndef MSL_PARSER_TESTS_TEMP_DIRECTORY_H
+#define MSL_PARSER_TESTS_TEMP_DIRECTORY_H
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace msl_parser {
+
+// A scratch directory for the running test, removed again at the end of
+// it. The name has the test's name, the process ID and a counter, since
+// ctest -j runs every test in its own process at the same time as the
+// others.
+class TempDirectory {
+public:
+    TempDirectory() {
+        static std::atomic<unsigned> created{0};
+        const testing::TestInfo* test = testing::UnitTest::GetInstance()->current_test_info();
+        std::string name = "msl_parser";
+        if (test) {
+            name += std::string(".") + test->test_suite_name() + "." + test->name();
+        }
+        name += "." + std::to_string(::getpid()) + "." + std::to_string(created.fetch_add(1));
+        path = std::filesystem::path(testing::TempDir()) / name;
+        std::filesystem::remove_all(path);
+        std::filesystem::create_directories(path);
+    }
+    ~TempDirectory() {
+        std::error_code error;
+        std::filesystem::remove_all(path, error);
+    }
+
+    TempDirectory(const TempDirectory&) = delete;
+    TempDirectory& operator=(const TempDirectory&) = delete;
+
+    // Writes `name`, relative to the directory, creating its parent
+    // directories, and returns its path.
+    std::string write(const std::string& name, const std::string& contents) const {
+        std::filesystem::create_directories((path / name).parent_path());
+        std::ofstream(path / name, std::ios::binary) << contents;
+        return file(name);
+    }
+
+    std::string file(const std::string& name) const { return (path / name).string(); }
+
+    std::string read(const std::string& name) const {
+        std::ifstream in(path / name, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    std::filesystem::path path;
+};
+
+} // namespace msl_parser
+
+#endif // MSL_PARSER_TESTS_TEMP_DIRECTORY_H
@@ -72,7 +72,7 @@ public:
     
     void visitIdentifier(Identifier* node) override {
         identifierCount++;
-        visitedIdentifiers.push_back(node->getName());
+        visitedIdentifiers.emplace_back(node->getName());
     }
     
     void visitUnaryExpression(UnaryExpression* node) override {
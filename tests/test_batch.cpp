@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "msl_parser/batch.h"
+#include "temp_directory.h"
+
+using namespace msl_parser;
+
+namespace {
+
+std::vector<std::string> splitLines(const std::string& text) {
+    std::vector<std::string> lines;
+    std::istringstream in(text);
+    for (std::string line; std::getline(in, line);) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+std::string process(const BatchOptions& options, const std::string& source) {
+    std::string out;
+    BatchProcessor(options).processSource("shader.metal", source, out);
+    return out;
+}
+
+} // namespace
+
+TEST(BatchTest, ExpandsDirectoriesAndResponseFiles) {
+    TempDirectory directory;
+    std::string a = directory.write("shaders/a.metal", "");
+    std::string b = directory.write("shaders/nested/b.metal", "");
+    directory.write("shaders/notes.txt", "");
+    std::string single = directory.write("single.metal", "");
+    std::string inner = directory.write("inner.rsp", "\"" + single + "\"\n");
+    std::string outer =
+        directory.write("outer.rsp", directory.file("shaders") + "  @" + inner + "\n");
+
+    std::vector<std::string> files;
+    std::string error;
+    ASSERT_TRUE(expandInputs({"@" + outer, single}, files, error)) << error;
+    EXPECT_EQ(files, (std::vector<std::string>{a, b, single, single}));
+
+    files.clear();
+    EXPECT_FALSE(expandInputs({directory.file("missing.metal")}, files, error));
+    EXPECT_NE(error.find("missing.metal"), std::string::npos);
+
+    // A response file that names itself
+    std::string loop = directory.write("loop.rsp", "@" + directory.file("loop.rsp"));
+    EXPECT_FALSE(expandInputs({"@" + loop}, files, error));
+}
+
+TEST(BatchTest, WritesOneLinePerFileInOrder) {
+    TempDirectory directory;
+    std::vector<std::string> files;
+    for (int i = 0; i < 40; i++) {
+        std::string name = "s" + std::to_string(i) + ".metal";
+        // Every fifth file has an error, and sizes vary so workers finish out
+        // of order
+        std::string source = i % 5 == 0 ? "float f() { return ; " : "";
+        for (int j = 0; j < i % 7; j++) {
+            source += "float g" + std::to_string(j) + "(float x) { return x * 2.0; }\n";
+        }
+        files.push_back(directory.write(name, source));
+    }
+    files.push_back(directory.file("missing.metal"));
+
+    BatchOptions options;
+    options.jobs = 4;
+    std::ostringstream out;
+    EXPECT_EQ(BatchProcessor(options).run(files, out), 9u);
+
+    std::vector<std::string> lines = splitLines(out.str());
+    ASSERT_EQ(lines.size(), files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+        EXPECT_EQ(lines[i].find("{\"file\":\"" + files[i] + "\""), 0u) << lines[i];
+        bool ok = i % 5 != 0 && i < 40;
+        EXPECT_NE(lines[i].find(ok ? "\"ok\":true" : "\"ok\":false"), std::string::npos)
+            << lines[i];
+    }
+    EXPECT_NE(lines.back().find("cannot read file"), std::string::npos);
+}
+
+TEST(BatchTest, WritesEveryLineWithManyWorkers) {
+    TempDirectory directory;
+    std::vector<std::string> files;
+    for (int i = 0; i < 200; i++) {
+        files.push_back(directory.write("t" + std::to_string(i) + ".metal",
+                                        "int g" + std::to_string(i) + ";\n"));
+    }
+    BatchOptions options;
+    options.mode = BatchMode::TOKENS;
+    options.jobs = 16;
+    for (int run = 0; run < 50; run++) {
+        std::ostringstream out;
+        EXPECT_EQ(BatchProcessor(options).run(files, out), 0u);
+        ASSERT_EQ(splitLines(out.str()).size(), files.size()) << "run " << run;
+    }
+}
+
+TEST(BatchTest, WritesTokensAndDiagnostics) {
+    BatchOptions options;
+    options.mode = BatchMode::TOKENS;
+    EXPECT_EQ(process(options, "x = \"a\\\"b\";\n@"),
+              "{\"file\":\"shader.metal\",\"ok\":false,\"tokens\":["
+              "{\"type\":\"IDENTIFIER\",\"text\":\"x\",\"line\":1,\"column\":1},"
+              "{\"type\":\"ASSIGN\",\"text\":\"=\",\"line\":1,\"column\":3},"
+              "{\"type\":\"STRING_LITERAL\",\"text\":\"\\\"a\\\\\\\"b\\\"\",\"line\":1,"
+              "\"column\":5},"
+              "{\"type\":\"SEMICOLON\",\"text\":\";\",\"line\":1,\"column\":11}],"
+              "\"diagnostics\":[{\"line\":2,\"column\":1,\"severity\":\"error\","
+              "\"message\":\"unexpected character '@'\"}]}\n");
+}
+
+TEST(BatchTest, WritesAstSummaryAndReflection) {
+    const std::string source = "struct VertexOut {\n"
+                               "    float4 position [[position]];\n"
+                               "    float2 uv;\n"
+                               "};\n"
+                               "constant float scale = 2.0;\n"
+                               "vertex VertexOut vert(const device float4* points [[buffer(0)]],\n"
+                               "                      uint id [[vertex_id]]) {\n"
+                               "    VertexOut out;\n"
+                               "    out.position = points[id] * scale;\n"
+                               "    return out;\n"
+                               "}\n"
+                               "float helper() { return 1.0; }\n";
+
+    BatchOptions options;
+    std::string ast = process(options, source);
+    EXPECT_NE(ast.find("\"ok\":true"), std::string::npos) << ast;
+    EXPECT_NE(ast.find("\"declarations\":[{\"kind\":\"StructDeclaration\",\"name\":\"VertexOut\","
+                       "\"line\":1},{\"kind\":\"VariableDeclaration\",\"name\":\"scale\","
+                       "\"line\":5},{\"kind\":\"FunctionDeclaration\",\"name\":\"vert\",\"line\":"
+                       "6},{\"kind\":\"FunctionDeclaration\",\"name\":\"helper\",\"line\":12}]"),
+              std::string::npos)
+        << ast;
+
+    options.mode = BatchMode::REFLECTION;
+    std::string reflection = process(options, source);
+    EXPECT_NE(reflection.find(
+                  "\"entryPoints\":[{\"name\":\"vert\",\"stage\":\"vertex\",\"line\":6,"
+                  "\"returnType\":\"VertexOut\",\"attributes\":[],\"parameters\":["
+                  "{\"name\":\"points\",\"type\":\"device const float4*\",\"attributes\":"
+                  "[{\"name\":\"buffer\",\"argument\":\"0\"}]},"
+                  "{\"name\":\"id\",\"type\":\"uint\",\"attributes\":[{\"name\":\"vertex_id\"}]}"
+                  "]}],"
+                  "\"structs\":[{\"name\":\"VertexOut\",\"line\":1,\"fields\":["
+                  "{\"name\":\"position\",\"type\":\"float4\",\"attributes\":"
+                  "[{\"name\":\"position\"}]},"
+                  "{\"name\":\"uv\",\"type\":\"float2\",\"attributes\":[]}]}],"
+                  "\"globals\":[{\"name\":\"scale\",\"type\":\"constant float\",\"line\":5,"
+                  "\"attributes\":[]}]"),
+              std::string::npos)
+        << reflection;
+}
+
+TEST(BatchTest, PreprocessesWithSearchPathsAndDefines) {
+    TempDirectory directory;
+    directory.write("include/common.h", "struct Light { float3 color; };\n");
+    BatchOptions options;
+    options.mode = BatchMode::REFLECTION;
+    options.searchPaths.push_back(directory.file("include"));
+    options.defines.emplace_back("COUNT", "4");
+
+    std::string out = process(options, "#include \"common.h\"\n"
+                                       "kernel void k(device Light* lights [[buffer(COUNT)]]) {}\n");
+    EXPECT_NE(out.find("\"structs\":[{\"name\":\"Light\",\"file\":\"" +
+                       directory.file("include/common.h") + "\",\"line\":1,"),
+              std::string::npos)
+        << out;
+    EXPECT_NE(out.find("[{\"name\":\"buffer\",\"argument\":\"4\"}]"), std::string::npos) << out;
+}
+
+TEST(BatchTest, ProcessesIdenticalFilesOnce) {
+    TempDirectory directory;
+    const std::string vendored = "struct Vertex { float4 position; };\n"
+                                 "vertex float4 v(const device Vertex* vertices [[buffer(0)]],\n"
+                                 "                uint id [[vertex_id]]) {\n"
+                                 "    return vertices[id].position;\n"
+                                 "}\n";
+    std::vector<std::string> files;
+    for (int i = 0; i < 20; i++) {
+        files.push_back(directory.write("copy" + std::to_string(i) + "/v.metal", vendored));
+    }
+    files.push_back(directory.write("broken.metal", "float f() { return ; "));
+    files.push_back(directory.write("broken2.metal", "float f() { return ; "));
+    // The same text including a different header next to each
+    const std::string local = "#include \"local.h\"\n"
+                              "kernel void k(device Data* d [[buffer(0)]]) {}\n";
+    directory.write("red/local.h", "struct Data { float red; };\n");
+    directory.write("blue/local.h", "struct Data { float blue; };\n");
+    files.push_back(directory.write("red/k.metal", local));
+    files.push_back(directory.write("blue/k.metal", local));
+
+    BatchOptions options;
+    options.mode = BatchMode::REFLECTION;
+    options.jobs = 4;
+    std::ostringstream out;
+    BatchStats stats;
+    EXPECT_EQ(BatchProcessor(options).run(files, out, &stats), 2u);
+    EXPECT_EQ(stats.processed, 4u);
+    EXPECT_EQ(stats.duplicates, 20u);
+    EXPECT_EQ(stats.duplicateBytes, 19 * vendored.size() + 21);
+
+    // The same lines as without sharing
+    options.deduplicateMemory = 0;
+    std::ostringstream expected;
+    EXPECT_EQ(BatchProcessor(options).run(files, expected, &stats), 2u);
+    EXPECT_EQ(stats.processed, files.size());
+    EXPECT_EQ(stats.duplicates, 0u);
+    EXPECT_EQ(out.str(), expected.str());
+    EXPECT_NE(out.str().find("\"red\""), std::string::npos);
+    EXPECT_NE(out.str().find("\"blue\""), std::string::npos);
+}
@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "msl_parser/dependency_scanner.h"
+#include "temp_directory.h"
+
+using namespace msl_parser;
+
+namespace {
+
+// A small shader tree.
+class Tree : public TempDirectory {
+public:
+    Tree() {
+        write("include/common.h", "#ifndef COMMON_H\n"
+                                  "#define COMMON_H\n"
+                                  "#include \"math.h\"\n"
+                                  "struct Light { float3 color; };\n"
+                                  "#endif\n");
+        write("include/math.h", "#pragma once\n"
+                                "inline float square(float x) { return x * x; }\n");
+        write("include/fast.h", "#define PRECISION 1\n");
+        write("include/precise.h", "#define PRECISION 2\n");
+        write("include/debug.h", "#include \"common.h\"\n");
+        write("shade.metal", "#include <common.h>\n"
+                             "#if defined(FAST) && FAST > 1\n"
+                             "#include <fast.h>\n"
+                             "#else\n"
+                             "#include <precise.h>\n"
+                             "#endif\n"
+                             "/*\n"
+                             "#include <debug.h>\n"
+                             "*/\n"
+                             "fragment float4 shade() { return float4(square(PRECISION)); }\n");
+        write("broken.metal", "#include \"nothere.h\"\n"
+                              "#include <missing.h>\n");
+    }
+    std::vector<std::string> names(const FileDependencies& result) const {
+        std::vector<std::string> found;
+        for (const std::string& dependency : result.dependencies) {
+            found.push_back(std::filesystem::relative(dependency, path).generic_string());
+        }
+        return found;
+    }
+};
+
+} // namespace
+
+TEST(DependencyScannerTest, MinimizesToDirectives) {
+    std::string source = "#include \"a.h\"\n"
+                         "float f() { return 1.0 / 2.0; } // #include \"b.h\"\n"
+                         "#if SKIPPED\n"
+                         "#error not needed\n"
+                         "#elif OTHER\n"
+                         "#endif\n"
+                         "const char* s = \"\n"
+                         "#include \\\"c.h\\\"\";\n"
+                         "  /* comment */ #define X(a) \\\n"
+                         "      (a + 1)\n"
+                         "#pragma once\n"
+                         "#pragma unroll\n"
+                         "x = 1 # define Y\n"
+                         "#ifdef USED\n"
+                         "#include <d.h> /* spans\n"
+                         "lines */\n"
+                         "#endif";
+    std::string expected = "#include \"a.h\"\n"
+                           "\n"
+                           "\n\n\n\n"
+                           "\n\n"
+                           "#define X(a) \\\n"
+                           "      (a + 1)\n"
+                           "#pragma once\n"
+                           "\n"
+                           "\n"
+                           "#ifdef USED\n"
+                           "#include <d.h> /* spans\n"
+                           "lines */\n"
+                           "#endif";
+    EXPECT_EQ(minimizeDirectives(source), expected);
+    EXPECT_EQ(minimizeDirectives("float x;\nfloat y;\n"), "\n\n");
+    EXPECT_EQ(minimizeDirectives(""), "");
+}
+
+TEST(DependencyScannerTest, FindsIncludesUnderConditions) {
+    Tree tree;
+    DependencyScanOptions options;
+    options.searchPaths.push_back(tree.file("include"));
+    options.jobs = 2;
+    std::vector<FileDependencies> results;
+    std::string error;
+    DependencyScanStats stats;
+    ASSERT_TRUE(scanDependencies({tree.file("shade.metal"), tree.file("broken.metal"),
+                                  tree.file("missing.metal")},
+                                 options, results, error, &stats))
+        << error;
+    ASSERT_EQ(results.size(), 3u);
+
+    EXPECT_TRUE(results[0].readable);
+    EXPECT_EQ(tree.names(results[0]),
+              (std::vector<std::string>{"include/common.h", "include/math.h",
+                                        "include/precise.h"}));
+    EXPECT_TRUE(results[0].errors.empty()) << results[0].errors;
+
+    EXPECT_TRUE(results[1].dependencies.empty());
+    EXPECT_NE(results[1].errors.find("nothere.h"), std::string::npos) << results[1].errors;
+    EXPECT_NE(results[1].errors.find("missing.h"), std::string::npos) << results[1].errors;
+
+    EXPECT_FALSE(results[2].readable);
+    EXPECT_EQ(stats.unreadable, 1u);
+    EXPECT_EQ(stats.cached, 0u);
+
+    options.defines.emplace_back("FAST", "2");
+    ASSERT_TRUE(scanDependencies({tree.file("shade.metal")}, options, results, error));
+    EXPECT_EQ(tree.names(results[0]), (std::vector<std::string>{"include/common.h",
+                                                                "include/math.h",
+                                                                "include/fast.h"}));
+}
+
+TEST(DependencyScannerTest, ReusesCachedFilesAcrossRuns) {
+    Tree tree;
+    DependencyScanOptions options;
+    options.searchPaths.push_back(tree.file("include"));
+    options.cachePath = tree.file("deps.cache");
+    std::vector<FileDependencies> results;
+    std::string error;
+    DependencyScanStats stats;
+    ASSERT_TRUE(scanDependencies({tree.file("shade.metal")}, options, results, error, &stats))
+        << error;
+    EXPECT_EQ(stats.minimized, 4u);  // shade.metal, common.h, math.h, precise.h
+    EXPECT_EQ(stats.cached, 0u);
+
+    ASSERT_TRUE(scanDependencies({tree.file("shade.metal")}, options, results, error, &stats));
+    EXPECT_EQ(stats.minimized, 0u);
+    EXPECT_EQ(stats.cached, 4u);
+    EXPECT_EQ(tree.names(results[0]),
+              (std::vector<std::string>{"include/common.h", "include/math.h",
+                                        "include/precise.h"}));
+
+    // A changed header is read again; the rest still come from the cache
+    tree.write("include/math.h", "#pragma once\n#include \"fast.h\"\n");
+    std::filesystem::last_write_time(tree.file("include/math.h"),
+                                     std::filesystem::file_time_type::clock::now() +
+                                         std::chrono::seconds(10));
+    ASSERT_TRUE(scanDependencies({tree.file("shade.metal")}, options, results, error, &stats));
+    EXPECT_EQ(stats.minimized, 2u);  // math.h and the newly included fast.h
+    EXPECT_EQ(stats.cached, 3u);
+    EXPECT_EQ(tree.names(results[0]),
+              (std::vector<std::string>{"include/common.h", "include/math.h", "include/fast.h",
+                                        "include/precise.h"}));
+
+    // An unusable cache file is ignored and replaced
+    tree.write("deps.cache", "not a cache");
+    ASSERT_TRUE(scanDependencies({tree.file("shade.metal")}, options, results, error, &stats));
+    EXPECT_EQ(stats.minimized, 5u);
+    ASSERT_TRUE(scanDependencies({tree.file("shade.metal")}, options, results, error, &stats));
+    EXPECT_EQ(stats.cached, 5u);
+}
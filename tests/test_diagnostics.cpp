@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include "msl_parser/error.h"
+#include "msl_parser/lexer.h"
+#include "msl_parser/parser.h"
+
+using namespace msl_parser;
+
+TEST(DiagnosticEngineTest, RecordsCompactDiagnostics) {
+    // Records hold no strings; formatting happens in DiagnosticPrinter
+    EXPECT_LE(sizeof(Diagnostic), 24u);
+    
+    DiagnosticEngine diagnostics;
+    diagnostics.report(DiagID::EXPECTED_EXPRESSION, 12);
+    diagnostics.report(DiagID::UNEXPECTED_CHARACTER, 3, DiagArgKind::CHARACTER, '$');
+    
+    ASSERT_EQ(diagnostics.getDiagnostics().size(), 2);
+    EXPECT_EQ(diagnostics.getDiagnostics()[0].id, DiagID::EXPECTED_EXPRESSION);
+    EXPECT_EQ(diagnostics.getDiagnostics()[0].offset, 12);
+    EXPECT_EQ(diagnostics.getDiagnostics()[1].argCount, 1);
+    EXPECT_EQ(diagnostics.getDiagnostics()[1].args[0], '$');
+}
+
+TEST(DiagnosticEngineTest, CapsErrors) {
+    DiagnosticEngine diagnostics(2);
+    diagnostics.report(DiagID::EXPECTED_EXPRESSION, 1);
+    diagnostics.report(DiagID::EXPECTED_EXPRESSION, 2);
+    diagnostics.report(DiagID::EXPECTED_EXPRESSION, 3);
+    
+    EXPECT_TRUE(diagnostics.errorLimitReached());
+    EXPECT_EQ(diagnostics.getErrorCount(), 2);
+    ASSERT_EQ(diagnostics.getDiagnostics().size(), 3);
+    EXPECT_EQ(diagnostics.getDiagnostics()[2].id, DiagID::TOO_MANY_ERRORS);
+    EXPECT_EQ(DiagnosticEngine::getSeverity(DiagID::TOO_MANY_ERRORS), Severity::NOTE);
+    EXPECT_EQ(DiagnosticPrinter("").formatMessage(diagnostics.getDiagnostics()[2]),
+              "too many errors emitted (limit 2), stopping now");
+}
+
+TEST(DiagnosticEngineTest, SuppressesById) {
+    DiagnosticEngine diagnostics;
+    diagnostics.suppress(DiagID::UNEXPECTED_CHARACTER);
+    
+    Lexer lexer("a @ b $ c", &diagnostics);
+    auto tokens = lexer.scanTokens();
+    
+    EXPECT_TRUE(diagnostics.getDiagnostics().empty());
+    EXPECT_FALSE(diagnostics.hasErrors());
+    EXPECT_EQ(tokens.size(), 4);
+    
+    diagnostics.unsuppress(DiagID::UNEXPECTED_CHARACTER);
+    EXPECT_FALSE(diagnostics.isSuppressed(DiagID::UNEXPECTED_CHARACTER));
+}
+
+TEST(DiagnosticEngineTest, ErrorLimitStopsLexing) {
+    DiagnosticEngine diagnostics(3);
+    Lexer lexer("@ @ @ @ @ a b c", &diagnostics);
+    auto tokens = lexer.scanTokens();
+    
+    EXPECT_EQ(diagnostics.getErrorCount(), 3);
+    ASSERT_EQ(tokens.size(), 1);
+    EXPECT_EQ(tokens[0].type, TokenType::END_OF_FILE);
+}
+
+TEST(DiagnosticPrinterTest, ResolvesLinesAndColumns) {
+    std::string source = "int a;\n\tfloat b\nint c;";
+    DiagnosticPrinter printer(source);
+    
+    uint32_t line;
+    uint32_t column;
+    printer.resolve(0, line, column);
+    EXPECT_EQ(line, 1);
+    EXPECT_EQ(column, 1);
+    printer.resolve(8, line, column);
+    EXPECT_EQ(line, 2);
+    EXPECT_EQ(column, 2);
+    printer.resolve(static_cast<uint32_t>(source.size()), line, column);
+    EXPECT_EQ(line, 3);
+    EXPECT_EQ(column, 7);
+}
+
+TEST(DiagnosticPrinterTest, RendersParserErrorsWithSnippet) {
+    std::string source = "void f() {\n\tfloat b\n}\n";
+    DiagnosticEngine diagnostics;
+    Lexer lexer(source, &diagnostics);
+    auto tokens = lexer.scanTokens();
+    Parser parser(tokens, &diagnostics);
+    parser.parse();
+    
+    ASSERT_EQ(diagnostics.getErrorCount(), 1);
+    DiagnosticPrinter printer(source, "shader.metal");
+    EXPECT_EQ(printer.render(diagnostics.getDiagnostics()[0]),
+              "shader.metal:3:1: error: expected ';' after declaration\n"
+              "}\n"
+              "^\n");
+    
+    std::ostringstream out;
+    printer.print(out, diagnostics);
+    EXPECT_EQ(out.str(), printer.render(diagnostics.getDiagnostics()[0]));
+}
+
+TEST(DiagnosticPrinterTest, FormatsTokenArguments) {
+    std::string source = "void f() { if x }";
+    DiagnosticEngine diagnostics;
+    Lexer lexer(source, &diagnostics);
+    auto tokens = lexer.scanTokens();
+    Parser parser(tokens, &diagnostics);
+    parser.parse();
+    
+    ASSERT_GE(diagnostics.getDiagnostics().size(), 1u);
+    EXPECT_EQ(DiagnosticPrinter(source).formatMessage(diagnostics.getDiagnostics()[0]),
+              "expected '(' after 'if'");
+}
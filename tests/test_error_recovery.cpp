@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+#include "msl_parser/error.h"
+#include "msl_parser/lexer.h"
+#include "msl_parser/parser.h"
+
+using namespace msl_parser;
+using namespace msl_parser::ast;
+
+namespace {
+
+std::unique_ptr<TranslationUnit> parseWith(const std::string& source,
+                                           DiagnosticEngine& diagnostics,
+                                           std::pmr::vector<Token>& tokens) {
+    Lexer lexer(source, &diagnostics);
+    tokens = lexer.scanTokens();
+    Parser parser(tokens, &diagnostics);
+    return parser.parse();
+}
+
+} // namespace
+
+TEST(LexerDiagnosticsTest, ReportsLexicalErrors) {
+    // Unknown character
+    {
+        std::string source = "int a @ b;";
+        DiagnosticEngine diagnostics;
+        Lexer lexer(source, &diagnostics);
+        auto tokens = lexer.scanTokens();
+        
+        ASSERT_EQ(diagnostics.getErrorCount(), 1);
+        const auto& diagnostic = diagnostics.getDiagnostics()[0];
+        EXPECT_EQ(diagnostic.id, DiagID::UNEXPECTED_CHARACTER);
+        EXPECT_EQ(diagnostic.offset, 6);
+        EXPECT_EQ(DiagnosticPrinter(source).formatMessage(diagnostic), "unexpected character '@'");
+        EXPECT_EQ(tokens.size(), 5);
+    }
+    
+    // Unterminated string
+    {
+        DiagnosticEngine diagnostics;
+        Lexer lexer("x = \"abc", &diagnostics);
+        lexer.scanTokens();
+        
+        ASSERT_EQ(diagnostics.getErrorCount(), 1);
+        EXPECT_EQ(diagnostics.getDiagnostics()[0].id, DiagID::UNTERMINATED_STRING);
+        EXPECT_EQ(diagnostics.getDiagnostics()[0].offset, 4);
+    }
+    
+    // Unterminated block comment
+    {
+        DiagnosticEngine diagnostics;
+        Lexer lexer("a /* never closed", &diagnostics);
+        lexer.scanTokens();
+        
+        ASSERT_EQ(diagnostics.getErrorCount(), 1);
+        EXPECT_EQ(diagnostics.getDiagnostics()[0].id, DiagID::UNTERMINATED_COMMENT);
+    }
+}
+
+TEST(ParserRecoveryTest, ResynchronizesAtSemicolon) {
+    DiagnosticEngine diagnostics;
+    std::pmr::vector<Token> tokens;
+    auto unit = parseWith("void f() {\n"
+                          "    int a = ) ;\n"
+                          "    int b = 2;\n"
+                          "}\n",
+                          diagnostics, tokens);
+    
+    EXPECT_EQ(diagnostics.getErrorCount(), 1);
+    ASSERT_EQ(unit->getDeclarations().size(), 1);
+    auto* fn = dynamic_cast<FunctionDeclaration*>(unit->getDeclarations()[0].get());
+    ASSERT_NE(fn, nullptr);
+    ASSERT_EQ(fn->getBody()->getStatements().size(), 1);
+    auto* decl = dynamic_cast<DeclarationStatement*>(fn->getBody()->getStatements()[0].get());
+    ASSERT_NE(decl, nullptr);
+    EXPECT_EQ(decl->getDeclarations()[0]->getName(), "b");
+}
+
+TEST(ParserRecoveryTest, ResynchronizesAtTopLevelKeyword) {
+    DiagnosticEngine diagnostics;
+    std::pmr::vector<Token> tokens;
+    auto unit = parseWith("kernel void broken(device float* a {\n"
+                          "    a[0] = 1.0;\n"
+                          "kernel void ok() {}\n"
+                          "struct S { float x; };\n",
+                          diagnostics, tokens);
+    
+    EXPECT_EQ(diagnostics.getErrorCount(), 1);
+    ASSERT_EQ(unit->getDeclarations().size(), 2);
+    EXPECT_EQ(unit->getDeclarations()[0]->getName(), "ok");
+    EXPECT_EQ(unit->getDeclarations()[1]->getName(), "S");
+}
+
+TEST(ParserRecoveryTest, MissingCloseBraceKeepsFunction) {
+    DiagnosticEngine diagnostics;
+    std::pmr::vector<Token> tokens;
+    auto unit = parseWith("void f() {\n"
+                          "    int a = 1;\n"
+                          "vertex float4 g() { return float4(0.0); }\n",
+                          diagnostics, tokens);
+    
+    EXPECT_EQ(diagnostics.getErrorCount(), 1);
+    ASSERT_EQ(unit->getDeclarations().size(), 2);
+    auto* f = dynamic_cast<FunctionDeclaration*>(unit->getDeclarations()[0].get());
+    ASSERT_NE(f, nullptr);
+    EXPECT_EQ(f->getBody()->getStatements().size(), 1);
+    EXPECT_EQ(unit->getDeclarations()[1]->getName(), "g");
+}
+
+TEST(ParserRecoveryTest, StopsAtErrorLimit) {
+    std::string source;
+    for (int i = 0; i < 1000; i++) {
+        source += "int = ;\n";
+    }
+    
+    DiagnosticEngine diagnostics(10);
+    std::pmr::vector<Token> tokens;
+    parseWith(source, diagnostics, tokens);
+    
+    EXPECT_EQ(diagnostics.getErrorCount(), 10);
+    EXPECT_TRUE(diagnostics.errorLimitReached());
+}
+
+TEST(ParserRecoveryTest, DeepNestingIsRejectedWithoutCrashing) {
+    const int depth = 100000;
+    
+    // Parentheses
+    {
+        std::string source = "float x = " + std::string(depth, '(') + "1" +
+                             std::string(depth, ')') + ";\nfloat y = 2.0;";
+        DiagnosticEngine diagnostics(0);
+        std::pmr::vector<Token> tokens;
+        auto unit = parseWith(source, diagnostics, tokens);
+        
+        EXPECT_TRUE(diagnostics.hasErrors());
+        ASSERT_FALSE(unit->getDeclarations().empty());
+        EXPECT_EQ(unit->getDeclarations().back()->getName(), "y");
+    }
+    
+    // Blocks
+    {
+        std::string source = "void f() " + std::string(depth, '{') + std::string(depth, '}');
+        DiagnosticEngine diagnostics(0);
+        std::pmr::vector<Token> tokens;
+        parseWith(source, diagnostics, tokens);
+        
+        EXPECT_TRUE(diagnostics.hasErrors());
+    }
+    
+    // Long operator chains and unary prefixes
+    {
+        std::string source = "float x = 1";
+        for (int i = 0; i < depth; i++) {
+            source += " + 1";
+        }
+        source += ";\nint y = " + std::string(depth, '-') + "1;";
+        DiagnosticEngine diagnostics(0);
+        std::pmr::vector<Token> tokens;
+        parseWith(source, diagnostics, tokens);
+        
+        EXPECT_EQ(diagnostics.getErrorCount(), 2);
+    }
+}
+
+TEST(ParserRecoveryTest, GarbageInputTerminates) {
+    // Every token kind, shuffled deterministically
+    const char* pieces[] = {"(", ")", "{", "}", "[", "]", "[[", "]]", ";", ",", "<", ">",
+                            "a", "float4", "kernel", "struct", "=", "+", "?", ":", "1.0",
+                            "if", "for", "\"s\"", "@", "using", "::", "->", "*", "&"};
+    const size_t count = sizeof(pieces) / sizeof(pieces[0]);
+    std::string source;
+    uint32_t state = 42;
+    for (int i = 0; i < 200000; i++) {
+        state = state * 1664525u + 1013904223u;
+        source += pieces[(state >> 16) % count];
+        source += ' ';
+    }
+    
+    DiagnosticEngine diagnostics(0);
+    std::pmr::vector<Token> tokens;
+    auto unit = parseWith(source, diagnostics, tokens);
+    
+    EXPECT_TRUE(diagnostics.hasErrors());
+    EXPECT_NE(unit, nullptr);
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "msl_parser/file_reader.h"
+#include "temp_directory.h"
+
+using namespace msl_parser;
+
+namespace {
+
+// Files of assorted sizes, with a missing file and a directory among them.
+class Files : public TempDirectory {
+public:
+    Files() {
+        std::filesystem::create_directories(path / "directory");
+        for (size_t i = 0; i < 100; i++) {
+            // Empty, small, and a few larger than a typical read buffer
+            std::string contents(i % 10 == 0 ? i * 1000 : i * 7, 'a' + static_cast<char>(i % 26));
+            names.push_back(write("file" + std::to_string(i) + ".metal", contents));
+            expected.push_back(contents);
+        }
+        names.push_back(file("missing.metal"));
+        names.push_back(file("directory"));
+    }
+
+    std::vector<std::string> names;
+    std::vector<std::string> expected;  // of the readable files
+};
+
+std::vector<FileIo> backends() {
+    std::vector<FileIo> result = {FileIo::THREADS};
+    if (FileReader::isIoUringAvailable()) {
+        result.push_back(FileIo::IO_URING);
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(FileReaderTest, ReadsEveryFileOnceWithEachBackend) {
+    Files files;
+    for (FileIo io : backends()) {
+        FileReaderOptions options;
+        options.io = io;
+        options.depth = 8;
+        options.maxQueued = 16;
+        FileReader reader(files.names, options);
+        EXPECT_EQ(reader.getIo(), io);
+
+        std::mutex mutex;
+        std::vector<int> seen(files.names.size(), 0);
+        std::vector<FileReader::File> results(files.names.size());
+        auto consume = [&]() {
+            FileReader::File file;
+            while (reader.next(file)) {
+                std::lock_guard<std::mutex> lock(mutex);
+                seen[file.index]++;
+                results[file.index] = std::move(file);
+            }
+        };
+        std::vector<std::thread> consumers;
+        for (int i = 0; i < 3; i++) {
+            consumers.emplace_back(consume);
+        }
+        for (std::thread& consumer : consumers) {
+            consumer.join();
+        }
+
+        for (size_t i = 0; i < files.names.size(); i++) {
+            EXPECT_EQ(seen[i], 1) << files.names[i];
+        }
+        for (size_t i = 0; i < files.expected.size(); i++) {
+            EXPECT_TRUE(results[i].readable) << files.names[i];
+            EXPECT_EQ(results[i].contents, files.expected[i]) << files.names[i];
+        }
+        EXPECT_FALSE(results[files.expected.size()].readable);
+        EXPECT_FALSE(results[files.expected.size() + 1].readable);
+    }
+}
+
+TEST(FileReaderTest, StopsWhenDestroyedEarly) {
+    Files files;
+    for (FileIo io : backends()) {
+        FileReaderOptions options;
+        options.io = io;
+        options.maxQueued = 4;
+        FileReader reader(files.names, options);
+        FileReader::File file;
+        ASSERT_TRUE(reader.next(file));
+        // The destructor must not wait for files nobody takes
+    }
+
+    std::vector<std::string> none;
+    FileReader empty(none);
+    FileReader::File file;
+    EXPECT_FALSE(empty.next(file));
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "msl_parser/green_tree.h"
+#include "msl_parser/lexer.h"
+#include "msl_parser/parser.h"
+#include "msl_parser/trivia.h"
+
+using namespace msl_parser;
+
+namespace {
+
+const char* const SHADER =
+    "// Lighting\n"
+    "struct Light {\n"
+    "    float3 position; /* world space */\n"
+    "    float intensity;\n"
+    "};\n"
+    "\n"
+    "float4 shade(Light light, float3 normal) {\r\n"
+    "    float k = dot(normal, light.position) \\\n"
+    "        * light.intensity;\n"
+    "    return float4(k, k, k, 1.0);\n"
+    "}\n"
+    "\n"
+    "float twice(float x) { return x * 2.0; }\n"
+    "/* trailing";
+
+std::string reconstruct(const std::string& source, const std::pmr::vector<Token>& tokens,
+                        const TriviaTable& trivia) {
+    std::string out;
+    for (size_t i = 0; i < tokens.size(); i++) {
+        for (const Trivia& piece : trivia.leading(i)) {
+            out.append(source, piece.offset, piece.length);
+        }
+        out += tokens[i].lexeme;
+    }
+    return out;
+}
+
+// The top-level function declarations of a green tree.
+std::vector<const GreenNode*> functions(const GreenNode* root) {
+    std::vector<const GreenNode*> result;
+    for (const GreenNode* child : root->getChildren()) {
+        if (!child->isToken() && child->getNodeKind() == NodeKind::FunctionDeclaration) {
+            result.push_back(child);
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(TriviaTest, ReproducesTheSource) {
+    std::string source = SHADER;
+    Lexer lexer(source);
+    auto tokens = lexer.scanTokens();
+    TriviaTable trivia(source, tokens);
+    EXPECT_EQ(reconstruct(source, tokens, trivia), source);
+
+    // "// Lighting" and its newline come before "struct"
+    auto leading = trivia.leading(0);
+    ASSERT_EQ(leading.size(), 2u);
+    EXPECT_EQ(leading.first[0].kind, TriviaKind::LINE_COMMENT);
+    EXPECT_EQ(leading.first[0].length, 11u);
+    EXPECT_EQ(leading.first[1].kind, TriviaKind::NEWLINE);
+    EXPECT_EQ(trivia.leadingLength(0), 12u);
+
+    std::vector<TriviaKind> kinds;
+    for (const Trivia& piece : trivia.getPieces()) {
+        kinds.push_back(piece.kind);
+    }
+    for (TriviaKind kind : {TriviaKind::WHITESPACE, TriviaKind::BLOCK_COMMENT,
+                            TriviaKind::LINE_CONTINUATION}) {
+        EXPECT_NE(std::find(kinds.begin(), kinds.end(), kind), kinds.end());
+    }
+    // The unterminated comment is the end-of-file token's trivia
+    EXPECT_EQ(trivia.leading(tokens.size() - 1).last[-1].kind, TriviaKind::BLOCK_COMMENT);
+}
+
+TEST(TriviaTest, KeepsSkippedCharacters) {
+    std::string source = "int a = 1 @ 2;\n`";
+    DiagnosticEngine diagnostics;
+    Lexer lexer(source, &diagnostics);
+    auto tokens = lexer.scanTokens();
+    TriviaTable trivia(source, tokens);
+    EXPECT_EQ(reconstruct(source, tokens, trivia), source);
+    size_t skipped = 0;
+    for (const Trivia& piece : trivia.getPieces()) {
+        skipped += piece.kind == TriviaKind::SKIPPED;
+    }
+    EXPECT_EQ(skipped, 2u);
+}
+
+TEST(GreenTreeTest, IsLosslessAndSharesUnchangedSubtrees) {
+    GreenNodeCache cache;
+    std::string source = SHADER;
+    Lexer lexer(source);
+    auto tokens = lexer.scanTokens();
+    Parser parser(tokens);
+    auto unit = parser.parse();
+    const GreenNode* first = cache.build(source, tokens, unit.get());
+
+    std::string text;
+    first->writeText(text);
+    EXPECT_EQ(text, source);
+    EXPECT_EQ(first->getWidth(), source.size());
+    // The same parse again is the same tree
+    EXPECT_EQ(cache.build(source, tokens, unit.get()), first);
+    size_t firstSize = cache.size();
+
+    // Edit the body of shade(); twice() and the struct are untouched
+    std::string edited = source;
+    edited.replace(edited.find("1.0"), 3, "0.5");
+    Lexer editedLexer(edited);
+    auto editedTokens = editedLexer.scanTokens();
+    Parser editedParser(editedTokens);
+    auto editedUnit = editedParser.parse();
+    const GreenNode* second = cache.build(edited, editedTokens, editedUnit.get());
+
+    text.clear();
+    second->writeText(text);
+    EXPECT_EQ(text, edited);
+    ASSERT_EQ(functions(first).size(), 2u);
+    ASSERT_EQ(functions(second).size(), 2u);
+    EXPECT_NE(functions(first)[0], functions(second)[0]);
+    EXPECT_EQ(functions(first)[1], functions(second)[1]);
+    EXPECT_EQ(first->getChildren()[0], second->getChildren()[0]);
+    // Only the path from the edited token to the root is new
+    EXPECT_LT(cache.size() - firstSize, 12u);
+
+    // Dropping the first version frees only what it did not share
+    size_t bothSize = cache.size();
+    cache.retain({second});
+    size_t retainedSize = cache.size();
+    EXPECT_LT(retainedSize, bothSize);
+    EXPECT_EQ(cache.build(edited, editedTokens, editedUnit.get()), second);
+    EXPECT_EQ(cache.size(), retainedSize);
+    text.clear();
+    second->writeText(text);
+    EXPECT_EQ(text, edited);
+}
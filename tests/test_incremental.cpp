@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+#include <typeinfo>
+#include "msl_parser/ast/recursive_visitor.h"
+#include "msl_parser/incremental.h"
+#include "msl_parser/lexer.h"
+#include "msl_parser/parser.h"
+
+using namespace msl_parser;
+
+namespace {
+
+const char* kShader =
+    "using namespace metal;\n"
+    "\n"
+    "struct VertexOut {\n"
+    "    float4 position [[position]];\n"
+    "    float2 uv;\n"
+    "};\n"
+    "\n"
+    "/* shared scale */\n"
+    "constant float scale = 2.0;\n"
+    "\n"
+    "vertex VertexOut vs(uint vid [[vertex_id]], constant float4* verts [[buffer(0)]]) {\n"
+    "    VertexOut out;\n"
+    "    out.position = verts[vid] * scale; // scaled\n"
+    "    out.uv = float2(0.0, 1.0);\n"
+    "    return out;\n"
+    "}\n"
+    "\n"
+    "fragment float4 fs(VertexOut in [[stage_in]]) {\n"
+    "    return float4(in.uv, 0.0, 1.0);\n"
+    "}\n";
+
+// Serializes a tree as node kinds and ranges, for comparing two parses.
+class TreeDumper : public ast::RecursiveASTVisitor {
+public:
+    std::ostringstream out;
+
+protected:
+    void visitNode(ast::ASTNode* node) override {
+        const auto& range = node->getSourceRange();
+        out << typeid(*node).name() << "@" << range.start.line << ":" << range.start.column << ":"
+            << range.start.offset << "-" << range.end.line << ":" << range.end.column << ":"
+            << range.end.offset << "\n";
+    }
+};
+
+std::string dump(ast::TranslationUnit* unit) {
+    TreeDumper dumper;
+    dumper.traverse(unit);
+    return dumper.out.str();
+}
+
+void expectMatchesFullParse(const IncrementalParser& incremental) {
+    Lexer lexer(incremental.getSource());
+    auto expected = lexer.scanTokens();
+    const auto& actual = incremental.getTokens();
+    
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        EXPECT_EQ(actual[i].type, expected[i].type) << "token " << i;
+        EXPECT_EQ(actual[i].lexeme, expected[i].lexeme) << "token " << i;
+        EXPECT_EQ(actual[i].line, expected[i].line) << "token " << i;
+        EXPECT_EQ(actual[i].column, expected[i].column) << "token " << i;
+        EXPECT_EQ(actual[i].offset, expected[i].offset) << "token " << i;
+        EXPECT_EQ(actual[i].flags, expected[i].flags) << "token " << i;
+    }
+    
+    DiagnosticEngine diagnostics(0);
+    Parser parser(expected, &diagnostics);
+    auto unit = parser.parse();
+    EXPECT_EQ(dump(incremental.getTranslationUnit()), dump(unit.get()));
+}
+
+} // namespace
+
+TEST(IncrementalParserTest, EditInsideFunctionReusesOtherDeclarations) {
+    IncrementalParser incremental(kShader);
+    const auto& before = incremental.getTranslationUnit()->getDeclarations();
+    ASSERT_EQ(before.size(), 5);
+    ast::Declaration* structDecl = before[1].get();
+    ast::Declaration* fragment = before[4].get();
+    
+    std::string source = kShader;
+    size_t offset = source.find("* scale");
+    incremental.applyEdit({offset, 7, "+ scale * 0.5"});
+    
+    expectMatchesFullParse(incremental);
+    const auto& after = incremental.getTranslationUnit()->getDeclarations();
+    ASSERT_EQ(after.size(), 5);
+    EXPECT_EQ(after[1].get(), structDecl);
+    EXPECT_EQ(after[4].get(), fragment);
+    EXPECT_EQ(incremental.getLastEditStats().reparsedDeclarations, 1);
+    EXPECT_EQ(incremental.getLastEditStats().reusedDeclarations, 4);
+    EXPECT_LT(incremental.getLastEditStats().relexedTokens, 10);
+}
+
+TEST(IncrementalParserTest, ShiftsLocationsAfterEdit) {
+    IncrementalParser incremental(kShader);
+    ast::Declaration* fragment = incremental.getTranslationUnit()->getDeclarations()[4].get();
+    int oldLine = fragment->getSourceRange().start.line;
+    
+    incremental.applyEdit({0, 0, "// header\n\n"});
+    
+    expectMatchesFullParse(incremental);
+    EXPECT_EQ(incremental.getTranslationUnit()->getDeclarations()[4].get(), fragment);
+    EXPECT_EQ(fragment->getSourceRange().start.line, oldLine + 2);
+}
+
+TEST(IncrementalParserTest, EditsThatChangeTokenBoundaries) {
+    IncrementalParser incremental("int ab = c - d;\nfloat e;");
+    
+    // Grow an identifier across the edit point
+    incremental.applyEdit({6, 0, "x"});
+    expectMatchesFullParse(incremental);
+    EXPECT_EQ(incremental.getTokens()[1].lexeme, "abx");
+    
+    // Turn '-' into '->'
+    size_t minus = incremental.getSource().find('-');
+    incremental.applyEdit({minus + 1, 0, ">"});
+    expectMatchesFullParse(incremental);
+    
+    // Open a block comment that swallows the rest of the file
+    incremental.applyEdit({0, 0, "/*"});
+    expectMatchesFullParse(incremental);
+    EXPECT_EQ(incremental.getTokens().size(), 1);
+    
+    // ...and close it again
+    incremental.applyEdit({0, 2, ""});
+    expectMatchesFullParse(incremental);
+}
+
+TEST(IncrementalParserTest, EditsThatJoinOrSplitLines) {
+    IncrementalParser incremental("float a;\nfloat b;\n#define N 4\nfloat c;");
+
+    // `float b` no longer starts its line
+    size_t newline = incremental.getSource().find('\n');
+    incremental.applyEdit({newline, 1, ""});
+    expectMatchesFullParse(incremental);
+    EXPECT_FALSE(incremental.getTokens()[3].flags & TOKEN_AT_LINE_START);
+
+    // ...and starts it again
+    incremental.applyEdit({newline, 0, "\n"});
+    expectMatchesFullParse(incremental);
+    EXPECT_TRUE(incremental.getTokens()[3].flags & TOKEN_AT_LINE_START);
+
+    // Join the directive to the line before it
+    newline = incremental.getSource().find("\n#");
+    incremental.applyEdit({newline, 1, " "});
+    expectMatchesFullParse(incremental);
+}
+
+TEST(IncrementalParserTest, RandomEditsMatchFullReparse) {
+    const std::string alphabet = "ab1.;{}()[]*+-/= \n\"";
+    std::mt19937 rng(1234);
+    IncrementalParser incremental(kShader);
+    
+    for (int i = 0; i < 300; i++) {
+        const std::string& source = incremental.getSource();
+        size_t offset = rng() % (source.size() + 1);
+        size_t removed = std::min<size_t>(rng() % 4, source.size() - offset);
+        std::string inserted;
+        for (size_t n = rng() % 4; n > 0; n--) {
+            inserted += alphabet[rng() % alphabet.size()];
+        }
+        
+        incremental.applyEdit({offset, removed, inserted});
+        expectMatchesFullParse(incremental);
+        if (HasFailure()) {
+            FAIL() << "after edit " << i << " at " << offset;
+        }
+    }
+}
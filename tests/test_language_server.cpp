@@ -0,0 +1,233 @@
+#include <gtest/gtest.h>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "msl_parser/language_server.h"
+
+using namespace msl_parser;
+
+namespace {
+
+const char* const SHADER = R"(struct Light {
+    float3 position;
+    float intensity;
+};
+
+float4 shade(Light light, float3 normal) {
+    return float4(normal * light.intensity, 1.0);
+}
+
+constant float scale = 2.0;
+)";
+
+// A LanguageServer whose output is collected as parsed messages.
+class Session {
+public:
+    explicit Session(std::chrono::milliseconds debounce = std::chrono::milliseconds(0))
+        : server([this](const std::string& message) { receive(message); }, options(debounce)) {}
+
+    void send(const std::string& message) { server.handle(message); }
+
+    // The result of the response to request `id`.
+    JsonValue result(int id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const JsonValue& message : messages) {
+            if (message.numberOr("id", -1) == id && message.get("result")) {
+                return *message.get("result");
+            }
+        }
+        ADD_FAILURE() << "no result for request " << id;
+        return JsonValue();
+    }
+
+    std::vector<JsonValue> notifications(const std::string& method) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<JsonValue> found;
+        for (const JsonValue& message : messages) {
+            if (message.stringOr("method", "") == method) {
+                found.push_back(*message.get("params"));
+            }
+        }
+        return found;
+    }
+
+    void open(const std::string& uri, const std::string& text) {
+        std::string message = R"({"jsonrpc":"2.0","method":"textDocument/didOpen","params":)"
+                              R"({"textDocument":{"uri":")" +
+                              uri + R"(","languageId":"metal","version":1,"text":)";
+        JsonWriter::escape(message, text);
+        send(message + "}}}");
+    }
+
+    JsonValue request(int id, const std::string& method, const std::string& uri) {
+        send(R"({"jsonrpc":"2.0","id":)" + std::to_string(id) + R"(,"method":")" + method +
+             R"(","params":{"textDocument":{"uri":")" + uri + R"("}}})");
+        return result(id);
+    }
+
+    LanguageServer server;
+
+private:
+    std::mutex mutex;
+    std::vector<JsonValue> messages;
+
+    static LanguageServerOptions options(std::chrono::milliseconds debounce) {
+        LanguageServerOptions options;
+        options.debounce = debounce;
+        return options;
+    }
+
+    void receive(const std::string& text) {
+        JsonValue message;
+        EXPECT_TRUE(JsonReader(text).read(message)) << text;
+        std::lock_guard<std::mutex> lock(mutex);
+        messages.push_back(std::move(message));
+    }
+};
+
+std::string serialize(const JsonValue& value) {
+    std::string out;
+    JsonWriter(out).value(value);
+    return out;
+}
+
+} // namespace
+
+TEST(LanguageServerTest, AnswersSymbolsAndSemanticTokens) {
+    Session session;
+    session.send(R"({"jsonrpc":"2.0","id":1,"method":"initialize","params":{}})");
+    JsonValue capabilities = *session.result(1).get("capabilities");
+    EXPECT_EQ(capabilities.get("textDocumentSync")->numberOr("change", 0), 2);
+    EXPECT_TRUE(capabilities.get("documentSymbolProvider")->boolean);
+
+    session.open("file:///a.metal", SHADER);
+    JsonValue symbols = session.request(2, "textDocument/documentSymbol", "file:///a.metal");
+    ASSERT_EQ(symbols.items.size(), 3u);
+    EXPECT_EQ(symbols.items[0].stringOr("name", ""), "Light");
+    EXPECT_EQ(symbols.items[0].numberOr("kind", 0), 23);
+    ASSERT_EQ(symbols.items[0].get("children")->items.size(), 2u);
+    EXPECT_EQ(symbols.items[0].get("children")->items[1].stringOr("name", ""), "intensity");
+    EXPECT_EQ(symbols.items[1].stringOr("name", ""), "shade");
+    EXPECT_EQ(symbols.items[1].numberOr("kind", 0), 12);
+    EXPECT_EQ(symbols.items[1].get("range")->get("start")->numberOr("line", -1), 5);
+    EXPECT_EQ(symbols.items[2].stringOr("name", ""), "scale");
+
+    // The first three tokens: "struct" (keyword), "Light" (type) and, on the
+    // next line, "float3" (type)
+    JsonValue tokens = session.request(3, "textDocument/semanticTokens/full", "file:///a.metal");
+    const std::vector<JsonValue>& data = tokens.get("data")->items;
+    ASSERT_GE(data.size(), 15u);
+    const double expected[] = {0, 0, 6, 0, 0, 0, 7, 5, 1, 0, 1, 4, 6, 1, 0};
+    for (size_t i = 0; i < 15; i++) {
+        EXPECT_EQ(data[i].number, expected[i]) << i;
+    }
+
+    session.send(R"({"jsonrpc":"2.0","id":4,"method":"textDocument/hover","params":{}})");
+    session.send(R"({"jsonrpc":"2.0","id":5,"method":"shutdown"})");
+    session.send(R"({"jsonrpc":"2.0","id":6,"method":"initialize","params":{}})");
+    session.send(R"({"jsonrpc":"2.0","method":"exit"})");
+    EXPECT_TRUE(session.server.isShutdown());
+    EXPECT_TRUE(session.server.hasExited());
+}
+
+TEST(LanguageServerTest, PlacesTokensAfterMultiLineCommentsAndStrings) {
+    Session session;
+    session.open("file:///a.metal", "/* a\n b */ float x;\nconst char* s = \"a\\\nb\"; int y;\n");
+    JsonValue tokens = session.request(1, "textDocument/semanticTokens/full", "file:///a.metal");
+    const std::vector<JsonValue>& data = tokens.get("data")->items;
+    ASSERT_GE(data.size(), 5u);
+    // "float" on the comment's second line, at character 6
+    EXPECT_EQ(data[0].number, 1);
+    EXPECT_EQ(data[1].number, 6);
+    EXPECT_EQ(data[2].number, 5);
+    // "int" after the string continued on line 3, at character 4
+    bool found = false;
+    uint32_t line = 0;
+    uint32_t character = 0;
+    for (size_t i = 0; i + 4 < data.size(); i += 5) {
+        line += static_cast<uint32_t>(data[i].number);
+        character = data[i].number == 0 ? character + static_cast<uint32_t>(data[i + 1].number)
+                                         : static_cast<uint32_t>(data[i + 1].number);
+        if (line == 3 && data[i + 2].number == 3) {
+            EXPECT_EQ(character, 4u);
+            found = true;
+        }
+    }
+    EXPECT_TRUE(found);
+}
+
+TEST(LanguageServerTest, IncrementalEditsMatchAFreshOpen) {
+    Session session;
+    session.open("file:///a.metal", SHADER);
+    // Rename "intensity" in the field (line 2) and its use (line 6), then
+    // insert a function using a non-ASCII comment on the first line
+    session.send(R"({"jsonrpc":"2.0","method":"textDocument/didChange","params":{)"
+                 R"("textDocument":{"uri":"file:///a.metal","version":2},"contentChanges":[)"
+                 R"({"range":{"start":{"line":2,"character":10},"end":{"line":2,"character":19}},)"
+                 R"("text":"power"},)"
+                 R"({"range":{"start":{"line":6,"character":36},"end":{"line":6,"character":45}},)"
+                 R"("text":"power"},)"
+                 R"({"range":{"start":{"line":0,"character":0},"end":{"line":0,"character":0}},)"
+                 R"("text":"// é😀\nfloat twice(float x) { return x * 2.0; }\n"}]}})");
+
+    std::string edited = std::string("// \xc3\xa9\xf0\x9f\x98\x80\n"
+                                     "float twice(float x) { return x * 2.0; }\n") +
+                         SHADER;
+    edited.replace(edited.find("intensity"), 9, "power");
+    edited.replace(edited.find("intensity"), 9, "power");
+    session.open("file:///b.metal", edited);
+
+    for (const char* method : {"textDocument/documentSymbol", "textDocument/semanticTokens/full"}) {
+        JsonValue incremental = session.request(10, method, "file:///a.metal");
+        JsonValue fresh = session.request(11, method, "file:///b.metal");
+        EXPECT_EQ(serialize(incremental), serialize(fresh)) << method;
+    }
+    JsonValue symbols = session.request(12, "textDocument/documentSymbol", "file:///a.metal");
+    ASSERT_EQ(symbols.items.size(), 4u);
+    EXPECT_EQ(symbols.items[0].stringOr("name", ""), "twice");
+    EXPECT_EQ(symbols.items[1].get("children")->items[1].stringOr("name", ""), "power");
+}
+
+TEST(LanguageServerTest, PublishesDiagnosticsForTheLatestVersionOnly) {
+    Session session(std::chrono::milliseconds(50));
+    session.open("file:///a.metal", "float f( {");
+    // Replaces the pending analysis of version 1 within the debounce interval
+    session.send(R"({"jsonrpc":"2.0","method":"textDocument/didChange","params":{)"
+                 R"("textDocument":{"uri":"file:///a.metal","version":2},"contentChanges":[)"
+                 R"({"text":"float f() { return 1.0; }\nfloat g( @"}]}})");
+    session.server.waitForAnalysis();
+
+    std::vector<JsonValue> published = session.notifications("textDocument/publishDiagnostics");
+    ASSERT_EQ(published.size(), 1u);
+    EXPECT_EQ(published[0].numberOr("version", 0), 2);
+    const std::vector<JsonValue>& diagnostics = published[0].get("diagnostics")->items;
+    ASSERT_FALSE(diagnostics.empty());
+    EXPECT_EQ(diagnostics[0].get("range")->get("start")->numberOr("line", -1), 1);
+    EXPECT_EQ(diagnostics[0].numberOr("severity", 0), 1);
+
+    session.send(R"({"jsonrpc":"2.0","method":"textDocument/didClose","params":)"
+                 R"({"textDocument":{"uri":"file:///a.metal"}}})");
+    published = session.notifications("textDocument/publishDiagnostics");
+    ASSERT_EQ(published.size(), 2u);
+    EXPECT_TRUE(published[1].get("diagnostics")->items.empty());
+}
+
+TEST(LanguageServerTest, RunsTheFramedProtocol) {
+    auto frame = [](const std::string& body) {
+        return "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    };
+    std::istringstream in(frame(R"({"jsonrpc":"2.0","id":1,"method":"initialize","params":{}})") +
+                          frame("{not json") +
+                          frame(R"({"jsonrpc":"2.0","id":2,"method":"shutdown"})") +
+                          frame(R"({"jsonrpc":"2.0","method":"exit"})"));
+    std::ostringstream out;
+    EXPECT_EQ(LanguageServer::run(in, out), 0);
+    std::string output = out.str();
+    EXPECT_EQ(output.find("Content-Length: "), 0u);
+    EXPECT_NE(output.find("\"code\":-32700"), std::string::npos);
+    EXPECT_NE(output.find(R"("id":2,"result":null)"), std::string::npos);
+
+    std::istringstream truncated(frame(R"({"jsonrpc":"2.0","method":"exit"})"));
+    EXPECT_EQ(LanguageServer::run(truncated, out), 1);
+}
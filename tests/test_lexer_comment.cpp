@@ -150,4 +150,19 @@ TEST(LexerTest, CommentsEdgeCases) {
         EXPECT_EQ(tokens[6].type, TokenType::SEMICOLON);
         EXPECT_EQ(tokens[7].type, TokenType::END_OF_FILE);
     }
-}
\ No newline at end of file
+}
+
+TEST(LexerTest, PositionsAfterMultiLineComments) {
+    Lexer lexer("/* a\n   b */ int x;\nfloat y; \"s\\\nt\" z");
+    auto tokens = lexer.scanTokens();
+
+    ASSERT_EQ(tokens.size(), 9);
+    EXPECT_EQ(tokens[0].line, 2u);
+    EXPECT_EQ(tokens[0].column, 9u);   // int
+    EXPECT_EQ(tokens[1].column, 13u);  // x
+    EXPECT_EQ(tokens[3].line, 3u);
+    EXPECT_EQ(tokens[3].column, 1u);   // float
+    // After a string continued with a backslash
+    EXPECT_EQ(tokens[7].line, 4u);
+    EXPECT_EQ(tokens[7].column, 4u);   // z
+}
@@ -162,4 +162,46 @@ TEST(LexerTest, NumericLiteralEdgeCases) {
         EXPECT_EQ(tokens[0].type, TokenType::FLOAT_LITERAL);
         EXPECT_EQ(tokens[0].lexeme, "1.5h");
     }
-}
\ No newline at end of file
+}
+
+TEST(LexerTest, NumericLiteralFlags) {
+    {
+        Lexer lexer("42 42u 0xFFu 0b101 1.5f 2.0h 1e3 .5");
+        auto tokens = lexer.scanTokens();
+        
+        ASSERT_EQ(tokens.size(), 10);  // ".5" is DOT then 5, plus EOF
+        EXPECT_EQ(tokens[0].numericFlags, 0);
+        EXPECT_EQ(tokens[1].type, TokenType::INTEGER_LITERAL);
+        EXPECT_EQ(tokens[1].lexeme, "42u");
+        EXPECT_EQ(tokens[1].numericFlags, NUMERIC_SUFFIX_U);
+        EXPECT_EQ(tokens[2].lexeme, "0xFFu");
+        EXPECT_EQ(tokens[2].numericFlags, NUMERIC_HEX | NUMERIC_SUFFIX_U);
+        EXPECT_EQ(tokens[3].numericFlags, NUMERIC_BINARY);
+        EXPECT_EQ(tokens[4].numericFlags, NUMERIC_FRACTION | NUMERIC_SUFFIX_F);
+        EXPECT_EQ(tokens[5].numericFlags, NUMERIC_FRACTION | NUMERIC_SUFFIX_H);
+        EXPECT_EQ(tokens[6].type, TokenType::FLOAT_LITERAL);
+        EXPECT_EQ(tokens[6].numericFlags, NUMERIC_EXPONENT);
+        EXPECT_EQ(tokens[7].type, TokenType::DOT);
+    }
+    
+    // An 'e' without exponent digits is not part of the literal
+    {
+        Lexer lexer("1else");
+        auto tokens = lexer.scanTokens();
+        
+        ASSERT_EQ(tokens.size(), 3);
+        EXPECT_EQ(tokens[0].type, TokenType::INTEGER_LITERAL);
+        EXPECT_EQ(tokens[0].lexeme, "1");
+        EXPECT_EQ(tokens[1].type, TokenType::ELSE);
+    }
+    
+    // Integer followed by a float suffix is a float
+    {
+        Lexer lexer("1f");
+        auto tokens = lexer.scanTokens();
+        
+        ASSERT_EQ(tokens.size(), 2);
+        EXPECT_EQ(tokens[0].type, TokenType::FLOAT_LITERAL);
+        EXPECT_EQ(tokens[0].numericFlags, NUMERIC_SUFFIX_F);
+    }
+}
@@ -225,4 +225,61 @@ TEST(LexerTest, OperatorEdgeCases) {
         EXPECT_EQ(tokens[4].type, TokenType::MINUS_MINUS);
         EXPECT_EQ(tokens[5].type, TokenType::END_OF_FILE);
     }
-}
\ No newline at end of file
+}
+
+TEST(LexerTest, OperatorMaximalMunch) {
+    // Every two-character operator, with no whitespace in between
+    {
+        Lexer lexer("++--->+=-=*=/=%===!=<=>=<<>>&&||::[[]]");
+        auto tokens = lexer.scanTokens();
+        
+        std::vector<TokenType> expected = {
+            TokenType::PLUS_PLUS, TokenType::MINUS_MINUS, TokenType::ARROW,
+            TokenType::PLUS_ASSIGN, TokenType::MINUS_ASSIGN, TokenType::MULTIPLY_ASSIGN,
+            TokenType::DIVIDE_ASSIGN, TokenType::MODULO_ASSIGN, TokenType::EQUAL,
+            TokenType::NOT_EQUAL, TokenType::LESS_EQUAL, TokenType::GREATER_EQUAL,
+            TokenType::LEFT_SHIFT, TokenType::RIGHT_SHIFT, TokenType::AND, TokenType::OR,
+            TokenType::SCOPE_RESOLUTION, TokenType::ATTRIBUTE_LEFT, TokenType::ATTRIBUTE_RIGHT,
+            TokenType::END_OF_FILE,
+        };
+        ASSERT_EQ(tokens.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            EXPECT_EQ(tokens[i].type, expected[i]) << "token " << i;
+        }
+    }
+    
+    // A second character that does not pair falls back to the single form
+    {
+        Lexer lexer("+*-<&=");
+        auto tokens = lexer.scanTokens();
+        
+        ASSERT_EQ(tokens.size(), 7);  // Including EOF token
+        EXPECT_EQ(tokens[0].type, TokenType::PLUS);
+        EXPECT_EQ(tokens[1].type, TokenType::MULTIPLY);
+        EXPECT_EQ(tokens[2].type, TokenType::MINUS);
+        EXPECT_EQ(tokens[3].type, TokenType::LESS_THAN);
+        EXPECT_EQ(tokens[4].type, TokenType::BITWISE_AND);
+        EXPECT_EQ(tokens[5].type, TokenType::ASSIGN);
+    }
+    
+    // An operator at the very end of the input
+    {
+        Lexer lexer("a -");
+        auto tokens = lexer.scanTokens();
+        
+        ASSERT_EQ(tokens.size(), 3);  // Including EOF token
+        EXPECT_EQ(tokens[1].type, TokenType::MINUS);
+        EXPECT_EQ(tokens[1].offset, 2u);
+    }
+    
+    // Bytes outside ASCII are not operators or identifier characters
+    {
+        Lexer lexer("a\xc3\xa9=b");
+        auto tokens = lexer.scanTokens();
+        
+        ASSERT_EQ(tokens.size(), 4);  // Including EOF token
+        EXPECT_EQ(tokens[0].lexeme, "a");
+        EXPECT_EQ(tokens[1].type, TokenType::ASSIGN);
+        EXPECT_EQ(tokens[2].lexeme, "b");
+    }
+}
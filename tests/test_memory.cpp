@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "msl_parser/ast/recursive_visitor.h"
+#include "msl_parser/lexer.h"
+#include "msl_parser/memory.h"
+#include "msl_parser/parser.h"
+
+using namespace msl_parser;
+
+namespace {
+
+class NodeBytesSum : public ast::RecursiveASTVisitor {
+public:
+    size_t bytes = 0;
+
+protected:
+    void visitNode(ast::ASTNode* node) override { bytes += nodeBytes(*node); }
+};
+
+std::string makeSource(int functions) {
+    std::string source = "using namespace metal;\n";
+    for (int i = 0; i < functions; i++) {
+        std::string n = std::to_string(i);
+        source += "kernel void a_rather_long_kernel_name_" + n +
+                  "(device float* data [[buffer(0)]], uint id [[thread_position_in_grid]]) {\n"
+                  "    float value = data[id] * 2.0 + " + n + ".0;\n"
+                  "    data[id] = value > 1.0 ? value : 1.0;\n"
+                  "}\n";
+    }
+    return source;
+}
+
+size_t countMemoryDiagnostics(const DiagnosticEngine& diagnostics) {
+    size_t count = 0;
+    for (const Diagnostic& diagnostic : diagnostics.getDiagnostics()) {
+        if (diagnostic.id == DiagID::MEMORY_LIMIT_EXCEEDED) {
+            count++;
+        }
+    }
+    return count;
+}
+
+} // namespace
+
+TEST(MemoryTest, HeapBytes) {
+    std::string small = "x";
+    EXPECT_EQ(heapBytes(small), 0u);
+    std::string large(100, 'x');
+    EXPECT_EQ(heapBytes(large), large.capacity() + 1);
+    EXPECT_GE(heapBytes(large), 101u);
+
+    MemoryBudget budget(100);
+    EXPECT_TRUE(budget.charge(MemoryCategory::AST, 60));
+    EXPECT_TRUE(budget.charge(MemoryCategory::TOKENS, 40));
+    EXPECT_FALSE(budget.limitExceeded());
+    EXPECT_FALSE(budget.charge(MemoryCategory::AST, 1));
+    EXPECT_TRUE(budget.limitExceeded());
+    budget.release(MemoryCategory::AST, 61);
+    EXPECT_EQ(budget.getTotal(), 40u);
+    EXPECT_EQ(budget.getPeak(), 101u);
+    EXPECT_EQ(budget.getUsage(MemoryCategory::TOKENS), 40u);
+    EXPECT_STREQ(memoryCategoryToString(MemoryCategory::LEXEMES), "lexemes");
+}
+
+TEST(MemoryTest, AccountsForParse) {
+    std::string source = makeSource(20);
+    MemoryBudget budget;
+    DiagnosticEngine diagnostics;
+    Lexer lexer(source, &diagnostics, &budget);
+    std::pmr::vector<Token> tokens = lexer.scanTokens();
+    Parser parser(tokens, &diagnostics, &budget);
+    auto unit = parser.parse();
+    ASSERT_FALSE(diagnostics.hasErrors());
+
+    // The lexer's copy of the source
+    EXPECT_GE(budget.getUsage(MemoryCategory::SOURCE), source.size() + 1);
+    EXPECT_EQ(budget.getUsage(MemoryCategory::TOKENS), tokens.capacity() * sizeof(Token));
+    size_t lexemeBytes = 0;
+    for (const Token& token : tokens) {
+        lexemeBytes += heapBytes(token.lexeme);
+    }
+    EXPECT_GT(lexemeBytes, 0u);
+    EXPECT_EQ(budget.getUsage(MemoryCategory::LEXEMES), lexemeBytes);
+
+    NodeBytesSum sum;
+    sum.traverse(unit.get());
+    EXPECT_EQ(budget.getUsage(MemoryCategory::AST), sum.bytes);
+    EXPECT_EQ(budget.getUsage(MemoryCategory::TABLES), 0u);
+    EXPECT_EQ(budget.getTotal(), budget.getUsage(MemoryCategory::SOURCE) +
+                                     tokens.capacity() * sizeof(Token) + lexemeBytes + sum.bytes);
+}
+
+TEST(MemoryTest, LimitStopsLexing) {
+    std::string source = makeSource(200);
+    MemoryBudget budget(source.size() + 16 * 1024);
+    DiagnosticEngine diagnostics;
+    Lexer lexer(source, &diagnostics, &budget);
+    std::pmr::vector<Token> tokens = lexer.scanTokens();
+
+    EXPECT_TRUE(budget.limitExceeded());
+    EXPECT_EQ(countMemoryDiagnostics(diagnostics), 1u);
+    EXPECT_EQ(DiagnosticPrinter(source).formatMessage(diagnostics.getDiagnostics()[0]),
+              "memory limit of " + std::to_string((budget.getLimit() + 1023) / 1024) +
+                  " KiB exceeded, stopping now");
+    ASSERT_FALSE(tokens.empty());
+    EXPECT_EQ(tokens.back().type, TokenType::END_OF_FILE);
+    EXPECT_LT(tokens.size(), Lexer(source).scanTokens().size());
+
+    // The parser stops at once without reporting again
+    Parser parser(tokens, &diagnostics, &budget);
+    auto unit = parser.parse();
+    ASSERT_NE(unit, nullptr);
+    EXPECT_TRUE(parser.hadError());
+    EXPECT_TRUE(unit->getDeclarations().empty());
+    EXPECT_EQ(diagnostics.getDiagnostics().size(), 1u);
+}
+
+TEST(MemoryTest, LimitStopsParsing) {
+    std::string source = makeSource(200);
+    DiagnosticEngine diagnostics;
+    MemoryBudget budget;
+    Lexer lexer(source, &diagnostics, &budget);
+    std::pmr::vector<Token> tokens = lexer.scanTokens();
+    budget.setLimit(budget.getTotal() + 8 * 1024);
+
+    Parser parser(tokens, &diagnostics, &budget);
+    auto unit = parser.parse();
+    ASSERT_NE(unit, nullptr);
+    EXPECT_TRUE(parser.hadError());
+    EXPECT_TRUE(budget.limitExceeded());
+
+    // One diagnostic and no cascade from the abandoned declaration
+    ASSERT_EQ(diagnostics.getDiagnostics().size(), 1u);
+    EXPECT_EQ(diagnostics.getDiagnostics()[0].id, DiagID::MEMORY_LIMIT_EXCEEDED);
+    EXPECT_LT(diagnostics.getDiagnostics()[0].offset, source.size());
+    EXPECT_FALSE(unit->getDeclarations().empty());
+    EXPECT_LT(unit->getDeclarations().size(), 200u);
+    // The overshoot is at most the node that crossed the limit
+    EXPECT_LT(budget.getTotal(), budget.getLimit() + 1024);
+}
@@ -0,0 +1,213 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <map>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include "msl_parser/ast/recursive_visitor.h"
+#include "msl_parser/lexer.h"
+#include "msl_parser/parser.h"
+
+using namespace msl_parser;
+
+namespace {
+
+// Allocations made through the global operator new while `countHeap` is
+// set, from any thread.
+std::atomic<bool> countHeap{false};
+std::atomic<size_t> heapAllocations{0};
+
+} // namespace
+
+// Replaced for the whole test binary; counts only while `countHeap` is set.
+void* operator new(size_t size) {
+    if (countHeap.load(std::memory_order_relaxed)) {
+        heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* pointer = std::malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+namespace {
+
+// Counts global heap allocations in its scope.
+class HeapCounter {
+public:
+    HeapCounter() {
+        heapAllocations = 0;
+        countHeap = true;
+    }
+    ~HeapCounter() { countHeap = false; }
+
+    size_t allocations() const { return heapAllocations; }
+};
+
+// Counts allocations and checks that every block is returned with the size
+// and alignment it was allocated with. Blocks come from malloc, and the
+// bookkeeping is not counted, so nothing done here shows up as a global
+// heap allocation.
+class CountingResource : public std::pmr::memory_resource {
+public:
+    size_t allocations = 0;
+    size_t bytesAllocated = 0;
+
+    size_t liveBlocks() const { return live.size(); }
+
+private:
+    std::map<void*, std::pair<size_t, size_t>> live;
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        bool counting = countHeap.exchange(false);
+        EXPECT_LE(alignment, alignof(std::max_align_t));
+        void* pointer = std::malloc(bytes ? bytes : 1);
+        allocations++;
+        bytesAllocated += bytes;
+        live[pointer] = {bytes, alignment};
+        countHeap = counting;
+        return pointer;
+    }
+
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override {
+        auto it = live.find(pointer);
+        ASSERT_NE(it, live.end()) << "block was not allocated here";
+        EXPECT_EQ(it->second.first, bytes);
+        EXPECT_EQ(it->second.second, alignment);
+        live.erase(it);
+        std::free(pointer);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+class NodeCounter : public ast::RecursiveASTVisitor {
+public:
+    size_t nodes = 0;
+
+protected:
+    void visitNode(ast::ASTNode*) override { nodes++; }
+};
+
+std::string makeSource(int functions) {
+    std::string source = "using namespace metal;\n";
+    for (int i = 0; i < functions; i++) {
+        std::string n = std::to_string(i);
+        source += "// Scales element " + n + " of the buffer\n"
+                  "kernel void scale_" + n +
+                  "(device float* data [[buffer(0)]], uint id [[thread_position_in_grid]]) {\n"
+                  "    float value = data[id] * 2.0 + " + n + ".0;\n"
+                  "    for (int j = 0; j < 4; j++) {\n"
+                  "        value = value > 1.0 ? value - 0.5 : value + float(j);\n"
+                  "    }\n"
+                  "    data[id] = value;\n"
+                  "}\n";
+    }
+    return source;
+}
+
+} // namespace
+
+TEST(MemoryResourceTest, LexerAllocatesFromResource) {
+    if (sizeof(void*) == 8) {
+        EXPECT_LE(sizeof(Token), 56u);
+    }
+
+    const std::string source = makeSource(100);
+    CountingResource resource;
+    {
+        Lexer lexer(source, nullptr, nullptr, &resource);
+        std::pmr::vector<Token> tokens = lexer.scanTokens();
+        EXPECT_EQ(tokens.get_allocator().resource(), &resource);
+        size_t longLexemes = 0;
+        for (const Token& token : tokens) {
+            EXPECT_EQ(token.lexeme.get_allocator().resource(), &resource);
+            if (heapBytes(token.lexeme) > 0) {
+                longLexemes++;
+            }
+        }
+
+        // The source copy, the growth steps of the token vector and one
+        // block per lexeme too long for the string itself; nothing per
+        // ordinary token.
+        EXPECT_GT(resource.allocations, longLexemes);
+        EXPECT_LE(resource.allocations, longLexemes + 32);
+        double perByte = static_cast<double>(resource.allocations) / source.size();
+        EXPECT_LT(perByte, 0.01) << resource.allocations << " allocations for "
+                                 << source.size() << " bytes";
+    }
+    EXPECT_EQ(resource.liveBlocks(), 0u);
+}
+
+TEST(MemoryResourceTest, ParserAllocatesNodesFromResource) {
+    const std::string source = makeSource(100);
+    // Function-local statics of the lexer and parser are built on first use
+    Lexer warmUp(source.substr(0, 300));
+    Parser(warmUp.scanTokens()).parse();
+
+    CountingResource resource;
+    {
+        std::pmr::vector<Token> tokens(&resource);
+        std::unique_ptr<ast::TranslationUnit> unit;
+        size_t lexerAllocations;
+        size_t heap;
+        {
+            HeapCounter counter;
+            Lexer lexer(source, nullptr, nullptr, &resource);
+            tokens = lexer.scanTokens();
+            lexerAllocations = resource.allocations;
+            Parser parser(tokens, nullptr, nullptr, &resource);
+            unit = parser.parse();
+            heap = counter.allocations();
+        }
+        ASSERT_EQ(unit->getDeclarations().size(), 101u);
+
+        // Names and lists inside the nodes come from the resource as well;
+        // lexing and parsing leave the global heap alone
+        EXPECT_EQ(heap, 0u);
+        EXPECT_EQ(unit->getDeclarations()[1]->getName().get_allocator().resource(), &resource);
+        NodeCounter counter;
+        counter.traverse(unit.get());
+        EXPECT_GE(resource.allocations - lexerAllocations, counter.nodes);
+
+        double perByte = static_cast<double>(resource.allocations) / source.size();
+        EXPECT_LT(perByte, 0.3) << resource.allocations << " allocations for "
+                                << source.size() << " bytes";
+    }
+    // Destroying the tree returns every node, name and list with its
+    // original size
+    EXPECT_EQ(resource.liveBlocks(), 0u);
+}
+
+TEST(MemoryResourceTest, ParsesIntoArena) {
+    const std::string source = makeSource(20);
+    CountingResource upstream;
+    std::pmr::monotonic_buffer_resource arena(64 * 1024, &upstream);
+    Lexer lexer(source, nullptr, nullptr, &arena);
+    std::pmr::vector<Token> tokens = lexer.scanTokens();
+    Parser parser(tokens, nullptr, nullptr, &arena);
+    auto unit = parser.parse();
+    ASSERT_FALSE(parser.hadError());
+    ASSERT_EQ(unit->getDeclarations().size(), 21u);
+
+    // The arena asks its upstream for a few large blocks only
+    EXPECT_LT(upstream.allocations, 16u);
+
+    // Nodes may be destroyed before the arena releases everything at once
+    unit.reset();
+    tokens.clear();
+    arena.release();
+    EXPECT_EQ(upstream.liveBlocks(), 0u);
+}
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "msl_parser/ast/recursive_visitor.h"
+#include "msl_parser/incremental.h"
+#include "msl_parser/lexer.h"
+#include "msl_parser/node_index.h"
+#include "msl_parser/parser.h"
+#include "msl_parser/stats.h"
+
+using namespace msl_parser;
+
+namespace {
+
+const char* const SHADER =
+    "struct Light {\n"
+    "    float3 position;\n"
+    "    float intensity;\n"
+    "};\n"
+    "\n"
+    "float4 shade(Light light, float3 normal) {\n"
+    "    float k = dot(normal, light.position) * light.intensity;\n"
+    "    if (k > 0.0) {\n"
+    "        return float4(k, k, k, 1.0);\n"
+    "    }\n"
+    "    return float4(0.0);\n"
+    "}\n";
+
+class NodeCollector : public ast::RecursiveASTVisitor {
+public:
+    std::vector<ast::ASTNode*> nodes;
+
+protected:
+    void visitNode(ast::ASTNode* node) override { nodes.push_back(node); }
+};
+
+// The smallest range containing `offset` by a linear scan; for equal ranges
+// the one visited last, i.e. the deepest.
+ast::ASTNode* innermostByScan(const std::vector<ast::ASTNode*>& nodes, int offset) {
+    ast::ASTNode* best = nullptr;
+    int bestLength = 0;
+    for (ast::ASTNode* node : nodes) {
+        const ast::SourceRange& range = node->getSourceRange();
+        int length = range.end.offset - range.start.offset;
+        if (range.start.offset <= offset && offset < range.end.offset &&
+            (!best || length <= bestLength)) {
+            best = node;
+            bestLength = length;
+        }
+    }
+    return best;
+}
+
+std::vector<NodeKind> kinds(const std::vector<ast::ASTNode*>& nodes) {
+    std::vector<NodeKind> result;
+    for (ast::ASTNode* node : nodes) {
+        result.push_back(getNodeKind(node));
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(NodeIndexTest, FindsInnermostAndEnclosingNodes) {
+    std::string source = SHADER;
+    Lexer lexer(source);
+    auto tokens = lexer.scanTokens();
+    Parser parser(tokens);
+    auto unit = parser.parse();
+    NodeIndex index(unit.get());
+
+    // "intensity" in "light.intensity"
+    size_t offset = source.find("intensity;\n    if") + 2;
+    std::vector<NodeKind> expected = {
+        NodeKind::MemberExpression,    NodeKind::BinaryExpression,
+        NodeKind::VariableDeclaration, NodeKind::DeclarationStatement,
+        NodeKind::CompoundStatement,   NodeKind::FunctionDeclaration,
+        NodeKind::TranslationUnit};
+    EXPECT_EQ(kinds(index.findEnclosing(offset)), expected);
+    EXPECT_EQ(index.findInnermost(offset), index.findEnclosing(offset).front());
+
+    // Between declarations only the translation unit applies; past the end
+    // nothing does
+    EXPECT_EQ(getNodeKind(index.findInnermost(source.find("\n\nfloat4"))),
+              NodeKind::TranslationUnit);
+    EXPECT_EQ(index.findInnermost(source.size() + 10), nullptr);
+}
+
+TEST(NodeIndexTest, AgreesWithALinearScan) {
+    std::string source = SHADER;
+    Lexer lexer(source);
+    auto tokens = lexer.scanTokens();
+    Parser parser(tokens);
+    auto unit = parser.parse();
+    NodeIndex index(unit.get());
+    NodeCollector collector;
+    collector.traverse(unit.get());
+
+    for (size_t offset = 0; offset <= source.size(); offset++) {
+        EXPECT_EQ(index.findInnermost(offset),
+                  innermostByScan(collector.nodes, static_cast<int>(offset)))
+            << "offset " << offset;
+    }
+}
+
+TEST(NodeIndexTest, AgreesWithALinearScanOnDeepTrees) {
+    // Nested parentheses and blocks, with siblings after each closing one
+    std::string source = "float f(float x) { return ";
+    for (int i = 0; i < 200; i++) {
+        source += "(x + ";
+    }
+    source += "1.0";
+    for (int i = 0; i < 200; i++) {
+        source += ") * x";
+    }
+    source += "; }\nvoid g() { ";
+    for (int i = 0; i < 100; i++) {
+        source += "{ float y; ";
+    }
+    for (int i = 0; i < 100; i++) {
+        source += "} ";
+    }
+    source += "}\n";
+    Lexer lexer(source);
+    auto tokens = lexer.scanTokens();
+    Parser parser(tokens);
+    auto unit = parser.parse();
+    NodeIndex index(unit.get());
+    NodeCollector collector;
+    collector.traverse(unit.get());
+
+    for (size_t offset = 0; offset <= source.size(); offset++) {
+        EXPECT_EQ(index.findInnermost(offset),
+                  innermostByScan(collector.nodes, static_cast<int>(offset)))
+            << "offset " << offset;
+    }
+}
+
+TEST(NodeIndexTest, IncrementalParserRebuildsAfterEdits) {
+    std::string source = SHADER;
+    IncrementalParser incremental(source);
+    size_t offset = source.find("return float4(0.0)");
+    EXPECT_EQ(getNodeKind(incremental.getNodeIndex().findInnermost(offset)),
+              NodeKind::ReturnStatement);
+    EXPECT_EQ(&incremental.getNodeIndex(), &incremental.getNodeIndex());
+
+    // Inserting a declaration in front moves everything after it
+    std::string inserted = "constant float bias = 0.5;\n";
+    incremental.applyEdit({0, 0, inserted});
+    const NodeIndex& index = incremental.getNodeIndex();
+    EXPECT_EQ(getNodeKind(index.findInnermost(offset + inserted.size())),
+              NodeKind::ReturnStatement);
+    NodeCollector collector;
+    collector.traverse(incremental.getTranslationUnit());
+    for (size_t i = 0; i <= incremental.getSource().size(); i++) {
+        EXPECT_EQ(index.findInnermost(i), innermostByScan(collector.nodes, static_cast<int>(i)))
+            << "offset " << i;
+    }
+}
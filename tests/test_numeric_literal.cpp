@@ -0,0 +1,226 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include "msl_parser/ast/recursive_visitor.h"
+#include "msl_parser/lexer.h"
+#include "msl_parser/numeric_literal.h"
+#include "msl_parser/parser.h"
+
+using namespace msl_parser;
+
+namespace {
+
+LiteralStatus decodeInteger(const std::string& text, uint64_t& value) {
+    return decodeIntegerLiteral(text.data(), text.data() + text.size(), value);
+}
+
+template <typename T>
+LiteralStatus decodeFloat(const std::string& text, T& value) {
+    return decodeFloatLiteral(text.data(), text.data() + text.size(), value);
+}
+
+// Bitwise comparison, so -0.0 vs 0.0 and rounding differences both show.
+template <typename T>
+bool sameBits(T a, T b) {
+    return std::memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+} // namespace
+
+TEST(NumericLiteralTest, Integers) {
+    uint64_t value = 0;
+    
+    EXPECT_EQ(decodeInteger("0", value), LiteralStatus::OK);
+    EXPECT_EQ(value, 0u);
+    EXPECT_EQ(decodeInteger("42", value), LiteralStatus::OK);
+    EXPECT_EQ(value, 42u);
+    EXPECT_EQ(decodeInteger("42u", value), LiteralStatus::OK);
+    EXPECT_EQ(value, 42u);
+    EXPECT_EQ(decodeInteger("0xDeAdBeEf", value), LiteralStatus::OK);
+    EXPECT_EQ(value, 0xDEADBEEFu);
+    EXPECT_EQ(decodeInteger("0XFFU", value), LiteralStatus::OK);
+    EXPECT_EQ(value, 255u);
+    EXPECT_EQ(decodeInteger("0b1010", value), LiteralStatus::OK);
+    EXPECT_EQ(value, 10u);
+    EXPECT_EQ(decodeInteger("017", value), LiteralStatus::OK);
+    EXPECT_EQ(value, 15u);
+    EXPECT_EQ(decodeInteger("18446744073709551615", value), LiteralStatus::OK);
+    EXPECT_EQ(value, std::numeric_limits<uint64_t>::max());
+    
+    EXPECT_EQ(decodeInteger("18446744073709551616", value), LiteralStatus::OUT_OF_RANGE);
+    EXPECT_EQ(decodeInteger("0x1ffffffffffffffff", value), LiteralStatus::OUT_OF_RANGE);
+    EXPECT_EQ(decodeInteger("0x", value), LiteralStatus::INVALID);
+    EXPECT_EQ(decodeInteger("0b", value), LiteralStatus::INVALID);
+    EXPECT_EQ(decodeInteger("09", value), LiteralStatus::INVALID);
+    EXPECT_EQ(decodeInteger("0b102", value), LiteralStatus::INVALID);
+    EXPECT_EQ(decodeInteger("12x", value), LiteralStatus::INVALID);
+}
+
+TEST(NumericLiteralTest, Floats) {
+    float f = 0;
+    double d = 0;
+    
+    EXPECT_EQ(decodeFloat("3.14", f), LiteralStatus::OK);
+    EXPECT_EQ(f, 3.14f);
+    EXPECT_EQ(decodeFloat("1.0f", f), LiteralStatus::OK);
+    EXPECT_EQ(f, 1.0f);
+    EXPECT_EQ(decodeFloat("1.5h", f), LiteralStatus::OK);
+    EXPECT_EQ(f, 1.5f);
+    EXPECT_EQ(decodeFloat("10.", f), LiteralStatus::OK);
+    EXPECT_EQ(f, 10.0f);
+    EXPECT_EQ(decodeFloat("2.5e-3", f), LiteralStatus::OK);
+    EXPECT_EQ(f, 2.5e-3f);
+    EXPECT_EQ(decodeFloat("3.14E+5", f), LiteralStatus::OK);
+    EXPECT_EQ(f, 3.14e5f);
+    EXPECT_EQ(decodeFloat("0.000", f), LiteralStatus::OK);
+    EXPECT_EQ(f, 0.0f);
+    EXPECT_EQ(decodeFloat("0.1", d), LiteralStatus::OK);
+    EXPECT_EQ(d, 0.1);
+    
+    // Boundaries of the float range
+    EXPECT_EQ(decodeFloat("3.4028234663852886e38", f), LiteralStatus::OK);
+    EXPECT_EQ(f, std::numeric_limits<float>::max());
+    EXPECT_EQ(decodeFloat("1e39", f), LiteralStatus::OUT_OF_RANGE);
+    EXPECT_TRUE(std::isinf(f));
+    EXPECT_EQ(decodeFloat("1.401298464324817e-45", f), LiteralStatus::OK);
+    EXPECT_EQ(f, std::numeric_limits<float>::denorm_min());
+    EXPECT_EQ(decodeFloat("1e-50", f), LiteralStatus::OK);
+    EXPECT_EQ(f, 0.0f);
+    EXPECT_EQ(decodeFloat("1e99999999999", d), LiteralStatus::OUT_OF_RANGE);
+    EXPECT_EQ(decodeFloat("1e-99999999999", d), LiteralStatus::OK);
+    EXPECT_EQ(d, 0.0);
+    
+    EXPECT_EQ(decodeFloat("1e", f), LiteralStatus::INVALID);
+    EXPECT_EQ(decodeFloat(".", f), LiteralStatus::INVALID);
+    EXPECT_EQ(decodeFloat("1.0x", f), LiteralStatus::INVALID);
+}
+
+TEST(NumericLiteralTest, CorrectlyRounded) {
+    // Halfway cases and long inputs that need the exact slow path
+    {
+        // 2^24 + 1 is halfway between two floats; ties go to even
+        float f = 0;
+        EXPECT_EQ(decodeFloat("16777217", f), LiteralStatus::OK);
+        EXPECT_EQ(f, 16777216.0f);
+        EXPECT_EQ(decodeFloat("16777217.000000000000000000000001", f), LiteralStatus::OK);
+        EXPECT_EQ(f, 16777218.0f);
+        
+        double d = 0;
+        EXPECT_EQ(decodeFloat("9007199254740993", d), LiteralStatus::OK);
+        EXPECT_EQ(d, 9007199254740992.0);
+        std::string justAbove = "9007199254740993." + std::string(800, '0') + "1";
+        EXPECT_EQ(decodeFloat(justAbove, d), LiteralStatus::OK);
+        EXPECT_EQ(d, 9007199254740994.0);
+    }
+    
+    // Random values of every magnitude round the same as the C library
+    {
+        std::mt19937_64 random(1234);
+        char buffer[64];
+        for (int i = 0; i < 20000; i++) {
+            uint64_t bits = random();
+            double reference;
+            std::memcpy(&reference, &bits, sizeof(reference));
+            if (!std::isfinite(reference)) {
+                continue;
+            }
+            reference = std::fabs(reference);
+            std::snprintf(buffer, sizeof(buffer), "%.*e", static_cast<int>(random() % 18),
+                          reference);
+            
+            // Printing with fewer digits can round up past the largest value
+            double d = 0;
+            double expectedDouble = std::strtod(buffer, nullptr);
+            EXPECT_EQ(decodeFloat(buffer, d), std::isinf(expectedDouble)
+                                                  ? LiteralStatus::OUT_OF_RANGE
+                                                  : LiteralStatus::OK) << buffer;
+            EXPECT_TRUE(sameBits(d, expectedDouble)) << buffer;
+            
+            float f = 0;
+            float expected = std::strtof(buffer, nullptr);
+            LiteralStatus status = decodeFloat(buffer, f);
+            EXPECT_EQ(status, std::isinf(expected) ? LiteralStatus::OUT_OF_RANGE
+                                                   : LiteralStatus::OK) << buffer;
+            EXPECT_TRUE(sameBits(f, expected)) << buffer;
+        }
+    }
+    
+    // The same within the float range, including subnormals
+    {
+        std::mt19937 random(5678);
+        char buffer[64];
+        for (int i = 0; i < 20000; i++) {
+            uint32_t bits = random() & 0x7fffffffu;
+            float reference;
+            std::memcpy(&reference, &bits, sizeof(reference));
+            if (!std::isfinite(reference)) {
+                continue;
+            }
+            std::snprintf(buffer, sizeof(buffer), "%.*e", static_cast<int>(random() % 12),
+                          static_cast<double>(reference));
+            
+            float f = 0;
+            float expected = std::strtof(buffer, nullptr);
+            LiteralStatus status = decodeFloat(buffer, f);
+            EXPECT_EQ(status, std::isinf(expected) ? LiteralStatus::OUT_OF_RANGE
+                                                   : LiteralStatus::OK) << buffer;
+            EXPECT_TRUE(sameBits(f, expected)) << buffer;
+        }
+    }
+}
+
+TEST(NumericLiteralTest, ParserWarnsAboutIntegersTooLargeForTheirType) {
+    Lexer lexer("kernel void k() { a = 4294967296; b = 3000000000; c = 3000000000u; "
+                "d = 0xFFFFFFFF; e = 2147483647; f = 0x100000000u; }");
+    auto tokens = lexer.scanTokens();
+    DiagnosticEngine diagnostics;
+    Parser parser(tokens, &diagnostics);
+    auto unit = parser.parse();
+
+    const auto& reported = diagnostics.getDiagnostics();
+    ASSERT_EQ(reported.size(), 3);
+    EXPECT_EQ(diagnostics.getErrorCount(), 0);
+    const uint32_t offsets[] = {22, 38, 103};
+    for (size_t i = 0; i < reported.size(); i++) {
+        EXPECT_EQ(reported[i].id, DiagID::INTEGER_LITERAL_OUT_OF_RANGE);
+        EXPECT_EQ(reported[i].offset, offsets[i]);
+    }
+}
+
+TEST(NumericLiteralTest, ParserUsesDecodedValues) {
+    Lexer lexer("kernel void k() { a = 0x10 + 0b11 + 1.5e1f + 1e39; b = 99999999999999999999; }");
+    auto tokens = lexer.scanTokens();
+    DiagnosticEngine diagnostics;
+    Parser parser(tokens, &diagnostics);
+    auto unit = parser.parse();
+    
+    ASSERT_EQ(diagnostics.getDiagnostics().size(), 2);
+    EXPECT_EQ(diagnostics.getDiagnostics()[0].id, DiagID::FLOAT_LITERAL_OUT_OF_RANGE);
+    EXPECT_EQ(diagnostics.getDiagnostics()[1].id, DiagID::INTEGER_LITERAL_TOO_LARGE);
+    EXPECT_EQ(diagnostics.getErrorCount(), 1);
+    
+    struct LiteralCollector : public ast::RecursiveASTVisitor {
+        std::vector<int> integers;
+        std::vector<float> floats;
+        void visitNode(ast::ASTNode* node) override {
+            if (auto* integer = dynamic_cast<ast::IntegerLiteral*>(node)) {
+                integers.push_back(integer->getValue());
+            } else if (auto* real = dynamic_cast<ast::FloatLiteral*>(node)) {
+                floats.push_back(real->getValue());
+            }
+        }
+    } collector;
+    collector.traverse(unit.get());
+    
+    ASSERT_EQ(collector.integers.size(), 3);
+    EXPECT_EQ(collector.integers[0], 16);
+    EXPECT_EQ(collector.integers[1], 3);
+    ASSERT_EQ(collector.floats.size(), 2);
+    EXPECT_EQ(collector.floats[0], 15.0f);
+    EXPECT_TRUE(std::isinf(collector.floats[1]));
+}
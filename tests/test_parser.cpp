@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+#include "msl_parser/lexer.h"
+#include "msl_parser/parser.h"
+
+using namespace msl_parser;
+using namespace msl_parser::ast;
+
+namespace {
+
+struct ParseResult {
+    std::pmr::vector<Token> tokens;
+    std::unique_ptr<TranslationUnit> unit;
+    std::vector<std::string> errors;
+};
+
+ParseResult parseSource(const std::string& source) {
+    ParseResult result;
+    DiagnosticEngine diagnostics;
+    Lexer lexer(source, &diagnostics);
+    result.tokens = lexer.scanTokens();
+    Parser parser(result.tokens, &diagnostics);
+    result.unit = parser.parse();
+    DiagnosticPrinter printer(source);
+    for (const auto& diagnostic : diagnostics.getDiagnostics()) {
+        result.errors.push_back(printer.render(diagnostic));
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(ParserTest, GlobalVariables) {
+    auto result = parseSource("constant float scale = 2.0, bias;");
+    
+    ASSERT_TRUE(result.errors.empty());
+    const auto& decls = result.unit->getDeclarations();
+    ASSERT_EQ(decls.size(), 2);
+    
+    auto* scale = dynamic_cast<VariableDeclaration*>(decls[0].get());
+    ASSERT_NE(scale, nullptr);
+    EXPECT_EQ(scale->getName(), "scale");
+    EXPECT_EQ(scale->getKind(), VariableDeclaration::Kind::GLOBAL);
+    EXPECT_EQ(scale->getType().name, "float");
+    EXPECT_EQ(scale->getType().addressSpace, AddressSpace::CONSTANT);
+    ASSERT_NE(scale->getInitializer(), nullptr);
+    
+    auto* bias = dynamic_cast<VariableDeclaration*>(decls[1].get());
+    ASSERT_NE(bias, nullptr);
+    EXPECT_EQ(bias->getName(), "bias");
+    EXPECT_EQ(bias->getInitializer(), nullptr);
+}
+
+TEST(ParserTest, StructDeclaration) {
+    auto result = parseSource(
+        "struct VertexOut {\n"
+        "    float4 position [[position]];\n"
+        "    float2 uv, extra;\n"
+        "};");
+    
+    ASSERT_TRUE(result.errors.empty());
+    ASSERT_EQ(result.unit->getDeclarations().size(), 1);
+    auto* decl = dynamic_cast<StructDeclaration*>(result.unit->getDeclarations()[0].get());
+    ASSERT_NE(decl, nullptr);
+    EXPECT_EQ(decl->getName(), "VertexOut");
+    
+    const auto& fields = decl->getFields();
+    ASSERT_EQ(fields.size(), 3);
+    EXPECT_EQ(fields[0]->getName(), "position");
+    ASSERT_EQ(fields[0]->getAttributes().size(), 1);
+    EXPECT_EQ(fields[0]->getAttributes()[0].name, "position");
+    EXPECT_EQ(fields[1]->getName(), "uv");
+    EXPECT_EQ(fields[2]->getName(), "extra");
+    EXPECT_EQ(fields[2]->getKind(), VariableDeclaration::Kind::FIELD);
+}
+
+TEST(ParserTest, KernelFunction) {
+    auto result = parseSource(
+        "using namespace metal;\n"
+        "kernel void add(device const float* a [[buffer(0)]],\n"
+        "                device float* out [[buffer(1)]],\n"
+        "                uint id [[thread_position_in_grid]]) {\n"
+        "    out[id] = a[id] * 2.0f;\n"
+        "}\n");
+    
+    ASSERT_TRUE(result.errors.empty());
+    const auto& decls = result.unit->getDeclarations();
+    ASSERT_EQ(decls.size(), 2);
+    EXPECT_NE(dynamic_cast<UsingDeclaration*>(decls[0].get()), nullptr);
+    EXPECT_EQ(decls[0]->getName(), "metal");
+    
+    auto* fn = dynamic_cast<FunctionDeclaration*>(decls[1].get());
+    ASSERT_NE(fn, nullptr);
+    EXPECT_EQ(fn->getName(), "add");
+    EXPECT_EQ(fn->getQualifier(), FunctionDeclaration::Qualifier::KERNEL);
+    EXPECT_EQ(fn->getReturnType().name, "void");
+    
+    const auto& params = fn->getParameters();
+    ASSERT_EQ(params.size(), 3);
+    EXPECT_EQ(params[0]->getName(), "a");
+    EXPECT_EQ(params[0]->getType().addressSpace, AddressSpace::DEVICE);
+    EXPECT_TRUE(params[0]->getType().isConst);
+    EXPECT_EQ(params[0]->getType().pointerDepth, 1);
+    ASSERT_EQ(params[0]->getAttributes().size(), 1);
+    EXPECT_EQ(params[0]->getAttributes()[0].name, "buffer");
+    EXPECT_EQ(params[0]->getAttributes()[0].argument, "0");
+    EXPECT_EQ(params[2]->getAttributes()[0].name, "thread_position_in_grid");
+    
+    ASSERT_NE(fn->getBody(), nullptr);
+    ASSERT_EQ(fn->getBody()->getStatements().size(), 1);
+    auto* stmt = dynamic_cast<ExpressionStatement*>(fn->getBody()->getStatements()[0].get());
+    ASSERT_NE(stmt, nullptr);
+    auto* assign = dynamic_cast<BinaryExpression*>(stmt->getExpression());
+    ASSERT_NE(assign, nullptr);
+    EXPECT_EQ(assign->getOperator(), BinaryExpression::Operator::ASSIGN);
+    EXPECT_NE(dynamic_cast<IndexExpression*>(assign->getLeft()), nullptr);
+    EXPECT_EQ(assign->getParent(), stmt);
+}
+
+TEST(ParserTest, OperatorPrecedence) {
+    auto result = parseSource("float x = 1 + 2 * 3 < 4 && b;");
+    
+    ASSERT_TRUE(result.errors.empty());
+    auto* var = dynamic_cast<VariableDeclaration*>(result.unit->getDeclarations()[0].get());
+    ASSERT_NE(var, nullptr);
+    
+    auto* logicalAnd = dynamic_cast<BinaryExpression*>(var->getInitializer());
+    ASSERT_NE(logicalAnd, nullptr);
+    EXPECT_EQ(logicalAnd->getOperator(), BinaryExpression::Operator::LOGICAL_AND);
+    
+    auto* less = dynamic_cast<BinaryExpression*>(logicalAnd->getLeft());
+    ASSERT_NE(less, nullptr);
+    EXPECT_EQ(less->getOperator(), BinaryExpression::Operator::LESS_THAN);
+    
+    auto* add = dynamic_cast<BinaryExpression*>(less->getLeft());
+    ASSERT_NE(add, nullptr);
+    EXPECT_EQ(add->getOperator(), BinaryExpression::Operator::ADD);
+    
+    auto* mul = dynamic_cast<BinaryExpression*>(add->getRight());
+    ASSERT_NE(mul, nullptr);
+    EXPECT_EQ(mul->getOperator(), BinaryExpression::Operator::MULTIPLY);
+}
+
+TEST(ParserTest, Statements) {
+    auto result = parseSource(
+        "void f(int n) {\n"
+        "    float4 color = float4(1.0, 0.5, 0.0, 1.0);\n"
+        "    for (int i = 0; i < n; i++) {\n"
+        "        if (i % 2 == 0) continue; else color.xyz *= 0.5;\n"
+        "    }\n"
+        "    while (n > 0) n--;\n"
+        "    do { n++; } while (n < 4);\n"
+        "    switch (n) { case 1: break; default: break; }\n"
+        "    return;\n"
+        "}\n");
+    
+    ASSERT_TRUE(result.errors.empty()) << result.errors[0];
+    auto* fn = dynamic_cast<FunctionDeclaration*>(result.unit->getDeclarations()[0].get());
+    ASSERT_NE(fn, nullptr);
+    
+    const auto& stmts = fn->getBody()->getStatements();
+    ASSERT_EQ(stmts.size(), 6);
+    auto* decl = dynamic_cast<DeclarationStatement*>(stmts[0].get());
+    ASSERT_NE(decl, nullptr);
+    auto* construct =
+        dynamic_cast<ConstructExpression*>(decl->getDeclarations()[0]->getInitializer());
+    ASSERT_NE(construct, nullptr);
+    EXPECT_EQ(construct->getType().name, "float4");
+    EXPECT_EQ(construct->getArguments().size(), 4);
+    
+    EXPECT_NE(dynamic_cast<ForStatement*>(stmts[1].get()), nullptr);
+    EXPECT_NE(dynamic_cast<WhileStatement*>(stmts[2].get()), nullptr);
+    EXPECT_NE(dynamic_cast<DoStatement*>(stmts[3].get()), nullptr);
+    EXPECT_NE(dynamic_cast<SwitchStatement*>(stmts[4].get()), nullptr);
+    EXPECT_NE(dynamic_cast<ReturnStatement*>(stmts[5].get()), nullptr);
+}
+
+TEST(ParserTest, NestedSubscriptSplitsAttributeBracket) {
+    auto result = parseSource("void f() { x = a[b[0]]; }");
+    
+    ASSERT_TRUE(result.errors.empty());
+    auto* fn = dynamic_cast<FunctionDeclaration*>(result.unit->getDeclarations()[0].get());
+    auto* stmt = dynamic_cast<ExpressionStatement*>(fn->getBody()->getStatements()[0].get());
+    auto* assign = dynamic_cast<BinaryExpression*>(stmt->getExpression());
+    ASSERT_NE(assign, nullptr);
+    auto* outer = dynamic_cast<IndexExpression*>(assign->getRight());
+    ASSERT_NE(outer, nullptr);
+    EXPECT_NE(dynamic_cast<IndexExpression*>(outer->getIndex()), nullptr);
+}
+
+TEST(ParserTest, SourceRanges) {
+    auto result = parseSource("float a;\nint b = 4;");
+    
+    ASSERT_EQ(result.unit->getDeclarations().size(), 2);
+    const auto& range = result.unit->getDeclarations()[1]->getSourceRange();
+    EXPECT_EQ(range.start.line, 2);
+    EXPECT_EQ(range.start.column, 1);
+    EXPECT_EQ(range.start.offset, 9);
+    EXPECT_EQ(range.end.offset, 19);
+}
+
+TEST(ParserTest, ReportsErrors) {
+    auto result = parseSource("float = ;");
+    
+    EXPECT_FALSE(result.errors.empty());
+}
@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "msl_parser/batch.h"
+#include "msl_parser/lexer.h"
+#include "msl_parser/parser.h"
+#include "msl_parser/prelude.h"
+#include "msl_parser/type_checker.h"
+#include "temp_directory.h"
+
+using namespace msl_parser;
+
+namespace {
+
+std::string spell(const std::pmr::vector<Token>& tokens) {
+    std::string text;
+    for (const Token& token : tokens) {
+        if (token.type == TokenType::END_OF_FILE) {
+            break;
+        }
+        if (!text.empty()) {
+            text += ' ';
+        }
+        text += token.lexeme;
+    }
+    return text;
+}
+
+// A directory with a prelude and the header it includes.
+class PreludeDirectory : public TempDirectory {
+public:
+    PreludeDirectory() {
+        write("common.h", "#ifndef COMMON_H\n"
+                          "#define COMMON_H\n"
+                          "#define SCALE(x) ((x) * 2.0)\n"
+                          "struct Light { float3 color; };\n"
+                          "#endif\n");
+        write("prelude.h", "#include \"common.h\"\n"
+                           "#define MAX_LIGHTS 8\n"
+                           "float luminance(float3 c) { return dot(c, float3(0.3, 0.6, 0.1)); }\n"
+                           "constant float gamma = 2.2;\n");
+    }
+
+    // Preprocesses prelude.h and writes its snapshot.
+    std::shared_ptr<const PreludeSnapshot> snapshot() {
+        DiagnosticEngine diagnostics;
+        Preprocessor preprocessor(&diagnostics);
+        auto tokens = preprocessor.preprocess(read("prelude.h"), file("prelude.h"));
+        EXPECT_TRUE(diagnostics.getDiagnostics().empty());
+        EXPECT_TRUE(PreludeSnapshot::write(file("prelude.snapshot"), preprocessor, tokens));
+        return PreludeSnapshot::open(file("prelude.snapshot"));
+    }
+};
+
+// The type names of the expression statements in the last function of
+// `source`, checked against `prelude`.
+std::vector<std::string> expressionTypes(const std::string& source,
+                                         std::shared_ptr<const PreludeDeclarations> prelude,
+                                         std::vector<DiagID>* ids = nullptr) {
+    Lexer lexer(source);
+    auto tokens = lexer.scanTokens();
+    DiagnosticEngine diagnostics;
+    Parser parser(tokens, &diagnostics);
+    auto unit = parser.parse();
+    TypeChecker checker(&diagnostics);
+    checker.setPrelude(std::move(prelude));
+    checker.check(unit.get());
+    for (const Diagnostic& diagnostic : diagnostics.getDiagnostics()) {
+        if (ids) {
+            ids->push_back(diagnostic.id);
+        }
+    }
+    std::vector<std::string> names;
+    auto* function = static_cast<ast::FunctionDeclaration*>(unit->getDeclarations().back().get());
+    for (const auto& statement : function->getBody()->getStatements()) {
+        if (auto* expression = dynamic_cast<ast::ExpressionStatement*>(statement.get())) {
+            names.push_back(checker.getTypes().getName(expression->getExpression()->getTypeId()));
+        }
+    }
+    return names;
+}
+
+} // namespace
+
+TEST(PreludeTest, RoundTripsMacrosAndDeclarations) {
+    PreludeDirectory directory;
+    auto snapshot = directory.snapshot();
+    ASSERT_NE(snapshot, nullptr);
+    EXPECT_EQ(snapshot->getMacroCount(), 3u);  // COMMON_H, SCALE, MAX_LIGHTS
+    EXPECT_EQ(snapshot->getDeclarationCount(), 3u);
+
+    MacroDefinition macro;
+    ASSERT_TRUE(snapshot->findMacro("SCALE", macro));
+    EXPECT_TRUE(macro.functionLike);
+    ASSERT_EQ(macro.parameters.size(), 1u);
+    EXPECT_EQ(macro.parameters[0], "x");
+    EXPECT_EQ(macro.body.size(), 7u);
+    EXPECT_FALSE(snapshot->findMacro("UNDEFINED", macro));
+
+    PreludeSnapshot::Declaration declaration;
+    ASSERT_TRUE(snapshot->findDeclaration("luminance", declaration));
+    EXPECT_EQ(declaration.kind, NodeKind::FunctionDeclaration);
+    ASSERT_TRUE(snapshot->findDeclaration("Light", declaration));
+    EXPECT_EQ(declaration.kind, NodeKind::StructDeclaration);
+    EXPECT_FALSE(snapshot->findDeclaration("missing", declaration));
+
+    // A declaration's tokens parse back into the declaration
+    ASSERT_TRUE(snapshot->findDeclaration("gamma", declaration));
+    auto tokens = snapshot->getTokens(declaration.firstToken, declaration.tokenCount);
+    EXPECT_EQ(spell(tokens), "constant float gamma = 2.2 ;");
+    DiagnosticEngine diagnostics;
+    Parser parser(tokens, &diagnostics);
+    auto unit = parser.parse();
+    ASSERT_EQ(unit->getDeclarations().size(), 1u);
+    EXPECT_EQ(unit->getDeclarations()[0]->getName(), "gamma");
+    EXPECT_TRUE(diagnostics.getDiagnostics().empty());
+}
+
+TEST(PreludeTest, StartsTranslationUnitsFromTheSnapshot) {
+    PreludeDirectory directory;
+    auto snapshot = directory.snapshot();
+    ASSERT_NE(snapshot, nullptr);
+
+    DiagnosticEngine diagnostics;
+    Preprocessor preprocessor(&diagnostics);
+    preprocessor.setPrelude(snapshot);
+    EXPECT_TRUE(preprocessor.isDefined("MAX_LIGHTS"));
+    // The prelude and the guarded header it included are not read again
+    auto tokens = preprocessor.preprocess("#include \"prelude.h\"\n"
+                                          "#include \"common.h\"\n"
+                                          "float a = SCALE(MAX_LIGHTS);\n",
+                                          directory.file("shader.metal"));
+    EXPECT_EQ(spell(tokens), "float a = ( ( 8 ) * 2.0 ) ;");
+    EXPECT_EQ(preprocessor.getSkippedIncludes(), 2u);
+    EXPECT_EQ(preprocessor.getFiles().size(), 1u);
+    EXPECT_TRUE(diagnostics.getDiagnostics().empty());
+
+    // Prelude macros can be undefined and redefined
+    preprocessor.undefine("MAX_LIGHTS");
+    EXPECT_FALSE(preprocessor.isDefined("MAX_LIGHTS"));
+    EXPECT_EQ(spell(preprocessor.preprocess("MAX_LIGHTS\n#define MAX_LIGHTS 4\nMAX_LIGHTS")),
+              "MAX_LIGHTS 4");
+    EXPECT_TRUE(diagnostics.getDiagnostics().empty());
+}
+
+TEST(PreludeTest, ResolvesNamesToPreludeDeclarations) {
+    PreludeDirectory directory;
+    auto snapshot = directory.snapshot();
+    ASSERT_NE(snapshot, nullptr);
+    auto prelude = std::make_shared<const PreludeDeclarations>(snapshot);
+    ASSERT_EQ(prelude->find("Light").size(), 1u);
+    EXPECT_EQ(prelude->find("Light")[0]->getName(), "Light");
+    EXPECT_TRUE(prelude->find("missing").empty());
+    EXPECT_EQ(prelude->getParsedCount(), 1u);
+
+    // Only the declarations a unit uses are parsed
+    EXPECT_EQ(expressionTypes("void f() { (gamma); }", prelude),
+              std::vector<std::string>{"float"});
+    EXPECT_EQ(prelude->getParsedCount(), 2u);
+
+    std::vector<DiagID> ids;
+    EXPECT_EQ(expressionTypes("void f(Light light, float3 c) {\n"
+                              "    (luminance(c));\n"
+                              "    (light.color);\n"
+                              "    (gamma * light.color);\n"
+                              "    (luminance(c, c));\n"
+                              "}\n",
+                              prelude, &ids),
+              (std::vector<std::string>{"float", "float3", "float3", "float"}));
+    EXPECT_EQ(ids, std::vector<DiagID>{DiagID::FUNCTION_ARGUMENT_COUNT});
+    EXPECT_EQ(prelude->getParsedCount(), 3u);
+
+    // The unit's own declarations hide the prelude's
+    EXPECT_EQ(expressionTypes("void f() { int gamma = 1; (gamma); }", prelude),
+              std::vector<std::string>{"int"});
+
+    // Without the prelude the names stay unresolved and untyped
+    EXPECT_EQ(expressionTypes("void f(float3 c) { (luminance(c)); (gamma); }", nullptr),
+              (std::vector<std::string>{"<unknown>", "<unknown>"}));
+}
+
+TEST(PreludeTest, BatchFilesStartFromThePrelude) {
+    PreludeDirectory directory;
+    BatchOptions options;
+    options.typeCheck = true;
+    options.prelude = directory.snapshot();
+    ASSERT_NE(options.prelude, nullptr);
+    BatchProcessor processor(options);
+
+    std::string out;
+    EXPECT_TRUE(processor.processSource(directory.file("a.metal"),
+                                        "float a(float3 c) { return luminance(c) * MAX_LIGHTS; }",
+                                        out));
+    EXPECT_FALSE(processor.processSource(directory.file("b.metal"),
+                                         "float b(float3 c) { return luminance(c, c); }", out));
+    EXPECT_NE(out.find("function takes 1 arguments, but 2 were given"), std::string::npos);
+}
+
+TEST(PreludeTest, RejectsInvalidSnapshots) {
+    PreludeDirectory directory;
+    ASSERT_NE(directory.snapshot(), nullptr);
+    EXPECT_EQ(PreludeSnapshot::open(directory.file("missing.snapshot")), nullptr);
+
+    std::string data = directory.read("prelude.snapshot");
+    directory.write("truncated.snapshot", data.substr(0, data.size() / 2));
+    EXPECT_EQ(PreludeSnapshot::open(directory.file("truncated.snapshot")), nullptr);
+
+    std::string corrupt = data;
+    corrupt[0] = 'X';
+    directory.write("corrupt.snapshot", corrupt);
+    EXPECT_EQ(PreludeSnapshot::open(directory.file("corrupt.snapshot")), nullptr);
+
+    directory.write("empty.snapshot", "");
+    EXPECT_EQ(PreludeSnapshot::open(directory.file("empty.snapshot")), nullptr);
+}
@@ -0,0 +1,307 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include "msl_parser/parser.h"
+#include "msl_parser/preprocessor.h"
+#include "temp_directory.h"
+
+using namespace msl_parser;
+
+namespace {
+
+// Lexemes joined by spaces, without the END_OF_FILE token.
+std::string spell(const std::pmr::vector<Token>& tokens) {
+    std::string text;
+    for (const Token& token : tokens) {
+        if (token.type == TokenType::END_OF_FILE) {
+            break;
+        }
+        if (!text.empty()) {
+            text += ' ';
+        }
+        text += token.lexeme;
+    }
+    return text;
+}
+
+std::string preprocessText(const std::string& source) {
+    DiagnosticEngine diagnostics;
+    Preprocessor preprocessor(&diagnostics);
+    std::string text = spell(preprocessor.preprocess(source));
+    EXPECT_TRUE(diagnostics.getDiagnostics().empty());
+    return text;
+}
+
+bool hasDiagnostic(const DiagnosticEngine& diagnostics, DiagID id) {
+    for (const Diagnostic& diagnostic : diagnostics.getDiagnostics()) {
+        if (diagnostic.id == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+TEST(PreprocessorTest, ExpandsMacros) {
+    EXPECT_EQ(preprocessText("#define N 4\n"
+                             "#define SQUARE(x) ((x) * (x))\n"
+                             "int a = SQUARE(N + 1);\n"),
+              "int a = ( ( 4 + 1 ) * ( 4 + 1 ) ) ;");
+    // Self-reference stops the expansion; arguments are expanded first
+    EXPECT_EQ(preprocessText("#define f(x) x + f\n"
+                             "#define g f(1)\n"
+                             "f(g)"),
+              "1 + f + f");
+    // A function-like macro name without arguments is left alone
+    EXPECT_EQ(preprocessText("#define f(x) x\nint f;"), "int f ;");
+    EXPECT_EQ(preprocessText("#define LOG(fmt, ...) print(fmt, __VA_ARGS__)\n"
+                             "LOG(\"a\", 1, 2)"),
+              "print ( \"a\" , 1 , 2 )");
+    // Lines joined with a backslash form one directive
+    EXPECT_EQ(preprocessText("#define SUM(a, b) \\\n    ((a) + (b))\nSUM(1, 2)"),
+              "( ( 1 ) + ( 2 ) )");
+}
+
+TEST(PreprocessorTest, StringizesAndPastes) {
+    EXPECT_EQ(preprocessText("#define STR(x) #x\nSTR(a + \"b\")"), "\"a + \\\"b\\\"\"");
+    EXPECT_EQ(preprocessText("#define CAT(a, b) a ## b\n"
+                             "#define FIELD(n) CAT(field_, n)\n"
+                             "FIELD(2) CAT(, x) CAT(1, 2u)"),
+              "field_2 x 12u");
+
+    DiagnosticEngine diagnostics;
+    Preprocessor preprocessor(&diagnostics);
+    preprocessor.preprocess("#define CAT(a, b) a ## b\nCAT(+, /)\n#define BAD(x) # y\n");
+    EXPECT_TRUE(hasDiagnostic(diagnostics, DiagID::INVALID_PASTE));
+    EXPECT_TRUE(hasDiagnostic(diagnostics, DiagID::INVALID_STRINGIFY));
+}
+
+TEST(PreprocessorTest, EvaluatesConditionals) {
+    EXPECT_EQ(preprocessText("#define METAL_VERSION 230\n"
+                             "#if defined(METAL_VERSION) && METAL_VERSION >= 200 + 10 * 3\n"
+                             "new\n"
+                             "#elif 1\n"
+                             "middle\n"
+                             "#else\n"
+                             "old\n"
+                             "#endif\n"),
+              "new");
+    // Skipped blocks may hold anything, including unbalanced directives
+    EXPECT_EQ(preprocessText("#ifdef MISSING\n"
+                             "#if garbage ((\n"
+                             "@ $ \\ x\n"
+                             "#endif\n"
+                             "#elif 0 && 1 / 0\n"
+                             "#else\n"
+                             "yes\n"
+                             "#endif\n"
+                             "#ifndef MISSING\n"
+                             "#undef MISSING\n"
+                             "too\n"
+                             "#endif"),
+              "yes too");
+
+    DiagnosticEngine diagnostics;
+    Preprocessor preprocessor(&diagnostics);
+    preprocessor.preprocess("#if 1 / 0\n#endif\n#else\n#if 1 +\n#endif\n#frobnicate\n#if 1\n");
+    EXPECT_TRUE(hasDiagnostic(diagnostics, DiagID::DIVISION_BY_ZERO_IN_CONDITION));
+    EXPECT_TRUE(hasDiagnostic(diagnostics, DiagID::UNMATCHED_CONDITIONAL));
+    EXPECT_TRUE(hasDiagnostic(diagnostics, DiagID::INVALID_CONDITION));
+    EXPECT_TRUE(hasDiagnostic(diagnostics, DiagID::INVALID_DIRECTIVE));
+    EXPECT_TRUE(hasDiagnostic(diagnostics, DiagID::UNTERMINATED_CONDITIONAL));
+}
+
+TEST(PreprocessorTest, LimitsConditionNesting) {
+    // Within the limit
+    std::string nested = "#if " + std::string(100, '(') + "1" + std::string(100, ')') +
+                         " && " + std::string(201, '!') + "0\nyes\n#endif\n";
+    EXPECT_EQ(preprocessText(nested), "yes");
+
+    // Far beyond it, without exhausting the stack
+    const std::string deep[] = {
+        "#if " + std::string(100000, '('),
+        "#if " + std::string(100000, '!') + "1",
+        "#if " + std::string(100000, '~') + "1",
+    };
+    for (const std::string& condition : deep) {
+        DiagnosticEngine diagnostics;
+        Preprocessor preprocessor(&diagnostics);
+        EXPECT_EQ(spell(preprocessor.preprocess(condition + "\nno\n#endif\nafter\n")), "after");
+        ASSERT_EQ(diagnostics.getDiagnostics().size(), 1u);
+        EXPECT_EQ(diagnostics.getDiagnostics()[0].id, DiagID::CONDITION_TOO_DEEP);
+    }
+}
+
+TEST(PreprocessorTest, LimitsMacroExpansion) {
+    // Calls nested in arguments, within the limit
+    std::string nested = "#define F(x, ...) x __VA_ARGS__\n";
+    for (int i = 0; i < 200; i++) {
+        nested += "F(";
+    }
+    nested += "a, b";
+    for (int i = 0; i < 200; i++) {
+        nested += ")";
+    }
+    EXPECT_EQ(preprocessText(nested), "a b");
+
+    std::string deep = "#define F(x) x\n";
+    for (int i = 0; i < 4000; i++) {
+        deep += "F(";
+    }
+    deep += "a";
+    for (int i = 0; i < 4000; i++) {
+        deep += ")";
+    }
+    {
+        DiagnosticEngine diagnostics;
+        Preprocessor preprocessor(&diagnostics);
+        preprocessor.preprocess(deep + "\nF(b)\n");
+        ASSERT_EQ(diagnostics.getDiagnostics().size(), 1u);
+        EXPECT_EQ(diagnostics.getDiagnostics()[0].id, DiagID::MACRO_ARGUMENTS_TOO_DEEP);
+        // The limit is per call
+        EXPECT_EQ(spell(preprocessor.preprocess("F(b)")), "b");
+    }
+
+    // Each level doubles the expansion
+    std::string doubling = "#define M0 x x\n";
+    for (int i = 1; i <= 24; i++) {
+        doubling += "#define M" + std::to_string(i) + " M" + std::to_string(i - 1) + " M" +
+                    std::to_string(i - 1) + "\n";
+    }
+    DiagnosticEngine diagnostics;
+    Preprocessor preprocessor(&diagnostics);
+    size_t size = preprocessor.preprocess(doubling + "M24\n").size();
+    EXPECT_LE(size, Preprocessor::MAX_EXPANDED_TOKENS + 64);
+    ASSERT_EQ(diagnostics.getDiagnostics().size(), 1u);
+    EXPECT_EQ(diagnostics.getDiagnostics()[0].id, DiagID::MACRO_EXPANSION_TOO_LARGE);
+}
+
+TEST(PreprocessorTest, ReportsMacroErrors) {
+    DiagnosticEngine diagnostics;
+    Preprocessor preprocessor(&diagnostics);
+    preprocessor.preprocess("#define F(a, b) a\n"
+                            "F(1)\n"
+                            "#define F(a) a\n"
+                            "#define 3\n"
+                            "#define G(a,) a\n"
+                            "F(1\n");
+    ASSERT_EQ(diagnostics.getDiagnostics().size(), 5u);
+    const Diagnostic& count = diagnostics.getDiagnostics()[0];
+    EXPECT_EQ(count.id, DiagID::MACRO_ARGUMENT_COUNT);
+    EXPECT_EQ(count.args[0], 2u);
+    EXPECT_EQ(count.args[1], 1u);
+    EXPECT_EQ(diagnostics.getDiagnostics()[1].id, DiagID::MACRO_REDEFINED);
+    EXPECT_EQ(diagnostics.getDiagnostics()[2].id, DiagID::EXPECTED_MACRO_NAME);
+    EXPECT_EQ(diagnostics.getDiagnostics()[3].id, DiagID::EXPECTED_MACRO_PARAMETER);
+    EXPECT_EQ(diagnostics.getDiagnostics()[4].id, DiagID::UNTERMINATED_MACRO_CALL);
+
+    DiagnosticPrinter printer("F(1)");
+    EXPECT_EQ(printer.formatMessage(count), "macro takes 2 arguments, but 1 were given");
+}
+
+TEST(PreprocessorTest, IncludesHeadersAndCachesThem) {
+    TempDirectory directory;
+    directory.write("common.h", "#define SCALE 2.0\n"
+                                "struct Light { float3 color; };\n");
+    directory.write("shading/lighting.h", "#include \"../common.h\"\n"
+                                          "float3 shade(Light light) { return light.color * SCALE; }\n");
+
+    HeaderCache cache;
+    const std::string source = "#include <metal_stdlib>\n"
+                               "#include <shading/lighting.h>\n"
+                               "kernel void k() { float s = SCALE; }\n";
+    for (int unit = 0; unit < 2; unit++) {
+        DiagnosticEngine diagnostics;
+        Preprocessor preprocessor(&diagnostics, &cache);
+        preprocessor.addSearchPath(directory.path.string());
+        std::pmr::vector<Token> tokens = preprocessor.preprocess(source, "main.metal");
+        EXPECT_TRUE(diagnostics.getDiagnostics().empty());
+
+        Parser parser(tokens, &diagnostics);
+        auto translationUnit = parser.parse();
+        EXPECT_FALSE(diagnostics.hasErrors());
+        EXPECT_EQ(translationUnit->getDeclarations().size(), 3u);
+
+        // Every token maps back to the file it was read from
+        ASSERT_EQ(preprocessor.getFiles().size(), 3u);
+        const Token& structKeyword = tokens[0];
+        const Preprocessor::SourceFile* file = preprocessor.findFile(structKeyword.offset);
+        ASSERT_NE(file, nullptr);
+        EXPECT_EQ(std::filesystem::path(file->file->path).filename(), "common.h");
+        EXPECT_EQ(file->file->source.compare(structKeyword.offset - file->base, 6, "struct"), 0);
+    }
+    // Both headers were lexed once, for the first translation unit
+    EXPECT_EQ(cache.getLexCount(), 2u);
+    EXPECT_EQ(cache.size(), 2u);
+
+    // A changed header is lexed again
+    directory.write("common.h", "#define SCALE 3.0\nstruct Light { float3 color; float3 dir; };\n");
+    Preprocessor preprocessor(nullptr, &cache);
+    preprocessor.addSearchPath(directory.path.string());
+    EXPECT_NE(spell(preprocessor.preprocess(source)).find("3.0"), std::string::npos);
+    EXPECT_EQ(cache.getLexCount(), 3u);
+}
+
+TEST(PreprocessorTest, ReportsIncludeErrorsInTheirFile) {
+    TempDirectory directory;
+    directory.write("broken.h", "int x = 1;\n#if\n#endif\n");
+    directory.write("recursive.h", "#include \"recursive.h\"\n");
+
+    HeaderCache cache;
+    DiagnosticEngine diagnostics(0);
+    Preprocessor preprocessor(&diagnostics, &cache);
+    preprocessor.addSearchPath(directory.path.string());
+    preprocessor.preprocess("#include \"missing.h\"\n"
+                            "#include \"broken.h\"\n"
+                            "#include <recursive.h>\n"
+                            "#include nothing\n",
+                            "main.metal");
+    EXPECT_TRUE(hasDiagnostic(diagnostics, DiagID::INCLUDE_NOT_FOUND));
+    EXPECT_TRUE(hasDiagnostic(diagnostics, DiagID::INCLUDE_TOO_DEEP));
+    EXPECT_TRUE(hasDiagnostic(diagnostics, DiagID::EXPECTED_INCLUDE_NAME));
+
+    std::ostringstream out;
+    preprocessor.printDiagnostics(out, diagnostics);
+    EXPECT_NE(out.str().find("main.metal:1:10: error: included file not found"),
+              std::string::npos);
+    EXPECT_NE(out.str().find("broken.h:2:4: error: invalid expression in preprocessor condition"),
+              std::string::npos);
+}
+
+TEST(PreprocessorTest, DetectsIncludeGuards) {
+    EXPECT_EQ(LexedFile::lex("a.h", "#ifndef A_H\n#define A_H\n#if X\n#else\n#endif\n#endif\n")
+                  ->includeGuard,
+              "A_H");
+    EXPECT_EQ(LexedFile::lex("b.h", "// comment\n#if !defined(B_H)\n#define B_H\n#endif")
+                  ->includeGuard,
+              "B_H");
+    // Not guards: code outside the block, an #else at its level, or no #ifndef first
+    EXPECT_EQ(LexedFile::lex("c.h", "#ifndef C_H\n#endif\nint c;\n")->includeGuard, "");
+    EXPECT_EQ(LexedFile::lex("d.h", "#ifndef D_H\n#else\n#endif\n")->includeGuard, "");
+    EXPECT_EQ(LexedFile::lex("e.h", "#define E_H\n#ifndef E_H\n#endif\n")->includeGuard, "");
+    EXPECT_EQ(LexedFile::lex("f.h", "#ifndef F_H\n#define F_H\n")->includeGuard, "");
+}
+
+TEST(PreprocessorTest, SkipsGuardedHeaders) {
+    TempDirectory directory;
+    directory.write("guarded.h", "#ifndef GUARDED_H\n#define GUARDED_H\nint guarded;\n#endif\n");
+    directory.write("once.h", "#pragma once\nint once;\n");
+    directory.write("plain.h", "int plain;\n");
+
+    HeaderCache cache;
+    Preprocessor preprocessor(nullptr, &cache);
+    preprocessor.addSearchPath(directory.path.string());
+    const std::string source = "#include \"guarded.h\"\n#include \"once.h\"\n#include \"plain.h\"\n";
+    EXPECT_EQ(spell(preprocessor.preprocess(source + source + source)),
+              "int guarded ; int once ; int plain ; int plain ; int plain ;");
+    EXPECT_EQ(preprocessor.getSkippedIncludes(), 4u);
+    EXPECT_EQ(cache.getLexCount(), 3u);
+
+    // "#pragma once" holds for one translation unit, the guard for as long
+    // as its macro is defined
+    EXPECT_EQ(spell(preprocessor.preprocess(source)), "int once ; int plain ;");
+    preprocessor.undefine("GUARDED_H");
+    EXPECT_EQ(spell(preprocessor.preprocess(source)), "int guarded ; int once ; int plain ;");
+}
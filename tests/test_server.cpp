@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "msl_parser/server.h"
+#include "temp_directory.h"
+
+using namespace msl_parser;
+
+#if defined(__unix__) || defined(__APPLE__)
+
+namespace {
+
+// A server on a socket in a directory of the test's own, serving on a
+// background thread until the end of the test.
+class RunningServer {
+public:
+    explicit RunningServer(ServerOptions options = threeThreads())
+        : socketPath(directory.file("server.sock")) {
+        server = std::make_unique<ParseServer>(options);
+        std::string error;
+        listening = server->listen(socketPath, error);
+        EXPECT_TRUE(listening) << error;
+        thread = std::thread([this]() { server->serve(); });
+    }
+    ~RunningServer() {
+        server->stop();
+        thread.join();
+    }
+
+    static ServerOptions threeThreads() {
+        ServerOptions options;
+        options.threads = 3;
+        return options;
+    }
+
+    TempDirectory directory;
+    const std::string socketPath;
+    std::unique_ptr<ParseServer> server;
+    bool listening = false;
+
+private:
+    std::thread thread;
+};
+
+std::string expected(BatchMode mode, const std::string& path, const std::string& source) {
+    BatchOptions options;
+    options.mode = mode;
+    std::string out;
+    BatchProcessor(options).processSource(path, source, out);
+    return out;
+}
+
+} // namespace
+
+TEST(ServerTest, AnswersPipelinedRequests) {
+    RunningServer running;
+    ParseClient client;
+    std::string error;
+    ASSERT_TRUE(client.connect(running.socketPath, error)) << error;
+
+    const BatchMode modes[] = {BatchMode::TOKENS, BatchMode::AST, BatchMode::REFLECTION};
+    std::vector<ParseRequest> requests;
+    for (int i = 0; i < 12; i++) {
+        ParseRequest request;
+        request.mode = modes[i % 3];
+        request.path = "shader" + std::to_string(i) + ".metal";
+        request.source = i % 4 == 0 ? "float f( { @"
+                                    : "kernel void k" + std::to_string(i) +
+                                          "(device float* a [[buffer(0)]]) { a[0] = 1.0; }";
+        requests.push_back(request);
+        EXPECT_EQ(client.send(request), static_cast<uint32_t>(i + 1));
+    }
+
+    std::vector<bool> seen(requests.size());
+    for (size_t i = 0; i < requests.size(); i++) {
+        ParseResponse response;
+        ASSERT_TRUE(client.receive(response));
+        ASSERT_GE(response.id, 1u);
+        ASSERT_LE(response.id, requests.size());
+        const ParseRequest& request = requests[response.id - 1];
+        EXPECT_FALSE(seen[response.id - 1]);
+        seen[response.id - 1] = true;
+        EXPECT_EQ(response.status, (response.id - 1) % 4 == 0 ? ResponseStatus::ERRORS
+                                                               : ResponseStatus::OK);
+        EXPECT_EQ(response.payload, expected(request.mode, request.path, request.source));
+    }
+
+    ParseRequest missing;
+    missing.flags = protocol::READ_FILE;
+    missing.path = running.directory.file("no_such_shader.metal");
+    ParseResponse response;
+    ASSERT_TRUE(client.request(missing, response));
+    EXPECT_EQ(response.status, ResponseStatus::ERRORS);
+    EXPECT_NE(response.payload.find("cannot read file"), std::string::npos);
+    EXPECT_EQ(running.server->getRequestCount(), 13u);
+}
+
+TEST(ServerTest, RejectsMalformedRequestsAndSecondServers) {
+    RunningServer running;
+    ParseClient client;
+    std::string error;
+    ASSERT_TRUE(client.connect(running.socketPath, error)) << error;
+
+    ParseRequest bad;
+    bad.mode = static_cast<BatchMode>(7);
+    ParseResponse response;
+    ASSERT_TRUE(client.request(bad, response));
+    EXPECT_EQ(response.status, ResponseStatus::BAD_REQUEST);
+
+    // The connection is still usable
+    ParseRequest good;
+    good.source = "float f() { return 1.0; }";
+    ASSERT_TRUE(client.request(good, response));
+    EXPECT_EQ(response.status, ResponseStatus::OK);
+
+    ParseServer second;
+    EXPECT_FALSE(second.listen(running.socketPath, error));
+    EXPECT_NE(error.find("already listening"), std::string::npos);
+}
+
+TEST(ServerTest, DisconnectsClientsThatStopReading) {
+    ServerOptions options;
+    options.threads = 1;
+    options.maxPendingRequests = 2;
+    options.sendTimeout = std::chrono::milliseconds(200);
+    RunningServer running(options);
+    std::string error;
+
+    // Tokens of a large source make responses that fill the socket buffers
+    ParseRequest large;
+    large.mode = BatchMode::TOKENS;
+    for (int i = 0; i < 2000; i++) {
+        large.source += "float a" + std::to_string(i) + " = b * 2.0;\n";
+    }
+    ParseClient stalled;
+    ASSERT_TRUE(stalled.connect(running.socketPath, error)) << error;
+    // Sends, never reading, until the server drops the connection
+    for (int i = 0; i < 1000 && stalled.send(large) != 0; i++) {
+    }
+    EXPECT_FALSE(stalled.isConnected());
+
+    // The only worker is free again
+    ParseClient client;
+    ASSERT_TRUE(client.connect(running.socketPath, error)) << error;
+    ParseRequest good;
+    good.source = "float f() { return 1.0; }";
+    ParseResponse response;
+    ASSERT_TRUE(client.request(good, response));
+    EXPECT_EQ(response.status, ResponseStatus::OK);
+}
+
+#endif
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include "msl_parser/ast/recursive_visitor.h"
+#include "msl_parser/lexer.h"
+#include "msl_parser/parser.h"
+#include "msl_parser/stats.h"
+
+using namespace msl_parser;
+
+TEST(StatsTest, ChromeTrace) {
+    Stats stats;
+    stats.phases.push_back(PhaseRecord{"lex", 1500, 2250, 0});
+    stats.phases.push_back(PhaseRecord{"parse", 4000, 1000, 0});
+    stats.tokensByType[static_cast<size_t>(TokenType::IDENTIFIER)] = 3;
+    stats.nodesByKind[static_cast<size_t>(NodeKind::BinaryExpression)] = 2;
+    stats.bytesProcessed = 42;
+
+    std::ostringstream out;
+    stats.writeChromeTrace(out);
+    std::string trace = out.str();
+
+    EXPECT_EQ(trace.find("{\"traceEvents\":["), 0u);
+    EXPECT_NE(trace.find("\"name\":\"lex\",\"cat\":\"msl_parser\",\"ph\":\"X\",\"pid\":1,"
+                         "\"tid\":1,\"ts\":1.500,\"dur\":2.250"),
+              std::string::npos);
+    EXPECT_NE(trace.find("\"ts\":4.000,\"dur\":1.000"), std::string::npos);
+    EXPECT_NE(trace.find("\"bytes_processed\":42,\"tokens\":3,\"nodes\":2"), std::string::npos);
+    EXPECT_NE(trace.find("\"IDENTIFIER\":3"), std::string::npos);
+    EXPECT_NE(trace.find("\"BinaryExpression\":2"), std::string::npos);
+
+    EXPECT_EQ(stats.phaseNanoseconds("lex"), 2250u);
+    EXPECT_EQ(stats.phaseNanoseconds("read"), 0u);
+    EXPECT_EQ(stats.totalTokens(), 3u);
+    EXPECT_EQ(stats.totalNodes(), 2u);
+
+    stats.reset();
+    EXPECT_TRUE(stats.phases.empty());
+    EXPECT_EQ(stats.totalTokens(), 0u);
+}
+
+TEST(StatsTest, LexAndParse) {
+    class Counter : public ast::RecursiveASTVisitor {
+    public:
+        int nodes = 0;
+
+    protected:
+        void visitNode(ast::ASTNode*) override { nodes++; }
+        const char* passName() const override { return "count_nodes"; }
+    };
+
+    const std::string source = "float f(float x) { return x * 2.0 + 1.0; }\n";
+    Stats& stats = threadStats();
+    stats.reset();
+    {
+        ScopedPhase phase("compile");
+        Lexer lexer(source);
+        std::pmr::vector<Token> tokens = lexer.scanTokens();
+        Parser parser(tokens);
+        auto unit = parser.parse();
+        ASSERT_FALSE(parser.hadError());
+        Counter counter;
+        counter.traverse(unit.get());
+        EXPECT_GT(counter.nodes, 0);
+    }
+
+    if (!statsEnabled()) {
+        // Only caller-defined phases are recorded
+        ASSERT_EQ(stats.phases.size(), 1u);
+        EXPECT_STREQ(stats.phases[0].name, "compile");
+        EXPECT_EQ(stats.totalTokens(), 0u);
+        EXPECT_EQ(stats.totalNodes(), 0u);
+        EXPECT_EQ(stats.bytesProcessed, 0u);
+        return;
+    }
+
+    // Phases are recorded as they finish, nested ones first
+    ASSERT_EQ(stats.phases.size(), 4u);
+    EXPECT_STREQ(stats.phases[0].name, "lex");
+    EXPECT_STREQ(stats.phases[1].name, "parse");
+    EXPECT_STREQ(stats.phases[2].name, "count_nodes");
+    EXPECT_STREQ(stats.phases[3].name, "compile");
+    EXPECT_EQ(stats.phases[0].depth, 1u);
+    EXPECT_EQ(stats.phases[3].depth, 0u);
+    EXPECT_LE(stats.phases[3].startNanoseconds, stats.phases[0].startNanoseconds);
+
+    EXPECT_EQ(stats.bytesProcessed, source.size());
+    EXPECT_EQ(stats.tokenCount(TokenType::FLOAT), 2u);
+    EXPECT_EQ(stats.tokenCount(TokenType::FLOAT_LITERAL), 2u);
+    EXPECT_EQ(stats.tokenCount(TokenType::END_OF_FILE), 1u);
+    EXPECT_EQ(stats.totalTokens(), stats.peakTokenCount);
+    EXPECT_GE(stats.peakTokenBytes, stats.peakTokenCount * sizeof(Token));
+
+    EXPECT_EQ(stats.nodeCount(NodeKind::BinaryExpression), 2u);
+    EXPECT_EQ(stats.nodeCount(NodeKind::FloatLiteral), 2u);
+    EXPECT_EQ(stats.nodeCount(NodeKind::TranslationUnit), 1u);
+    EXPECT_GT(stats.arenaBytes, 0u);
+}
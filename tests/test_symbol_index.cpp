@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "msl_parser/symbol_index.h"
+#include "temp_directory.h"
+
+using namespace msl_parser;
+
+namespace {
+
+// A small corpus.
+class Corpus : public TempDirectory {
+public:
+    Corpus() {
+        write("common.h", "#pragma once\n"
+                          "#define MAX_LIGHTS 8\n"
+                          "struct Light { float3 color; float intensity; };\n"
+                          "float3 tint(Light light);\n");
+        write("lighting.metal", "#include \"common.h\"\n"
+                                "float3 tint(Light light) { return light.color; }\n"
+                                "constant float gamma = 2.2;\n");
+        write("blur.metal",
+              "#include \"common.h\"\n"
+              "kernel void blur(device float* input [[buffer(0)]],\n"
+              "                 device Light* lights [[buffer(3)]],\n"
+              "                 texture2d<float> image [[texture(1)]],\n"
+              "                 uint id [[thread_position_in_grid]]) {\n"
+              "    float3 c = tint(lights[id]) * MAX_LIGHTS;\n"
+              "    input[id] = c.x + tint(lights[0]).y;\n"
+              "}\n");
+        write("shade.metal", "#include \"common.h\"\n"
+                             "fragment float4 shade(constant Light& light [[buffer(3)]]) {\n"
+                             "    return float4(tint(light), 1.0);\n"
+                             "}\n");
+    }
+
+    std::vector<std::string> files() const {
+        return {file("common.h"), file("lighting.metal"), file("blur.metal"),
+                file("shade.metal"), file("missing.metal")};
+    }
+};
+
+std::vector<std::string> locations(const std::vector<SymbolEntry>& entries) {
+    std::vector<std::string> result;
+    for (const SymbolEntry& entry : entries) {
+        std::string file = std::filesystem::path(entry.file).filename().string();
+        result.push_back(file + ":" + std::to_string(entry.line) + ":" +
+                         std::to_string(entry.column));
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(SymbolIndexTest, AnswersDefinitionReferenceAndBindingQueries) {
+    Corpus corpus;
+    std::string indexPath = corpus.file("index.bin");
+    std::string error;
+    SymbolIndexOptions options;
+    options.jobs = 3;
+    SymbolIndex::BuildStats stats;
+    ASSERT_TRUE(SymbolIndex::build(corpus.files(), indexPath, options, error, nullptr, &stats))
+        << error;
+    EXPECT_EQ(stats.indexed, 4u);
+    EXPECT_EQ(stats.unreadable, 1u);
+
+    auto index = SymbolIndex::open(indexPath);
+    ASSERT_TRUE(index);
+    EXPECT_EQ(index->getFileCount(), 4u);
+
+    // The prototype in the header and the definition, each at the name
+    std::vector<SymbolEntry> tint = index->findDefinitions("tint");
+    ASSERT_EQ(tint.size(), 2u);
+    EXPECT_EQ(tint[0].role, SymbolRole::DEFINITION);
+    EXPECT_EQ(locations({tint[0]}), std::vector<std::string>{"lighting.metal:2:8"});
+    EXPECT_EQ(tint[1].role, SymbolRole::DECLARATION);
+    EXPECT_EQ(locations(index->findDefinitions("Light")),
+              std::vector<std::string>{"common.h:3:8"});
+    EXPECT_EQ(locations(index->findDefinitions("MAX_LIGHTS")),
+              std::vector<std::string>{"common.h:2:9"});
+    EXPECT_EQ(index->findDefinitions("MAX_LIGHTS")[0].kind, SymbolKind::MACRO);
+    EXPECT_EQ(index->findDefinitions("gamma")[0].kind, SymbolKind::VARIABLE);
+    EXPECT_TRUE(index->findDefinitions("nothing").empty());
+
+    // Uses of tint, one entry per file, not counting its definitions
+    std::vector<SymbolEntry> uses = index->findReferences("tint");
+    EXPECT_EQ(locations(uses), (std::vector<std::string>{"blur.metal:6:16", "shade.metal:3:19"}));
+    EXPECT_EQ(uses[0].value, 2u);
+    EXPECT_EQ(locations(index->findReferences("MAX_LIGHTS")),
+              std::vector<std::string>{"blur.metal:6:35"});
+
+    std::vector<SymbolEntry> slot3 = index->findBindings(SymbolKind::BUFFER, 3);
+    ASSERT_EQ(slot3.size(), 2u);
+    EXPECT_EQ(slot3[0].name, "lights");
+    EXPECT_EQ(slot3[0].context, "blur");
+    EXPECT_EQ(slot3[1].name, "light");
+    EXPECT_EQ(slot3[1].context, "shade");
+    EXPECT_EQ(locations(index->findBindings(SymbolKind::TEXTURE, 1)),
+              std::vector<std::string>{"blur.metal:4:35"});
+    EXPECT_TRUE(index->findBindings(SymbolKind::BUFFER, 1).empty());
+    EXPECT_TRUE(index->findBindings(SymbolKind::SAMPLER, 3).empty());
+}
+
+TEST(SymbolIndexTest, UpdatesOnlyChangedFiles) {
+    Corpus corpus;
+    std::string indexPath = corpus.file("index.bin");
+    std::string error;
+    ASSERT_TRUE(SymbolIndex::build(corpus.files(), indexPath, {}, error)) << error;
+    auto previous = SymbolIndex::open(indexPath);
+    ASSERT_TRUE(previous);
+
+    corpus.write("shade.metal", "fragment float4 shade2(constant float4& c [[buffer(7)]]) {\n"
+                                "    return c;\n"
+                                "}\n");
+    SymbolIndex::BuildStats stats;
+    ASSERT_TRUE(SymbolIndex::build(corpus.files(), indexPath, {}, error, previous.get(), &stats))
+        << error;
+    EXPECT_EQ(stats.indexed, 1u);
+    EXPECT_EQ(stats.reused, 3u);
+
+    auto index = SymbolIndex::open(indexPath);
+    ASSERT_TRUE(index);
+    EXPECT_TRUE(index->findDefinitions("shade").empty());
+    EXPECT_EQ(index->findDefinitions("shade2").size(), 1u);
+    EXPECT_EQ(index->findBindings(SymbolKind::BUFFER, 3).size(), 1u);
+    EXPECT_EQ(index->findBindings(SymbolKind::BUFFER, 7).size(), 1u);
+    // Entries of reused files are carried over unchanged
+    for (size_t file = 0; file < 3; file++) {
+        EXPECT_EQ(locations(index->getFileEntries(file)),
+                  locations(previous->getFileEntries(file)));
+    }
+
+    // Anything that is not an index of this version is rejected
+    corpus.write("bad.bin", "MSLSYMIX but not really an index");
+    EXPECT_FALSE(SymbolIndex::open(corpus.file("bad.bin")));
+    EXPECT_FALSE(SymbolIndex::open(corpus.file("missing.bin")));
+}
@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "msl_parser/ast/recursive_visitor.h"
+#include "msl_parser/lexer.h"
+#include "msl_parser/parser.h"
+#include "msl_parser/symbol_table.h"
+
+using namespace msl_parser;
+
+namespace {
+
+std::unique_ptr<ast::TranslationUnit> parse(const std::string& source) {
+    Lexer lexer(source);
+    auto tokens = lexer.scanTokens();
+    Parser parser(tokens);
+    return parser.parse();
+}
+
+// The identifiers and member accesses of a tree, in source order.
+class ReferenceCollector : public ast::RecursiveASTVisitor {
+public:
+    std::vector<ast::Identifier*> identifiers;
+    std::vector<ast::MemberExpression*> members;
+
+    void visitIdentifier(ast::Identifier* node) override { identifiers.push_back(node); }
+    void visitMemberExpression(ast::MemberExpression* node) override {
+        members.push_back(node);
+        RecursiveASTVisitor::visitMemberExpression(node);
+    }
+};
+
+} // namespace
+
+TEST(SymbolTableTest, InternsNames) {
+    NameTable names;
+    uint32_t position = names.intern("position");
+    EXPECT_EQ(names.intern("uv"), position + 1);
+    EXPECT_EQ(names.intern(std::string("position")), position);
+    EXPECT_EQ(names.find("uv"), position + 1);
+    EXPECT_EQ(names.find("normal"), NameTable::NO_NAME);
+    EXPECT_EQ(names.getName(position), "position");
+
+    // Growing the table keeps every ID
+    for (int i = 0; i < 1000; i++) {
+        names.intern("name" + std::to_string(i));
+    }
+    EXPECT_EQ(names.size(), 1002u);
+    EXPECT_EQ(names.find("name500"), position + 502);
+    EXPECT_EQ(names.getName(position + 1), "uv");
+}
+
+TEST(SymbolTableTest, RestoresShadowedBindingsOnPop) {
+    auto unit = parse("float a; float b; float c;");
+    const auto& declarations = unit->getDeclarations();
+    ast::Declaration* outer = declarations[0].get();
+    ast::Declaration* inner = declarations[1].get();
+    ast::Declaration* innermost = declarations[2].get();
+
+    SymbolTable symbols;
+    symbols.declare("x", outer);
+    symbols.pushScope();
+    symbols.declare("x", inner);
+    symbols.declare("y", inner);
+    symbols.pushScope();
+    symbols.declare("x", innermost);
+    EXPECT_EQ(symbols.getDepth(), 2u);
+    EXPECT_EQ(symbols.lookup("x"), innermost);
+    symbols.popScope();
+    EXPECT_EQ(symbols.lookup("x"), inner);
+    EXPECT_EQ(symbols.lookup("y"), inner);
+    symbols.popScope();
+    EXPECT_EQ(symbols.lookup("x"), outer);
+    EXPECT_EQ(symbols.lookup("y"), nullptr);
+    EXPECT_EQ(symbols.lookup("z"), nullptr);
+    EXPECT_EQ(symbols.getDepth(), 0u);
+}
+
+TEST(SymbolTableTest, ResolvesIdentifiers) {
+    auto unit = parse("constant float scale = 2.0;\n"
+                      "float twice(float x) { return x * scale; }\n"
+                      "kernel void k(device float* data, uint id) {\n"
+                      "    float x = twice(data[id]);\n"
+                      "    {\n"
+                      "        float x = 1.0;\n"
+                      "        data[id] = x;\n"
+                      "    }\n"
+                      "    for (int i = 0; i < 4; i++) { x += i; }\n"
+                      "    data[id] = max(x, scale);\n"
+                      "}\n");
+    const auto& declarations = unit->getDeclarations();
+    auto* scale = declarations[0].get();
+    auto* twice = static_cast<ast::FunctionDeclaration*>(declarations[1].get());
+    auto* kernel = static_cast<ast::FunctionDeclaration*>(declarations[2].get());
+
+    NameResolver resolver;
+    resolver.resolve(unit.get());
+    ReferenceCollector references;
+    references.traverse(unit.get());
+
+    std::vector<std::string> names;
+    for (ast::Identifier* identifier : references.identifiers) {
+        names.emplace_back(identifier->getName());
+    }
+    ASSERT_EQ(names, (std::vector<std::string>{"x", "scale", "twice", "data", "id", "data",
+                                               "id", "x", "i", "i", "x", "i", "data", "id", "max",
+                                               "x", "scale"}));
+    const auto& ids = references.identifiers;
+    EXPECT_EQ(ids[0]->getDeclaration(), twice->getParameters()[0].get());
+    EXPECT_EQ(ids[1]->getDeclaration(), scale);
+    EXPECT_EQ(ids[2]->getDeclaration(), twice);
+    EXPECT_EQ(ids[3]->getDeclaration(), kernel->getParameters()[0].get());
+    EXPECT_EQ(ids[4]->getDeclaration(), kernel->getParameters()[1].get());
+
+    auto* body = kernel->getBody();
+    auto* local = static_cast<ast::DeclarationStatement*>(body->getStatements()[0].get())
+                      ->getDeclarations()[0]
+                      .get();
+    auto* block = static_cast<ast::CompoundStatement*>(body->getStatements()[1].get());
+    auto* shadow = static_cast<ast::DeclarationStatement*>(block->getStatements()[0].get())
+                       ->getDeclarations()[0]
+                       .get();
+    EXPECT_EQ(ids[7]->getDeclaration(), shadow);    // inner block
+    EXPECT_EQ(ids[10]->getDeclaration(), local);    // loop body
+    ASSERT_NE(ids[8]->getDeclaration(), nullptr);   // loop variable
+    EXPECT_EQ(ids[8]->getDeclaration(), ids[11]->getDeclaration());
+    EXPECT_EQ(ids[14]->getDeclaration(), nullptr);  // built-in max
+    EXPECT_EQ(ids[15]->getDeclaration(), local);    // after the block
+    EXPECT_EQ(ids[16]->getDeclaration(), scale);
+
+    EXPECT_EQ(resolver.getUnresolvedCount(), 1u);
+    EXPECT_EQ(resolver.getResolvedCount(), 16u);
+    EXPECT_EQ(resolver.getSymbols().lookup("twice"), twice);
+    EXPECT_EQ(resolver.getSymbols().lookup("id"), nullptr);  // out of scope again
+}
+
+TEST(SymbolTableTest, ResolvesStructFields) {
+    auto unit = parse("struct Light { float3 color; float intensity; };\n"
+                      "struct Scene { Light key; };\n"
+                      "float f(constant Light* lights, Scene scene, float4 v) {\n"
+                      "    return lights[0].intensity + lights->intensity\n"
+                      "        + scene.key.color.x + v.x;\n"
+                      "}\n");
+    const auto& declarations = unit->getDeclarations();
+    auto* light = static_cast<ast::StructDeclaration*>(declarations[0].get());
+    auto* scene = static_cast<ast::StructDeclaration*>(declarations[1].get());
+
+    NameResolver resolver;
+    resolver.resolve(unit.get());
+    ReferenceCollector references;
+    references.traverse(unit.get());
+
+    std::vector<std::string> members;
+    for (ast::MemberExpression* member : references.members) {
+        members.emplace_back(member->getMember());
+    }
+    ASSERT_EQ(members, (std::vector<std::string>{"intensity", "intensity", "x", "color", "key",
+                                                 "x"}));
+    const auto& accesses = references.members;
+    EXPECT_EQ(accesses[0]->getField(), light->getFields()[1].get());
+    EXPECT_EQ(accesses[1]->getField(), light->getFields()[1].get());
+    EXPECT_EQ(accesses[2]->getField(), nullptr);  // swizzle of float3
+    EXPECT_EQ(accesses[3]->getField(), light->getFields()[0].get());
+    EXPECT_EQ(accesses[4]->getField(), scene->getFields()[0].get());
+    EXPECT_EQ(accesses[5]->getField(), nullptr);
+}
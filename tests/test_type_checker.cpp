@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "msl_parser/lexer.h"
+#include "msl_parser/parser.h"
+#include "msl_parser/type_checker.h"
+
+using namespace msl_parser;
+
+namespace {
+
+const char* kPrelude = "struct Light { float3 color; float intensity; };\n";
+
+struct Checked {
+    std::unique_ptr<ast::TranslationUnit> unit;
+    DiagnosticEngine diagnostics;
+    TypeChecker checker{&diagnostics};
+};
+
+std::unique_ptr<Checked> check(const std::string& source) {
+    auto checked = std::make_unique<Checked>();
+    Lexer lexer(source);
+    auto tokens = lexer.scanTokens();
+    Parser parser(tokens, &checked->diagnostics);
+    checked->unit = parser.parse();
+    EXPECT_FALSE(checked->diagnostics.hasErrors()) << source;
+    checked->checker.check(checked->unit.get());
+    return checked;
+}
+
+std::vector<DiagID> diagnosticIds(const std::string& body) {
+    auto checked = check(std::string(kPrelude) + "void f(float4 v, float3x3 m, float s, int i, "
+                                                 "constant Light* lights) {\n" + body + "\n}\n");
+    std::vector<DiagID> ids;
+    for (const Diagnostic& diagnostic : checked->diagnostics.getDiagnostics()) {
+        ids.push_back(diagnostic.id);
+    }
+    return ids;
+}
+
+// The type of `expression` evaluated in a function with some parameters.
+// It is parenthesized so that `a * b` is not taken for a declaration.
+std::string typeOf(const std::string& expression) {
+    auto checked = check(std::string(kPrelude) +
+                         "void f(float4 v, float3 u, int4 n, float3x3 m, float2x4 r, float s, "
+                         "int i, uint k, half h, bool b, constant Light* lights, "
+                         "Light light, device float* p, texture2d<float> t) {\n" +
+                         "(" + expression + ");\n}\n");
+    EXPECT_TRUE(checked->diagnostics.getDiagnostics().empty()) << expression;
+    const auto& declarations = checked->unit->getDeclarations();
+    auto* function = static_cast<ast::FunctionDeclaration*>(declarations.back().get());
+    auto* statement =
+        static_cast<ast::ExpressionStatement*>(function->getBody()->getStatements()[0].get());
+    return checked->checker.getTypes().getName(statement->getExpression()->getTypeId());
+}
+
+} // namespace
+
+TEST(TypeCheckerTest, InternsTypes) {
+    TypeTable types;
+    EXPECT_EQ(TypeTable::findBuiltin("float4"), TypeTable::vector(ScalarType::FLOAT, 4));
+    EXPECT_EQ(TypeTable::findBuiltin("metal::packed_half3"), TypeTable::vector(ScalarType::HALF, 3));
+    EXPECT_EQ(TypeTable::findBuiltin("float2x3"), TypeTable::matrix(ScalarType::FLOAT, 2, 3));
+    EXPECT_EQ(TypeTable::findBuiltin("uint32_t"), TypeTable::scalar(ScalarType::UINT));
+    EXPECT_EQ(TypeTable::findBuiltin("int2x2"), TypeTable::UNKNOWN);
+    EXPECT_EQ(TypeTable::findBuiltin("float5"), TypeTable::UNKNOWN);
+    EXPECT_EQ(types.getName(TypeTable::matrix(ScalarType::HALF, 4, 2)), "half4x2");
+
+    TypeId pointer = types.pointer(TypeTable::scalar(ScalarType::FLOAT), ast::AddressSpace::DEVICE);
+    EXPECT_EQ(types.pointer(TypeTable::scalar(ScalarType::FLOAT), ast::AddressSpace::DEVICE),
+              pointer);
+    EXPECT_NE(types.pointer(TypeTable::scalar(ScalarType::FLOAT), ast::AddressSpace::CONSTANT),
+              pointer);
+    EXPECT_EQ(types.getName(pointer), "device float*");
+    EXPECT_EQ(types.opaque("sampler"), types.opaque("sampler"));
+    EXPECT_EQ(types.size(), TypeTable::NUM_BUILTIN_TYPES + 3u);
+}
+
+TEST(TypeCheckerTest, TypesExpressions) {
+    EXPECT_EQ(typeOf("v + s"), "float4");
+    EXPECT_EQ(typeOf("i * 2"), "int");
+    EXPECT_EQ(typeOf("i + k"), "uint");
+    EXPECT_EQ(typeOf("h * i"), "half");
+    EXPECT_EQ(typeOf("h * s"), "float");
+    EXPECT_EQ(typeOf("v < 1.0"), "bool4");
+    EXPECT_EQ(typeOf("s < 1.0 && b"), "bool");
+    EXPECT_EQ(typeOf("!n"), "bool4");
+    EXPECT_EQ(typeOf("n << 1"), "int4");
+    EXPECT_EQ(typeOf("b ? u : 0.0"), "float3");
+    EXPECT_EQ(typeOf("v = 1.0"), "float4");
+
+    // Swizzles
+    EXPECT_EQ(typeOf("v.xy"), "float2");
+    EXPECT_EQ(typeOf("v.bgra"), "float4");
+    EXPECT_EQ(typeOf("u.z"), "float");
+    EXPECT_EQ(typeOf("v.xxxx.w"), "float");
+
+    // Matrices: columns x rows, with the linear-algebra product
+    EXPECT_EQ(typeOf("m * u"), "float3");
+    EXPECT_EQ(typeOf("u * m"), "float3");
+    EXPECT_EQ(typeOf("r * v.xy"), "float4");
+    EXPECT_EQ(typeOf("v * r"), "float2");
+    EXPECT_EQ(typeOf("m * m"), "float3x3");
+    EXPECT_EQ(typeOf("m * 2.0"), "float3x3");
+    EXPECT_EQ(typeOf("m[1]"), "float3");
+    EXPECT_EQ(typeOf("transpose(r)"), "float4x2");
+
+    // Constructors, built-ins, fields, pointers
+    EXPECT_EQ(typeOf("float4(u, 1.0)"), "float4");
+    EXPECT_EQ(typeOf("half2(h)"), "half2");
+    EXPECT_EQ(typeOf("float3x3(u, u, u)"), "float3x3");
+    EXPECT_EQ(typeOf("dot(u, u)"), "float");
+    EXPECT_EQ(typeOf("normalize(u)"), "float3");
+    EXPECT_EQ(typeOf("clamp(s, 0.0, 1.0)"), "float");
+    EXPECT_EQ(typeOf("mix(0.0, v, s)"), "float4");
+    EXPECT_EQ(typeOf("lights[i].color.rg"), "float2");
+    EXPECT_EQ(typeOf("lights->intensity"), "float");
+    EXPECT_EQ(typeOf("light.color * s"), "float3");
+    EXPECT_EQ(typeOf("*p"), "float");
+    EXPECT_EQ(typeOf("p + 1"), "device float*");
+    EXPECT_EQ(typeOf("&s"), "float*");
+    EXPECT_EQ(typeOf("(int)s"), "int");
+    EXPECT_EQ(typeOf("t.sample(s, u.xy)"), "<unknown>");
+    EXPECT_EQ(typeOf("t.sample(s, u.xy).x + 1.0"), "<unknown>");
+}
+
+TEST(TypeCheckerTest, TypesFunctionCalls) {
+    auto checked = check("float3 tint(float3 c, float k) { return c * k; }\n"
+                         "float tint(float c) { return c; }\n"
+                         "float scale(float x);\n"
+                         "float scale(float x) { return x * 2.0; }\n"
+                         "void f(float3 c) {\n"
+                         "    tint(c, 1.0);\n"
+                         "    tint(1.0);\n"
+                         "    scale(c.x);\n"
+                         "    scale(1.0, 2.0);\n"
+                         "    scale(c);\n"
+                         "}\n");
+    const auto& declarations = checked->unit->getDeclarations();
+    auto* f = static_cast<ast::FunctionDeclaration*>(declarations.back().get());
+    const auto& statements = f->getBody()->getStatements();
+    auto typeAt = [&](size_t index) {
+        auto* statement = static_cast<ast::ExpressionStatement*>(statements[index].get());
+        return checked->checker.getTypes().getName(statement->getExpression()->getTypeId());
+    };
+    EXPECT_EQ(typeAt(0), "float3");
+    EXPECT_EQ(typeAt(1), "float");
+    EXPECT_EQ(typeAt(2), "float");
+    const auto& diagnostics = checked->diagnostics.getDiagnostics();
+    ASSERT_EQ(diagnostics.size(), 2u);
+    EXPECT_EQ(diagnostics[0].id, DiagID::FUNCTION_ARGUMENT_COUNT);
+    EXPECT_EQ(diagnostics[0].args[0], 1u);
+    EXPECT_EQ(diagnostics[0].args[1], 2u);
+    EXPECT_EQ(diagnostics[1].id, DiagID::INCOMPATIBLE_TYPES);
+}
+
+TEST(TypeCheckerTest, ReportsTypeErrors) {
+    using IDs = std::vector<DiagID>;
+    EXPECT_EQ(diagnosticIds("float3 a = v;"), IDs{DiagID::INCOMPATIBLE_TYPES});
+    EXPECT_EQ(diagnosticIds("float4 a = s; int b = s; float2 c = v.xy;"), IDs{});
+    EXPECT_EQ(diagnosticIds("v + v.xyz;"), IDs{DiagID::INVALID_OPERANDS});
+    EXPECT_EQ(diagnosticIds("(m * v);"), IDs{DiagID::INVALID_OPERANDS});
+    EXPECT_EQ(diagnosticIds("s % 2.0;"), IDs{DiagID::INVALID_OPERANDS});
+    EXPECT_EQ(diagnosticIds("v & 1;"), IDs{DiagID::INVALID_OPERANDS});
+    EXPECT_EQ(diagnosticIds("~s;"), IDs{DiagID::INVALID_UNARY_OPERAND});
+    EXPECT_EQ(diagnosticIds("v.xq;"), IDs{DiagID::INVALID_SWIZZLE});
+    EXPECT_EQ(diagnosticIds("v.xyzwx;"), IDs{DiagID::INVALID_SWIZZLE});
+    EXPECT_EQ(diagnosticIds("v.xg;"), IDs{DiagID::INVALID_SWIZZLE});
+    EXPECT_EQ(diagnosticIds("v.xyz.w;"), IDs{DiagID::INVALID_SWIZZLE});
+    EXPECT_EQ(diagnosticIds("lights->radius;"), IDs{DiagID::NO_SUCH_FIELD});
+    EXPECT_EQ(diagnosticIds("s.x;"), IDs{DiagID::INVALID_MEMBER_BASE});
+    EXPECT_EQ(diagnosticIds("s[0];"), IDs{DiagID::NOT_SUBSCRIPTABLE});
+    EXPECT_EQ(diagnosticIds("if (v) {}"), IDs{DiagID::INVALID_CONDITION_TYPE});
+    EXPECT_EQ(diagnosticIds("return s;"), IDs{DiagID::RETURN_VALUE_IN_VOID_FUNCTION});
+    // Errors do not cascade through the expressions around them
+    EXPECT_EQ(diagnosticIds("float a = (v + u) * s;"), IDs{});  // u is undeclared here
+    EXPECT_EQ(diagnosticIds("float a = (v + v.xyz).x * 2.0;"), IDs{DiagID::INVALID_OPERANDS});
+
+    auto checked = check("float4 f(float s) { float4(s, s); return float4(1.0, 2.0, 3.0); }\n"
+                         "float g() { return; }\n");
+    const auto& diagnostics = checked->diagnostics.getDiagnostics();
+    ASSERT_EQ(diagnostics.size(), 3u);
+    EXPECT_EQ(diagnostics[0].id, DiagID::CONSTRUCTOR_COMPONENTS);
+    EXPECT_EQ(diagnostics[0].args[0], 4u);
+    EXPECT_EQ(diagnostics[0].args[1], 2u);
+    EXPECT_EQ(diagnostics[1].id, DiagID::CONSTRUCTOR_COMPONENTS);
+    EXPECT_EQ(diagnostics[2].id, DiagID::MISSING_RETURN_VALUE);
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "msl_parser/watcher.h"
+#include "temp_directory.h"
+
+using namespace msl_parser;
+
+namespace {
+
+// A shader tree.
+class Tree : public TempDirectory {
+public:
+    Tree() {
+        write("include/common.h", "struct Light { float3 color; };\n");
+        write("shaders/lit.metal", "#include \"common.h\"\n"
+                                   "fragment float4 lit(constant Light& light [[buffer(0)]]) {\n"
+                                   "    return float4(light.color, 1.0);\n"
+                                   "}\n");
+        write("shaders/flat.metal", "fragment float4 flat() { return float4(1.0); }\n");
+    }
+};
+
+WatchOptions watchOptions(const Tree& tree) {
+    WatchOptions options;
+    options.batch.mode = BatchMode::REFLECTION;
+    options.batch.jobs = 2;
+    options.batch.searchPaths.push_back(tree.file("include"));
+    return options;
+}
+
+size_t countLines(const std::string& text) {
+    return static_cast<size_t>(std::count(text.begin(), text.end(), '\n'));
+}
+
+} // namespace
+
+TEST(WatcherTest, ReprocessesOnlyAffectedShaders) {
+    Tree tree;
+    ShaderWatcher watcher(watchOptions(tree));
+    std::string out;
+    std::string error;
+    ASSERT_TRUE(watcher.start({tree.file("shaders")}, out, error)) << error;
+    EXPECT_EQ(countLines(out), 2u);
+    EXPECT_EQ(watcher.getFileCount(), 2u);
+
+    // Only the shader including the header
+    tree.write("include/common.h", "struct Light { float3 color; float intensity; };\n");
+    out.clear();
+    EXPECT_EQ(watcher.update({tree.file("include/common.h")}, out), 1u);
+    EXPECT_NE(out.find("lit.metal"), std::string::npos) << out;
+    EXPECT_NE(out.find("\"intensity\""), std::string::npos) << out;
+    EXPECT_EQ(out.find("flat.metal"), std::string::npos) << out;
+
+    // A changed shader alone
+    tree.write("shaders/flat.metal", "fragment half4 flat() { return half4(1.0); }\n");
+    out.clear();
+    EXPECT_EQ(watcher.update({tree.file("shaders/flat.metal")}, out), 1u);
+    EXPECT_NE(out.find("half4"), std::string::npos) << out;
+
+    // New and deleted shaders
+    tree.write("shaders/late.metal", "#include \"late.h\"\n"
+                                     "kernel void late(device float* data [[buffer(0)]]) {}\n");
+    std::filesystem::remove(tree.path / "shaders/flat.metal");
+    out.clear();
+    EXPECT_EQ(watcher.update({tree.file("shaders/late.metal"), tree.file("shaders/flat.metal")},
+                             out),
+              2u);
+    EXPECT_NE(out.find("\"removed\":true"), std::string::npos) << out;
+    EXPECT_NE(out.find("\"ok\":false"), std::string::npos) << out;
+    EXPECT_EQ(watcher.getFileCount(), 2u);
+
+    // A missing include appearing reprocesses the shaders with errors
+    tree.write("include/late.h", "#define UNUSED 1\n");
+    out.clear();
+    EXPECT_EQ(watcher.update({tree.file("include/late.h")}, out), 1u);
+    EXPECT_NE(out.find("late.metal"), std::string::npos) << out;
+    EXPECT_NE(out.find("\"ok\":true"), std::string::npos) << out;
+}
+
+#if defined(__linux__)
+TEST(WatcherTest, ReactsToFileSystemEvents) {
+    Tree tree;
+    ShaderWatcher watcher(watchOptions(tree));
+    std::string out;
+    std::string error;
+    ASSERT_TRUE(watcher.start({tree.file("shaders")}, out, error)) << error;
+    ASSERT_TRUE(watcher.isWatching());
+
+    // Saved through a temporary file, as many editors do
+    tree.write("include/common.tmp", "struct Light { float3 color; float range; };\n");
+    std::filesystem::rename(tree.path / "include/common.tmp", tree.path / "include/common.h");
+    out.clear();
+    for (int attempt = 0; attempt < 50 && out.empty(); attempt++) {
+        ASSERT_TRUE(watcher.wait(std::chrono::milliseconds(100), out));
+    }
+    EXPECT_EQ(countLines(out), 1u) << out;
+    EXPECT_NE(out.find("\"range\""), std::string::npos) << out;
+
+    // New directories are watched too
+    std::filesystem::create_directories(tree.path / "shaders/post");
+    tree.write("shaders/post/blur.metal", "kernel void blur() {}\n");
+    out.clear();
+    for (int attempt = 0; attempt < 50 && out.find("blur") == std::string::npos; attempt++) {
+        ASSERT_TRUE(watcher.wait(std::chrono::milliseconds(100), out));
+    }
+    EXPECT_NE(out.find("blur.metal"), std::string::npos) << out;
+    EXPECT_EQ(watcher.getFileCount(), 3u);
+
+    watcher.stop();
+    EXPECT_FALSE(watcher.wait(std::chrono::milliseconds(1000), out));
+}
+#endif
@@ -0,0 +1,179 @@
+// Prints the headers each Metal file includes, for build systems (see
+// dependency_scanner.h).
+//
+// Usage: msl-deps [--format=make|json] [--cache=FILE] [--jobs=N] [-I DIR]
+//                 [-D NAME[=VALUE]] INPUT...
+//
+// Inputs are files, directories (every .metal file below them) and @FILE
+// response files. The make format prints one rule per input,
+// "INPUT.air: INPUT HEADER...", with the input's extension replaced; the
+// json format prints one object per line with "file", "dependencies" and,
+// when an include could not be resolved, "errors". With --cache, minimized
+// files are kept in FILE, so headers unchanged since the last run are not
+// read again.
+//
+// Exits with 0 on success, 1 when an input could not be read or has
+// preprocessor errors and 2 for invalid arguments.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "msl_parser/batch.h"
+#include "msl_parser/dependency_scanner.h"
+#include "msl_parser/json.h"
+
+using namespace msl_parser;
+
+namespace {
+
+struct Options {
+    DependencyScanOptions scan;
+    bool json = false;
+    std::vector<std::string> inputs;
+};
+
+void printUsage(const char* program) {
+    std::fprintf(stderr,
+                 "usage: %s [--format=make|json] [--cache=FILE] [--jobs=N] [-I DIR] "
+                 "[-D NAME[=VALUE]] INPUT...\n",
+                 program);
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        // The value of "-I DIR" or "-IDIR"; null when missing
+        auto value = [&](const char* flag) -> const char* {
+            size_t length = std::strlen(flag);
+            if (arg[length] != '\0') {
+                return arg + length;
+            }
+            return i + 1 < argc ? argv[++i] : nullptr;
+        };
+
+        if (std::strcmp(arg, "--format=make") == 0) {
+            options.json = false;
+        } else if (std::strcmp(arg, "--format=json") == 0) {
+            options.json = true;
+        } else if (std::strncmp(arg, "--cache=", 8) == 0) {
+            options.scan.cachePath = arg + 8;
+        } else if (std::strncmp(arg, "--jobs=", 7) == 0) {
+            options.scan.jobs = static_cast<unsigned>(std::strtoul(arg + 7, nullptr, 10));
+        } else if (std::strncmp(arg, "-I", 2) == 0) {
+            const char* directory = value("-I");
+            if (!directory) {
+                return false;
+            }
+            options.scan.searchPaths.push_back(directory);
+        } else if (std::strncmp(arg, "-D", 2) == 0) {
+            const char* define = value("-D");
+            if (!define) {
+                return false;
+            }
+            std::string text = define;
+            size_t equals = text.find('=');
+            options.scan.defines.emplace_back(
+                text.substr(0, equals), equals == std::string::npos ? "1" : text.substr(equals + 1));
+        } else if (arg[0] == '-' && arg[1] != '\0') {
+            return false;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+    return !options.inputs.empty();
+}
+
+// Spaces and '$' are special in make; '#' starts a comment
+std::string makeEscape(const std::string& path) {
+    std::string escaped;
+    for (char c : path) {
+        if (c == ' ' || c == '#') {
+            escaped += '\\';
+        } else if (c == '$') {
+            escaped += '$';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+void printMake(const FileDependencies& result) {
+    std::string target = std::filesystem::path(result.file).replace_extension(".air").string();
+    std::string line = makeEscape(target) + ": " + makeEscape(result.file);
+    for (const std::string& dependency : result.dependencies) {
+        line += " \\\n  " + makeEscape(dependency);
+    }
+    std::printf("%s\n", line.c_str());
+}
+
+void printJson(const FileDependencies& result) {
+    std::string line;
+    JsonWriter writer(line);
+    writer.beginObject();
+    writer.key("file");
+    writer.string(result.file);
+    writer.key("dependencies");
+    writer.beginArray();
+    for (const std::string& dependency : result.dependencies) {
+        writer.string(dependency);
+    }
+    writer.endArray();
+    if (!result.errors.empty()) {
+        writer.key("errors");
+        writer.string(result.errors);
+    }
+    writer.endObject();
+    std::printf("%s\n", line.c_str());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    std::vector<std::string> files;
+    std::string error;
+    if (!expandInputs(options.inputs, files, error)) {
+        std::fprintf(stderr, "msl-deps: %s\n", error.c_str());
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<FileDependencies> results;
+    DependencyScanStats stats;
+    if (!scanDependencies(files, options.scan, results, error, &stats)) {
+        std::fprintf(stderr, "msl-deps: %s\n", error.c_str());
+    }
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int status = 0;
+    for (const FileDependencies& result : results) {
+        if (!result.readable) {
+            std::fprintf(stderr, "msl-deps: cannot read %s\n", result.file.c_str());
+            status = 1;
+            continue;
+        }
+        if (!result.errors.empty()) {
+            status = 1;
+            if (!options.json) {
+                std::fprintf(stderr, "%s", result.errors.c_str());
+            }
+        }
+        if (options.json) {
+            printJson(result);
+        } else {
+            printMake(result);
+        }
+    }
+    std::fprintf(stderr, "msl-deps: %zu files minimized, %zu from the cache in %.3fs\n",
+                 stats.minimized, stats.cached, seconds);
+    return status;
+}
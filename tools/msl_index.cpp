@@ -0,0 +1,185 @@
+// Builds and queries a persistent symbol index over many Metal files (see
+// symbol_index.h).
+//
+// Usage: msl-index --output=INDEX [--update] [--jobs=N] [-I DIR]
+//                  [-D NAME[=VALUE]] INPUT...
+//        msl-index --index=INDEX (--definition=NAME | --references=NAME |
+//                  --buffer=N | --texture=N | --sampler=N)
+//
+// Inputs are files, directories (every .metal file below them) and @FILE
+// response files. With --update, files unchanged since the existing index
+// at INDEX are not parsed again. Queries print one match per line as
+// "file:line:column: kind name", with the function of a binding and the
+// number of uses of a reference.
+//
+// Exits with 0 on success, 1 when a query finds nothing and 2 for invalid
+// arguments, inputs or index files.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "msl_parser/batch.h"
+#include "msl_parser/symbol_index.h"
+
+using namespace msl_parser;
+
+namespace {
+
+struct Options {
+    SymbolIndexOptions index;
+    std::string outputPath;
+    std::string indexPath;
+    bool update = false;
+    std::vector<std::string> inputs;
+    // The query
+    std::string name;
+    bool references = false;
+    SymbolKind bindingKind = SymbolKind::NAME;
+    uint32_t slot = 0;
+};
+
+void printUsage(const char* program) {
+    std::fprintf(stderr,
+                 "usage: %s --output=INDEX [--update] [--jobs=N] [-I DIR] [-D NAME[=VALUE]] "
+                 "INPUT...\n"
+                 "       %s --index=INDEX (--definition=NAME | --references=NAME |\n"
+                 "       --buffer=N | --texture=N | --sampler=N)\n",
+                 program, program);
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    int queries = 0;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        // The value of "-I DIR" or "-IDIR"; null when missing
+        auto value = [&](const char* flag) -> const char* {
+            size_t length = std::strlen(flag);
+            if (arg[length] != '\0') {
+                return arg + length;
+            }
+            return i + 1 < argc ? argv[++i] : nullptr;
+        };
+        auto binding = [&](SymbolKind kind, const char* slot) {
+            options.bindingKind = kind;
+            options.slot = static_cast<uint32_t>(std::strtoul(slot, nullptr, 10));
+            queries++;
+        };
+
+        if (std::strncmp(arg, "--output=", 9) == 0) {
+            options.outputPath = arg + 9;
+        } else if (std::strncmp(arg, "--index=", 8) == 0) {
+            options.indexPath = arg + 8;
+        } else if (std::strcmp(arg, "--update") == 0) {
+            options.update = true;
+        } else if (std::strncmp(arg, "--jobs=", 7) == 0) {
+            options.index.jobs = static_cast<unsigned>(std::strtoul(arg + 7, nullptr, 10));
+        } else if (std::strncmp(arg, "--definition=", 13) == 0) {
+            options.name = arg + 13;
+            queries++;
+        } else if (std::strncmp(arg, "--references=", 13) == 0) {
+            options.name = arg + 13;
+            options.references = true;
+            queries++;
+        } else if (std::strncmp(arg, "--buffer=", 9) == 0) {
+            binding(SymbolKind::BUFFER, arg + 9);
+        } else if (std::strncmp(arg, "--texture=", 10) == 0) {
+            binding(SymbolKind::TEXTURE, arg + 10);
+        } else if (std::strncmp(arg, "--sampler=", 10) == 0) {
+            binding(SymbolKind::SAMPLER, arg + 10);
+        } else if (std::strncmp(arg, "-I", 2) == 0) {
+            const char* directory = value("-I");
+            if (!directory) {
+                return false;
+            }
+            options.index.searchPaths.push_back(directory);
+        } else if (std::strncmp(arg, "-D", 2) == 0) {
+            const char* define = value("-D");
+            if (!define) {
+                return false;
+            }
+            std::string text = define;
+            size_t equals = text.find('=');
+            options.index.defines.emplace_back(
+                text.substr(0, equals), equals == std::string::npos ? "1" : text.substr(equals + 1));
+        } else if (arg[0] == '-' && arg[1] != '\0') {
+            return false;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+    if (!options.outputPath.empty()) {
+        return options.indexPath.empty() && queries == 0 && !options.inputs.empty();
+    }
+    return !options.indexPath.empty() && queries == 1 && options.inputs.empty();
+}
+
+int build(const Options& options) {
+    std::vector<std::string> files;
+    std::string error;
+    if (!expandInputs(options.inputs, files, error)) {
+        std::fprintf(stderr, "msl-index: %s\n", error.c_str());
+        return 2;
+    }
+    std::shared_ptr<const SymbolIndex> previous;
+    if (options.update) {
+        // A missing or outdated index just means a full build
+        previous = SymbolIndex::open(options.outputPath);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    SymbolIndex::BuildStats stats;
+    if (!SymbolIndex::build(files, options.outputPath, options.index, error, previous.get(),
+                            &stats)) {
+        std::fprintf(stderr, "msl-index: %s\n", error.c_str());
+        return 2;
+    }
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "msl-index: %zu files parsed, %zu unchanged, %zu unreadable in %.2fs\n",
+                 stats.indexed, stats.reused, stats.unreadable, seconds);
+    return 0;
+}
+
+int query(const Options& options) {
+    std::shared_ptr<const SymbolIndex> index = SymbolIndex::open(options.indexPath);
+    if (!index) {
+        std::fprintf(stderr, "msl-index: cannot open index %s\n", options.indexPath.c_str());
+        return 2;
+    }
+    std::vector<SymbolEntry> entries;
+    if (options.bindingKind != SymbolKind::NAME) {
+        entries = index->findBindings(options.bindingKind, options.slot);
+    } else if (options.references) {
+        entries = index->findReferences(options.name);
+    } else {
+        entries = index->findDefinitions(options.name);
+    }
+    for (const SymbolEntry& entry : entries) {
+        std::printf("%.*s:%u:%u: %s %.*s", static_cast<int>(entry.file.size()), entry.file.data(),
+                    entry.line, entry.column, symbolKindToString(entry.kind),
+                    static_cast<int>(entry.name.size()), entry.name.data());
+        if (entry.role == SymbolRole::BINDING) {
+            std::printf(" in %.*s", static_cast<int>(entry.context.size()), entry.context.data());
+        } else if (entry.role == SymbolRole::REFERENCE) {
+            std::printf(" (%u uses)", entry.value);
+        } else if (entry.role == SymbolRole::DECLARATION) {
+            std::printf(" (declaration)");
+        }
+        std::printf("\n");
+    }
+    return entries.empty() ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    return options.outputPath.empty() ? query(options) : build(options);
+}
@@ -0,0 +1,32 @@
+// Language server for Metal, speaking LSP over stdin and stdout.
+//
+// Usage: msl-lsp [--debounce=MS] [--no-typecheck]
+//
+// --debounce is how long a document must go unedited before diagnostics are
+// computed (default 150). --no-typecheck reports only lexer and parser
+// diagnostics.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "msl_parser/language_server.h"
+
+using namespace msl_parser;
+
+int main(int argc, char** argv) {
+    LanguageServerOptions options;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (std::strncmp(arg, "--debounce=", 11) == 0) {
+            options.debounce = std::chrono::milliseconds(std::strtol(arg + 11, nullptr, 10));
+        } else if (std::strcmp(arg, "--no-typecheck") == 0) {
+            options.typeCheck = false;
+        } else {
+            std::fprintf(stderr, "msl-lsp: unknown option '%s'\n", arg);
+            return 2;
+        }
+    }
+    std::ios::sync_with_stdio(false);
+    return LanguageServer::run(std::cin, std::cout, options);
+}
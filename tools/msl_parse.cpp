@@ -0,0 +1,269 @@
+// Parses many Metal files in one process and writes one line of JSON per
+// file (see batch.h for the format), in the order the files were given.
+//
+// Inputs are files, directories (every .metal file below them) and @FILE
+// response files. Files are processed in parallel, one per worker thread at
+// a time, while a FileReader (see file_reader.h) reads the next ones ahead:
+// through io_uring where available, or with --io=threads, a pool of pread
+// threads. Files identical to one already taken get its line instead of
+// being parsed again; how many is reported on stderr.
+//
+// Usage: msl-parse [--mode=tokens|ast|reflection] [--jobs=N] [--output=FILE]
+//                  [-I DIR] [-D NAME[=VALUE]] [--no-preprocess] [--typecheck]
+//                  [--io=auto|uring|threads] [--prelude=SNAPSHOT] INPUT...
+//        msl-parse --serve=SOCKET [--jobs=N] [-I DIR] [-D NAME[=VALUE]]
+//                  [--no-preprocess] [--prelude=SNAPSHOT]
+//        msl-parse --watch [--mode=tokens|ast|reflection] [--jobs=N] [-I DIR]
+//                  [-D NAME[=VALUE]] [--no-preprocess] [--typecheck]
+//                  [--prelude=SNAPSHOT] INPUT...
+//
+// --prelude starts every file from a prelude snapshot (see prelude.h).
+//
+// Exits with 0 when every file parsed without errors, 1 when some had
+// errors and 2 for invalid arguments or inputs.
+//
+// With --serve, runs as a daemon that answers requests on a Unix domain
+// socket (see server.h) until interrupted.
+//
+// With --watch, writes the lines of every file, then watches the inputs
+// (see watcher.h) and writes new lines for the files affected by each
+// change until interrupted. Deleted files get a line with "removed": true.
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "msl_parser/batch.h"
+#include "msl_parser/prelude.h"
+#include "msl_parser/server.h"
+#include "msl_parser/watcher.h"
+
+using namespace msl_parser;
+
+namespace {
+
+constexpr size_t OUTPUT_BUFFER_SIZE = 1 << 20;
+
+struct Options {
+    BatchOptions batch;
+    std::string outputPath;
+    std::string socketPath;
+    std::string preludePath;
+    bool watch = false;
+    std::vector<std::string> inputs;
+};
+
+ParseServer* runningServer = nullptr;
+ShaderWatcher* runningWatcher = nullptr;
+
+void stopServer(int) {
+    if (runningServer) {
+        runningServer->stop();
+    }
+    if (runningWatcher) {
+        runningWatcher->stop();
+    }
+}
+
+void printUsage(const char* program) {
+    std::fprintf(stderr,
+                 "usage: %s [--mode=tokens|ast|reflection] [--jobs=N] [--output=FILE]\n"
+                 "       [-I DIR] [-D NAME[=VALUE]] [--no-preprocess] [--typecheck]\n"
+                 "       [--io=auto|uring|threads] [--prelude=SNAPSHOT] INPUT...\n"
+                 "       %s --serve=SOCKET [--jobs=N] [-I DIR] [-D NAME[=VALUE]]\n"
+                 "       [--no-preprocess] [--prelude=SNAPSHOT]\n"
+                 "       %s --watch [--mode=tokens|ast|reflection] [--jobs=N] [-I DIR]\n"
+                 "       [-D NAME[=VALUE]] [--no-preprocess] [--typecheck]\n"
+                 "       [--prelude=SNAPSHOT] INPUT...\n",
+                 program, program, program);
+}
+
+void addDefine(const std::string& text, BatchOptions& options) {
+    size_t equals = text.find('=');
+    if (equals == std::string::npos) {
+        options.defines.emplace_back(text, "1");
+    } else {
+        options.defines.emplace_back(text.substr(0, equals), text.substr(equals + 1));
+    }
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        // The value of "-I DIR" or "-IDIR"; null when missing
+        auto value = [&](const char* flag) -> const char* {
+            size_t length = std::strlen(flag);
+            if (arg[length] != '\0') {
+                return arg + length;
+            }
+            return i + 1 < argc ? argv[++i] : nullptr;
+        };
+
+        if (std::strcmp(arg, "--mode=tokens") == 0) {
+            options.batch.mode = BatchMode::TOKENS;
+        } else if (std::strcmp(arg, "--mode=ast") == 0) {
+            options.batch.mode = BatchMode::AST;
+        } else if (std::strcmp(arg, "--mode=reflection") == 0) {
+            options.batch.mode = BatchMode::REFLECTION;
+        } else if (std::strncmp(arg, "--jobs=", 7) == 0) {
+            options.batch.jobs = static_cast<unsigned>(std::strtoul(arg + 7, nullptr, 10));
+        } else if (std::strncmp(arg, "--serve=", 8) == 0) {
+            options.socketPath = arg + 8;
+        } else if (std::strcmp(arg, "--watch") == 0) {
+            options.watch = true;
+        } else if (std::strncmp(arg, "--output=", 9) == 0) {
+            options.outputPath = arg + 9;
+        } else if (std::strncmp(arg, "-I", 2) == 0) {
+            const char* directory = value("-I");
+            if (!directory) {
+                return false;
+            }
+            options.batch.searchPaths.push_back(directory);
+        } else if (std::strncmp(arg, "-D", 2) == 0) {
+            const char* define = value("-D");
+            if (!define) {
+                return false;
+            }
+            addDefine(define, options.batch);
+        } else if (std::strcmp(arg, "--no-preprocess") == 0) {
+            options.batch.preprocess = false;
+        } else if (std::strcmp(arg, "--typecheck") == 0) {
+            options.batch.typeCheck = true;
+        } else if (std::strcmp(arg, "--io=auto") == 0) {
+            options.batch.io = FileIo::AUTO;
+        } else if (std::strcmp(arg, "--io=uring") == 0) {
+            options.batch.io = FileIo::IO_URING;
+        } else if (std::strcmp(arg, "--io=threads") == 0) {
+            options.batch.io = FileIo::THREADS;
+        } else if (std::strncmp(arg, "--prelude=", 10) == 0) {
+            options.preludePath = arg + 10;
+        } else if (arg[0] == '-' && arg[1] != '\0') {
+            return false;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+    if (options.watch && (!options.socketPath.empty() || !options.outputPath.empty())) {
+        return false;
+    }
+    return options.socketPath.empty() != options.inputs.empty();
+}
+
+int serve(const Options& options) {
+    ServerOptions serverOptions;
+    serverOptions.batch = options.batch;
+    serverOptions.threads = options.batch.jobs;
+    ParseServer server(serverOptions);
+    std::string error;
+    if (!server.listen(options.socketPath, error)) {
+        std::fprintf(stderr, "msl-parse: %s\n", error.c_str());
+        return 2;
+    }
+    runningServer = &server;
+    std::signal(SIGINT, stopServer);
+    std::signal(SIGTERM, stopServer);
+    server.serve();
+    runningServer = nullptr;
+    return 0;
+}
+
+int watch(const Options& options) {
+    WatchOptions watchOptions;
+    watchOptions.batch = options.batch;
+    ShaderWatcher watcher(watchOptions);
+    std::string out;
+    std::string error;
+    if (!watcher.start(options.inputs, out, error)) {
+        std::fprintf(stderr, "msl-parse: %s\n", error.c_str());
+        return 2;
+    }
+    std::fwrite(out.data(), 1, out.size(), stdout);
+    std::fflush(stdout);
+    if (!watcher.isWatching()) {
+        std::fprintf(stderr, "msl-parse: file watching is not supported on this platform\n");
+        return 2;
+    }
+    std::fprintf(stderr, "msl-parse: watching %zu files\n", watcher.getFileCount());
+
+    runningWatcher = &watcher;
+    std::signal(SIGINT, stopServer);
+    std::signal(SIGTERM, stopServer);
+    out.clear();
+    while (watcher.wait(std::chrono::milliseconds(1000), out)) {
+        if (!out.empty()) {
+            std::fwrite(out.data(), 1, out.size(), stdout);
+            std::fflush(stdout);
+            out.clear();
+        }
+    }
+    runningWatcher = nullptr;
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    if (!options.preludePath.empty()) {
+        options.batch.prelude = PreludeSnapshot::open(options.preludePath);
+        if (!options.batch.prelude) {
+            std::fprintf(stderr, "msl-parse: cannot use prelude snapshot %s\n",
+                         options.preludePath.c_str());
+            return 2;
+        }
+    }
+    if (!options.socketPath.empty()) {
+        return serve(options);
+    }
+    if (options.watch) {
+        return watch(options);
+    }
+
+    std::vector<std::string> files;
+    std::string error;
+    if (!expandInputs(options.inputs, files, error)) {
+        std::fprintf(stderr, "msl-parse: %s\n", error.c_str());
+        return 2;
+    }
+
+    // Lines are written whole, so a large buffer keeps the writes few
+    std::vector<char> buffer(OUTPUT_BUFFER_SIZE);
+    std::ofstream file;
+    std::ostream* out = &std::cout;
+    if (!options.outputPath.empty()) {
+        file.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        file.open(options.outputPath, std::ios::binary);
+        if (!file) {
+            std::fprintf(stderr, "msl-parse: cannot write %s\n", options.outputPath.c_str());
+            return 2;
+        }
+        out = &file;
+    } else {
+        std::ios::sync_with_stdio(false);
+    }
+
+    BatchProcessor processor(options.batch);
+    BatchStats stats;
+    size_t failures = processor.run(files, *out, &stats);
+    out->flush();
+    if (!*out) {
+        std::fprintf(stderr, "msl-parse: error writing output\n");
+        return 2;
+    }
+    if (stats.duplicates > 0) {
+        std::fprintf(stderr,
+                     "msl-parse: %zu files processed, %zu identical to another (%zu bytes) "
+                     "not processed again\n",
+                     stats.processed, stats.duplicates, stats.duplicateBytes);
+    }
+    return failures ? 1 : 0;
+}
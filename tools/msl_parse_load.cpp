@@ -0,0 +1,198 @@
+// Load test for the parse daemon (msl-parse --serve). Each connection runs
+// on its own thread and keeps up to --pipeline requests in flight, cycling
+// through the input files; the latency of every request, from sending it
+// to receiving its response, is reported as percentiles.
+//
+// Usage: msl-parse-load --socket=PATH [--connections=N] [--requests=N]
+//                       [--pipeline=N] [--mode=tokens|ast|reflection]
+//                       [--read-file] INPUT...
+//
+// --requests is the total over all connections. With --read-file only the
+// paths are sent and the server reads the files itself.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "msl_parser/batch.h"
+#include "msl_parser/server.h"
+
+using namespace msl_parser;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string socketPath;
+    size_t connections = 4;
+    size_t requests = 1000;
+    size_t pipeline = 8;
+    BatchMode mode = BatchMode::AST;
+    bool readFile = false;
+    std::vector<std::string> inputs;
+};
+
+struct Input {
+    std::string path;
+    std::string source;
+};
+
+struct ConnectionResult {
+    std::vector<double> latencies; // milliseconds
+    size_t failures = 0;
+    std::string error;
+};
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (std::strncmp(arg, "--socket=", 9) == 0) {
+            options.socketPath = arg + 9;
+        } else if (std::strncmp(arg, "--connections=", 14) == 0) {
+            options.connections = std::strtoul(arg + 14, nullptr, 10);
+        } else if (std::strncmp(arg, "--requests=", 11) == 0) {
+            options.requests = std::strtoul(arg + 11, nullptr, 10);
+        } else if (std::strncmp(arg, "--pipeline=", 11) == 0) {
+            options.pipeline = std::strtoul(arg + 11, nullptr, 10);
+        } else if (std::strcmp(arg, "--mode=tokens") == 0) {
+            options.mode = BatchMode::TOKENS;
+        } else if (std::strcmp(arg, "--mode=ast") == 0) {
+            options.mode = BatchMode::AST;
+        } else if (std::strcmp(arg, "--mode=reflection") == 0) {
+            options.mode = BatchMode::REFLECTION;
+        } else if (std::strcmp(arg, "--read-file") == 0) {
+            options.readFile = true;
+        } else if (arg[0] == '-') {
+            return false;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+    return !options.socketPath.empty() && !options.inputs.empty() && options.connections > 0 &&
+           options.pipeline > 0;
+}
+
+void runConnection(const Options& options, const std::vector<Input>& inputs, size_t first,
+                   size_t count, ConnectionResult& result) {
+    ParseClient client;
+    if (!client.connect(options.socketPath, result.error)) {
+        return;
+    }
+    // Send times by request ID
+    std::vector<Clock::time_point> sent(count + 1);
+    size_t sentCount = 0;
+    size_t received = 0;
+    while (received < count) {
+        while (sentCount < count && sentCount - received < options.pipeline) {
+            const Input& input = inputs[(first + sentCount) % inputs.size()];
+            ParseRequest request;
+            request.id = static_cast<uint32_t>(sentCount + 1);
+            request.mode = options.mode;
+            request.path = input.path;
+            if (options.readFile) {
+                request.flags = protocol::READ_FILE;
+            } else {
+                request.source = input.source;
+            }
+            sent[request.id] = Clock::now();
+            if (!client.send(std::move(request))) {
+                result.error = "connection closed";
+                return;
+            }
+            sentCount++;
+        }
+        ParseResponse response;
+        if (!client.receive(response) || response.id == 0 || response.id > count) {
+            result.error = "connection closed";
+            return;
+        }
+        std::chrono::duration<double, std::milli> latency = Clock::now() - sent[response.id];
+        result.latencies.push_back(latency.count());
+        if (response.status == ResponseStatus::BAD_REQUEST) {
+            result.failures++;
+        }
+        received++;
+    }
+}
+
+double percentile(const std::vector<double>& sorted, double fraction) {
+    size_t index = static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr,
+                     "usage: %s --socket=PATH [--connections=N] [--requests=N] [--pipeline=N]\n"
+                     "       [--mode=tokens|ast|reflection] [--read-file] INPUT...\n",
+                     argv[0]);
+        return 2;
+    }
+
+    std::vector<std::string> files;
+    std::string error;
+    if (!expandInputs(options.inputs, files, error) || files.empty()) {
+        std::fprintf(stderr, "msl-parse-load: %s\n", error.empty() ? "no inputs" : error.c_str());
+        return 2;
+    }
+    std::vector<Input> inputs;
+    for (const std::string& file : files) {
+        std::ifstream in(file, std::ios::binary);
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        inputs.push_back({file, buffer.str()});
+    }
+
+    std::vector<ConnectionResult> results(options.connections);
+    std::vector<std::thread> threads;
+    Clock::time_point start = Clock::now();
+    size_t first = 0;
+    for (size_t i = 0; i < options.connections; i++) {
+        // Spread the remainder over the first connections
+        size_t count = options.requests / options.connections +
+                       (i < options.requests % options.connections ? 1 : 0);
+        threads.emplace_back(runConnection, std::cref(options), std::cref(inputs), first, count,
+                             std::ref(results[i]));
+        first += count;
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> seconds = Clock::now() - start;
+
+    std::vector<double> latencies;
+    size_t failures = 0;
+    for (const ConnectionResult& result : results) {
+        if (!result.error.empty()) {
+            std::fprintf(stderr, "msl-parse-load: %s\n", result.error.c_str());
+            return 1;
+        }
+        latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+        failures += result.failures;
+    }
+    if (latencies.empty()) {
+        return 0;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    std::printf("%zu requests over %zu connections (pipeline %zu) in %.3f s: %.0f requests/s\n",
+                latencies.size(), options.connections, options.pipeline, seconds.count(),
+                static_cast<double>(latencies.size()) / seconds.count());
+    std::printf("latency ms: p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+                percentile(latencies, 0.5), percentile(latencies, 0.9),
+                percentile(latencies, 0.99), latencies.back());
+    if (failures) {
+        std::printf("%zu bad requests\n", failures);
+        return 1;
+    }
+    return 0;
+}